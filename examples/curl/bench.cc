@@ -0,0 +1,93 @@
+#include <examples/curl/Curl.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Same as muduo/net/http/tests/HttpClient_bench.cc, with libcurl.
+// Run that one without a url to get a server on port 18005.
+
+class Bench
+{
+ public:
+  Bench(EventLoop* loop, const char* url, int requests)
+    : loop_(loop),
+      curl_(loop),
+      url_(url),
+      remaining_(requests),
+      outstanding_(0),
+      failures_(0)
+  {
+  }
+
+  void start(int concurrency)
+  {
+    for (int i = 0; i < concurrency && remaining_ > 0; ++i)
+    {
+      send();
+    }
+  }
+
+  int failures() const { return failures_; }
+
+ private:
+  void send()
+  {
+    --remaining_;
+    ++outstanding_;
+    curl::RequestPtr req = curl_.getUrl(url_);
+    req->setDataCallback(boost::bind(&Bench::onData, this, _1, _2));
+    req->setDoneCallback(boost::bind(&Bench::onDone, this, _1, _2));
+  }
+
+  void onData(const char*, int)
+  {
+  }
+
+  void onDone(curl::Request* req, int code)
+  {
+    --outstanding_;
+    if (code != 0 || req->getResponseCode() != 200)
+    {
+      ++failures_;
+    }
+    if (remaining_ > 0)
+    {
+      send();
+    }
+    else if (outstanding_ == 0)
+    {
+      loop_->quit();
+    }
+  }
+
+  EventLoop* loop_;
+  curl::Curl curl_;
+  const char* url_;
+  int remaining_;
+  int outstanding_;
+  int failures_;
+};
+
+int main(int argc, char* argv[])
+{
+  const char* url = argc > 1 ? argv[1] : "http://127.0.0.1:18005/hello";
+  int requests = argc > 2 ? atoi(argv[2]) : 100000;
+  int concurrency = argc > 3 ? atoi(argv[3]) : 8;
+
+  curl::Curl::initialize(curl::Curl::kCURLnossl);
+  EventLoop loop;
+  Bench bench(&loop, url, requests);
+  Timestamp start(Timestamp::now());
+  bench.start(concurrency);
+  loop.loop();
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("%d requests, concurrency %d: %.3f seconds, %.0f req/s, %d failures\n",
+         requests, concurrency, seconds, requests / seconds, bench.failures());
+}
@@ -33,6 +33,8 @@ class QueryClient : boost::noncopyable
         boost::bind(&QueryClient::onAnswer, this, _1, _2, _3));
     dispatcher_.registerMessageCallback<muduo::Empty>(
         boost::bind(&QueryClient::onEmpty, this, _1, _2, _3));
+    codec_.setMessageFactory(
+        boost::bind(&ProtobufDispatcher::newMessage, &dispatcher_, _1));
     client_.setConnectionCallback(
         boost::bind(&QueryClient::onConnection, this, _1));
     client_.setMessageCallback(
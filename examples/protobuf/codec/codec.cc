@@ -127,7 +127,7 @@ void ProtobufCodec::onMessage(const TcpConnectionPtr& conn,
     else if (buf->readableBytes() >= implicit_cast<size_t>(len + kHeaderLen))
     {
       ErrorCode errorCode = kNoError;
-      MessagePtr message = parse(buf->peek()+kHeaderLen, len, &errorCode);
+      MessagePtr message = parse(buf->peek()+kHeaderLen, len, factory_, &errorCode);
       if (errorCode == kNoError && message)
       {
         messageCallback_(conn, message, receiveTime);
@@ -164,6 +164,13 @@ google::protobuf::Message* ProtobufCodec::createMessage(const std::string& typeN
 }
 
 MessagePtr ProtobufCodec::parse(const char* buf, int len, ErrorCode* error)
+{
+  return parse(buf, len, MessageFactory(), error);
+}
+
+MessagePtr ProtobufCodec::parse(const char* buf, int len,
+                                const MessageFactory& factory,
+                                ErrorCode* error)
 {
   MessagePtr message;
 
@@ -179,9 +186,16 @@ MessagePtr ProtobufCodec::parse(const char* buf, int len, ErrorCode* error)
     int32_t nameLen = asInt32(buf);
     if (nameLen >= 2 && nameLen <= len - 2*kHeaderLen)
     {
-      std::string typeName(buf + kHeaderLen, buf + kHeaderLen + nameLen - 1);
+      StringPiece typeName(buf + kHeaderLen, nameLen - 1);
       // create message object
-      message.reset(createMessage(typeName));
+      if (factory)
+      {
+        message = factory(typeName);
+      }
+      if (!message)
+      {
+        message.reset(createMessage(std::string(typeName.data(), typeName.size())));
+      }
       if (message)
       {
         // parse from buffer
@@ -9,6 +9,7 @@
 #ifndef MUDUO_EXAMPLES_PROTOBUF_CODEC_CODEC_H
 #define MUDUO_EXAMPLES_PROTOBUF_CODEC_CODEC_H
 
+#include <muduo/base/StringPiece.h>
 #include <muduo/net/Buffer.h>
 #include <muduo/net/TcpConnection.h>
 
@@ -55,6 +56,9 @@ class ProtobufCodec : boost::noncopyable
                                 muduo::Timestamp,
                                 ErrorCode)> ErrorCallback;
 
+  // a new or reused message of typeName, NULL to fall back to createMessage()
+  typedef boost::function<MessagePtr (muduo::StringPiece typeName)> MessageFactory;
+
   explicit ProtobufCodec(const ProtobufMessageCallback& messageCb)
     : messageCallback_(messageCb),
       errorCallback_(defaultErrorCallback)
@@ -67,6 +71,11 @@ class ProtobufCodec : boost::noncopyable
   {
   }
 
+  /// eg. ProtobufDispatcher::newMessage, which avoids the look up of the
+  /// type name in the descriptor pool and the allocation of each message.
+  void setMessageFactory(const MessageFactory& factory)
+  { factory_ = factory; }
+
   void onMessage(const muduo::net::TcpConnectionPtr& conn,
                  muduo::net::Buffer* buf,
                  muduo::Timestamp receiveTime);
@@ -84,6 +93,9 @@ class ProtobufCodec : boost::noncopyable
   static void fillEmptyBuffer(muduo::net::Buffer* buf, const google::protobuf::Message& message);
   static google::protobuf::Message* createMessage(const std::string& type_name);
   static MessagePtr parse(const char* buf, int len, ErrorCode* errorCode);
+  static MessagePtr parse(const char* buf, int len,
+                          const MessageFactory& factory,
+                          ErrorCode* errorCode);
 
  private:
   static void defaultErrorCallback(const muduo::net::TcpConnectionPtr&,
@@ -93,6 +105,7 @@ class ProtobufCodec : boost::noncopyable
 
   ProtobufMessageCallback messageCallback_;
   ErrorCallback errorCallback_;
+  MessageFactory factory_;
 
   const static int kHeaderLen = sizeof(int32_t);
   const static int kMinMessageLen = 2*kHeaderLen + 2; // nameLen + typeName + checkSum
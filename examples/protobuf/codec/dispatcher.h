@@ -9,12 +9,17 @@
 #ifndef MUDUO_EXAMPLES_PROTOBUF_CODEC_DISPATCHER_H
 #define MUDUO_EXAMPLES_PROTOBUF_CODEC_DISPATCHER_H
 
+#include <muduo/base/Mutex.h>
+#include <muduo/base/StringPiece.h>
 #include <muduo/net/Callbacks.h>
 
+#include <google/protobuf/descriptor.h>
 #include <google/protobuf/message.h>
 
-#include <map>
+#include <vector>
 
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
@@ -26,6 +31,67 @@
 
 typedef boost::shared_ptr<google::protobuf::Message> MessagePtr;
 
+// Messages of type T cleared for reuse, so that parsing into one reuses the
+// memory of its strings and repeated fields. Given out as shared_ptr, which
+// bring them back when the last copy is gone, in any thread.
+template <typename T>
+class MessagePool : boost::noncopyable,
+                    public boost::enable_shared_from_this<MessagePool<T> >
+{
+ public:
+  explicit MessagePool(size_t maxIdle)
+    : maxIdle_(maxIdle)
+  {
+  }
+
+  ~MessagePool()
+  {
+    for (size_t i = 0; i < idle_.size(); ++i)
+    {
+      delete idle_[i];
+    }
+  }
+
+  boost::shared_ptr<T> get()
+  {
+    T* message = NULL;
+    {
+      muduo::MutexLockGuard lock(mutex_);
+      if (!idle_.empty())
+      {
+        message = idle_.back();
+        idle_.pop_back();
+      }
+    }
+    if (message == NULL)
+    {
+      message = new T;
+    }
+    // the deleter keeps the pool alive
+    return boost::shared_ptr<T>(message,
+                                boost::bind(&MessagePool::recycle, this->shared_from_this(), _1));
+  }
+
+ private:
+  void recycle(T* message)
+  {
+    message->Clear();
+    {
+      muduo::MutexLockGuard lock(mutex_);
+      if (idle_.size() < maxIdle_)
+      {
+        idle_.push_back(message);
+        return;
+      }
+    }
+    delete message;
+  }
+
+  const size_t maxIdle_;
+  muduo::MutexLock mutex_;
+  std::vector<T*> idle_;
+};
+
 class Callback : boost::noncopyable
 {
  public:
@@ -33,6 +99,7 @@ class Callback : boost::noncopyable
   virtual void onMessage(const muduo::net::TcpConnectionPtr&,
                          const MessagePtr& message,
                          muduo::Timestamp) const = 0;
+  virtual MessagePtr newMessage() const = 0;
 };
 
 template <typename T>
@@ -46,9 +113,13 @@ class CallbackT : public Callback
                                 const boost::shared_ptr<T>& message,
                                 muduo::Timestamp)> ProtobufMessageTCallback;
 
-  CallbackT(const ProtobufMessageTCallback& callback)
+  CallbackT(const ProtobufMessageTCallback& callback, size_t poolSize)
     : callback_(callback)
   {
+    if (poolSize > 0)
+    {
+      pool_.reset(new MessagePool<T>(poolSize));
+    }
   }
 
   virtual void onMessage(const muduo::net::TcpConnectionPtr& conn,
@@ -60,8 +131,14 @@ class CallbackT : public Callback
     callback_(conn, concrete, receiveTime);
   }
 
+  virtual MessagePtr newMessage() const
+  {
+    return pool_ ? MessagePtr(pool_->get()) : MessagePtr(new T);
+  }
+
  private:
   ProtobufMessageTCallback callback_;
+  boost::shared_ptr<MessagePool<T> > pool_;
 };
 
 class ProtobufDispatcher
@@ -74,16 +151,17 @@ class ProtobufDispatcher
   explicit ProtobufDispatcher(const ProtobufMessageCallback& defaultCb)
     : defaultCallback_(defaultCb)
   {
+    rehash();  // find() needs a table before any registration
   }
 
   void onProtobufMessage(const muduo::net::TcpConnectionPtr& conn,
                          const MessagePtr& message,
                          muduo::Timestamp receiveTime) const
   {
-    CallbackMap::const_iterator it = callbacks_.find(message->GetDescriptor());
-    if (it != callbacks_.end())
+    const Entry* entry = find(message->GetDescriptor());
+    if (entry)
     {
-      it->second->onMessage(conn, message, receiveTime);
+      entry->callback->onMessage(conn, message, receiveTime);
     }
     else
     {
@@ -91,17 +169,121 @@ class ProtobufDispatcher
     }
   }
 
+  /// A message of a registered type, from its pool, NULL for other types.
+  /// For ProtobufCodec::setMessageFactory().
+  MessagePtr newMessage(muduo::StringPiece typeName) const
+  {
+    const Entry* entry = find(typeName);
+    return entry ? entry->callback->newMessage() : MessagePtr();
+  }
+
+  /// Up to poolSize messages of T are kept for reuse by newMessage(),
+  /// 0 for none. Not thread safe, register before receiving messages.
   template<typename T>
-  void registerMessageCallback(const typename CallbackT<T>::ProtobufMessageTCallback& callback)
+  void registerMessageCallback(const typename CallbackT<T>::ProtobufMessageTCallback& callback,
+                               size_t poolSize = kDefaultPoolSize)
   {
-    boost::shared_ptr<CallbackT<T> > pd(new CallbackT<T>(callback));
-    callbacks_[T::descriptor()] = pd;
+    Entry entry;
+    entry.descriptor = T::descriptor();
+    entry.callback.reset(new CallbackT<T>(callback, poolSize));
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+      if (entries_[i].descriptor == entry.descriptor)
+      {
+        entries_[i] = entry;
+        return;
+      }
+    }
+    entries_.push_back(entry);
+    rehash();
   }
 
+  static const size_t kDefaultPoolSize = 16;
+
  private:
-  typedef std::map<const google::protobuf::Descriptor*, boost::shared_ptr<Callback> > CallbackMap;
+  struct Entry
+  {
+    const google::protobuf::Descriptor* descriptor;
+    boost::shared_ptr<Callback> callback;
+  };
+
+  // Open addressing with linear probing, at most half full, rebuilt on
+  // registration. Indices into entries_, -1 for empty.
+  void rehash()
+  {
+    size_t size = 4;
+    while (size < entries_.size() * 2)
+    {
+      size *= 2;
+    }
+    byName_.assign(size, -1);
+    byDescriptor_.assign(size, -1);
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+      const google::protobuf::Descriptor* descriptor = entries_[i].descriptor;
+      size_t j = hash(descriptor->full_name()) & (size - 1);
+      while (byName_[j] >= 0)
+      {
+        j = (j + 1) & (size - 1);
+      }
+      byName_[j] = static_cast<int>(i);
+
+      j = hash(descriptor) & (size - 1);
+      while (byDescriptor_[j] >= 0)
+      {
+        j = (j + 1) & (size - 1);
+      }
+      byDescriptor_[j] = static_cast<int>(i);
+    }
+  }
+
+  const Entry* find(muduo::StringPiece name) const
+  {
+    const size_t mask = byName_.size() - 1;
+    for (size_t j = hash(name) & mask; byName_[j] >= 0; j = (j + 1) & mask)
+    {
+      const Entry& entry = entries_[byName_[j]];
+      if (name == entry.descriptor->full_name())
+      {
+        return &entry;
+      }
+    }
+    return NULL;
+  }
+
+  const Entry* find(const google::protobuf::Descriptor* descriptor) const
+  {
+    const size_t mask = byDescriptor_.size() - 1;
+    for (size_t j = hash(descriptor) & mask; byDescriptor_[j] >= 0; j = (j + 1) & mask)
+    {
+      const Entry& entry = entries_[byDescriptor_[j]];
+      if (entry.descriptor == descriptor)
+      {
+        return &entry;
+      }
+    }
+    return NULL;
+  }
+
+  // FNV-1a
+  static size_t hash(muduo::StringPiece name)
+  {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < name.size(); ++i)
+    {
+      h = (h ^ static_cast<uint8_t>(name[i])) * 16777619u;
+    }
+    return h;
+  }
+
+  static size_t hash(const google::protobuf::Descriptor* descriptor)
+  {
+    return (reinterpret_cast<uintptr_t>(descriptor) >> 4) * 2654435761u;
+  }
 
-  CallbackMap callbacks_;
+  std::vector<Entry> entries_;
+  std::vector<int> byName_;
+  std::vector<int> byDescriptor_;
   ProtobufMessageCallback defaultCallback_;
 };
 #endif  // MUDUO_EXAMPLES_PROTOBUF_CODEC_DISPATCHER_H
@@ -42,14 +42,43 @@ void onUnknownMessageType(const muduo::net::TcpConnectionPtr&,
   cout << "onUnknownMessageType: " << message->GetTypeName() << endl;
 }
 
+void test_newMessage(const ProtobufDispatcher& dispatcher)
+{
+  MessagePtr msg = dispatcher.newMessage("muduo.Query");
+  assert(msg && msg->GetDescriptor() == muduo::Query::descriptor());
+  assert(dispatcher.newMessage("muduo.Answer"));
+  assert(!dispatcher.newMessage("muduo.Empty"));
+  assert(!dispatcher.newMessage("muduo.Quer"));
+
+  // released messages are cleared and reused
+  QueryPtr query(muduo::down_pointer_cast<muduo::Query>(msg));
+  query->set_questioner("Chen Shuo");
+  const google::protobuf::Message* reused = msg.get();
+  msg.reset();
+  query.reset();
+  msg = dispatcher.newMessage("muduo.Query");
+  assert(msg.get() == reused); (void)reused;
+  assert(muduo::down_pointer_cast<muduo::Query>(msg)->questioner().empty());
+}
+
 int main()
 {
   GOOGLE_PROTOBUF_VERIFY_VERSION;
   test_down_pointer_cast();
 
+  {
+    // nothing registered yet
+    ProtobufDispatcher fresh(onUnknownMessageType);
+    assert(!fresh.newMessage("muduo.Query"));
+    fresh.onProtobufMessage(muduo::net::TcpConnectionPtr(),
+                            MessagePtr(new muduo::Query),
+                            muduo::Timestamp());
+  }
+
   ProtobufDispatcher dispatcher(onUnknownMessageType);
   dispatcher.registerMessageCallback<muduo::Query>(onQuery);
   dispatcher.registerMessageCallback<muduo::Answer>(onAnswer);
+  test_newMessage(dispatcher);
 
   muduo::net::TcpConnectionPtr conn;
   muduo::Timestamp t;
@@ -30,6 +30,8 @@ class QueryServer : boost::noncopyable
         boost::bind(&QueryServer::onQuery, this, _1, _2, _3));
     dispatcher_.registerMessageCallback<muduo::Answer>(
         boost::bind(&QueryServer::onAnswer, this, _1, _2, _3));
+    codec_.setMessageFactory(
+        boost::bind(&ProtobufDispatcher::newMessage, &dispatcher_, _1));
     server_.setConnectionCallback(
         boost::bind(&QueryServer::onConnection, this, _1));
     server_.setMessageCallback(
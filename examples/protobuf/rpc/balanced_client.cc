@@ -0,0 +1,97 @@
+#include <examples/protobuf/rpc/sudoku.pb.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/protorpc/BalancedRpcChannel.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Solves through several sudoku servers, each call goes to the one with
+// the fewest calls outstanding.
+class BalancedClient : boost::noncopyable
+{
+ public:
+  BalancedClient(EventLoop* loop, const std::vector<InetAddress>& servers, int calls)
+    : loop_(loop),
+      channel_(loop, servers, "BalancedClient"),
+      stub_(&channel_),
+      calls_(calls),
+      finished_(0)
+  {
+    channel_.setCallTimeout(5.0);
+    channel_.setOutlierEjection(3.0, 30.0);
+  }
+
+  void start()
+  {
+    channel_.connect();
+    // Connector backs off from 0.5s
+    loop_->runAfter(1.0, boost::bind(&BalancedClient::solve, this));
+  }
+
+ private:
+  void solve()
+  {
+    sudoku::SudokuRequest request;
+    request.set_checkerboard("001010");
+    for (int i = 0; i < calls_; ++i)
+    {
+      RpcController* controller = new RpcController;
+      sudoku::SudokuResponse* response = new sudoku::SudokuResponse;
+      stub_.Solve(controller, &request, response,
+                  NewCallback(this, &BalancedClient::solved, controller, response));
+    }
+  }
+
+  void solved(RpcController* controller, sudoku::SudokuResponse* resp)
+  {
+    if (controller->Failed())
+    {
+      LOG_ERROR << "failed: " << controller->ErrorText();
+    }
+    else
+    {
+      LOG_DEBUG << "solved: " << resp->checkerboard();
+    }
+    delete controller;
+    if (++finished_ == calls_)
+    {
+      printf("%s", channel_.report().c_str());
+      loop_->quit();
+    }
+  }
+
+  EventLoop* loop_;
+  BalancedRpcChannel channel_;
+  sudoku::SudokuService::Stub stub_;
+  const int calls_;
+  int finished_;  // in loop
+};
+
+int main(int argc, char* argv[])
+{
+  LOG_INFO << "pid = " << getpid();
+  if (argc > 1)
+  {
+    std::vector<InetAddress> servers;
+    for (int i = 1; i < argc; ++i)
+    {
+      servers.push_back(InetAddress(argv[i], 9981));
+    }
+    EventLoop loop;
+    BalancedClient client(&loop, servers, 1000);
+    client.start();
+    loop.loop();
+  }
+  else
+  {
+    printf("Usage: %s host_ip [host_ip]...\n", argv[0]);
+  }
+  google::protobuf::ShutdownProtobufLibrary();
+}
@@ -27,6 +27,8 @@ class RpcClient : boost::noncopyable
         boost::bind(&RpcClient::onConnection, this, _1));
     client_.setMessageCallback(
         boost::bind(&RpcChannel::onMessage, get_pointer(channel_), _1, _2, _3));
+    // fail rather than wait forever for a server which never answers
+    channel_->setCallTimeout(5.0);
     // client_.enableRetry();
   }
 
@@ -1,11 +1,16 @@
 #include <examples/protobuf/rpc/sudoku.pb.h>
 
 #include <muduo/base/Logging.h>
+#include <muduo/base/ThreadPool.h>
 #include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+#include <muduo/net/inspect/Inspector.h>
 #include <muduo/net/protorpc/RpcServer.h>
 
 #include <boost/bind.hpp>
 
+#include <stdlib.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -29,14 +34,30 @@ class SudokuServiceImpl : public SudokuService
 
 }
 
-int main()
+int main(int argc, char* argv[])
 {
   LOG_INFO << "pid = " << getpid();
+  int numThreads = argc > 1 ? atoi(argv[1]) : 0;
   EventLoop loop;
   InetAddress listenAddr(9981);
   sudoku::SudokuServiceImpl impl;
   RpcServer server(&loop, listenAddr);
   server.registerService(&impl);
+
+  // solving is CPU bound, keep it off the IO thread
+  ThreadPool pool("SudokuSolver");
+  if (numThreads > 0)
+  {
+    pool.setMaxQueueSize(numThreads * 100);
+    pool.start(numThreads);
+    server.setMethodOptions("sudoku.SudokuService.Solve", &pool, numThreads * 2, 1000);
+  }
+
+  EventLoopThread inspectThread;
+  Inspector inspector(inspectThread.startLoop(), InetAddress(9982), "sudoku-rpc");
+  inspector.add("rpc", "methods", boost::bind(&RpcServer::methodStats, &server),
+                "calls and latency of each method");
+
   server.start();
   loop.loop();
   google::protobuf::ShutdownProtobufLibrary();
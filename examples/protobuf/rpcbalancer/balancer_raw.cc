@@ -21,7 +21,7 @@ using namespace muduo::net;
 struct RawMessage
 {
   RawMessage(StringPiece m)
-    : message_(m), id_(0), loc_(NULL)
+    : message_(m), id_(0), loc_(NULL), checksumType_(ProtobufCodecLite::kAdler32)
   { }
 
   uint64_t id() const { return id_; }
@@ -32,8 +32,9 @@ struct RawMessage
     const char* const body = message_.data() + ProtobufCodecLite::kHeaderLen;
     const int bodylen = message_.size() - ProtobufCodecLite::kHeaderLen;
     const int taglen = static_cast<int>(tag.size());
-    if (ProtobufCodecLite::validateChecksum(body, bodylen)
-        && (memcmp(body, tag.data(), tag.size()) == 0)
+    // the backends decide whether to take frames without checksum
+    if (ProtobufCodecLite::validateFrame(tag, body, bodylen, true, &checksumType_)
+          == ProtobufCodecLite::kNoError
         && (bodylen >= taglen + 3 + 8))
     {
       const char* const p = body + taglen;
@@ -58,7 +59,8 @@ struct RawMessage
 
     const char* body = message_.data() + ProtobufCodecLite::kHeaderLen;
     int bodylen = message_.size() - ProtobufCodecLite::kHeaderLen;
-    int32_t checkSum = ProtobufCodecLite::checksum(body, bodylen - ProtobufCodecLite::kChecksumLen);
+    int32_t checkSum = ProtobufCodecLite::checksum(checksumType_, body,
+                                                   bodylen - ProtobufCodecLite::kChecksumLen);
     int32_t be32 = sockets::hostToNetwork32(checkSum);
     memcpy(const_cast<char*>(body + bodylen - ProtobufCodecLite::kChecksumLen), &be32, sizeof(be32));
   }
@@ -68,6 +70,7 @@ struct RawMessage
  private:
   uint64_t id_;
   const void* loc_;
+  ProtobufCodecLite::ChecksumType checksumType_;  // kept as it came
 };
 
 class BackendSession : boost::noncopyable
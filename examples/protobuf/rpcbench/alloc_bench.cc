@@ -0,0 +1,212 @@
+#include <examples/protobuf/rpcbench/echo.pb.h>
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/protorpc/RpcChannel.h>
+#include <muduo/net/protorpc/RpcServer.h>
+
+#include <boost/bind.hpp>
+
+#include <new>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Heap allocations of the IO thread of an echo server per call, with the
+// request and response on the heap and on arenas, and the calls per second.
+// The client runs in a thread of its own, whose allocations are not counted.
+
+__thread bool t_counting = false;
+AtomicInt64 g_allocations;
+
+void* operator new(size_t size)
+{
+  if (t_counting)
+  {
+    g_allocations.increment();
+  }
+  void* p = malloc(size > 0 ? size : 1);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) throw()
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) throw()
+{
+  free(p);
+}
+
+namespace
+{
+
+const int kCalls = 200000;
+const int kPipeline = 100;  // calls in flight
+
+class EchoServiceImpl : public echo::EchoService
+{
+ public:
+  virtual void Echo(::google::protobuf::RpcController* controller,
+                    const ::echo::EchoRequest* request,
+                    ::echo::EchoResponse* response,
+                    ::google::protobuf::Closure* done)
+  {
+    response->set_payload(request->payload());
+    done->Run();
+  }
+};
+
+void startCounting()
+{
+  t_counting = true;
+}
+
+class BenchClient : boost::noncopyable
+{
+ public:
+  BenchClient(EventLoop* loop, const InetAddress& serverAddr)
+    : client_(loop, serverAddr, "BenchClient"),
+      channel_(new RpcChannel),
+      stub_(get_pointer(channel_)),
+      connected_(1),
+      finished_(NULL),
+      sent_(0),
+      count_(0)
+  {
+    client_.setConnectionCallback(
+        boost::bind(&BenchClient::onConnection, this, _1));
+    client_.setMessageCallback(
+        boost::bind(&RpcChannel::onMessage, get_pointer(channel_), _1, _2, _3));
+    client_.connect();
+    connected_.wait();
+  }
+
+  // seconds to make calls of payload
+  double run(const std::string& payload)
+  {
+    CountDownLatch finished(1);
+    finished_ = &finished;
+    payload_ = payload;
+    sent_ = 0;
+    count_ = 0;
+    Timestamp start(Timestamp::now());
+    client_.getLoop()->runInLoop(boost::bind(&BenchClient::startInLoop, this));
+    finished.wait();
+    return timeDifference(Timestamp::now(), start);
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setTcpNoDelay(true);
+      channel_->setConnection(conn);
+      connected_.countDown();
+    }
+  }
+
+  void startInLoop()
+  {
+    for (int i = 0; i < kPipeline; ++i)
+    {
+      sendRequest();
+    }
+  }
+
+  void sendRequest()
+  {
+    ++sent_;
+    echo::EchoRequest request;
+    request.set_payload(payload_);
+    echo::EchoResponse* response = new echo::EchoResponse;
+    stub_.Echo(NULL, &request, response, NewCallback(this, &BenchClient::replied, response));
+  }
+
+  void replied(echo::EchoResponse* response)
+  {
+    if (response->payload().size() != payload_.size())
+    {
+      abort();
+    }
+    ++count_;
+    if (sent_ < kCalls)
+    {
+      sendRequest();
+    }
+    else if (count_ == kCalls)
+    {
+      finished_->countDown();
+    }
+  }
+
+  TcpClient client_;
+  RpcChannelPtr channel_;
+  echo::EchoService::Stub stub_;
+  CountDownLatch connected_;
+  CountDownLatch* finished_;
+  std::string payload_;
+  int sent_;
+  int count_;
+};
+
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  const uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 8889);
+  EventLoopThread serverThread;
+  EventLoop* serverLoop = serverThread.startLoop();
+  serverLoop->runInLoop(startCounting);
+  EventLoopThread clientThread;
+  EventLoop* clientLoop = clientThread.startLoop();
+
+  // one server with arenas off, one with them on
+  EchoServiceImpl impl;
+  RpcServer heapServer(serverLoop, InetAddress(port));
+  heapServer.setArenaBlockSize(0);
+  heapServer.registerService(&impl);
+  serverLoop->runInLoop(boost::bind(&RpcServer::start, &heapServer));
+  RpcServer arenaServer(serverLoop, InetAddress(static_cast<uint16_t>(port + 1)));
+  arenaServer.registerService(&impl);
+  serverLoop->runInLoop(boost::bind(&RpcServer::start, &arenaServer));
+
+  BenchClient heapClient(clientLoop, InetAddress("127.0.0.1", port));
+  BenchClient arenaClient(clientLoop, InetAddress("127.0.0.1", static_cast<uint16_t>(port + 1)));
+
+  printf("%8s %18s %12s %18s %12s\n", "payload", "heap allocs/call", "calls/s",
+         "arena allocs/call", "calls/s");
+  const int sizes[] = { 6, 256, 4096 };
+  for (size_t i = 0; i < sizeof sizes / sizeof sizes[0]; ++i)
+  {
+    std::string payload(sizes[i], 'x');
+    int64_t before = g_allocations.get();
+    double heapSeconds = heapClient.run(payload);
+    int64_t heapAllocations = g_allocations.get() - before;
+    before = g_allocations.get();
+    double arenaSeconds = arenaClient.run(payload);
+    int64_t arenaAllocations = g_allocations.get() - before;
+    printf("%8d %18.2f %12.0f %18.2f %12.0f\n", sizes[i],
+           static_cast<double>(heapAllocations) / kCalls, kCalls / heapSeconds,
+           static_cast<double>(arenaAllocations) / kCalls, kCalls / arenaSeconds);
+  }
+  // the servers go with the process
+  fflush(stdout);
+  _exit(0);
+}
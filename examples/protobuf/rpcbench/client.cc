@@ -1,6 +1,7 @@
 #include <examples/protobuf/rpcbench/echo.pb.h>
 
 #include <muduo/base/CountDownLatch.h>
+#include <muduo/base/FileUtil.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/EventLoopThreadPool.h>
@@ -18,6 +19,26 @@ using namespace muduo;
 using namespace muduo::net;
 
 static const int kRequests = 50000;
+static std::string g_payload("001010");
+static int g_pipeline = 1;  // calls in flight per client
+static double g_batchWindow = -1;  // seconds, negative for no batching
+static double g_callTimeout = 10.0;  // seconds, 0 arms no timer per call
+
+// read and write system calls of this process so far
+int64_t ioSyscalls()
+{
+  string io;
+  FileUtil::readFile("/proc/self/io", 65536, &io);
+  long long reads = 0, writes = 0;
+  size_t r = io.find("syscr:");
+  size_t w = io.find("syscw:");
+  if (r != string::npos && w != string::npos)
+  {
+    sscanf(io.c_str() + r, "syscr: %lld", &reads);
+    sscanf(io.c_str() + w, "syscw: %lld", &writes);
+  }
+  return reads + writes;
+}
 
 class RpcClient : boost::noncopyable
 {
@@ -33,6 +54,7 @@ class RpcClient : boost::noncopyable
       stub_(get_pointer(channel_)),
       allConnected_(allConnected),
       allFinished_(allFinished),
+      sent_(0),
       count_(0)
   {
     client_.setConnectionCallback(
@@ -47,22 +69,41 @@ class RpcClient : boost::noncopyable
     client_.connect();
   }
 
+  void start()
+  {
+    client_.getLoop()->runInLoop(boost::bind(&RpcClient::startInLoop, this));
+  }
+
+ private:
+  void startInLoop()
+  {
+    for (int i = 0; i < g_pipeline && sent_ < kRequests; ++i)
+    {
+      sendRequest();
+    }
+  }
+
   void sendRequest()
   {
+    ++sent_;
     echo::EchoRequest request;
-    request.set_payload("001010");
+    request.set_payload(g_payload);
     echo::EchoResponse* response = new echo::EchoResponse;
     stub_.Echo(NULL, &request, response, NewCallback(this, &RpcClient::replied, response));
   }
 
- private:
   void onConnection(const TcpConnectionPtr& conn)
   {
     if (conn->connected())
     {
       //channel_.reset(new RpcChannel(conn));
       conn->setTcpNoDelay(true);
+      channel_->setCallTimeout(g_callTimeout);
       channel_->setConnection(conn);
+      if (g_batchWindow >= 0)
+      {
+        channel_->enableBatching(g_batchWindow);
+      }
       allConnected_->countDown();
     }
   }
@@ -72,11 +113,11 @@ class RpcClient : boost::noncopyable
     // LOG_INFO << "replied:\n" << resp->DebugString().c_str();
     // loop_->quit();
     ++count_;
-    if (count_ < kRequests)
+    if (sent_ < kRequests)
     {
       sendRequest();
     }
-    else
+    else if (count_ == kRequests)
     {
       LOG_INFO << "RpcClient " << this << " finished";
       allFinished_->countDown();
@@ -89,6 +130,7 @@ class RpcClient : boost::noncopyable
   echo::EchoService::Stub stub_;
   CountDownLatch* allConnected_;
   CountDownLatch* allFinished_;
+  int sent_;
   int count_;
 };
 
@@ -111,6 +153,26 @@ int main(int argc, char* argv[])
       nThreads = atoi(argv[3]);
     }
 
+    if (argc > 4)
+    {
+      g_payload.assign(atoi(argv[4]), 'x');
+    }
+
+    if (argc > 5)
+    {
+      g_pipeline = atoi(argv[5]);
+    }
+
+    if (argc > 6)
+    {
+      g_batchWindow = atof(argv[6]) / 1e6;
+    }
+
+    if (argc > 7)
+    {
+      g_callTimeout = atof(argv[7]);
+    }
+
     CountDownLatch allConnected(nClients);
     CountDownLatch allFinished(nClients);
 
@@ -127,24 +189,31 @@ int main(int argc, char* argv[])
       clients.back().connect();
     }
     allConnected.wait();
+    int64_t syscalls = ioSyscalls();
     Timestamp start(Timestamp::now());
     LOG_INFO << "all connected";
     for (int i = 0; i < nClients; ++i)
     {
-      clients[i].sendRequest();
+      clients[i].start();
     }
     allFinished.wait();
     Timestamp end(Timestamp::now());
+    syscalls = ioSyscalls() - syscalls;
     LOG_INFO << "all finished";
     double seconds = timeDifference(end, start);
     printf("%f seconds\n", seconds);
-    printf("%.1f calls per second\n", nClients * kRequests / seconds);
+    printf("%.1f calls per second, %zd-byte payload\n",
+           nClients * kRequests / seconds, g_payload.size());
+    printf("%.2f read/write syscalls per call, %d in flight per client\n",
+           static_cast<double>(syscalls) / (nClients * kRequests), g_pipeline);
 
     exit(0);
   }
   else
   {
-    printf("Usage: %s host_ip numClients [numThreads]\n", argv[0]);
+    printf("Usage: %s host_ip numClients [numThreads [payloadSize [pipeline [batchWindowUs [callTimeout]]]]]\n"
+           "batchWindowUs: 0 for each loop iteration, -1 for no batching (default)\n"
+           "callTimeout: seconds, 10 by default, 0 for none\n", argv[0]);
   }
 }
 
@@ -0,0 +1,94 @@
+#include <examples/protobuf/rpcbench/echo.pb.h>
+
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/protorpc/RpcCodec.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Encodes and decodes echo requests, as RpcChannel does per call, with the
+// nested SerializeAsString() envelope and with the one serialized in place.
+
+int g_parsed = 0;
+
+void onMessage(const TcpConnectionPtr&, const RpcMessagePtr& message, Timestamp)
+{
+  echo::EchoRequest request;
+  if (request.ParseFromString(message->request()))
+  {
+    g_parsed += static_cast<int>(request.payload().size());
+  }
+}
+
+bool onRawMessage(const TcpConnectionPtr&, StringPiece frame, Timestamp)
+{
+  RpcMessage message;
+  StringPiece payload;
+  echo::EchoRequest request;
+  if (parseRpcFrame(frame, &message, &payload)
+      && request.ParseFromArray(payload.data(), payload.size()))
+  {
+    g_parsed += static_cast<int>(request.payload().size());
+  }
+  return false;
+}
+
+RpcMessage envelope()
+{
+  RpcMessage message;
+  message.set_type(REQUEST);
+  message.set_id(1);
+  message.set_service("echo.EchoService");
+  message.set_method("Echo");
+  return message;
+}
+
+double benchNested(const echo::EchoRequest& request, int calls)
+{
+  RpcCodec codec(onMessage);
+  Buffer buf;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < calls; ++i)
+  {
+    RpcMessage message(envelope());
+    message.set_request(request.SerializeAsString());
+    codec.fillEmptyBuffer(&buf, message);
+    codec.onMessage(TcpConnectionPtr(), &buf, start);
+  }
+  return timeDifference(Timestamp::now(), start);
+}
+
+double benchInPlace(const echo::EchoRequest& request, int calls)
+{
+  RpcCodec codec(onMessage, onRawMessage);
+  Buffer buf;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < calls; ++i)
+  {
+    fillRpcBuffer(&buf, envelope(), request);
+    codec.onMessage(TcpConnectionPtr(), &buf, start);
+  }
+  return timeDifference(Timestamp::now(), start);
+}
+
+int main(int argc, char* argv[])
+{
+  const int kBytes = argc > 1 ? atoi(argv[1]) : 256 * 1024 * 1024;
+  const int sizes[] = { 6, 256, 4096, 65536 };
+  for (size_t i = 0; i < sizeof sizes / sizeof sizes[0]; ++i)
+  {
+    echo::EchoRequest request;
+    request.set_payload(std::string(sizes[i], 'x'));
+    const int calls = kBytes / (sizes[i] + 64);
+    double nested = benchNested(request, calls);
+    double inPlace = benchInPlace(request, calls);
+    printf("%6d-byte payload: nested %9.0f calls/s, in place %9.0f calls/s, %.2fx\n",
+           sizes[i], calls / nested, calls / inPlace, nested / inPlace);
+  }
+  return g_parsed == 0;
+}
@@ -33,9 +33,21 @@ int main(int argc, char* argv[])
   EventLoop loop;
   int port = argc > 2 ? atoi(argv[2]) : 8888;
   InetAddress listenAddr(static_cast<uint16_t>(port));
+  // microseconds, 0 for each loop iteration
+  double batchWindowUs = argc > 3 ? atof(argv[3]) : -1;
+  // bytes of the first block of the arena of each call, 0 for the heap
+  int arenaBlockSize = argc > 4 ? atoi(argv[4]) : -1;
   echo::EchoServiceImpl impl;
   RpcServer server(&loop, listenAddr);
   server.setThreadNum(nThreads);
+  if (batchWindowUs >= 0)
+  {
+    server.enableBatching(batchWindowUs / 1e6);
+  }
+  if (arenaBlockSize >= 0)
+  {
+    server.setArenaBlockSize(arenaBlockSize);
+  }
   server.registerService(&impl);
   server.start();
   loop.loop();
@@ -0,0 +1,185 @@
+#include <examples/protobuf/rpcstream/file.pb.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/protorpc/RpcChannel.h>
+#include <muduo/net/protorpc/RpcController.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+typedef boost::shared_ptr<FILE> FilePtr;
+
+const int kChunkSize = 64 * 1024;
+
+class FileClient : boost::noncopyable
+{
+ public:
+  FileClient(EventLoop* loop, const InetAddress& serverAddr,
+             bool upload, const string& localPath, const string& remotePath)
+    : loop_(loop),
+      client_(loop, serverAddr, "FileClient"),
+      channel_(new RpcChannel),
+      stub_(get_pointer(channel_)),
+      upload_(upload),
+      localPath_(localPath),
+      remotePath_(remotePath),
+      bytes_(0)
+  {
+    client_.setConnectionCallback(
+        boost::bind(&FileClient::onConnection, this, _1));
+    client_.setMessageCallback(
+        boost::bind(&RpcChannel::onMessage, get_pointer(channel_), _1, _2, _3));
+    // for the whole file, not each chunk
+    channel_->setCallTimeout(600.0);
+  }
+
+  bool connect()
+  {
+    FILE* fp = ::fopen(localPath_.c_str(), upload_ ? "rb" : "wb");
+    if (!fp)
+    {
+      LOG_SYSERR << "fopen " << localPath_;
+      return false;
+    }
+    fp_.reset(fp, ::fclose);
+    client_.connect();
+    return true;
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      channel_->setConnection(conn);
+      if (upload_)
+      {
+        upload();
+      }
+      else
+      {
+        download();
+      }
+    }
+    else
+    {
+      loop_->quit();
+    }
+  }
+
+  void download()
+  {
+    rpcstream::DownloadRequest request;
+    request.set_path(remotePath_.c_str());
+    request.set_chunk_size(kChunkSize);
+    rpcstream::Chunk* response = new rpcstream::Chunk;
+    controller_.setResponseReader(boost::bind(&FileClient::onChunk, this, _1));
+    stub_.Download(&controller_, &request, response,
+                   NewCallback(this, &FileClient::downloaded, response));
+  }
+
+  void onChunk(const ::google::protobuf::Message* message)
+  {
+    const std::string& data = muduo::down_cast<const rpcstream::Chunk*>(message)->data();
+    ::fwrite(data.data(), 1, data.size(), get_pointer(fp_));
+    bytes_ += data.size();
+  }
+
+  void downloaded(rpcstream::Chunk* response)
+  {
+    fp_.reset();
+    if (controller_.Failed() || response->has_error())
+    {
+      LOG_ERROR << "download failed: " << controller_.ErrorText()
+                << response->error();
+    }
+    else
+    {
+      LOG_INFO << "downloaded " << bytes_ << " of " << response->total_bytes() << " bytes";
+    }
+    client_.disconnect();
+  }
+
+  void upload()
+  {
+    // the first chunk names the file, the writer reads the rest
+    rpcstream::Chunk request;
+    request.set_path(remotePath_.c_str());
+    readChunk(fp_, &request);
+    rpcstream::UploadSummary* response = new rpcstream::UploadSummary;
+    controller_.setRequestWriter(boost::bind(&FileClient::readChunk, fp_, _1));
+    stub_.Upload(&controller_, &request, response,
+                 NewCallback(this, &FileClient::uploaded, response));
+  }
+
+  static bool readChunk(const FilePtr& fp, ::google::protobuf::Message* next)
+  {
+    std::string* data = muduo::down_cast<rpcstream::Chunk*>(next)->mutable_data();
+    data->resize(kChunkSize);
+    size_t n = ::fread(&*data->begin(), 1, kChunkSize, get_pointer(fp));
+    data->resize(n);
+    return n > 0;
+  }
+
+  void uploaded(rpcstream::UploadSummary* response)
+  {
+    fp_.reset();
+    if (controller_.Failed() || response->has_error())
+    {
+      LOG_ERROR << "upload failed: " << controller_.ErrorText()
+                << response->error();
+    }
+    else
+    {
+      LOG_INFO << "uploaded " << response->total_bytes() << " bytes";
+    }
+    client_.disconnect();
+  }
+
+  EventLoop* loop_;
+  TcpClient client_;
+  RpcChannelPtr channel_;
+  rpcstream::FileService::Stub stub_;
+  RpcController controller_;
+  const bool upload_;
+  const string localPath_;
+  const string remotePath_;
+  FilePtr fp_;
+  int64_t bytes_;
+};
+
+int main(int argc, char* argv[])
+{
+  LOG_INFO << "pid = " << getpid();
+  if (argc > 4 && (strcmp(argv[2], "get") == 0 || strcmp(argv[2], "put") == 0))
+  {
+    bool upload = strcmp(argv[2], "put") == 0;
+    EventLoop loop;
+    InetAddress serverAddr(argv[1], 9991);
+
+    // get remote local, put local remote
+    FileClient fileClient(&loop, serverAddr, upload,
+                          upload ? argv[3] : argv[4],
+                          upload ? argv[4] : argv[3]);
+    if (fileClient.connect())
+    {
+      loop.loop();
+    }
+  }
+  else
+  {
+    printf("Usage: %s host_ip get remote_path local_path\n"
+           "       %s host_ip put local_path remote_path\n", argv[0], argv[0]);
+  }
+  google::protobuf::ShutdownProtobufLibrary();
+}
@@ -0,0 +1,186 @@
+#include <examples/protobuf/rpcstream/file.pb.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/protorpc/RpcController.h>
+#include <muduo/net/protorpc/RpcServer.h>
+
+#include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace rpcstream
+{
+
+typedef boost::shared_ptr<FILE> FilePtr;
+
+// one upload, its chunks come in one at a time
+class Upload : boost::noncopyable
+{
+ public:
+  Upload(const FilePtr& fp, UploadSummary* response, ::google::protobuf::Closure* done)
+    : fp_(fp),
+      response_(response),
+      done_(done),
+      bytes_(0)
+  {
+  }
+
+  // false if it fails, done is run then and the rest is dropped
+  bool write(const Chunk& chunk)
+  {
+    if (::fwrite(chunk.data().data(), 1, chunk.data().size(), get_pointer(fp_)) != chunk.data().size())
+    {
+      response_->set_error(strerror_tl(errno));
+      finish();
+      return false;
+    }
+    bytes_ += chunk.data().size();
+    return true;
+  }
+
+  void finish()
+  {
+    fp_.reset();
+    response_->set_total_bytes(bytes_);
+    LOG_INFO << "uploaded " << bytes_ << " bytes";
+    done_->Run();
+  }
+
+  // NULL at the end of the stream, or of the connection
+  void onChunk(const ::google::protobuf::Message* message)
+  {
+    if (message)
+    {
+      write(*muduo::down_cast<const Chunk*>(message));
+    }
+    else
+    {
+      finish();
+    }
+  }
+
+ private:
+  FilePtr fp_;
+  UploadSummary* response_;
+  ::google::protobuf::Closure* done_;
+  int64_t bytes_;
+};
+
+class FileServiceImpl : public FileService
+{
+ public:
+  explicit FileServiceImpl(const string& root)
+    : root_(root)
+  {
+  }
+
+  virtual void Download(::google::protobuf::RpcController* controller,
+                        const ::rpcstream::DownloadRequest* request,
+                        ::rpcstream::Chunk* response,
+                        ::google::protobuf::Closure* done)
+  {
+    LOG_INFO << "Download " << request->path();
+    FilePtr fp = open(request->path(), "rb", response->mutable_error());
+    struct stat st;
+    if (fp && ::fstat(::fileno(get_pointer(fp)), &st) == 0)
+    {
+      // the last response goes after the chunks
+      response->clear_error();
+      response->set_total_bytes(st.st_size);
+      int chunkSize = std::max(request->chunk_size(), 1);
+      static_cast<RpcController*>(controller)->setResponseWriter(
+          boost::bind(&FileServiceImpl::readChunk, fp, chunkSize, _1));
+    }
+    done->Run();
+  }
+
+  virtual void Upload(::google::protobuf::RpcController* controller,
+                      const ::rpcstream::Chunk* request,
+                      ::rpcstream::UploadSummary* response,
+                      ::google::protobuf::Closure* done)
+  {
+    LOG_INFO << "Upload " << request->path();
+    FilePtr fp = open(request->path(), "wb", response->mutable_error());
+    if (!fp)
+    {
+      done->Run();
+      return;
+    }
+    response->clear_error();
+    boost::shared_ptr<rpcstream::Upload> upload(new rpcstream::Upload(fp, response, done));
+    if (upload->write(*request)
+        && !static_cast<RpcController*>(controller)->setRequestReader(
+            boost::bind(&rpcstream::Upload::onChunk, upload, _1)))
+    {
+      // all in one request
+      upload->finish();
+    }
+  }
+
+ private:
+  static bool readChunk(const FilePtr& fp, int chunkSize, ::google::protobuf::Message* next)
+  {
+    std::string* data = muduo::down_cast<Chunk*>(next)->mutable_data();
+    data->resize(chunkSize);
+    size_t n = ::fread(&*data->begin(), 1, chunkSize, get_pointer(fp));
+    data->resize(n);
+    return n > 0;
+  }
+
+  // paths are relative to root_, and may not leave it
+  FilePtr open(const std::string& path, const char* mode, std::string* error)
+  {
+    FilePtr fp;
+    if (path.empty() || path[0] == '/' || path.find("..") != std::string::npos)
+    {
+      *error = "bad path";
+    }
+    else
+    {
+      string fullPath = root_ + "/" + path.c_str();
+      FILE* f = ::fopen(fullPath.c_str(), mode);
+      if (f)
+      {
+        fp.reset(f, ::fclose);
+      }
+      else
+      {
+        *error = strerror_tl(errno);
+      }
+    }
+    return fp;
+  }
+
+  const string root_;
+};
+
+}
+
+int main(int argc, char* argv[])
+{
+  LOG_INFO << "pid = " << getpid();
+  if (argc > 1)
+  {
+    EventLoop loop;
+    InetAddress listenAddr(9991);
+    rpcstream::FileServiceImpl impl(argv[1]);
+    RpcServer server(&loop, listenAddr);
+    server.registerService(&impl);
+    server.start();
+    loop.loop();
+  }
+  else
+  {
+    printf("Usage: %s root_dir\n", argv[0]);
+  }
+  google::protobuf::ShutdownProtobufLibrary();
+}
@@ -0,0 +1,259 @@
+#undef NDEBUG
+#include <examples/protobuf/rpcstream/file.pb.h>
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/protorpc/RpcChannel.h>
+#include <muduo/net/protorpc/RpcController.h>
+#include <muduo/net/protorpc/RpcServer.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+using namespace rpcstream;
+
+// Uploads that the service fails partway through, from the reader or the
+// method, and one cut short by the connection.
+
+namespace
+{
+
+const uint16_t kPort = 19021;
+
+// in the server IO thread
+int g_chunks = 0;
+int g_chunksAfterDone = 0;
+int g_ends = 0;
+
+class UploadCall : boost::noncopyable
+{
+ public:
+  UploadCall(RpcController* controller, UploadSummary* response,
+             ::google::protobuf::Closure* done, int failAfter)
+    : controller_(controller),
+      response_(response),
+      done_(done),
+      failAfter_(failAfter),
+      chunks_(0)
+  {
+  }
+
+  void onChunk(const ::google::protobuf::Message* message)
+  {
+    if (done_ == NULL)
+    {
+      ++g_chunksAfterDone;
+    }
+    else if (message == NULL)
+    {
+      ++g_ends;
+      response_->set_total_bytes(chunks_);
+      run();
+    }
+    else
+    {
+      ++g_chunks;
+      if (++chunks_ == failAfter_)
+      {
+        controller_->SetFailed("quota");
+        run();
+      }
+    }
+  }
+
+ private:
+  void run()
+  {
+    ::google::protobuf::Closure* done = done_;
+    done_ = NULL;
+    done->Run();
+  }
+
+  RpcController* controller_;
+  UploadSummary* response_;
+  ::google::protobuf::Closure* done_;
+  const int failAfter_;
+  int chunks_;
+};
+
+class FileServiceImpl : public FileService
+{
+ public:
+  // path is the number of chunks to take, 0 to fail before any, -1 for all
+  virtual void Upload(::google::protobuf::RpcController* controller,
+                      const ::rpcstream::Chunk* request,
+                      ::rpcstream::UploadSummary* response,
+                      ::google::protobuf::Closure* done)
+  {
+    RpcController* c = static_cast<RpcController*>(controller);
+    int failAfter = atoi(request->path().c_str());
+    if (failAfter == 0)
+    {
+      c->SetFailed("rejected");
+      done->Run();
+      return;
+    }
+    boost::shared_ptr<UploadCall> upload(new UploadCall(c, response, done, failAfter));
+    bool streams = c->setRequestReader(boost::bind(&UploadCall::onChunk, upload, _1));
+    assert(streams);
+    (void) streams;
+  }
+};
+
+bool writeChunk(int* left, ::google::protobuf::Message* next)
+{
+  if (*left == 0)
+  {
+    return false;
+  }
+  --*left;
+  static_cast<Chunk*>(next)->set_data(std::string(1000, 'x'));
+  return true;
+}
+
+struct Call
+{
+  Call() : latch(1), failed(false), total(-1) { }
+
+  RpcController controller;
+  CountDownLatch latch;
+  bool failed;
+  int64_t total;
+};
+
+void uploaded(Call* call, UploadSummary* response)
+{
+  call->failed = call->controller.Failed();
+  call->total = response->total_bytes();
+  call->latch.countDown();
+}
+
+// uploads path and chunks more chunks, waits for the answer
+void upload(FileService::Stub* stub, const char* path, int chunks, Call* call)
+{
+  Chunk first;
+  first.set_path(path);
+  // not called once the call is over
+  int left = chunks;
+  call->controller.setRequestWriter(boost::bind(writeChunk, &left, _1));
+  UploadSummary* response = new UploadSummary;
+  stub->Upload(&call->controller, &first, response, NewCallback(uploaded, call, response));
+  call->latch.wait();
+}
+
+void onConnection(const RpcChannelPtr& channel, CountDownLatch* connected,
+                  const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    channel->setConnection(conn);
+    connected->countDown();
+  }
+  else
+  {
+    channel->failOutstandingCalls(UNAVAILABLE);
+    channel->closeStreams();
+  }
+}
+
+void readStat(const int* stat, int* value, CountDownLatch* latch)
+{
+  *value = *stat;
+  latch->countDown();
+}
+
+int serverStat(EventLoop* loop, const int* stat)
+{
+  int value = 0;
+  CountDownLatch latch(1);
+  loop->runInLoop(boost::bind(readStat, stat, &value, &latch));
+  latch.wait();
+  return value;
+}
+
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoopThread serverThread;
+  EventLoop* serverLoop = serverThread.startLoop();
+  FileServiceImpl impl;
+  RpcServer server(serverLoop, InetAddress(kPort));
+  server.registerService(&impl);
+  serverLoop->runInLoop(boost::bind(&RpcServer::start, &server));
+
+  EventLoopThread clientThread;
+  EventLoop* clientLoop = clientThread.startLoop();
+  RpcChannelPtr channel(new RpcChannel);
+  TcpClient client(clientLoop, InetAddress("127.0.0.1", kPort), "StreamTest");
+  CountDownLatch connected(1);
+  client.setConnectionCallback(boost::bind(onConnection, channel, &connected, _1));
+  client.setMessageCallback(
+      boost::bind(&RpcChannel::onMessage, get_pointer(channel), _1, _2, _3));
+  client.connect();
+  connected.wait();
+  FileService::Stub stub(get_pointer(channel));
+
+  // failed from the reader after 5 of 10000 chunks
+  {
+    Call call;
+    upload(&stub, "5", 10000, &call);
+    assert(call.failed);
+    assert(call.controller.ErrorText() == "quota");
+  }
+  // failed by the method, the chunks that follow are dropped
+  {
+    Call call;
+    upload(&stub, "0", 1000, &call);
+    assert(call.failed);
+    assert(call.controller.ErrorText() == "rejected");
+  }
+  // the connection still works
+  {
+    Call call;
+    upload(&stub, "-1", 20, &call);
+    assert(!call.failed);
+    assert(call.total == 20);
+  }
+  assert(serverStat(serverLoop, &g_chunksAfterDone) == 0);
+  assert(serverStat(serverLoop, &g_ends) == 1);
+
+  // cut short by the connection, the reader gets NULL
+  {
+    Call call;
+    Chunk first;
+    first.set_path("-1");
+    int left = -1;  // never ends
+    call.controller.setRequestWriter(boost::bind(writeChunk, &left, _1));
+    UploadSummary* response = new UploadSummary;
+    stub.Upload(&call.controller, &first, response, NewCallback(uploaded, &call, response));
+    while (serverStat(serverLoop, &g_chunks) < 1000)
+    {
+      usleep(1000);
+    }
+    clientLoop->runInLoop(boost::bind(&TcpClient::disconnect, &client));
+    call.latch.wait();
+    assert(call.failed);
+    while (serverStat(serverLoop, &g_ends) < 2)
+    {
+      usleep(1000);
+    }
+  }
+  assert(serverStat(serverLoop, &g_chunksAfterDone) == 0);
+  printf("all tests passed\n");
+  fflush(stdout);
+  // the server and client go with the process
+  _exit(0);
+}
@@ -24,12 +24,10 @@ void onRequest(const HttpRequest& req, HttpResponse* resp)
   LOG_INFO << "Headers " << req.methodString() << " " << req.path();
   if (!benchmark)
   {
-    const std::map<string, string>& headers = req.headers();
-    for (std::map<string, string>::const_iterator it = headers.begin();
-        it != headers.end();
-        ++it)
+    const HttpHeaders& headers = req.headers();
+    for (size_t i = 0; i < headers.size(); ++i)
     {
-      LOG_DEBUG << it->first << ": " << it->second;
+      LOG_DEBUG << headers.field(i) << ": " << headers.value(i);
     }
   }
 
@@ -1,5 +1,7 @@
 // This is not a standalone header
 
+#include <muduo/base/LatencyHistogram.h>
+
 class SudokuStat : boost::noncopyable
 {
  public:
@@ -14,7 +16,8 @@ class SudokuStat : boost::noncopyable
       badRequests_(0),
       droppedRequests_(0),
       totalLatency_(0),
-      badLatency_(0)
+      badLatency_(0),
+      latencyHistogram_("sudoku_latency_us")
   {
   }
 
@@ -62,6 +65,10 @@ class SudokuStat : boost::noncopyable
     int64_t latencyAvg = totalResponses_ == 0 ? 0 : totalLatency_ / totalResponses_;
     result << "latency_us_avg " << latencyAvg << '\n';
     }
+    LatencyHistogram::Snapshot snapshot = latencyHistogram_.snapshot();
+    result << "latency_us_p50 " << snapshot.percentile(50) << '\n';
+    result << "latency_us_p99 " << snapshot.percentile(99) << '\n';
+    result << "latency_us_p999 " << snapshot.percentile(99.9) << '\n';
     return result.buffer().toString();
   }
 
@@ -79,6 +86,7 @@ class SudokuStat : boost::noncopyable
     totalLatency_ = 0;
     badLatency_ = 0;
     }
+    latencyHistogram_.reset();
     return "reset done.";
   }
 
@@ -86,6 +94,10 @@ class SudokuStat : boost::noncopyable
   {
     const time_t second = now.secondsSinceEpoch();
     const int64_t elapsed_us = now.microSecondsSinceEpoch() - receive.microSecondsSinceEpoch();
+    if (elapsed_us >= 0)
+    {
+      latencyHistogram_.record(elapsed_us);
+    }
     MutexLockGuard lock(mutex_);
     assert(requests_.size() == latencies_.size());
     ++totalResponses_;
@@ -189,6 +201,7 @@ class SudokuStat : boost::noncopyable
   boost::circular_buffer<int64_t> latencies_;
   int64_t totalRequests_, totalResponses_, totalSolved_, badRequests_, droppedRequests_, totalLatency_, badLatency_;
   // FIXME int128_t for totalLatency_;
+  LatencyHistogram latencyHistogram_;
 
   static const int kSeconds = 60;
 };
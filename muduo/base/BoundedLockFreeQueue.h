@@ -0,0 +1,344 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef MUDUO_BASE_BOUNDEDLOCKFREEQUEUE_H
+#define MUDUO_BASE_BOUNDEDLOCKFREEQUEUE_H
+
+#include <boost/noncopyable.hpp>
+#include <algorithm>
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace muduo
+{
+
+namespace detail
+{
+
+inline size_t loadAcquire(const volatile size_t* p)
+{
+#ifdef __ATOMIC_ACQUIRE
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+  size_t v = *p;
+  __sync_synchronize();
+  return v;
+#endif
+}
+
+inline void storeRelease(volatile size_t* p, size_t v)
+{
+#ifdef __ATOMIC_RELEASE
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#else
+  __sync_synchronize();
+  *p = v;
+#endif
+}
+
+inline void futexWait(volatile int* addr, int val)
+{
+  ::syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+inline void futexWake(volatile int* addr, int n)
+{
+  ::syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+}
+
+///
+/// Bounded multi-producer multi-consumer queue on a ring of sequenced cells
+/// (Dmitry Vyukov's design), no lock is taken on put/take.
+///
+/// tryPut/tryTake never block. put/take spin briefly when the queue is
+/// full/empty, then sleep on a futex until the other side makes progress.
+/// The batch variants claim a run of consecutive cells with one CAS and
+/// issue at most one wakeup per batch.
+///
+/// Capacity is rounded up to a power of two.
+/// T must be default constructible and assignable; a taken item is
+/// swapped out and the cell reset to T(), so resources held by T are
+/// released on take.
+///
+template<typename T>
+class BoundedLockFreeQueue : boost::noncopyable
+{
+ public:
+  explicit BoundedLockFreeQueue(size_t maxSize)
+    : capacity_(roundUp(maxSize)),
+      mask_(capacity_ - 1),
+      cells_(new Cell[capacity_]),
+      enqueuePos_(0),
+      dequeuePos_(0),
+      notEmptySeq_(0),
+      notEmptyWaiters_(0),
+      notFullSeq_(0),
+      notFullWaiters_(0)
+  {
+    for (size_t i = 0; i < capacity_; ++i)
+    {
+      cells_[i].sequence = i;
+    }
+  }
+
+  ~BoundedLockFreeQueue()
+  {
+    delete[] cells_;
+  }
+
+  bool tryPut(const T& x)
+  {
+    return tryPutBatch(&x, 1) == 1;
+  }
+
+  bool tryTake(T* x)
+  {
+    return tryTakeBatch(x, 1) == 1;
+  }
+
+  /// Puts the longest prefix of items that fits, returns its length.
+  size_t tryPutBatch(const T* items, size_t n)
+  {
+    if (n == 0)
+      return 0;
+    size_t pos = enqueuePos_;
+    for (;;)
+    {
+      intptr_t diff = static_cast<intptr_t>(
+          detail::loadAcquire(&cells_[pos & mask_].sequence) - pos);
+      if (diff < 0)
+      {
+        return 0;  // full
+      }
+      else if (diff == 0)
+      {
+        size_t k = 1;
+        while (k < n && k < capacity_
+               && detail::loadAcquire(&cells_[(pos + k) & mask_].sequence) == pos + k)
+        {
+          ++k;
+        }
+        size_t old = __sync_val_compare_and_swap(&enqueuePos_, pos, pos + k);
+        if (old == pos)
+        {
+          for (size_t i = 0; i < k; ++i)
+          {
+            Cell& cell = cells_[(pos + i) & mask_];
+            cell.data = items[i];
+            detail::storeRelease(&cell.sequence, pos + i + 1);
+          }
+          wake(&notEmptySeq_, &notEmptyWaiters_);
+          return k;
+        }
+        pos = old;
+      }
+      else
+      {
+        pos = enqueuePos_;
+      }
+    }
+  }
+
+  /// Takes up to n items into out, returns how many were taken.
+  size_t tryTakeBatch(T* out, size_t n)
+  {
+    if (n == 0)
+      return 0;
+    size_t pos = dequeuePos_;
+    for (;;)
+    {
+      intptr_t diff = static_cast<intptr_t>(
+          detail::loadAcquire(&cells_[pos & mask_].sequence) - (pos + 1));
+      if (diff < 0)
+      {
+        return 0;  // empty
+      }
+      else if (diff == 0)
+      {
+        size_t k = 1;
+        while (k < n && k < capacity_
+               && detail::loadAcquire(&cells_[(pos + k) & mask_].sequence) == pos + k + 1)
+        {
+          ++k;
+        }
+        size_t old = __sync_val_compare_and_swap(&dequeuePos_, pos, pos + k);
+        if (old == pos)
+        {
+          for (size_t i = 0; i < k; ++i)
+          {
+            Cell& cell = cells_[(pos + i) & mask_];
+            using std::swap;
+            swap(out[i], cell.data);
+            cell.data = T();
+            detail::storeRelease(&cell.sequence, pos + i + capacity_);
+          }
+          wake(&notFullSeq_, &notFullWaiters_);
+          return k;
+        }
+        pos = old;
+      }
+      else
+      {
+        pos = dequeuePos_;
+      }
+    }
+  }
+
+  void put(const T& x)
+  {
+    while (!tryPut(x))
+    {
+      waitUntil(&BoundedLockFreeQueue::canPut, &notFullSeq_, &notFullWaiters_);
+    }
+  }
+
+  T take()
+  {
+    T x = T();
+    while (!tryTake(&x))
+    {
+      waitUntil(&BoundedLockFreeQueue::canTake, &notEmptySeq_, &notEmptyWaiters_);
+    }
+    return x;
+  }
+
+  /// Blocks until all n items are put.
+  void putBatch(const T* items, size_t n)
+  {
+    while (n > 0)
+    {
+      size_t k = tryPutBatch(items, n);
+      if (k == 0)
+      {
+        waitUntil(&BoundedLockFreeQueue::canPut, &notFullSeq_, &notFullWaiters_);
+      }
+      items += k;
+      n -= k;
+    }
+  }
+
+  /// Blocks until at least one item is available, takes up to n.
+  size_t takeBatch(T* out, size_t n)
+  {
+    assert(n > 0);
+    size_t k = 0;
+    while ((k = tryTakeBatch(out, n)) == 0)
+    {
+      waitUntil(&BoundedLockFreeQueue::canTake, &notEmptySeq_, &notEmptyWaiters_);
+    }
+    return k;
+  }
+
+  /// Approximate when other threads are putting or taking.
+  size_t size() const
+  {
+    size_t head = dequeuePos_;
+    size_t tail = enqueuePos_;
+    intptr_t n = static_cast<intptr_t>(tail - head);
+    return n < 0 ? 0 : std::min(static_cast<size_t>(n), capacity_);
+  }
+
+  bool empty() const
+  {
+    return !canTake();
+  }
+
+  bool full() const
+  {
+    return !canPut();
+  }
+
+  size_t capacity() const
+  {
+    return capacity_;
+  }
+
+ private:
+  struct Cell
+  {
+    volatile size_t sequence;
+    T data;
+  };
+
+  static const int kSpinCount = 64;
+
+  static size_t roundUp(size_t n)
+  {
+    size_t cap = 2;
+    while (cap < n)
+      cap <<= 1;
+    return cap;
+  }
+
+  bool canPut() const
+  {
+    size_t pos = enqueuePos_;
+    return static_cast<intptr_t>(
+        detail::loadAcquire(&cells_[pos & mask_].sequence) - pos) >= 0;
+  }
+
+  bool canTake() const
+  {
+    size_t pos = dequeuePos_;
+    return static_cast<intptr_t>(
+        detail::loadAcquire(&cells_[pos & mask_].sequence) - (pos + 1)) >= 0;
+  }
+
+  // Spins on ready() for a while, then sleeps on seq. A waker bumps seq
+  // after publishing, and the waiter re-checks ready() after registering
+  // itself, so either the waiter sees the new item or futexWait returns.
+  // The waker clears waiters and wakes everyone registered, so a burst of
+  // puts or takes costs one FUTEX_WAKE rather than one per element.
+  void waitUntil(bool (BoundedLockFreeQueue::*ready)() const,
+                 volatile int* seq, volatile int* waiters)
+  {
+    for (int i = 0; i < kSpinCount; ++i)
+    {
+      if ((this->*ready)())
+        return;
+#if defined(__i386__) || defined(__x86_64__)
+      __builtin_ia32_pause();
+#endif
+    }
+    int val = *seq;
+    __sync_fetch_and_add(waiters, 1);
+    if (!(this->*ready)())
+    {
+      detail::futexWait(seq, val);
+    }
+  }
+
+  void wake(volatile int* seq, volatile int* waiters)
+  {
+    __sync_synchronize();
+    if (*waiters > 0 && __sync_lock_test_and_set(waiters, 0) > 0)
+    {
+      __sync_fetch_and_add(seq, 1);
+      detail::futexWake(seq, INT_MAX);
+    }
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  Cell* const cells_;
+  char pad0_[64];
+  volatile size_t enqueuePos_;
+  char pad1_[64];
+  volatile size_t dequeuePos_;
+  char pad2_[64];
+  volatile int notEmptySeq_;
+  volatile int notEmptyWaiters_;
+  char pad3_[64];
+  volatile int notFullSeq_;
+  volatile int notFullWaiters_;
+};
+
+}
+
+#endif  // MUDUO_BASE_BOUNDEDLOCKFREEQUEUE_H
@@ -0,0 +1,179 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/base/Crc32c.h>
+
+#include <string.h>
+
+#if defined(__SSE4_2__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define MUDUO_CRC32C_SSE42 1
+#endif
+
+using namespace muduo;
+
+namespace
+{
+
+#ifndef MUDUO_CRC32C_SSE42
+const uint32_t kPolynomial = 0x82f63b78;  // reversed 0x1edc6f41
+
+// table_[k][b] is the crc of byte b followed by k zero bytes
+struct Tables
+{
+  Tables()
+  {
+    for (uint32_t b = 0; b < 256; ++b)
+    {
+      uint32_t crc = b;
+      for (int i = 0; i < 8; ++i)
+      {
+        crc = (crc >> 1) ^ (kPolynomial & (0 - (crc & 1)));
+      }
+      table_[0][b] = crc;
+    }
+    for (int k = 1; k < 8; ++k)
+    {
+      for (uint32_t b = 0; b < 256; ++b)
+      {
+        uint32_t crc = table_[k - 1][b];
+        table_[k][b] = (crc >> 8) ^ table_[0][crc & 0xff];
+      }
+    }
+  }
+
+  uint32_t table_[8][256];
+};
+
+const Tables tables;
+#else
+inline uint64_t load64(const uint8_t* p)
+{
+  uint64_t word;
+  memcpy(&word, p, sizeof word);
+  return word;
+}
+
+// The instruction takes three cycles, and can start one every cycle,
+// so three streams are run at once and joined by shifting: the state after
+// bytes a then b is shift(state after a, b.size) ^ state after b from 0.
+// The state after n zero bytes is linear in the state before.
+class Shift
+{
+ public:
+  explicit Shift(size_t n)
+  {
+    uint32_t basis[32];
+    for (int i = 0; i < 32; ++i)
+    {
+      uint64_t c = 1u << i;
+      for (size_t k = 0; k < n; k += 8)
+      {
+        c = _mm_crc32_u64(c, 0);
+      }
+      basis[i] = static_cast<uint32_t>(c);
+    }
+    for (int j = 0; j < 4; ++j)
+    {
+      for (uint32_t b = 0; b < 256; ++b)
+      {
+        uint32_t c = 0;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+          if (b & (1u << bit))
+            c ^= basis[8 * j + bit];
+        }
+        table_[j][b] = c;
+      }
+    }
+  }
+
+  uint32_t operator()(uint32_t c) const
+  {
+    return table_[0][c & 0xff] ^ table_[1][(c >> 8) & 0xff]
+         ^ table_[2][(c >> 16) & 0xff] ^ table_[3][c >> 24];
+  }
+
+ private:
+  uint32_t table_[4][256];
+};
+
+const size_t kLongBlock = 8192;
+const size_t kShortBlock = 256;
+const Shift longShift(kLongBlock);
+const Shift shortShift(kShortBlock);
+
+uint32_t extend3(uint32_t c, const uint8_t** p, const uint8_t* end,
+                 size_t block, const Shift& shift)
+{
+  const uint8_t* a = *p;
+  while (static_cast<size_t>(end - a) >= 3 * block)
+  {
+    const uint8_t* b = a + block;
+    const uint8_t* d = b + block;
+    uint64_t ca = c, cb = 0, cd = 0;
+    for (size_t i = 0; i < block; i += 8)
+    {
+      ca = _mm_crc32_u64(ca, load64(a + i));
+      cb = _mm_crc32_u64(cb, load64(b + i));
+      cd = _mm_crc32_u64(cd, load64(d + i));
+    }
+    c = shift(shift(static_cast<uint32_t>(ca)) ^ static_cast<uint32_t>(cb))
+        ^ static_cast<uint32_t>(cd);
+    a = d + block;
+  }
+  *p = a;
+  return c;
+}
+#endif
+
+}
+
+uint32_t Crc32c::extend(uint32_t crc, const void* data, size_t n)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  const uint8_t* const end = p + n;
+  uint32_t c = ~crc;
+#ifdef MUDUO_CRC32C_SSE42
+  c = extend3(c, &p, end, kLongBlock, longShift);
+  c = extend3(c, &p, end, kShortBlock, shortShift);
+  uint64_t c64 = c;
+  while (end - p >= 8)
+  {
+    c64 = _mm_crc32_u64(c64, load64(p));
+    p += 8;
+  }
+  c = static_cast<uint32_t>(c64);
+  while (p < end)
+  {
+    c = _mm_crc32_u8(c, *p++);
+  }
+#else
+  const uint32_t (*t)[256] = tables.table_;
+  while (end - p >= 8)
+  {
+    // little endian
+    uint32_t lo, hi;
+    memcpy(&lo, p, sizeof lo);
+    memcpy(&hi, p + 4, sizeof hi);
+    lo ^= c;
+    c = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24]
+      ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    p += 8;
+  }
+  while (p < end)
+  {
+    c = (c >> 8) ^ t[0][(c ^ *p++) & 0xff];
+  }
+#endif
+  return ~c;
+}
+
+bool Crc32c::isHardware()
+{
+#ifdef MUDUO_CRC32C_SSE42
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,31 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_BASE_CRC32C_H
+#define MUDUO_BASE_CRC32C_H
+
+#include <muduo/base/Types.h>
+
+namespace muduo
+{
+
+/// CRC-32C (Castagnoli), as in iSCSI and SCTP.
+/// With the SSE 4.2 crc32 instruction when the build targets a CPU that
+/// has it, -march=native does, otherwise eight bytes at a time from tables.
+namespace Crc32c
+{
+  /// The crc of data[0, n) following bytes whose crc is crc, 0 for none.
+  uint32_t extend(uint32_t crc, const void* data, size_t n);
+
+  inline uint32_t value(const void* data, size_t n)
+  { return extend(0, data, n); }
+
+  /// True if extend() uses the crc32 instruction.
+  bool isHardware();
+}
+
+}
+
+#endif  // MUDUO_BASE_CRC32C_H
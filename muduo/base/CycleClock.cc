@@ -0,0 +1,76 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/base/CycleClock.h>
+
+#include <pthread.h>
+#include <time.h>
+
+using namespace muduo;
+
+namespace
+{
+
+pthread_once_t g_once = PTHREAD_ONCE_INIT;
+double g_nanoSecondsPerCycle = 1.0;
+int64_t g_baseCycles = 0;
+int64_t g_baseMicroSeconds = 0;
+
+void calibrate()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  const int64_t kCalibrationNanoSeconds = 10 * 1000 * 1000;
+  int64_t startNs = CycleClock::monotonicNanoSeconds();
+  int64_t startCycles = CycleClock::now();
+  int64_t endNs = startNs;
+  int64_t endCycles = startCycles;
+  while (endNs - startNs < kCalibrationNanoSeconds)
+  {
+    endNs = CycleClock::monotonicNanoSeconds();
+    endCycles = CycleClock::now();
+  }
+  g_nanoSecondsPerCycle = static_cast<double>(endNs - startNs)
+                        / static_cast<double>(endCycles - startCycles);
+#endif
+  g_baseCycles = CycleClock::now();
+  g_baseMicroSeconds = Timestamp::now().microSecondsSinceEpoch();
+}
+
+inline void calibrateOnce()
+{
+  pthread_once(&g_once, calibrate);
+}
+
+}
+
+int64_t CycleClock::monotonicNanoSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+double CycleClock::cyclesPerSecond()
+{
+  calibrateOnce();
+  return 1e9 / g_nanoSecondsPerCycle;
+}
+
+int64_t CycleClock::toNanoSeconds(int64_t cycles)
+{
+  calibrateOnce();
+  return static_cast<int64_t>(static_cast<double>(cycles) * g_nanoSecondsPerCycle);
+}
+
+double CycleClock::toSeconds(int64_t cycles)
+{
+  calibrateOnce();
+  return static_cast<double>(cycles) * g_nanoSecondsPerCycle * 1e-9;
+}
+
+Timestamp CycleClock::toTimestamp(int64_t cycles)
+{
+  calibrateOnce();
+  double elapsedUs = static_cast<double>(cycles - g_baseCycles) * g_nanoSecondsPerCycle * 1e-3;
+  return Timestamp(g_baseMicroSeconds + static_cast<int64_t>(elapsedUs));
+}
@@ -0,0 +1,54 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef MUDUO_BASE_CYCLECLOCK_H
+#define MUDUO_BASE_CYCLECLOCK_H
+
+#include <muduo/base/Timestamp.h>
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Low overhead clock reading the CPU time stamp counter, for measuring
+/// short intervals on hot paths where Timestamp::now() is too costly.
+///
+/// Assumes an invariant TSC (constant_tsc and nonstop_tsc in /proc/cpuinfo),
+/// true for x86-64 CPUs of the last decade.
+/// Other architectures fall back to CLOCK_MONOTONIC in nanoseconds.
+///
+class CycleClock
+{
+ public:
+  static int64_t now()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return static_cast<int64_t>((static_cast<uint64_t>(hi) << 32) | lo);
+#else
+    return monotonicNanoSeconds();
+#endif
+  }
+
+  ///
+  /// Calibrated against CLOCK_MONOTONIC on first call, which spins for 10ms.
+  ///
+  static double cyclesPerSecond();
+
+  static int64_t toNanoSeconds(int64_t cycles);
+  static double toSeconds(int64_t cycles);
+
+  ///
+  /// Wall clock time of a cycle count, anchored at calibration.
+  ///
+  static Timestamp toTimestamp(int64_t cycles);
+  static Timestamp nowTimestamp() { return toTimestamp(now()); }
+
+  static int64_t monotonicNanoSeconds();
+};
+
+}
+#endif  // MUDUO_BASE_CYCLECLOCK_H
@@ -0,0 +1,220 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/base/LatencyHistogram.h>
+
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/LogStream.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Singleton.h>
+
+#include <algorithm>
+
+#include <string.h>
+
+using namespace muduo;
+
+namespace
+{
+
+const int64_t kMaxValue = (static_cast<int64_t>(1) << LatencyHistogram::kMaxValueBits) - 1;
+const int64_t kNoMin = static_cast<int64_t>(~(static_cast<uint64_t>(1) << 63));
+
+struct Registry
+{
+  void no_destroy();  // histograms may outlive atexit()
+
+  MutexLock mutex;
+  std::vector<LatencyHistogram*> histograms;
+};
+
+}
+
+int LatencyHistogram::bucketIndex(int64_t value)
+{
+  if (value < 2 * kSubBuckets)
+  {
+    return value < 0 ? 0 : static_cast<int>(value);
+  }
+  if (value > kMaxValue)
+  {
+    value = kMaxValue;
+  }
+  int msb = 63 - __builtin_clzll(static_cast<unsigned long long>(value));
+  int shift = msb - kSubBucketBits;
+  return (shift + 1) * kSubBuckets + static_cast<int>(value >> shift) - kSubBuckets;
+}
+
+int64_t LatencyHistogram::bucketLowest(int index)
+{
+  if (index < 2 * kSubBuckets)
+  {
+    return index;
+  }
+  int shift = index / kSubBuckets - 1;
+  int64_t sub = index % kSubBuckets + kSubBuckets;
+  return sub << shift;
+}
+
+int64_t LatencyHistogram::bucketHighest(int index)
+{
+  return index + 1 < kNumBuckets ? bucketLowest(index + 1) - 1 : kMaxValue;
+}
+
+LatencyHistogram::Snapshot::Snapshot()
+  : buckets_(kNumBuckets),
+    count_(0),
+    sum_(0),
+    min_(kNoMin),
+    max_(0)
+{
+}
+
+void LatencyHistogram::Snapshot::merge(const Snapshot& that)
+{
+  for (int i = 0; i < kNumBuckets; ++i)
+  {
+    buckets_[i] += that.buckets_[i];
+  }
+  count_ += that.count_;
+  sum_ += that.sum_;
+  min_ = std::min(min_, that.min_);
+  max_ = std::max(max_, that.max_);
+}
+
+double LatencyHistogram::Snapshot::mean() const
+{
+  return count_ > 0 ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0;
+}
+
+int64_t LatencyHistogram::Snapshot::percentile(double percent) const
+{
+  if (count_ == 0)
+  {
+    return 0;
+  }
+  int64_t target = static_cast<int64_t>(percent / 100 * static_cast<double>(count_) + 0.5);
+  target = std::max(target, static_cast<int64_t>(1));
+  int64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i)
+  {
+    seen += buckets_[i];
+    if (seen >= target)
+    {
+      int64_t value = (bucketLowest(i) + bucketHighest(i)) / 2;
+      return std::min(std::max(value, min()), max());
+    }
+  }
+  return max();
+}
+
+string LatencyHistogram::Snapshot::toString() const
+{
+  LogStream s;
+  s << "count " << count_
+    << " min " << min()
+    << " mean " << static_cast<int64_t>(mean())
+    << " p50 " << percentile(50)
+    << " p90 " << percentile(90)
+    << " p99 " << percentile(99)
+    << " p999 " << percentile(99.9)
+    << " max " << max();
+  return s.buffer().toString();
+}
+
+LatencyHistogram::LatencyHistogram(const string& name)
+  : name_(name),
+    shards_(new Shard[kNumShards])
+{
+  reset();
+  Registry& registry = Singleton<Registry>::instance();
+  MutexLockGuard lock(registry.mutex);
+  registry.histograms.push_back(this);
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+  Registry& registry = Singleton<Registry>::instance();
+  MutexLockGuard lock(registry.mutex);
+  std::vector<LatencyHistogram*>::iterator it =
+    std::find(registry.histograms.begin(), registry.histograms.end(), this);
+  assert(it != registry.histograms.end());
+  registry.histograms.erase(it);
+}
+
+void LatencyHistogram::record(int64_t value)
+{
+  if (value < 0)
+  {
+    value = 0;
+  }
+  Shard& shard = shards_[CurrentThread::tid() % kNumShards];
+  __sync_fetch_and_add(&shard.buckets[bucketIndex(value)], 1);
+  __sync_fetch_and_add(&shard.count, 1);
+  __sync_fetch_and_add(&shard.sum, value);
+
+  int64_t min = shard.min;
+  while (value < min && !__sync_bool_compare_and_swap(&shard.min, min, value))
+  {
+    min = shard.min;
+  }
+  int64_t max = shard.max;
+  while (value > max && !__sync_bool_compare_and_swap(&shard.max, max, value))
+  {
+    max = shard.max;
+  }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+  Snapshot result;
+  for (int i = 0; i < kNumShards; ++i)
+  {
+    const Shard& shard = shards_[i];
+    for (int j = 0; j < kNumBuckets; ++j)
+    {
+      result.buckets_[j] += shard.buckets[j];
+    }
+    result.count_ += shard.count;
+    result.sum_ += shard.sum;
+    result.min_ = std::min(result.min_, shard.min);
+    result.max_ = std::max(result.max_, shard.max);
+  }
+  return result;
+}
+
+void LatencyHistogram::reset()
+{
+  for (int i = 0; i < kNumShards; ++i)
+  {
+    Shard& shard = shards_[i];
+    memset(shard.buckets, 0, sizeof shard.buckets);
+    shard.count = 0;
+    shard.sum = 0;
+    shard.min = kNoMin;
+    shard.max = 0;
+  }
+}
+
+string LatencyHistogram::dumpAll(const string& name, bool reset)
+{
+  string result;
+  Registry& registry = Singleton<Registry>::instance();
+  MutexLockGuard lock(registry.mutex);
+  for (size_t i = 0; i < registry.histograms.size(); ++i)
+  {
+    LatencyHistogram* histogram = registry.histograms[i];
+    if (name.empty() || name == histogram->name())
+    {
+      result += histogram->name();
+      result += " ";
+      result += histogram->snapshot().toString();
+      result += "\n";
+      if (reset)
+      {
+        histogram->reset();
+      }
+    }
+  }
+  return result;
+}
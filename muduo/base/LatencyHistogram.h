@@ -0,0 +1,125 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef MUDUO_BASE_LATENCYHISTOGRAM_H
+#define MUDUO_BASE_LATENCYHISTOGRAM_H
+
+#include <muduo/base/copyable.h>
+#include <muduo/base/CycleClock.h>
+#include <muduo/base/Types.h>
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+namespace muduo
+{
+
+///
+/// Latency histogram with HDR-style log-linear buckets:
+/// 32 sub-buckets per power of two, i.e. 3% relative error,
+/// values above 2^40 (18 minutes in nanoseconds) are clamped.
+///
+/// record() is lock-free, it adds to one of kNumShards shards picked by
+/// the thread id, so threads rarely share a cache line.
+/// snapshot() merges all shards.
+///
+/// Every live histogram is listed by dumpAll(), which PerformanceInspector
+/// serves at /perf/latency.
+///
+class LatencyHistogram : boost::noncopyable
+{
+ public:
+  static const int kSubBucketBits = 5;
+  static const int kSubBuckets = 1 << kSubBucketBits;
+  static const int kMaxValueBits = 40;
+  static const int kNumBuckets = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+  static const int kNumShards = 8;
+
+  class Snapshot : public muduo::copyable
+  {
+   public:
+    Snapshot();
+
+    void merge(const Snapshot& that);
+
+    int64_t count() const { return count_; }
+    int64_t sum() const { return sum_; }
+    int64_t min() const { return count_ > 0 ? min_ : 0; }
+    int64_t max() const { return max_; }
+    double mean() const;
+
+    /// value at percentile in [0, 100], e.g. 99.9
+    int64_t percentile(double percent) const;
+
+    /// count min mean p50 p90 p99 p999 max
+    string toString() const;
+
+   private:
+    friend class LatencyHistogram;
+    std::vector<int64_t> buckets_;
+    int64_t count_;
+    int64_t sum_;
+    int64_t min_;
+    int64_t max_;
+  };
+
+  explicit LatencyHistogram(const string& name);
+  ~LatencyHistogram();
+
+  const string& name() const { return name_; }
+
+  /// usually nanoseconds, as recorded by ScopedLatency
+  void record(int64_t value);
+
+  Snapshot snapshot() const;
+
+  /// not atomic with concurrent record()
+  void reset();
+
+  /// one line per histogram, only the ones of name if not empty
+  static string dumpAll(const string& name, bool reset);
+
+  static int bucketIndex(int64_t value);
+  static int64_t bucketLowest(int index);
+  static int64_t bucketHighest(int index);
+
+ private:
+  struct Shard
+  {
+    int64_t buckets[kNumBuckets];
+    int64_t count;
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+    char padding[64];
+  };
+
+  const string name_;
+  boost::scoped_array<Shard> shards_;
+};
+
+///
+/// Records the nanoseconds from construction to destruction.
+///
+class ScopedLatency : boost::noncopyable
+{
+ public:
+  explicit ScopedLatency(LatencyHistogram* histogram)
+    : histogram_(histogram),
+      start_(CycleClock::now())
+  {
+  }
+
+  ~ScopedLatency()
+  {
+    histogram_->record(CycleClock::toNanoSeconds(CycleClock::now() - start_));
+  }
+
+ private:
+  LatencyHistogram* histogram_;
+  int64_t start_;
+};
+
+}
+#endif  // MUDUO_BASE_LATENCYHISTOGRAM_H
@@ -1,6 +1,7 @@
 #include <muduo/base/Logging.h>
 
 #include <muduo/base/CurrentThread.h>
+#include <muduo/base/Mutex.h>
 #include <muduo/base/Timestamp.h>
 #include <muduo/base/TimeZone.h>
 
@@ -33,6 +34,7 @@ class LoggerImpl
 __thread char t_errnobuf[512];
 __thread char t_time[32];
 __thread time_t t_lastSecond;
+__thread time_t t_lastMinute;
 
 //̸߳errornoϸַϢһȫֺ
 const char* strerror_tl(int savedErrno)
@@ -52,6 +54,41 @@ Logger::LogLevel initLogLevel()
 }
 
 Logger::LogLevel g_logLevel = initLogLevel();
+Logger::LogLevel g_minLogLevel = g_logLevel;
+int g_numModuleLogLevels = 0;
+
+// Entries are appended under the mutex and never removed, only deactivated,
+// so readers in Logger::logLevel(file) can scan the table without locking.
+struct ModuleLogLevel
+{
+  char name[32];
+  int len;
+  Logger::LogLevel level;  // NUM_LOG_LEVELS means inactive
+};
+
+const int kMaxModuleLogLevels = 64;
+ModuleLogLevel g_moduleLogLevels[kMaxModuleLogLevels];
+int g_moduleLogLevelsSize = 0;
+MutexLock g_moduleLogLevelsMutex;
+
+// REQUIRES: g_moduleLogLevelsMutex held
+void updateMinLogLevel()
+{
+  Logger::LogLevel minLevel = g_logLevel;
+  int active = 0;
+  for (int i = 0; i < g_moduleLogLevelsSize; ++i)
+  {
+    Logger::LogLevel level = g_moduleLogLevels[i].level;
+    if (level != Logger::NUM_LOG_LEVELS)
+    {
+      ++active;
+      if (level < minLevel)
+        minLevel = level;
+    }
+  }
+  g_numModuleLogLevels = active;
+  g_minLogLevel = minLevel;
+}
 
 const char* LogLevelName[Logger::NUM_LOG_LEVELS] =
 {
@@ -105,6 +142,7 @@ void defaultFlush()
 //ȫֱ
 Logger::OutputFunc g_output = defaultOutput;  //ĬϵĻ
 Logger::FlushFunc g_flush = defaultFlush;
+Logger::ClockFunc g_clock = Timestamp::now;
 TimeZone g_logTimeZone;
 
 }   //ȫȫ
@@ -112,7 +150,7 @@ TimeZone g_logTimeZone;
 using namespace muduo;
 
 Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile& file, int line)
-  : time_(Timestamp::now()),
+  : time_(g_clock()),
     stream_(),
     level_(level),
     line_(line),
@@ -141,33 +179,53 @@ void Logger::Impl::formatTime()
   if (seconds != t_lastSecond)
   {
     t_lastSecond = seconds;
-    struct tm tm_time;
-    if (g_logTimeZone.valid())
+    // zone offsets are whole minutes, so within the same minute
+    // only the two digits of second need to be rewritten.
+    if (seconds / 60 == t_lastMinute)
     {
-      tm_time = g_logTimeZone.toLocalTime(seconds);
+      int second = static_cast<int>(seconds % 60);
+      t_time[15] = static_cast<char>('0' + second / 10);
+      t_time[16] = static_cast<char>('0' + second % 10);
     }
     else
     {
-      ::gmtime_r(&seconds, &tm_time); // FIXME TimeZone::fromUtcTime
+      t_lastMinute = seconds / 60;
+      struct tm tm_time;
+      if (g_logTimeZone.valid())
+      {
+        tm_time = g_logTimeZone.toLocalTime(seconds);
+      }
+      else
+      {
+        ::gmtime_r(&seconds, &tm_time); // FIXME TimeZone::fromUtcTime
+      }
+
+      int len = snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
+          tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+          tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+      assert(len == 17); (void)len;
     }
-
-    int len = snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
-        tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
-        tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
-    assert(len == 17); (void)len;
   }
 
+  char us[10];
+  us[0] = '.';
+  for (int i = 6; i > 0; --i)
+  {
+    us[i] = static_cast<char>('0' + microseconds % 10);
+    microseconds /= 10;
+  }
   if (g_logTimeZone.valid())
   {
-    Fmt us(".%06d ", microseconds);
-    assert(us.length() == 8);
-    stream_ << T(t_time, 17) << T(us.data(), 8);  //ʽ
+    us[7] = ' ';
+    us[8] = '\0';
+    stream_ << T(t_time, 17) << T(us, 8);  //ʽ
   }
   else
   {
-    Fmt us(".%06dZ ", microseconds);
-    assert(us.length() == 9);
-    stream_ << T(t_time, 17) << T(us.data(), 9);
+    us[7] = 'Z';
+    us[8] = ' ';
+    us[9] = '\0';
+    stream_ << T(t_time, 17) << T(us, 9);
   }
 }
 
@@ -212,7 +270,97 @@ Logger::~Logger()   //
 
 void Logger::setLogLevel(Logger::LogLevel level)
 {
+  MutexLockGuard lock(g_moduleLogLevelsMutex);
   g_logLevel = level;
+  updateMinLogLevel();
+}
+
+Logger::LogLevel Logger::logLevel(const SourceFile& file)
+{
+  LogLevel level = g_logLevel;
+  int longest = 0;
+  int size = g_moduleLogLevelsSize;
+  __sync_synchronize();
+  for (int i = 0; i < size; ++i)
+  {
+    const ModuleLogLevel& m = g_moduleLogLevels[i];
+    LogLevel moduleLevel = m.level;
+    if (moduleLevel != NUM_LOG_LEVELS
+        && m.len > longest
+        && m.len <= file.size_
+        && memcmp(m.name, file.data_, m.len) == 0)
+    {
+      level = moduleLevel;
+      longest = m.len;
+    }
+  }
+  return level;
+}
+
+bool Logger::setModuleLogLevel(const string& module, LogLevel level)
+{
+  if (module.empty()
+      || module.size() >= sizeof g_moduleLogLevels[0].name
+      || level < TRACE || level >= NUM_LOG_LEVELS)
+  {
+    return false;
+  }
+
+  MutexLockGuard lock(g_moduleLogLevelsMutex);
+  for (int i = 0; i < g_moduleLogLevelsSize; ++i)
+  {
+    ModuleLogLevel& m = g_moduleLogLevels[i];
+    if (module == m.name)
+    {
+      m.level = level;
+      updateMinLogLevel();
+      return true;
+    }
+  }
+
+  if (g_moduleLogLevelsSize >= kMaxModuleLogLevels)
+  {
+    return false;
+  }
+  ModuleLogLevel& m = g_moduleLogLevels[g_moduleLogLevelsSize];
+  memcpy(m.name, module.c_str(), module.size()+1);
+  m.len = static_cast<int>(module.size());
+  m.level = level;
+  // publish the entry before making it visible to readers
+  __sync_synchronize();
+  ++g_moduleLogLevelsSize;
+  updateMinLogLevel();
+  return true;
+}
+
+void Logger::resetModuleLogLevel(const string& module)
+{
+  MutexLockGuard lock(g_moduleLogLevelsMutex);
+  for (int i = 0; i < g_moduleLogLevelsSize; ++i)
+  {
+    ModuleLogLevel& m = g_moduleLogLevels[i];
+    if (module == m.name)
+    {
+      m.level = NUM_LOG_LEVELS;
+      updateMinLogLevel();
+      break;
+    }
+  }
+}
+
+Logger::ModuleLogLevelList Logger::moduleLogLevels()
+{
+  ModuleLogLevelList result;
+  MutexLockGuard lock(g_moduleLogLevelsMutex);
+  for (int i = 0; i < g_moduleLogLevelsSize; ++i)
+  {
+    const ModuleLogLevel& m = g_moduleLogLevels[i];
+    if (m.level != NUM_LOG_LEVELS)
+    {
+      result.push_back(std::make_pair(string(m.name, m.len), m.level));
+    }
+  }
+  return result;
 }
 
 //OutputFuncǸָ룬OutputFuncڲд
@@ -226,6 +374,11 @@ void Logger::setFlush(FlushFunc flush)
   g_flush = flush;
 }
 
+void Logger::setClock(ClockFunc clock)
+{
+  g_clock = clock;
+}
+
 void Logger::setTimeZone(const TimeZone& tz)
 {
   g_logTimeZone = tz;
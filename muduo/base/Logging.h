@@ -4,6 +4,9 @@
 #include <muduo/base/LogStream.h>
 #include <muduo/base/Timestamp.h>
 
+#include <utility>
+#include <vector>
+
 namespace muduo
 {
 
@@ -79,10 +82,26 @@ class Logger
   static LogLevel logLevel();
   static void setLogLevel(LogLevel level);
 
+  // Per-module log level overrides.
+  // A module is matched against the prefix of the source file basename,
+  // e.g. "TcpConnection" matches TcpConnection.cc, "Tcp" matches TcpServer.cc too.
+  // The longest matching prefix wins, otherwise the global level applies.
+  // Only TRACE, DEBUG and INFO are subject to filtering, like before.
+  typedef std::vector<std::pair<string, LogLevel> > ModuleLogLevelList;
+  static LogLevel logLevel(const SourceFile& file);
+  static bool isEnabled(LogLevel level, const SourceFile& file);
+  static bool setModuleLogLevel(const string& module, LogLevel level);
+  static void resetModuleLogLevel(const string& module);
+  static ModuleLogLevelList moduleLogLevels();
+
   typedef void (*OutputFunc)(const char* msg, int len);
   typedef void (*FlushFunc)();
+  // Timestamp::now by default, Timestamp::cachedNow or Timestamp::nowCoarse
+  // trade precision for less time spent per log line.
+  typedef Timestamp (*ClockFunc)();
   static void setOutput(OutputFunc);
   static void setFlush(FlushFunc);
+  static void setClock(ClockFunc);
   static void setTimeZone(const TimeZone& tz);
 
  private:
@@ -107,12 +126,21 @@ class Impl
 };
 
 extern Logger::LogLevel g_logLevel;
+// min(g_logLevel, any module override), so that disabled levels cost one compare
+extern Logger::LogLevel g_minLogLevel;
+extern int g_numModuleLogLevels;
 
 inline Logger::LogLevel Logger::logLevel()
 {
   return g_logLevel;
 }
 
+inline bool Logger::isEnabled(LogLevel level, const SourceFile& file)
+{
+  return g_minLogLevel <= level
+      && (g_numModuleLogLevels == 0 ? g_logLevel <= level : logLevel(file) <= level);
+}
+
 // 
 // CAUTION: do not write:
 //
@@ -131,11 +159,11 @@ inline Logger::LogLevel Logger::logLevel()
 //
 //ǰҪж־
 //ú궨幹һݼţнд־û
-#define LOG_TRACE if (muduo::Logger::logLevel() <= muduo::Logger::TRACE) \
+#define LOG_TRACE if (muduo::Logger::isEnabled(muduo::Logger::TRACE, __FILE__)) \
   muduo::Logger(__FILE__, __LINE__, muduo::Logger::TRACE, __func__).stream()
-#define LOG_DEBUG if (muduo::Logger::logLevel() <= muduo::Logger::DEBUG) \
+#define LOG_DEBUG if (muduo::Logger::isEnabled(muduo::Logger::DEBUG, __FILE__)) \
   muduo::Logger(__FILE__, __LINE__, muduo::Logger::DEBUG, __func__).stream()
-#define LOG_INFO if (muduo::Logger::logLevel() <= muduo::Logger::INFO) \
+#define LOG_INFO if (muduo::Logger::isEnabled(muduo::Logger::INFO, __FILE__)) \
   muduo::Logger(__FILE__, __LINE__).stream()
 #define LOG_WARN muduo::Logger(__FILE__, __LINE__, muduo::Logger::WARN).stream()
 #define LOG_ERROR muduo::Logger(__FILE__, __LINE__, muduo::Logger::ERROR).stream()
@@ -93,6 +93,25 @@ void ThreadPool::run(const Task& task)
   }
 }
 
+bool ThreadPool::tryRun(const Task& task)
+{
+  if (threads_.empty())
+  {
+    task();
+  }
+  else
+  {
+    MutexLockGuard lock(mutex_);
+    if (isFull())
+    {
+      return false;
+    }
+    queue_.push_back(task);
+    notEmpty_.notify();
+  }
+  return true;
+}
+
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 void ThreadPool::run(Task&& task)
 {
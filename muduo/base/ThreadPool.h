@@ -48,6 +48,9 @@ class ThreadPool : boost::noncopyable
   void run(Task&& f);
 #endif
 
+  // Never blocks, returns false if the queue is full.
+  bool tryRun(const Task& f);
+
  private:
   bool isFull() const;
   void runInThread();
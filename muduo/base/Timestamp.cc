@@ -1,7 +1,8 @@
-less_than_comparable#include <muduo/base/Timestamp.h>
+#include <muduo/base/Timestamp.h>
 
 #include <sys/time.h>
 #include <stdio.h>
+#include <time.h>
 
 
 //μtoStringʵ
@@ -66,3 +67,19 @@ Timestamp Timestamp::now()
   return Timestamp(seconds * kMicroSecondsPerSecond + tv.tv_usec);
 }
 
+Timestamp Timestamp::nowCoarse()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+  int64_t seconds = ts.tv_sec;
+  return Timestamp(seconds * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
+
+namespace muduo
+{
+namespace detail
+{
+__thread int64_t t_cachedMicroSecondsSinceEpoch = 0;
+}
+}
+
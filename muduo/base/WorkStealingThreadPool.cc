@@ -0,0 +1,328 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/base/WorkStealingThreadPool.h>
+
+#include <muduo/base/Exception.h>
+#include <muduo/base/Logging.h>
+
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+namespace
+{
+
+// set in worker threads, so that run() from a task queues onto its own deque
+__thread const WorkStealingThreadPool* t_pool = NULL;
+__thread size_t t_workerIndex = 0;
+
+void pinToCpu(int cpu)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+  if (ret != 0)
+  {
+    errno = ret;
+    LOG_SYSERR << "pthread_setaffinity_np " << cpu;
+  }
+}
+
+}
+
+WorkStealingThreadPool::WorkStealingThreadPool(const string& nameArg)
+  : mutex_(),
+    notEmpty_(mutex_),
+    notFull_(mutex_),
+    name_(nameArg),
+    maxQueueSize_(0),
+    queued_(0),
+    nextWorker_(0),
+    idle_(0),
+    running_(false)
+{
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+  if (running_)
+  {
+    stop();
+  }
+}
+
+void WorkStealingThreadPool::start(int numThreads)
+{
+  assert(threads_.empty());
+  running_ = true;
+  // every deque must exist before any worker starts stealing
+  workers_.reserve(numThreads);
+  for (int i = 0; i < numThreads; ++i)
+  {
+    workers_.push_back(new Worker);
+  }
+  threads_.reserve(numThreads);
+  for (int i = 0; i < numThreads; ++i)
+  {
+    char id[32];
+    snprintf(id, sizeof id, "%d", i+1);
+    threads_.push_back(new muduo::Thread(
+          boost::bind(&WorkStealingThreadPool::runInThread, this, i), name_+id));
+    threads_[i].start();
+  }
+
+  if (numThreads == 0 && threadInitCallback_)
+  {
+    threadInitCallback_();
+  }
+}
+
+void WorkStealingThreadPool::stop()
+{
+  {
+  MutexLockGuard lock(mutex_);
+  running_ = false;
+  notEmpty_.notifyAll();
+  notFull_.notifyAll();
+  }
+  for_each(threads_.begin(),
+           threads_.end(),
+           boost::bind(&muduo::Thread::join, _1));
+}
+
+size_t WorkStealingThreadPool::queueSize() const
+{
+  return queued_;
+}
+
+void WorkStealingThreadPool::run(const Task& task)
+{
+  if (workers_.empty())
+  {
+    task();
+  }
+  else
+  {
+    reserve(1);
+    size_t index = t_pool == this
+                 ? t_workerIndex
+                 : __sync_fetch_and_add(&nextWorker_, 1) % workers_.size();
+    Worker& worker = workers_[index];
+    {
+    MutexLockGuard lock(worker.mutex);
+    worker.tasks.push_back(task);
+    }
+    wakeUp(1);
+  }
+}
+
+void WorkStealingThreadPool::runBatch(const std::vector<Task>& tasks)
+{
+  if (workers_.empty())
+  {
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+      tasks[i]();
+    }
+    return;
+  }
+
+  const size_t numWorkers = workers_.size();
+  std::vector<Task>::const_iterator it = tasks.begin();
+  while (it != tasks.end())
+  {
+    size_t reserved = reserve(static_cast<size_t>(tasks.end() - it));
+    size_t chunk = (reserved + numWorkers - 1) / numWorkers;
+    size_t first = __sync_fetch_and_add(&nextWorker_, 1);
+    size_t left = reserved;
+    for (size_t i = 0; left > 0; ++i)
+    {
+      size_t n = std::min(chunk, left);
+      Worker& worker = workers_[(first + i) % numWorkers];
+      {
+      MutexLockGuard lock(worker.mutex);
+      worker.tasks.insert(worker.tasks.end(), it, it + n);
+      }
+      it += n;
+      left -= n;
+    }
+    wakeUp(reserved);
+  }
+}
+
+// returns number of slots reserved, at least 1, blocks if queue is full
+size_t WorkStealingThreadPool::reserve(size_t n)
+{
+  if (maxQueueSize_ == 0)
+  {
+    __sync_fetch_and_add(&queued_, n);
+    return n;
+  }
+
+  for (;;)
+  {
+    size_t queued = queued_;
+    if (queued < maxQueueSize_ || !running_)
+    {
+      size_t k = queued < maxQueueSize_ ? std::min(n, maxQueueSize_ - queued) : n;
+      if (__sync_bool_compare_and_swap(&queued_, queued, queued + k))
+      {
+        return k;
+      }
+    }
+    else
+    {
+      MutexLockGuard lock(mutex_);
+      while (queued_ >= maxQueueSize_ && running_)
+      {
+        notFull_.wait();
+      }
+    }
+  }
+}
+
+void WorkStealingThreadPool::release()
+{
+  size_t queued = __sync_fetch_and_sub(&queued_, 1);
+  if (maxQueueSize_ > 0 && queued >= maxQueueSize_)
+  {
+    // the queue was full, producers might be waiting
+    MutexLockGuard lock(mutex_);
+    notFull_.notifyAll();
+  }
+}
+
+void WorkStealingThreadPool::wakeUp(size_t n)
+{
+  // pairs with the increment of idle_ before checking queued_ in runInThread(),
+  // queued_ has been increased with a full barrier in reserve().
+  size_t idle = idle_;
+  if (idle > 0)
+  {
+    MutexLockGuard lock(mutex_);
+    if (n >= idle)
+    {
+      notEmpty_.notifyAll();
+    }
+    else
+    {
+      for (size_t i = 0; i < n; ++i)
+      {
+        notEmpty_.notify();
+      }
+    }
+  }
+}
+
+bool WorkStealingThreadPool::take(size_t index, Task* task)
+{
+  Worker& worker = workers_[index];
+  MutexLockGuard lock(worker.mutex);
+  if (worker.tasks.empty())
+  {
+    return false;
+  }
+  task->swap(worker.tasks.front());
+  worker.tasks.pop_front();
+  return true;
+}
+
+// steals the older half of the first non-empty deque after ours
+bool WorkStealingThreadPool::steal(size_t index, std::vector<Task>* stolen, Task* task)
+{
+  const size_t numWorkers = workers_.size();
+  for (size_t i = 1; i < numWorkers; ++i)
+  {
+    Worker& victim = workers_[(index + i) % numWorkers];
+    {
+    MutexLockGuard lock(victim.mutex);
+    size_t n = (victim.tasks.size() + 1) / 2;
+    if (n == 0)
+    {
+      continue;
+    }
+    stolen->resize(n);
+    for (size_t j = 0; j < n; ++j)
+    {
+      (*stolen)[j].swap(victim.tasks.front());
+      victim.tasks.pop_front();
+    }
+    }
+
+    task->swap(stolen->front());
+    if (stolen->size() > 1)
+    {
+      Worker& worker = workers_[index];
+      MutexLockGuard lock(worker.mutex);
+      worker.tasks.insert(worker.tasks.end(), stolen->begin() + 1, stolen->end());
+    }
+    stolen->clear();
+    return true;
+  }
+  return false;
+}
+
+void WorkStealingThreadPool::runInThread(size_t index)
+{
+  try
+  {
+    t_pool = this;
+    t_workerIndex = index;
+    if (!cpus_.empty())
+    {
+      pinToCpu(cpus_[index % cpus_.size()]);
+    }
+    if (threadInitCallback_)
+    {
+      threadInitCallback_();
+    }
+
+    std::vector<Task> stolen;
+    Task task;
+    while (running_)
+    {
+      if (take(index, &task) || steal(index, &stolen, &task))
+      {
+        release();
+        task();
+        task.clear();
+      }
+      else
+      {
+        MutexLockGuard lock(mutex_);
+        __sync_fetch_and_add(&idle_, 1);
+        while (queued_ == 0 && running_)
+        {
+          notEmpty_.wait();
+        }
+        __sync_fetch_and_sub(&idle_, 1);
+      }
+    }
+  }
+  catch (const Exception& ex)
+  {
+    fprintf(stderr, "exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    fprintf(stderr, "reason: %s\n", ex.what());
+    fprintf(stderr, "stack trace: %s\n", ex.stackTrace());
+    abort();
+  }
+  catch (const std::exception& ex)
+  {
+    fprintf(stderr, "exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    fprintf(stderr, "reason: %s\n", ex.what());
+    abort();
+  }
+  catch (...)
+  {
+    fprintf(stderr, "unknown exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    throw; // rethrow
+  }
+}
@@ -0,0 +1,95 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
+#define MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
+
+#include <muduo/base/Condition.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Types.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <deque>
+#include <vector>
+
+namespace muduo
+{
+
+///
+/// Drop-in alternative to ThreadPool for many short CPU-bound tasks.
+///
+/// Each worker owns a deque with its own lock, run() spreads tasks
+/// round-robin (or onto the caller's deque when called from a worker),
+/// and an idle worker steals half of a busy worker's deque.
+/// The pool-wide lock is only taken to sleep and wake idle workers,
+/// and by producers blocked on setMaxQueueSize().
+///
+class WorkStealingThreadPool : boost::noncopyable
+{
+ public:
+  typedef boost::function<void ()> Task;
+
+  explicit WorkStealingThreadPool(const string& nameArg = string("WorkStealingThreadPool"));
+  ~WorkStealingThreadPool();
+
+  // Must be called before start().
+  // Bounds the number of queued tasks of all workers, like ThreadPool.
+  void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
+  void setThreadInitCallback(const Task& cb)
+  { threadInitCallback_ = cb; }
+  // Pins worker i to cpus[i % cpus.size()].
+  void setCpuAffinity(const std::vector<int>& cpus)
+  { cpus_ = cpus; }
+
+  void start(int numThreads);
+  void stop();
+
+  const string& name() const
+  { return name_; }
+
+  size_t queueSize() const;
+
+  // Could block if maxQueueSize > 0
+  void run(const Task& f);
+
+  // Queues tasks with one lock per worker instead of one per task.
+  // Could block if maxQueueSize > 0
+  void runBatch(const std::vector<Task>& tasks);
+
+ private:
+  struct Worker : boost::noncopyable
+  {
+    MutexLock mutex;
+    std::deque<Task> tasks;
+  };
+
+  size_t reserve(size_t n);
+  void release();
+  void wakeUp(size_t n);
+  bool take(size_t index, Task* task);
+  bool steal(size_t index, std::vector<Task>* stolen, Task* task);
+  void runInThread(size_t index);
+
+  mutable MutexLock mutex_;
+  Condition notEmpty_;
+  Condition notFull_;
+
+  string name_;
+  Task threadInitCallback_;
+  std::vector<int> cpus_;
+  boost::ptr_vector<muduo::Thread> threads_;
+  boost::ptr_vector<Worker> workers_;
+  size_t maxQueueSize_;
+  volatile size_t queued_;      // tasks reserved but not yet taken
+  volatile size_t nextWorker_;
+  volatile size_t idle_;        // workers waiting on notEmpty_
+  volatile bool running_;
+};
+
+}
+
+#endif  // MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
@@ -10,9 +10,12 @@ project "base"
             'AsyncLogging.cc',
             'Condition.cc',
             'CountDownLatch.cc',
+            'Crc32c.cc',
+            'CycleClock.cc',
             'Date.cc',
             'Exception.cc',
             'FileUtil.cc',
+            'LatencyHistogram.cc',
             'LogFile.cc',
             'Logging.cc',
             'LogStream.cc',
@@ -21,4 +24,5 @@ project "base"
             'TimeZone.cc',
             'Thread.cc',
             'ThreadPool.cc',
+            'WorkStealingThreadPool.cc',
      }
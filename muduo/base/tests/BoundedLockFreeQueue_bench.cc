@@ -0,0 +1,143 @@
+#include <muduo/base/BlockingQueue.h>
+#include <muduo/base/BoundedBlockingQueue.h>
+#include <muduo/base/BoundedLockFreeQueue.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Throughput of the three queues with P producers and C consumers,
+// each producer puts kItems ints, -1 tells a consumer to quit.
+
+const int kItems = 200000;
+const int kCapacity = 1024;
+const int kBatch = 32;
+
+struct Unbounded : muduo::BlockingQueue<int>
+{
+  static const char* name() { return "BlockingQueue"; }
+};
+
+struct Bounded : muduo::BoundedBlockingQueue<int>
+{
+  Bounded() : muduo::BoundedBlockingQueue<int>(kCapacity) { }
+  static const char* name() { return "BoundedBlockingQueue"; }
+};
+
+struct LockFree : muduo::BoundedLockFreeQueue<int>
+{
+  LockFree() : muduo::BoundedLockFreeQueue<int>(kCapacity) { }
+  static const char* name() { return "BoundedLockFreeQueue"; }
+};
+
+struct LockFreeBatch : LockFree
+{
+  static const char* name() { return "BoundedLockFreeQueue batch"; }
+};
+
+template<typename Queue>
+void produce(Queue* queue, muduo::CountDownLatch* latch)
+{
+  latch->wait();
+  for (int i = 0; i < kItems; ++i)
+  {
+    queue->put(i);
+  }
+}
+
+void produce(LockFreeBatch* queue, muduo::CountDownLatch* latch)
+{
+  latch->wait();
+  int items[kBatch];
+  for (int i = 0; i < kItems; i += kBatch)
+  {
+    for (int j = 0; j < kBatch; ++j)
+      items[j] = i + j;
+    queue->putBatch(items, kBatch);
+  }
+}
+
+template<typename Queue>
+void consume(Queue* queue)
+{
+  while (queue->take() >= 0)
+  {
+  }
+}
+
+void consume(LockFreeBatch* queue)
+{
+  int items[kBatch];
+  for (;;)
+  {
+    size_t n = queue->takeBatch(items, kBatch);
+    for (size_t i = 0; i < n; ++i)
+    {
+      if (items[i] < 0)
+      {
+        for (size_t j = i + 1; j < n; ++j)
+          queue->put(items[j]);
+        return;
+      }
+    }
+  }
+}
+
+template<typename Queue>
+void bench(int producers, int consumers)
+{
+  Queue queue;
+  muduo::CountDownLatch latch(1);
+  boost::ptr_vector<muduo::Thread> consumerThreads;
+  boost::ptr_vector<muduo::Thread> producerThreads;
+  for (int i = 0; i < consumers; ++i)
+  {
+    void (*func)(Queue*) = &consume;
+    consumerThreads.push_back(new muduo::Thread(boost::bind(func, &queue)));
+    consumerThreads.back().start();
+  }
+  for (int i = 0; i < producers; ++i)
+  {
+    void (*func)(Queue*, muduo::CountDownLatch*) = &produce;
+    producerThreads.push_back(new muduo::Thread(boost::bind(func, &queue, &latch)));
+    producerThreads.back().start();
+  }
+
+  muduo::Timestamp start = muduo::Timestamp::now();
+  latch.countDown();
+  for (int i = 0; i < producers; ++i)
+  {
+    producerThreads[i].join();
+  }
+  for (int i = 0; i < consumers; ++i)
+  {
+    queue.put(-1);
+  }
+  for (int i = 0; i < consumers; ++i)
+  {
+    consumerThreads[i].join();
+  }
+  double seconds = timeDifference(muduo::Timestamp::now(), start);
+  printf("%-28s %2d producers %2d consumers %8.3fs %10.0f items/s\n",
+         Queue::name(), producers, consumers, seconds,
+         producers * kItems / seconds);
+}
+
+int main(int argc, char* argv[])
+{
+  int maxThreads = argc > 1 ? atoi(argv[1]) : 8;
+  for (int producers = 1; producers <= maxThreads; producers *= 2)
+  {
+    for (int consumers = 1; consumers <= maxThreads; consumers *= 2)
+    {
+      bench<Unbounded>(producers, consumers);
+      bench<Bounded>(producers, consumers);
+      bench<LockFree>(producers, consumers);
+      bench<LockFreeBatch>(producers, consumers);
+    }
+  }
+}
@@ -0,0 +1,167 @@
+#include <muduo/base/BoundedLockFreeQueue.h>
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <string>
+#include <vector>
+#include <assert.h>
+#include <stdio.h>
+
+typedef muduo::BoundedLockFreeQueue<int> IntQueue;
+
+void testSingleThread()
+{
+  IntQueue queue(5);
+  assert(queue.capacity() == 8);
+  assert(queue.empty());
+  assert(!queue.full());
+
+  int x = 0;
+  assert(!queue.tryTake(&x));
+  for (int i = 0; i < 8; ++i)
+  {
+    assert(queue.tryPut(i));
+  }
+  assert(queue.full());
+  assert(queue.size() == 8);
+  assert(!queue.tryPut(8));
+
+  for (int i = 0; i < 8; ++i)
+  {
+    assert(queue.tryTake(&x));
+    assert(x == i);
+  }
+  assert(queue.empty());
+  assert(queue.size() == 0);
+
+  // wrap around several times with batches
+  int items[6] = { 0, 1, 2, 3, 4, 5 };
+  int out[8];
+  for (int round = 0; round < 10; ++round)
+  {
+    assert(queue.tryPutBatch(items, 6) == 6);
+    assert(queue.tryPutBatch(items, 6) == 2);
+    assert(queue.tryTakeBatch(out, 3) == 3);
+    assert(out[0] == 0 && out[1] == 1 && out[2] == 2);
+    assert(queue.takeBatch(out, 8) == 5);
+    assert(out[0] == 3 && out[4] == 1);
+    assert(queue.empty());
+  }
+  (void) x;
+  (void) items;
+  (void) out;
+}
+
+void testReleasesTaken()
+{
+  muduo::BoundedLockFreeQueue<std::string> queue(4);
+  queue.put("hello");
+  assert(queue.take() == "hello");
+  queue.put(std::string(1000, 'x'));
+  std::string s;
+  assert(queue.tryTake(&s));
+  assert(s.size() == 1000);
+}
+
+const int kItemsPerProducer = 200000;
+const int kStop = -1;
+
+void produce(IntQueue* queue, bool batch)
+{
+  if (batch)
+  {
+    int items[32];
+    for (int i = 1; i <= kItemsPerProducer; i += 32)
+    {
+      int n = 0;
+      for (; n < 32 && i + n <= kItemsPerProducer; ++n)
+      {
+        items[n] = i + n;
+      }
+      queue->putBatch(items, n);
+    }
+  }
+  else
+  {
+    for (int i = 1; i <= kItemsPerProducer; ++i)
+    {
+      queue->put(i);
+    }
+  }
+}
+
+void consume(IntQueue* queue, muduo::AtomicInt64* sum, muduo::AtomicInt64* count, bool batch)
+{
+  int64_t localSum = 0;
+  int64_t localCount = 0;
+  bool running = true;
+  while (running)
+  {
+    int items[16];
+    size_t n = batch ? queue->takeBatch(items, 16) : (items[0] = queue->take(), 1);
+    for (size_t i = 0; i < n; ++i)
+    {
+      if (items[i] == kStop)
+      {
+        running = false;
+        // hand the rest back, other consumers need their stop marks
+        for (size_t j = i + 1; j < n; ++j)
+          queue->put(items[j]);
+        break;
+      }
+      localSum += items[i];
+      ++localCount;
+    }
+  }
+  sum->add(localSum);
+  count->add(localCount);
+}
+
+void testThreads(int producers, int consumers, bool batch)
+{
+  IntQueue queue(64);
+  muduo::AtomicInt64 sum, count;
+  boost::ptr_vector<muduo::Thread> threads;
+  for (int i = 0; i < consumers; ++i)
+  {
+    threads.push_back(new muduo::Thread(boost::bind(consume, &queue, &sum, &count, batch)));
+    threads.back().start();
+  }
+  boost::ptr_vector<muduo::Thread> producerThreads;
+  for (int i = 0; i < producers; ++i)
+  {
+    producerThreads.push_back(new muduo::Thread(boost::bind(produce, &queue, batch)));
+    producerThreads.back().start();
+  }
+  for (int i = 0; i < producers; ++i)
+  {
+    producerThreads[i].join();
+  }
+  for (int i = 0; i < consumers; ++i)
+  {
+    queue.put(kStop);
+  }
+  for (int i = 0; i < consumers; ++i)
+  {
+    threads[i].join();
+  }
+  int64_t n = kItemsPerProducer;
+  assert(count.get() == producers * n);
+  assert(sum.get() == producers * n * (n + 1) / 2);
+  assert(queue.empty());
+  printf("producers %d consumers %d batch %d ok\n", producers, consumers, batch);
+  (void) n;
+}
+
+int main()
+{
+  testSingleThread();
+  testReleasesTaken();
+  testThreads(1, 1, false);
+  testThreads(4, 4, false);
+  testThreads(2, 6, true);
+  testThreads(6, 2, true);
+}
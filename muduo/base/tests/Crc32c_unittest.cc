@@ -0,0 +1,98 @@
+#include <muduo/base/Crc32c.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+using muduo::Crc32c::extend;
+using muduo::Crc32c::value;
+
+// RFC 3720, B.4
+void testVectors()
+{
+  char buf[32];
+  memset(buf, 0, sizeof buf);
+  assert(value(buf, sizeof buf) == 0x8a9136aa);
+  memset(buf, 0xff, sizeof buf);
+  assert(value(buf, sizeof buf) == 0x62a8ab43);
+  for (int i = 0; i < 32; ++i)
+  {
+    buf[i] = static_cast<char>(i);
+  }
+  assert(value(buf, sizeof buf) == 0x46dd794e);
+  for (int i = 0; i < 32; ++i)
+  {
+    buf[i] = static_cast<char>(31 - i);
+  }
+  assert(value(buf, sizeof buf) == 0x113fdb5c);
+
+  assert(value("123456789", 9) == 0xe3069283);
+  assert(value("", 0) == 0);
+  (void) buf;
+}
+
+// any split gives the same crc, at any alignment
+void testExtend()
+{
+  char buf[100];
+  for (int i = 0; i < 100; ++i)
+  {
+    buf[i] = static_cast<char>(i * 37 + 11);
+  }
+  for (int begin = 0; begin < 16; ++begin)
+  {
+    const uint32_t whole = value(buf + begin, sizeof buf - begin);
+    for (size_t split = begin; split <= sizeof buf; ++split)
+    {
+      uint32_t crc = extend(value(buf + begin, split - begin), buf + split, sizeof buf - split);
+      assert(crc == whole);
+      (void) crc;
+    }
+    (void) whole;
+  }
+}
+
+// a bit at a time
+uint32_t reference(const char* data, size_t n)
+{
+  uint32_t crc = ~0u;
+  for (size_t i = 0; i < n; ++i)
+  {
+    crc ^= static_cast<uint8_t>(data[i]);
+    for (int k = 0; k < 8; ++k)
+    {
+      crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+// long enough for the blocks of the hardware version
+void testLong()
+{
+  std::vector<char> buf(100000);
+  uint32_t x = 1;
+  for (size_t i = 0; i < buf.size(); ++i)
+  {
+    x = x * 1103515245 + 12345;
+    buf[i] = static_cast<char>(x >> 16);
+  }
+  const size_t lengths[] = { 767, 768, 769, 1000, 24575, 24576, 24577, 30000, 99990 };
+  for (size_t i = 0; i < sizeof lengths / sizeof lengths[0]; ++i)
+  {
+    for (size_t begin = 0; begin < 3; ++begin)
+    {
+      assert(value(&buf[begin], lengths[i]) == reference(&buf[begin], lengths[i]));
+    }
+  }
+}
+
+int main()
+{
+  testVectors();
+  testExtend();
+  testLong();
+  printf("hardware %d\n", muduo::Crc32c::isHardware());
+}
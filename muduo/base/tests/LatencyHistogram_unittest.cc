@@ -0,0 +1,116 @@
+#include <muduo/base/LatencyHistogram.h>
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/Thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <assert.h>
+#include <stdio.h>
+
+using muduo::CycleClock;
+using muduo::LatencyHistogram;
+
+void testBuckets()
+{
+  int last = -1;
+  for (int64_t v = 0; v < (1 << 20); ++v)
+  {
+    int index = LatencyHistogram::bucketIndex(v);
+    assert(index == last || index == last + 1);
+    assert(LatencyHistogram::bucketLowest(index) <= v);
+    assert(v <= LatencyHistogram::bucketHighest(index));
+    last = index;
+  }
+  (void) last;
+  int64_t max = (static_cast<int64_t>(1) << LatencyHistogram::kMaxValueBits) - 1;
+  assert(LatencyHistogram::bucketIndex(max) == LatencyHistogram::kNumBuckets - 1);
+  assert(LatencyHistogram::bucketIndex(max * 2) == LatencyHistogram::kNumBuckets - 1);
+  assert(LatencyHistogram::bucketIndex(-1) == 0);
+  (void) max;
+}
+
+void testPercentile()
+{
+  LatencyHistogram hist("test");
+  for (int i = 1; i <= 10000; ++i)
+  {
+    hist.record(i);
+  }
+  LatencyHistogram::Snapshot s = hist.snapshot();
+  assert(s.count() == 10000);
+  assert(s.min() == 1);
+  assert(s.max() == 10000);
+  assert(s.sum() == 10000 * 10001 / 2);
+  int64_t p50 = s.percentile(50);
+  int64_t p99 = s.percentile(99);
+  assert(p50 > 5000 * 97 / 100 && p50 < 5000 * 103 / 100);
+  assert(p99 > 9900 * 97 / 100 && p99 < 9900 * 103 / 100);
+  assert(s.percentile(100) == 10000);
+  (void) p50; (void) p99;
+  printf("%s\n", s.toString().c_str());
+
+  LatencyHistogram::Snapshot merged;
+  merged.merge(s);
+  merged.merge(s);
+  assert(merged.count() == 20000);
+  assert(merged.percentile(50) == p50);
+
+  hist.reset();
+  assert(hist.snapshot().count() == 0);
+}
+
+void recordInThread(LatencyHistogram* hist, int n)
+{
+  for (int i = 0; i < n; ++i)
+  {
+    hist->record(i % 1000);
+  }
+}
+
+void testThreads()
+{
+  LatencyHistogram hist("threads");
+  const int kThreads = 4;
+  const int kRecords = 100*1000;
+  boost::ptr_vector<muduo::Thread> threads;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads.push_back(new muduo::Thread(boost::bind(recordInThread, &hist, kRecords)));
+    threads.back().start();
+  }
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads[i].join();
+  }
+  assert(hist.snapshot().count() == kThreads * kRecords);
+  printf("%s", LatencyHistogram::dumpAll("threads", false).c_str());
+}
+
+void testCycleClock()
+{
+  printf("%.0f cycles per second\n", CycleClock::cyclesPerSecond());
+  int64_t start = CycleClock::now();
+  muduo::CurrentThread::sleepUsec(10 * 1000);
+  int64_t ns = CycleClock::toNanoSeconds(CycleClock::now() - start);
+  assert(ns >= 9 * 1000 * 1000 && ns < 1000 * 1000 * 1000);
+  double diff = timeDifference(CycleClock::nowTimestamp(), muduo::Timestamp::now());
+  assert(diff > -0.01 && diff < 0.01);
+  (void) ns; (void) diff;
+
+  LatencyHistogram hist("cycleclock");
+  for (int i = 0; i < 1000; ++i)
+  {
+    muduo::ScopedLatency latency(&hist);
+  }
+  printf("%s", LatencyHistogram::dumpAll("cycleclock", false).c_str());
+}
+
+int main()
+{
+  testBuckets();
+  testPercentile();
+  testThreads();
+  testCycleClock();
+  printf("All tests passed\n");
+}
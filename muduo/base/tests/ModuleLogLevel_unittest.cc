@@ -0,0 +1,109 @@
+#undef NDEBUG
+#include <muduo/base/Logging.h>
+
+#include <assert.h>
+#include <stdio.h>
+
+using muduo::Logger;
+
+int g_lines = 0;
+
+void countOutput(const char*, int)
+{
+  ++g_lines;
+}
+
+// the number of lines logged at each level by this file
+int logAll()
+{
+  g_lines = 0;
+  LOG_TRACE << "trace";
+  LOG_DEBUG << "debug";
+  LOG_INFO << "info";
+  LOG_WARN << "warn";
+  return g_lines;
+}
+
+void testLookup()
+{
+  Logger::setLogLevel(Logger::INFO);
+  assert(Logger::setModuleLogLevel("Tcp", Logger::DEBUG));
+  assert(Logger::setModuleLogLevel("TcpConnection", Logger::WARN));
+  assert(Logger::setModuleLogLevel("EventLoop", Logger::TRACE));
+
+  // the longest prefix of the basename wins
+  assert(Logger::logLevel(Logger::SourceFile("muduo/net/TcpServer.cc")) == Logger::DEBUG);
+  assert(Logger::logLevel(Logger::SourceFile("muduo/net/TcpConnection.cc")) == Logger::WARN);
+  assert(Logger::logLevel(Logger::SourceFile("EventLoop.cc")) == Logger::TRACE);
+  assert(Logger::logLevel(Logger::SourceFile("EventLoopThread.cc")) == Logger::TRACE);
+  assert(Logger::logLevel(Logger::SourceFile("Buffer.cc")) == Logger::INFO);
+  // the directory is not part of the module
+  assert(Logger::logLevel(Logger::SourceFile("Tcp/Buffer.cc")) == Logger::INFO);
+
+  assert(Logger::isEnabled(Logger::DEBUG, Logger::SourceFile("TcpServer.cc")));
+  assert(!Logger::isEnabled(Logger::INFO, Logger::SourceFile("TcpConnection.cc")));
+  assert(Logger::isEnabled(Logger::WARN, Logger::SourceFile("TcpConnection.cc")));
+  assert(!Logger::isEnabled(Logger::DEBUG, Logger::SourceFile("Buffer.cc")));
+
+  // setting a module again replaces its level
+  assert(Logger::setModuleLogLevel("Tcp", Logger::ERROR));
+  assert(Logger::logLevel(Logger::SourceFile("TcpServer.cc")) == Logger::ERROR);
+  assert(Logger::moduleLogLevels().size() == 3);
+
+  assert(!Logger::setModuleLogLevel("", Logger::DEBUG));
+  assert(!Logger::setModuleLogLevel(muduo::string(40, 'x'), Logger::DEBUG));
+  assert(!Logger::setModuleLogLevel("Buffer", Logger::NUM_LOG_LEVELS));
+  assert(Logger::moduleLogLevels().size() == 3);
+}
+
+void testReset()
+{
+  Logger::resetModuleLogLevel("TcpConnection");
+  // the shorter prefix applies again
+  assert(Logger::logLevel(Logger::SourceFile("TcpConnection.cc")) == Logger::ERROR);
+  Logger::resetModuleLogLevel("Tcp");
+  Logger::resetModuleLogLevel("EventLoop");
+  Logger::resetModuleLogLevel("NoSuchModule");
+  assert(Logger::moduleLogLevels().empty());
+  assert(Logger::logLevel(Logger::SourceFile("TcpConnection.cc")) == Logger::INFO);
+  assert(Logger::logLevel(Logger::SourceFile("EventLoop.cc")) == Logger::INFO);
+
+  // a reset module can be set again
+  assert(Logger::setModuleLogLevel("Tcp", Logger::TRACE));
+  assert(Logger::logLevel(Logger::SourceFile("TcpServer.cc")) == Logger::TRACE);
+  Logger::resetModuleLogLevel("Tcp");
+  assert(Logger::moduleLogLevels().empty());
+}
+
+void testMacros()
+{
+  Logger::setOutput(countOutput);
+  Logger::setLogLevel(Logger::INFO);
+  assert(logAll() == 2);
+
+  assert(Logger::setModuleLogLevel("ModuleLogLevel", Logger::TRACE));
+  assert(logAll() == 4);
+  // the global level does not apply to the module
+  Logger::setLogLevel(Logger::ERROR);
+  assert(logAll() == 4);
+  // nor the level of another module
+  assert(Logger::setModuleLogLevel("Module", Logger::WARN));
+  assert(logAll() == 4);
+
+  assert(Logger::setModuleLogLevel("ModuleLogLevel", Logger::WARN));
+  assert(logAll() == 1);  // WARN is never filtered
+  Logger::resetModuleLogLevel("ModuleLogLevel");
+  assert(logAll() == 1);
+  Logger::resetModuleLogLevel("Module");
+  assert(logAll() == 1);
+  Logger::setLogLevel(Logger::DEBUG);
+  assert(logAll() == 3);
+}
+
+int main()
+{
+  testLookup();
+  testReset();
+  testMacros();
+  printf("all tests passed\n");
+}
@@ -0,0 +1,79 @@
+#include <muduo/base/ThreadPool.h>
+#include <muduo/base/WorkStealingThreadPool.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+#include <stdio.h>
+
+const int kTasks = 1000*1000;
+
+// about 1us of work, like a small request
+void compute(muduo::CountDownLatch* latch)
+{
+  volatile double x = 1.0;
+  for (int i = 0; i < 200; ++i)
+  {
+    x = x * 1.000001 + 0.5;
+  }
+  latch->countDown();
+}
+
+void runBatch(muduo::ThreadPool* pool, const std::vector<muduo::ThreadPool::Task>& tasks)
+{
+  for (size_t i = 0; i < tasks.size(); ++i)
+  {
+    pool->run(tasks[i]);
+  }
+}
+
+void runBatch(muduo::WorkStealingThreadPool* pool,
+              const std::vector<muduo::WorkStealingThreadPool::Task>& tasks)
+{
+  pool->runBatch(tasks);
+}
+
+template<typename Pool>
+double bench(int numThreads, bool batch)
+{
+  Pool pool("bench");
+  pool.setMaxQueueSize(64 * 1024);
+  pool.start(numThreads);
+
+  muduo::CountDownLatch latch(kTasks);
+  typename Pool::Task task = boost::bind(compute, &latch);
+  muduo::Timestamp start(muduo::Timestamp::now());
+  if (batch)
+  {
+    std::vector<typename Pool::Task> tasks(64, task);
+    for (int i = 0; i < kTasks; i += 64)
+    {
+      runBatch(&pool, tasks);
+    }
+  }
+  else
+  {
+    for (int i = 0; i < kTasks; ++i)
+    {
+      pool.run(task);
+    }
+  }
+  latch.wait();
+  double seconds = timeDifference(muduo::Timestamp::now(), start);
+  pool.stop();
+  return seconds;
+}
+
+int main()
+{
+  printf("%d tasks, seconds (tasks/s)\n", kTasks);
+  printf("threads   ThreadPool               WorkStealing             WorkStealing batch\n");
+  for (int threads = 1; threads <= 64; threads *= 2)
+  {
+    double t1 = bench<muduo::ThreadPool>(threads, false);
+    double t2 = bench<muduo::WorkStealingThreadPool>(threads, false);
+    double t3 = bench<muduo::WorkStealingThreadPool>(threads, true);
+    printf("%7d   %6.3f (%10.0f)   %6.3f (%10.0f)   %6.3f (%10.0f)\n", threads,
+           t1, kTasks / t1, t2, kTasks / t2, t3, kTasks / t3);
+  }
+}
@@ -0,0 +1,58 @@
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+
+#include <stdio.h>
+
+using muduo::Logger;
+using muduo::Timestamp;
+
+const int kNumber = 10*1000*1000;
+
+void benchClock(const char* name, Logger::ClockFunc clock)
+{
+  int64_t sum = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kNumber; ++i)
+  {
+    sum += clock().microSecondsSinceEpoch();
+  }
+  Timestamp end(Timestamp::now());
+  double seconds = timeDifference(end, start);
+  printf("%12s: %6.2f ns/call %d\n", name, seconds * 1e9 / kNumber, static_cast<int>(sum & 1));
+}
+
+int g_total;
+
+void dummyOutput(const char* msg, int len)
+{
+  g_total += len;
+}
+
+void benchLogging(const char* name, Logger::ClockFunc clock)
+{
+  const int n = 1000*1000;
+  Logger::setOutput(dummyOutput);
+  Logger::setClock(clock);
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz" << i;
+  }
+  Timestamp end(Timestamp::now());
+  double seconds = timeDifference(end, start);
+  printf("%12s: %6.2f ns/log\n", name, seconds * 1e9 / n);
+}
+
+int main()
+{
+  benchClock("now", Timestamp::now);
+  benchClock("nowCoarse", Timestamp::nowCoarse);
+  benchClock("cachedNow", Timestamp::cachedNow);
+  // like EventLoop does once per iteration
+  Timestamp::setCachedNow(Timestamp::now());
+  benchClock("cachedNow", Timestamp::cachedNow);
+
+  benchLogging("now", Timestamp::now);
+  benchLogging("nowCoarse", Timestamp::nowCoarse);
+  benchLogging("cachedNow", Timestamp::cachedNow);
+}
@@ -0,0 +1,95 @@
+#include <muduo/base/WorkStealingThreadPool.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/Logging.h>
+
+#include <boost/bind.hpp>
+#include <stdio.h>
+
+muduo::AtomicInt32 g_count;
+
+void print()
+{
+  printf("tid=%d\n", muduo::CurrentThread::tid());
+}
+
+void printString(const std::string& str)
+{
+  LOG_INFO << str;
+  g_count.increment();
+  usleep(10*1000);
+}
+
+void spawn(muduo::WorkStealingThreadPool* pool, int depth)
+{
+  g_count.increment();
+  if (depth > 0)
+  {
+    pool->run(boost::bind(spawn, pool, depth-1));
+    pool->run(boost::bind(spawn, pool, depth-1));
+  }
+}
+
+void test(int maxSize)
+{
+  LOG_WARN << "Test WorkStealingThreadPool with max queue size = " << maxSize;
+  muduo::WorkStealingThreadPool pool("MainThreadPool");
+  pool.setMaxQueueSize(maxSize);
+  pool.start(5);
+  g_count.getAndSet(0);
+
+  LOG_WARN << "Adding";
+  pool.run(print);
+  pool.run(print);
+  for (int i = 0; i < 100; ++i)
+  {
+    char buf[32];
+    snprintf(buf, sizeof buf, "task %d", i);
+    pool.run(boost::bind(printString, std::string(buf)));
+  }
+
+  std::vector<muduo::WorkStealingThreadPool::Task> batch;
+  for (int i = 0; i < 100; ++i)
+  {
+    char buf[32];
+    snprintf(buf, sizeof buf, "batch %d", i);
+    batch.push_back(boost::bind(printString, std::string(buf)));
+  }
+  pool.runBatch(batch);
+  LOG_WARN << "Done";
+
+  muduo::CountDownLatch latch(1);
+  pool.run(boost::bind(&muduo::CountDownLatch::countDown, &latch));
+  latch.wait();
+  while (pool.queueSize() > 0)
+  {
+    usleep(10*1000);
+  }
+  pool.stop();
+  LOG_WARN << "Ran " << g_count.get() << " tasks";
+}
+
+void testSpawn()
+{
+  // tasks queued from workers land on their own deques and get stolen
+  muduo::WorkStealingThreadPool pool("SpawnThreadPool");
+  pool.start(4);
+  g_count.getAndSet(0);
+  pool.run(boost::bind(spawn, &pool, 15));
+  while (g_count.get() < (1 << 16) - 1)
+  {
+    usleep(10*1000);
+  }
+  pool.stop();
+  LOG_WARN << "Spawned " << g_count.get() << " tasks";
+}
+
+int main()
+{
+  test(0);
+  test(1);
+  test(5);
+  test(10);
+  test(50);
+  testSpawn();
+}
@@ -28,6 +28,8 @@ Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
     serverAddr_(serverAddr),
     connect_(false),
     state_(kDisconnected),
+    maxRetries_(-1),
+    retries_(0),
     retryDelayMs_(kInitRetryDelayMs)
 {
   LOG_DEBUG << "ctor[" << this << "]";
@@ -44,6 +46,7 @@ Connector::~Connector()
 void Connector::start()
 {
   connect_ = true;
+  retries_ = 0;
   loop_->runInLoop(boost::bind(&Connector::startInLoop, this)); // FIXME: unsafe
 }
 
@@ -111,12 +114,13 @@ void Connector::connect()
     case ENOTSOCK:
       LOG_SYSERR << "connect error in Connector::startInLoop " << savedErrno;
       sockets::close(sockfd);	//رsockfd
+      connectFailed();
       break;
 
     default:
       LOG_SYSERR << "Unexpected error in Connector::startInLoop " << savedErrno;
       sockets::close(sockfd);
-      // connectErrorCallback_();
+      connectFailed();
       break;
   }
 }
@@ -128,6 +132,7 @@ void Connector::restart()
   loop_->assertInLoopThread();
   setState(kDisconnected);
   retryDelayMs_ = kInitRetryDelayMs;
+  retries_ = 0;
   connect_ = true;
   startInLoop();
 }
@@ -226,8 +231,16 @@ void Connector::retry(int sockfd)
 {
   sockets::close(sockfd);  //رsocketfd
   setState(kDisconnected);  
-  if (connect_)
+  if (connect_ && maxRetries_ >= 0 && retries_ >= maxRetries_)
+  {
+    LOG_WARN << "Connector::retry - Give up connecting to " << serverAddr_.toIpPort()
+             << " after " << retries_ << " retries";
+    connect_ = false;
+    connectFailed();
+  }
+  else if (connect_)
   {
+    ++retries_;
     LOG_INFO << "Connector::retry - Retry connecting to " << serverAddr_.toIpPort()
              << " in " << retryDelayMs_ << " milliseconds. ";
 	//һʱ
@@ -241,3 +254,10 @@ void Connector::retry(int sockfd)
   }
 }
 
+void Connector::connectFailed()
+{
+  if (connectFailedCallback_)
+  {
+    connectFailedCallback_();
+  }
+}
@@ -11,6 +11,7 @@
 #ifndef MUDUO_NET_CONNECTOR_H
 #define MUDUO_NET_CONNECTOR_H
 
+#include <muduo/net/Callbacks.h>
 #include <muduo/net/InetAddress.h>
 
 #include <boost/enable_shared_from_this.hpp>
@@ -39,6 +40,14 @@ class Connector : boost::noncopyable,
   void setNewConnectionCallback(const NewConnectionCallback& cb)
   { newConnectionCallback_ = cb; }
 
+  /// Gives up after maxRetries failed attempts in a row, and calls cb,
+  /// as on an error not worth a retry. -1, the default, retries forever.
+  void setConnectFailedCallback(const ConnectFailedCallback& cb, int maxRetries)
+  {
+    connectFailedCallback_ = cb;
+    maxRetries_ = maxRetries;
+  }
+
   void start();  // can be called in any thread
   void restart();  // must be called in loop thread
   void stop();  // can be called in any thread
@@ -58,6 +67,7 @@ class Connector : boost::noncopyable,
   void handleWrite();
   void handleError();
   void retry(int sockfd);
+  void connectFailed();
   int removeAndResetChannel();
   void resetChannel();
 
@@ -67,6 +77,9 @@ class Connector : boost::noncopyable,
   States state_;  // FIXME: use atomic variable   //״̬
   boost::scoped_ptr<Channel> channel_;    // ConnectorӦChannel
   NewConnectionCallback newConnectionCallback_;  // ӳɹص
+  ConnectFailedCallback connectFailedCallback_;
+  int maxRetries_;  // -1 for ever
+  int retries_;     // since start() or restart()
   int retryDelayMs_;  // ӳʱ䣨λ룩
 };
 
@@ -122,6 +122,7 @@ void EventLoop::loop()
     activeChannels_.clear();   //ͨ
     //ͨpollػͨactiveChannel
     pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+    Timestamp::setCachedNow(pollReturnTime_);
     ++iteration_;
 	//ӡ
     if (Logger::logLevel() <= Logger::TRACE)
@@ -16,6 +16,7 @@
 #include <fcntl.h>
 #include <stdio.h>  // snprintf
 #include <strings.h>  // bzero
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -180,6 +181,14 @@ ssize_t sockets::write(int sockfd, const void *buf, size_t count)
   return ::write(sockfd, buf, count);
 }
 
+ssize_t sockets::sendfile(int sockfd, int fd, int64_t* offset, size_t count)
+{
+  off_t off = *offset;
+  ssize_t n = ::sendfile(sockfd, fd, &off, count);
+  *offset = off;
+  return n;
+}
+
 void sockets::close(int sockfd)
 {
   if (::close(sockfd) < 0)
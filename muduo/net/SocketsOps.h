@@ -33,6 +33,8 @@ int  accept(int sockfd, struct sockaddr_in6* addr);
 ssize_t read(int sockfd, void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 ssize_t write(int sockfd, const void *buf, size_t count);
+// advances *offset by the bytes sent
+ssize_t sendfile(int sockfd, int fd, int64_t* offset, size_t count);
 void close(int sockfd);
 void shutdownWrite(int sockfd);
 
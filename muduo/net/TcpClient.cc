@@ -68,7 +68,6 @@ TcpClient::TcpClient(EventLoop* loop,
   //ӳɹص
   connector_->setNewConnectionCallback(
       boost::bind(&TcpClient::newConnection, this, _1));
-  // FIXME setConnectFailedCallback
   LOG_INFO << "TcpClient::TcpClient[" << name_
            << "] - connector " << get_pointer(connector_);
 }
@@ -132,6 +131,11 @@ void TcpClient::disconnect()
   }
 }
 
+void TcpClient::setConnectFailedCallback(const ConnectFailedCallback& cb, int maxRetries)
+{
+  connector_->setConnectFailedCallback(cb, maxRetries);
+}
+
 // ֹͣconnector_
 void TcpClient::stop()
 {
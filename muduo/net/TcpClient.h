@@ -66,6 +66,11 @@ class TcpClient : boost::noncopyable
   void setWriteCompleteCallback(const WriteCompleteCallback& cb)
   { writeCompleteCallback_ = cb; }
 
+  /// Stops connecting after maxRetries failed attempts in a row, which
+  /// otherwise go on forever, and calls cb in the loop thread.
+  /// Not thread safe, call before connect().
+  void setConnectFailedCallback(const ConnectFailedCallback& cb, int maxRetries);
+
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
   void setConnectionCallback(ConnectionCallback&& cb)
   { connectionCallback_ = std::move(cb); }
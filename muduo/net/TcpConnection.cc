@@ -136,6 +136,25 @@ void TcpConnection::send(Buffer* buf)
   }
 }
 
+void TcpConnection::sendFile(const boost::shared_ptr<const void>& file,
+                             int fd, int64_t offset, size_t count)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendFileInLoop(file, fd, offset, count);
+    }
+    else
+    {
+      loop_->runInLoop(
+          boost::bind(&TcpConnection::sendFileInLoop,
+                      this,     // FIXME
+                      file, fd, offset, count));
+    }
+  }
+}
+
 void TcpConnection::sendInLoop(const StringPiece& message)
 {
   sendInLoop(message.data(), message.size());
@@ -184,7 +203,8 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   // ûд󣬲һδдݣ˵ں˷ͻҪδдӵoutput bufferУ
   if (!faultError && remaining > 0)
   {
-    size_t oldLen = outputBuffer_.readableBytes();  //outbufбе
+    Buffer* output = files_.empty() ? &outputBuffer_ : &files_.back().after;
+    size_t oldLen = output->readableBytes();  //outbufбе
 	// highWaterMark_ˮλ꣩صhighWaterMarkCallback_
     if (oldLen + remaining >= highWaterMark_
         && oldLen < highWaterMark_
@@ -194,7 +214,7 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
       //todo : WHY??
       loop_->queueInLoop(boost::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
     }
-    outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
+    output->append(static_cast<const char*>(data)+nwrote, remaining);
     if (!channel_->isWriting())    //ûйעPOLLOUT¼йעpollout¼
     {
       channel_->enableWriting();  
@@ -202,6 +222,70 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   }
 }
 
+void TcpConnection::sendFileInLoop(const boost::shared_ptr<const void>& file,
+                                   int fd, int64_t offset, size_t count)
+{
+  loop_->assertInLoopThread();
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  files_.push_back(PendingFile());
+  PendingFile& pending = files_.back();
+  pending.file = file;
+  pending.fd = fd;
+  pending.offset = offset;
+  pending.remaining = count;
+  // if no thing in output queue, try sending directly
+  if (!channel_->isWriting())
+  {
+    assert(outputBuffer_.readableBytes() == 0);
+    if (writeFile())
+    {
+      if (writeCompleteCallback_)
+      {
+        loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
+      }
+    }
+    else if (state_ != kDisconnected)
+    {
+      channel_->enableWriting();
+    }
+  }
+}
+
+bool TcpConnection::writeFile()
+{
+  PendingFile& pending = files_.front();
+  while (pending.remaining > 0)
+  {
+    ssize_t n = sockets::sendfile(channel_->fd(), pending.fd,
+                                  &pending.offset, pending.remaining);
+    if (n > 0)
+    {
+      pending.remaining -= n;
+    }
+    else
+    {
+      if (n == 0)
+      {
+        // the file shrank, the peer would wait for the rest forever
+        LOG_ERROR << "TcpConnection::writeFile [" << name_ << "] - unexpected end of file";
+        forceCloseInLoop();
+      }
+      else if (errno != EWOULDBLOCK)
+      {
+        LOG_SYSERR << "TcpConnection::writeFile";
+      }
+      return false;
+    }
+  }
+  outputBuffer_.swap(pending.after);
+  files_.pop_front();
+  return true;
+}
+
 void TcpConnection::shutdown()
 {
   // FIXME: use compare and swap
@@ -396,34 +480,42 @@ void TcpConnection::handleWrite()
   //ڹעPOLLOUT¼,˵֮ǰûзɣ򽫻ݷ
   if (channel_->isWriting())   
   {
-    ssize_t n = sockets::write(channel_->fd(),
-                               outputBuffer_.peek(),
-                               outputBuffer_.readableBytes());
-    if (n > 0)
+    if (outputBuffer_.readableBytes() > 0)
     {
-      outputBuffer_.retrieve(n);  //readindex_ָ
-      if (outputBuffer_.readableBytes() == 0)  //˵Ѿˣ
+      ssize_t n = sockets::write(channel_->fd(),
+                                 outputBuffer_.peek(),
+                                 outputBuffer_.readableBytes());
+      if (n > 0)
       {
-        //ֹͣעPOLLOUT¼busy-loop
-        channel_->disableWriting();
-        if (writeCompleteCallback_)  //صwriteCompleteCallback
-        {
-			// Ӧò㷢ͻգͻصwriteCompleteCallback_
-          loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
-        }
-        if (state_ == kDisconnecting)
-        {
-          shutdownInLoop();  // ͻղ״̬kDisconnecting, Ҫر
-        }
+        outputBuffer_.retrieve(n);  //readindex_ָ
+      }
+      else
+      {
+        LOG_SYSERR << "TcpConnection::handleWrite";
+        // if (state_ == kDisconnecting)
+        // {
+        //   shutdownInLoop();
+        // }
+        return;
       }
     }
-    else
+    // then the pending files, each followed by what was sent after it
+    while (outputBuffer_.readableBytes() == 0 && !files_.empty() && writeFile())
     {
-      LOG_SYSERR << "TcpConnection::handleWrite";
-      // if (state_ == kDisconnecting)
-      // {
-      //   shutdownInLoop();
-      // }
+    }
+    if (outputBuffer_.readableBytes() == 0 && files_.empty())  //˵Ѿˣ
+    {
+      //ֹͣעPOLLOUT¼busy-loop
+      channel_->disableWriting();
+      if (writeCompleteCallback_)  //صwriteCompleteCallback
+      {
+			// Ӧò㷢ͻգͻصwriteCompleteCallback_
+        loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
+      }
+      if (state_ == kDisconnecting)
+      {
+        shutdownInLoop();  // ͻղ״̬kDisconnecting, Ҫر
+      }
     }
   }
   else
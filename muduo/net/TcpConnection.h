@@ -23,6 +23,8 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <deque>
+
 // struct tcp_info is in <netinet/tcp.h>
 struct tcp_info;
 
@@ -89,6 +91,10 @@ class TcpConnection : boost::noncopyable,
   void send(const StringPiece& message);
   // void send(Buffer&& message); // C++11
   void send(Buffer* message);  // this one will swap data
+  // Sends count bytes of fd from offset with sendfile(2), in order with
+  // the data sent before and after it. file keeps fd open till then.
+  void sendFile(const boost::shared_ptr<const void>& file,
+                int fd, int64_t offset, size_t count);
   void shutdown(); // NOT thread safe, no simultaneous calling
   // void shutdownAndForceCloseAfter(double seconds); // NOT thread safe, no simultaneous calling
 
@@ -147,6 +153,10 @@ class TcpConnection : boost::noncopyable,
   // void sendInLoop(string&& message);
   void sendInLoop(const StringPiece& message);
   void sendInLoop(const void* message, size_t len);
+  void sendFileInLoop(const boost::shared_ptr<const void>& file,
+                      int fd, int64_t offset, size_t count);
+  // returns false if the socket would block or has failed
+  bool writeFile();
   void shutdownInLoop();
   // void shutdownAndForceCloseInLoop(double seconds);
   void forceCloseInLoop();
@@ -177,6 +187,17 @@ class TcpConnection : boost::noncopyable,
   Buffer inputBuffer_;		//ջ
   Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
 
+  // sent after outputBuffer_, data sent meanwhile goes to files_.back().after
+  struct PendingFile
+  {
+    boost::shared_ptr<const void> file;
+    int fd;
+    int64_t offset;
+    size_t remaining;
+    Buffer after;
+  };
+  std::deque<PendingFile> files_;
+
   //boost::anyһֿɱ͵ָ룬void*Ͱȫ֧͵Ͱȫ洢Լȫ
   //ڱ׼дŲͬ͵ķvector<boost::any>
   boost::any context_;	//һδ֪͵Ķ
@@ -200,7 +200,8 @@ void TimerQueue::cancelInLoop(TimerId timerId)
 void TimerQueue::handleRead()
 {
   loop_->assertInLoopThread();
-  Timestamp now(Timestamp::now());
+  // poll return time of this iteration, timerfd became readable before it
+  Timestamp now(Timestamp::cachedNow());
   readTimerfd(timerfd_, now);   //¼һֱ
 
   //ȡʱǰеĶʱб(ʱʱб)
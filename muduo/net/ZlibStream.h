@@ -42,16 +42,20 @@ class ZlibInputStream : boost::noncopyable
 };
 
 // input is uncompressed data, output zlib compressed data
+// or gzip with windowBits = 16 + MAX_WBITS, see deflateInit2().
 class ZlibOutputStream : boost::noncopyable
 {
  public:
-  explicit ZlibOutputStream(Buffer* output)
+  explicit ZlibOutputStream(Buffer* output,
+                            int windowBits = MAX_WBITS,
+                            int level = Z_DEFAULT_COMPRESSION)
     : output_(output),
       zerror_(Z_OK),
       bufferSize_(1024)
   {
     bzero(&zstream_, sizeof zstream_);
-    zerror_ = deflateInit(&zstream_, Z_DEFAULT_COMPRESSION);
+    zerror_ = deflateInit2(&zstream_, level, Z_DEFLATED, windowBits,
+                           8, Z_DEFAULT_STRATEGY);
   }
 
   ~ZlibOutputStream()
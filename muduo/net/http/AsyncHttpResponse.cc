@@ -0,0 +1,206 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/http/AsyncHttpResponse.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/http/HttpCompressor.h>
+#include <muduo/net/http/HttpServer.h>
+
+#include <boost/bind.hpp>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t AsyncHttpResponse::kStreamHighWaterMark;
+
+AsyncHttpResponse::AsyncHttpResponse(HttpServer* server,
+                                     const TcpConnectionPtr& conn,
+                                     int64_t sequence,
+                                     bool close)
+  : server_(server->ref_),
+    compressor_(server->compressor_),
+    loop_(conn->getLoop()),
+    conn_(conn),
+    sequence_(sequence),
+    done_(false),
+    response_(close),
+    streaming_(false),
+    chunked_(false),
+    head_(false),
+    finished_(false),
+    active_(false),
+    congested_(false),
+    aborted_(false),
+    sendQueued_(false)
+{
+}
+
+AsyncHttpResponse::~AsyncHttpResponse()
+{
+  if (streaming_)
+  {
+    // held by the connection until the body is sent, so the client is gone
+    if (!done_ && !aborted_)
+    {
+      LOG_WARN << "AsyncHttpResponse stream for " << request_.path() << " never done";
+    }
+  }
+  else if (!done_)
+  {
+    LOG_ERROR << "AsyncHttpResponse for " << request_.path() << " never done";
+    response_.reset(true);
+    response_.setStatusCode(HttpResponse::k500InternalServerError);
+    done();
+  }
+}
+
+void AsyncHttpResponse::done()
+{
+  assert(!done_);
+  done_ = true;
+  if (streaming_)
+  {
+    {
+      MutexLockGuard lock(mutex_);
+      finished_ = true;
+      if (chunked_ && !head_ && !aborted_)
+      {
+        pending_.append("0\r\n\r\n");
+      }
+    }
+    // queued even in the IO thread, finishing may start the next response
+    queueInLoop(boost::bind(&HttpServer::onStreamWrite, _1, shared_from_this()));
+    return;
+  }
+
+  if (compressor_)
+  {
+    compressor_->compress(request_, &response_);
+  }
+  boost::shared_ptr<Buffer> output(new Buffer);
+  bool close = response_.closeConnection();
+  if (request_.method() == HttpRequest::kHead)
+  {
+    response_.appendHeadersToBuffer(output.get());
+  }
+  else if (!response_.appendToBuffer(output.get()))
+  {
+    // the body is cut short, closing tells the client
+    close = true;
+  }
+  // always queued, so a handler finishing inline does not reenter onMessage
+  queueInLoop(boost::bind(&HttpServer::onResponseDone, _1, conn_,
+                          sequence_, output, close));
+}
+
+void AsyncHttpResponse::startStream(const WritableCallback& cb)
+{
+  assert(!done_ && !streaming_);
+  streaming_ = true;
+  chunked_ = request_.getVersion() == HttpRequest::kHttp11;
+  head_ = request_.method() == HttpRequest::kHead;
+  writableCallback_ = cb;
+  if (chunked_)
+  {
+    response_.setChunked(true);
+  }
+  else
+  {
+    response_.setCloseConnection(true);
+  }
+  boost::shared_ptr<Buffer> headers(new Buffer);
+  response_.appendHeadersToBuffer(headers.get());
+  queueInLoop(boost::bind(&HttpServer::onStreamStart, _1, shared_from_this(), headers));
+}
+
+bool AsyncHttpResponse::write(const StringPiece& data)
+{
+  assert(streaming_ && !done_);
+  bool send = false;
+  {
+    MutexLockGuard lock(mutex_);
+    if (aborted_ || conn_.expired())
+    {
+      return false;
+    }
+    // an empty chunk would end the body
+    if (data.empty() || head_)
+    {
+      return true;
+    }
+    if (chunked_)
+    {
+      char size[32];
+      int len = snprintf(size, sizeof size, "%x\r\n", data.size());
+      pending_.ensureWritableBytes(len + data.size() + 2);
+      pending_.append(size, len);
+      pending_.append(data);
+      pending_.append("\r\n", 2);
+    }
+    else
+    {
+      pending_.append(data);
+    }
+    // before its turn, the data is sent when the stream becomes active
+    send = active_ && !sendQueued_;
+    sendQueued_ = send;
+  }
+
+  // queued even in the IO thread: a producer writing in a loop stops at
+  // kStreamHighWaterMark, not only once the connection is congested,
+  // which a broken pipe never is
+  if (send)
+  {
+    return queueInLoop(boost::bind(&HttpServer::onStreamWrite, _1, shared_from_this()));
+  }
+  return true;
+}
+
+bool AsyncHttpResponse::writable() const
+{
+  MutexLockGuard lock(mutex_);
+  // true once aborted, so a producer waiting for it gets to a failing write()
+  return aborted_
+      || (active_
+          && !congested_
+          && !finished_
+          && pending_.readableBytes() < kStreamHighWaterMark);
+}
+
+void AsyncHttpResponse::abort()
+{
+  MutexLockGuard lock(mutex_);
+  aborted_ = true;
+  pending_.retrieveAll();
+}
+
+bool AsyncHttpResponse::queueInLoop(const ServerFunctor& f)
+{
+  // the server destroys the IO loops, it must not be gone meanwhile
+  MutexLockGuard lock(server_->mutex);
+  if (server_->server == NULL)
+  {
+    return false;
+  }
+  loop_->queueInLoop(boost::bind(&AsyncHttpResponse::runInServer, server_, f));
+  return true;
+}
+
+void AsyncHttpResponse::runInServer(const boost::shared_ptr<detail::HttpServerRef>& server,
+                                    const ServerFunctor& f)
+{
+  HttpServer* s = NULL;
+  {
+    MutexLockGuard lock(server->mutex);
+    s = server->server;
+  }
+  if (s)
+  {
+    f(s);
+  }
+}
@@ -0,0 +1,138 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_ASYNCHTTPRESPONSE_H
+#define MUDUO_NET_HTTP_ASYNCHTTPRESPONSE_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/Callbacks.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/weak_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class AsyncHttpResponse;
+class EventLoop;
+class HttpCompressor;
+class HttpServer;
+
+namespace detail
+{
+struct HttpServerRef;
+}
+
+typedef boost::shared_ptr<AsyncHttpResponse> AsyncHttpResponsePtr;
+
+///
+/// A request whose response is completed later, possibly in another
+/// thread. Responses of pipelined requests are still sent in request
+/// order, a response done early waits for those before it.
+///
+/// If the last reference goes away before done(), 500 is sent.
+///
+/// The body may also be streamed, for exports and long polling, see
+/// startStream(). The producer is paced by the client: it writes when
+/// told the connection is writable, so the memory held per connection
+/// stays around kStreamHighWaterMark.
+///
+/// A handle may outlive its HttpServer, done(), startStream() and
+/// write() are no-ops then, write() returns false. The handle must not
+/// be used while the server is being destroyed in another thread.
+///
+class AsyncHttpResponse : boost::noncopyable,
+                          public boost::enable_shared_from_this<AsyncHttpResponse>
+{
+ public:
+  typedef boost::function<void (const AsyncHttpResponsePtr&)> WritableCallback;
+
+  /// writable() turns false above this many bytes not yet sent.
+  static const size_t kStreamHighWaterMark = 64 * 1024;
+
+  ~AsyncHttpResponse();
+
+  const HttpRequest& request() const
+  { return request_; }
+
+  HttpResponse* response()
+  { return &response_; }
+
+  /// Sends the response. Thread safe, call once.
+  /// After startStream(), ends the body instead.
+  void done();
+
+  /// Sends the status line and headers of response() now and the body
+  /// with write(), in chunked Transfer-Encoding; HTTP/1.0 clients get a
+  /// body ended by closing the connection.
+  /// cb is called in the IO thread whenever the stream may write: when
+  /// the responses before it have been sent, then each time everything
+  /// written so far has been taken by the kernel, until done().
+  /// Call once, before done().
+  void startStream(const WritableCallback& cb);
+
+  /// Appends data to the streamed body. Thread safe.
+  /// Returns false once the connection is gone, the producer should stop.
+  bool write(const StringPiece& data);
+
+  /// False while the client is behind: before the stream's turn, and
+  /// after kStreamHighWaterMark bytes have piled up until they are sent.
+  /// True once the connection is gone, so the next write() fails.
+  /// Thread safe.
+  bool writable() const;
+
+ private:
+  friend class HttpServer;
+
+  AsyncHttpResponse(HttpServer* server,
+                    const TcpConnectionPtr& conn,
+                    int64_t sequence,
+                    bool close);
+
+  typedef boost::function<void (HttpServer*)> ServerFunctor;
+
+  // the connection is gone, write() fails from now on
+  void abort();
+  // queues f in the IO thread, returns false if the server is gone
+  bool queueInLoop(const ServerFunctor& f);
+  // in the IO thread, the server may be destroyed since f was queued
+  static void runInServer(const boost::shared_ptr<detail::HttpServerRef>& server,
+                          const ServerFunctor& f);
+
+  boost::shared_ptr<detail::HttpServerRef> server_;
+  boost::shared_ptr<HttpCompressor> compressor_;
+  EventLoop* loop_;
+  boost::weak_ptr<TcpConnection> conn_;
+  const int64_t sequence_;
+  bool done_;
+  HttpRequest request_;
+  HttpResponse response_;
+
+  // set by startStream()
+  bool streaming_;
+  bool chunked_;
+  bool head_;                          // no body is sent
+  WritableCallback writableCallback_;  // called in the IO thread
+
+  mutable MutexLock mutex_;
+  Buffer pending_;    // written, not handed to the connection yet; guarded by mutex_
+  bool finished_;     // done() called on a stream
+  bool active_;       // the headers are sent
+  bool congested_;    // above kStreamHighWaterMark until a write completes
+  bool aborted_;
+  bool sendQueued_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_ASYNCHTTPRESPONSE_H
@@ -0,0 +1,1001 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/http/HttpClient.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/ThreadPool.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/http/HttpParsing.h>
+
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+bool isIdempotent(HttpRequest::Method method)
+{
+  return method == HttpRequest::kGet
+      || method == HttpRequest::kHead
+      || method == HttpRequest::kPut
+      || method == HttpRequest::kDelete;
+}
+
+bool isPipelinable(HttpRequest::Method method)
+{
+  return method == HttpRequest::kGet || method == HttpRequest::kHead;
+}
+
+struct HttpClientCall : boost::noncopyable
+{
+  HttpRequest::Method method;
+  string data;                        // the whole request
+  HttpClient::ResponseCallback cb;
+  HttpClientHost* host;
+  HttpClientConnection* connection;   // NULL while waiting
+  TimerId timer;
+  bool retried;
+};
+
+typedef boost::shared_ptr<HttpClientCall> HttpClientCallPtr;
+typedef boost::shared_ptr<HttpClientConnection> HttpClientConnectionPtr;
+
+struct HttpClientHost : boost::noncopyable
+{
+  HttpClientHost(HttpClient* clientArg, const string& keyArg, const string& hostPortArg)
+    : client(clientArg),
+      key(keyArg),
+      hostPort(hostPortArg),
+      resolved(false),
+      nextId(1)
+  {
+  }
+
+  HttpClient* const client;
+  const string key;       // in HttpClient::hosts_
+  const string hostPort;  // the Host header
+  InetAddress addr;
+  bool resolved;          // no connection is opened before
+  std::vector<HttpClientConnectionPtr> connections;
+  std::deque<HttpClientCallPtr> waiting;
+  int nextId;
+};
+
+// Parses the responses arriving on one connection.
+class HttpResponseParser
+{
+ public:
+  enum Result
+  {
+    kNeedMore,
+    kComplete,
+    kError,
+  };
+
+  static const size_t kMaxHeaderSize = 64 * 1024;
+
+  explicit HttpResponseParser(size_t maxBodySize)
+    : maxBodySize_(maxBodySize)
+  {
+    reset();
+  }
+
+  // head: the response answers HEAD, it has no body
+  Result parse(Buffer* buf, bool head, HttpClientResponse* response);
+
+  // for the next response
+  void reset()
+  {
+    state_ = kExpectStatusLine;
+    bodyRemaining_ = 0;
+    headerScanned_ = 0;
+    headerSize_ = 0;
+    started_ = false;
+    keepAlive_ = true;
+  }
+
+  // some of the response has arrived
+  bool started() const
+  { return started_; }
+
+  // the body ends when the connection closes
+  bool expectClose() const
+  { return state_ == kExpectClose; }
+
+  // valid once the headers are parsed
+  bool keepAlive() const
+  { return keepAlive_; }
+
+ private:
+  enum State
+  {
+    kExpectStatusLine,
+    kExpectHeaders,
+    kExpectBody,
+    kExpectChunkSize,
+    kExpectChunkData,
+    kExpectChunkEnd,
+    kExpectTrailers,
+    kExpectClose,
+    kGotAll,
+  };
+
+  bool processStatusLine(const char* begin, const char* end, HttpClientResponse* response);
+  bool processHeadersEnd(bool head, HttpClientResponse* response);
+  bool processChunkSize(const char* begin, const char* end, HttpClientResponse* response);
+
+  const size_t maxBodySize_;
+  State state_;
+  size_t bodyRemaining_;  // of Content-Length body or current chunk
+  size_t headerScanned_;
+  size_t headerSize_;  // of the header block and trailers taken
+  bool started_;
+  bool keepAlive_;
+};
+
+// One keep-alive connection of a host, with the requests sent on it.
+class HttpClientConnection : boost::noncopyable,
+                             public boost::enable_shared_from_this<HttpClientConnection>
+{
+ public:
+  HttpClientConnection(HttpClient* client, HttpClientHost* host, const string& name)
+    : client_(client),
+      host_(host),
+      tcp_(client->getLoop(), host->addr, name),
+      notPipelinable_(0),
+      parser_(client->maxResponseBodySize_),
+      closed_(false)
+  {
+  }
+
+  void connect();
+
+  bool closed() const
+  { return closed_; }
+
+  bool idle() const
+  { return inFlight_.empty(); }
+
+  size_t inFlight() const
+  { return inFlight_.size(); }
+
+  bool canPipeline(HttpRequest::Method method, int maxPipelined) const
+  {
+    return isPipelinable(method)
+        && notPipelinable_ == 0
+        && inFlight_.size() < static_cast<size_t>(maxPipelined);
+  }
+
+  // queued until flush()
+  void send(const HttpClientCallPtr& call);
+  void flush();
+
+  // Fails culprit with error, and the others of its in flight requests
+  // which can not be sent again with kConnectionClosed.
+  // kConnectFailed fails them all.
+  void close(const HttpClientCallPtr& culprit, HttpClientResponse::Error error);
+
+  // for HttpClient::~HttpClient()
+  void drop();
+
+  void onConnection(const TcpConnectionPtr& conn);
+  void onConnectFailed();
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp);
+
+ private:
+  HttpClient* client_;
+  HttpClientHost* host_;
+  TcpClient tcp_;
+  TcpConnectionPtr conn_;                  // once connected
+  std::deque<HttpClientCallPtr> inFlight_;  // sent or in outbox_, in order
+  int notPipelinable_;                     // in inFlight_
+  Buffer outbox_;                          // requests not written yet
+  HttpResponseParser parser_;
+  HttpClientResponse response_;            // reused for every response
+  bool closed_;
+};
+
+void onConnection(const boost::weak_ptr<HttpClientConnection>& weakConn,
+                  const TcpConnectionPtr& conn)
+{
+  HttpClientConnectionPtr connection(weakConn.lock());
+  if (connection)
+  {
+    connection->onConnection(conn);
+  }
+}
+
+void onConnectFailed(const boost::weak_ptr<HttpClientConnection>& weakConn)
+{
+  HttpClientConnectionPtr connection(weakConn.lock());
+  if (connection)
+  {
+    connection->onConnectFailed();
+  }
+}
+
+// Connector may fail inside TcpClient::connect(), while dispatch() is
+// still picking connections; report it from the loop instead.
+void queueConnectFailed(EventLoop* loop,
+                        const boost::weak_ptr<HttpClientConnection>& weakConn)
+{
+  loop->queueInLoop(boost::bind(&onConnectFailed, weakConn));
+}
+
+void onMessage(const boost::weak_ptr<HttpClientConnection>& weakConn,
+               const TcpConnectionPtr& conn,
+               Buffer* buf,
+               Timestamp receiveTime)
+{
+  HttpClientConnectionPtr connection(weakConn.lock());
+  if (connection)
+  {
+    connection->onMessage(conn, buf, receiveTime);
+  }
+  else
+  {
+    buf->retrieveAll();
+  }
+}
+
+void destroyConnection(const HttpClientConnectionPtr&)
+{
+}
+
+}
+}
+}
+
+using namespace muduo::net::detail;
+
+const size_t HttpResponseParser::kMaxHeaderSize;
+
+bool HttpResponseParser::processStatusLine(const char* begin,
+                                           const char* end,
+                                           HttpClientResponse* response)
+{
+  // "HTTP/1.1 200 OK", the reason phrase may be empty
+  if (end - begin < 12
+      || memcmp(begin, "HTTP/1.", 7) != 0
+      || begin[8] != ' '
+      || (end - begin > 12 && begin[12] != ' '))
+  {
+    return false;
+  }
+  if (begin[7] == '1')
+  {
+    response->setVersion(HttpRequest::kHttp11);
+  }
+  else if (begin[7] == '0')
+  {
+    response->setVersion(HttpRequest::kHttp10);
+  }
+  else
+  {
+    return false;
+  }
+
+  int code = 0;
+  for (const char* p = begin + 9; p < begin + 12; ++p)
+  {
+    if (*p < '0' || *p > '9')
+    {
+      return false;
+    }
+    code = code * 10 + (*p - '0');
+  }
+  response->setStatusCode(code);
+  if (end - begin > 13)
+  {
+    response->setStatusMessage(begin + 13, end);
+  }
+  return true;
+}
+
+// decides how the body is delimited once the empty line is seen
+bool HttpResponseParser::processHeadersEnd(bool head, HttpClientResponse* response)
+{
+  int code = response->statusCode();
+  if (code >= 100 && code < 200)
+  {
+    // interim, eg. "100 Continue", the final response follows
+    response->clear();
+    state_ = kExpectStatusLine;
+    return true;
+  }
+
+  StringPiece connection = response->header("Connection");
+  if (response->version() == HttpRequest::kHttp11)
+  {
+    keepAlive_ = !(connection.size() == 5 && ::strncasecmp(connection.data(), "close", 5) == 0);
+  }
+  else
+  {
+    keepAlive_ = connection.size() == 10 && ::strncasecmp(connection.data(), "keep-alive", 10) == 0;
+  }
+
+  if (head || code == 204 || code == 304)
+  {
+    state_ = kGotAll;
+    return true;
+  }
+
+  if (response->headers().has("Transfer-Encoding"))
+  {
+    if (!detail::isChunked(response->header("Transfer-Encoding")))
+    {
+      return false;
+    }
+    state_ = kExpectChunkSize;
+    return true;
+  }
+
+  if (response->headers().has("Content-Length"))
+  {
+    size_t contentLength = 0;
+    if (!detail::parseContentLength(response->header("Content-Length"), &contentLength))
+    {
+      return false;
+    }
+    if (contentLength > maxBodySize_)
+    {
+      return false;
+    }
+    if (contentLength > 0)
+    {
+      response->reserveBody(contentLength);
+      bodyRemaining_ = contentLength;
+      state_ = kExpectBody;
+    }
+    else
+    {
+      state_ = kGotAll;
+    }
+    return true;
+  }
+
+  keepAlive_ = false;
+  state_ = kExpectClose;
+  return true;
+}
+
+// chunk-size [ chunk-ext ] CRLF
+bool HttpResponseParser::processChunkSize(const char* begin,
+                                          const char* end,
+                                          HttpClientResponse* response)
+{
+  size_t size = 0;
+  if (!detail::parseChunkSize(begin, end, &size)
+      || size > maxBodySize_ - response->body().size())
+  {
+    return false;
+  }
+  bodyRemaining_ = size;
+  state_ = size > 0 ? kExpectChunkData : kExpectTrailers;
+  return true;
+}
+
+HttpResponseParser::Result HttpResponseParser::parse(Buffer* buf,
+                                                     bool head,
+                                                     HttpClientResponse* response)
+{
+  if (buf->readableBytes() > 0)
+  {
+    started_ = true;
+  }
+  while (true)
+  {
+    if (state_ == kExpectStatusLine)
+    {
+      const char* crlf = detail::findCRLF(buf->peek(), buf->beginWrite());
+      if (!crlf)
+      {
+        return buf->readableBytes() > kMaxHeaderSize ? kError : kNeedMore;
+      }
+      if (!processStatusLine(buf->peek(), crlf, response))
+      {
+        return kError;
+      }
+      buf->retrieveUntil(crlf + 2);
+      state_ = kExpectHeaders;
+    }
+    else if (state_ == kExpectHeaders)
+    {
+      const char* begin = buf->peek();
+      const char* end = buf->beginWrite();
+      const char* blockEnd = detail::findHeaderBlockEnd(begin, end, headerScanned_);
+      if (!blockEnd)
+      {
+        headerScanned_ = buf->readableBytes();
+        return headerScanned_ > kMaxHeaderSize ? kError : kNeedMore;
+      }
+      // as HttpContext, a block read at once is limited too
+      if (static_cast<size_t>(blockEnd + 2 - begin) > kMaxHeaderSize
+          || !response->addHeaderBlock(begin, blockEnd))
+      {
+        return kError;
+      }
+      buf->retrieveUntil(blockEnd + 2);
+      headerScanned_ = 0;
+      headerSize_ = blockEnd + 2 - begin;
+      if (!processHeadersEnd(head, response))
+      {
+        return kError;
+      }
+    }
+    else if (state_ == kExpectBody || state_ == kExpectChunkData)
+    {
+      size_t n = std::min(buf->readableBytes(), bodyRemaining_);
+      response->appendBody(buf->peek(), buf->peek() + n);
+      buf->retrieve(n);
+      bodyRemaining_ -= n;
+      if (bodyRemaining_ > 0)
+      {
+        return kNeedMore;
+      }
+      state_ = state_ == kExpectBody ? kGotAll : kExpectChunkEnd;
+    }
+    else if (state_ == kExpectChunkSize)
+    {
+      const char* crlf = detail::findCRLF(buf->peek(), buf->beginWrite());
+      if (!crlf)
+      {
+        return buf->readableBytes() > detail::kMaxChunkSizeLine ? kError : kNeedMore;
+      }
+      if (static_cast<size_t>(crlf - buf->peek()) > detail::kMaxChunkSizeLine
+          || !processChunkSize(buf->peek(), crlf, response))
+      {
+        return kError;
+      }
+      buf->retrieveUntil(crlf + 2);
+    }
+    else if (state_ == kExpectChunkEnd)
+    {
+      if (buf->readableBytes() < 2)
+      {
+        return kNeedMore;
+      }
+      if (buf->peek()[0] != '\r' || buf->peek()[1] != '\n')
+      {
+        return kError;
+      }
+      buf->retrieve(2);
+      state_ = kExpectChunkSize;
+    }
+    else if (state_ == kExpectTrailers)
+    {
+      // as HttpContext, trailers count against kMaxHeaderSize
+      const char* crlf = detail::findCRLF(buf->peek(), buf->beginWrite());
+      if (!crlf)
+      {
+        return headerSize_ + buf->readableBytes() > kMaxHeaderSize ? kError : kNeedMore;
+      }
+      headerSize_ += crlf + 2 - buf->peek();
+      if (headerSize_ > kMaxHeaderSize)
+      {
+        return kError;
+      }
+      const char* colon = NULL;
+      detail::TrailerLine line = detail::parseTrailerLine(buf->peek(), crlf, &colon);
+      if (line == detail::kBadTrailer)
+      {
+        return kError;
+      }
+      else if (line == detail::kTrailerField)
+      {
+        response->addHeader(buf->peek(), colon, crlf);
+      }
+      else
+      {
+        state_ = kGotAll;
+      }
+      buf->retrieveUntil(crlf + 2);
+    }
+    else if (state_ == kExpectClose)
+    {
+      if (buf->readableBytes() > maxBodySize_ - response->body().size())
+      {
+        return kError;
+      }
+      response->appendBody(buf->peek(), buf->beginWrite());
+      buf->retrieveAll();
+      return kNeedMore;
+    }
+    else
+    {
+      // kGotAll, the next pipelined response stays in buf
+      return kComplete;
+    }
+  }
+}
+
+void HttpClientConnection::connect()
+{
+  boost::weak_ptr<HttpClientConnection> weakThis(shared_from_this());
+  tcp_.setConnectionCallback(boost::bind(&detail::onConnection, weakThis, _1));
+  tcp_.setMessageCallback(boost::bind(&detail::onMessage, weakThis, _1, _2, _3));
+  tcp_.setConnectFailedCallback(boost::bind(&detail::queueConnectFailed,
+                                            client_->getLoop(), weakThis),
+                                client_->connectRetries_);
+  tcp_.connect();
+}
+
+void HttpClientConnection::send(const HttpClientCallPtr& call)
+{
+  call->connection = this;
+  inFlight_.push_back(call);
+  if (!isPipelinable(call->method))
+  {
+    ++notPipelinable_;
+  }
+  outbox_.append(call->data);
+}
+
+void HttpClientConnection::flush()
+{
+  if (conn_ && outbox_.readableBytes() > 0)
+  {
+    conn_->send(&outbox_);
+  }
+}
+
+void HttpClientConnection::onConnection(const TcpConnectionPtr& conn)
+{
+  if (closed_)
+  {
+    return;
+  }
+  if (conn->connected())
+  {
+    conn_ = conn;
+    conn->setTcpNoDelay(true);
+    flush();
+  }
+  else
+  {
+    if (!inFlight_.empty() && parser_.expectClose())
+    {
+      HttpClientCallPtr call(inFlight_.front());
+      inFlight_.pop_front();
+      client_->complete(call, response_);
+    }
+    close(HttpClientCallPtr(), HttpClientResponse::kConnectionClosed);
+  }
+}
+
+void HttpClientConnection::onConnectFailed()
+{
+  if (!closed_)
+  {
+    LOG_ERROR << "HttpClient can not connect to " << host_->hostPort;
+    close(HttpClientCallPtr(), HttpClientResponse::kConnectFailed);
+  }
+}
+
+void HttpClientConnection::onMessage(const TcpConnectionPtr& conn,
+                                     Buffer* buf,
+                                     Timestamp)
+{
+  while (!closed_ && !inFlight_.empty())
+  {
+    HttpClientCallPtr call(inFlight_.front());
+    HttpResponseParser::Result result =
+        parser_.parse(buf, call->method == HttpRequest::kHead, &response_);
+    if (result == HttpResponseParser::kNeedMore)
+    {
+      return;
+    }
+    if (result == HttpResponseParser::kError)
+    {
+      LOG_ERROR << "HttpClient bad response from " << host_->hostPort;
+      close(call, HttpClientResponse::kBadResponse);
+      return;
+    }
+
+    inFlight_.pop_front();
+    if (!isPipelinable(call->method))
+    {
+      --notPipelinable_;
+    }
+    bool keepAlive = parser_.keepAlive();
+    parser_.reset();
+    client_->complete(call, response_);
+    response_.clear();
+    if (!keepAlive)
+    {
+      close(HttpClientCallPtr(), HttpClientResponse::kConnectionClosed);
+      return;
+    }
+  }
+
+  if (!closed_)
+  {
+    if (buf->readableBytes() > 0)
+    {
+      LOG_ERROR << "HttpClient unexpected data from " << host_->hostPort;
+      close(HttpClientCallPtr(), HttpClientResponse::kConnectionClosed);
+    }
+    else if (!host_->waiting.empty())
+    {
+      client_->dispatch(host_);
+    }
+  }
+}
+
+void HttpClientConnection::close(const HttpClientCallPtr& culprit,
+                                 HttpClientResponse::Error error)
+{
+  assert(!closed_);
+  closed_ = true;
+  if (conn_)
+  {
+    conn_->forceClose();
+    conn_.reset();
+  }
+  std::deque<HttpClientCallPtr> calls;
+  calls.swap(inFlight_);
+  notPipelinable_ = 0;
+  client_->removeConnection(host_, this);
+
+  // the unanswered ones go back in front of the waiting requests, in order,
+  // unless the host is not there at all
+  bool connectFailed = error == HttpClientResponse::kConnectFailed;
+  std::vector<HttpClientCallPtr> failed;
+  for (size_t i = calls.size(); i > 0; --i)
+  {
+    const HttpClientCallPtr& call = calls[i - 1];
+    call->connection = NULL;
+    bool answered = i == 1 && parser_.started();
+    if (!connectFailed && call != culprit && !answered && !call->retried
+        && isIdempotent(call->method))
+    {
+      call->retried = true;
+      host_->waiting.push_front(call);
+    }
+    else
+    {
+      failed.push_back(call);
+    }
+  }
+  for (size_t i = failed.size(); i > 0; --i)
+  {
+    const HttpClientCallPtr& call = failed[i - 1];
+    client_->fail(call, call == culprit || connectFailed
+                        ? error : HttpClientResponse::kConnectionClosed);
+  }
+  client_->dispatch(host_);
+}
+
+void HttpClientConnection::drop()
+{
+  closed_ = true;
+  for (size_t i = 0; i < inFlight_.size(); ++i)
+  {
+    client_->getLoop()->cancel(inFlight_[i]->timer);
+  }
+  inFlight_.clear();
+  conn_.reset();
+}
+
+HttpClient::HttpClient(EventLoop* loop, const string& name)
+  : loop_(CHECK_NOTNULL(loop)),
+    name_(name),
+    maxConnectionsPerHost_(8),
+    maxPipelined_(1),
+    maxResponseBodySize_(64 * 1024 * 1024),
+    timeout_(30.0),
+    connectRetries_(2)
+{
+}
+
+HttpClient::~HttpClient()
+{
+  loop_->assertInLoopThread();
+  for (std::map<string, HostPtr>::iterator it = hosts_.begin();
+       it != hosts_.end(); ++it)
+  {
+    HttpClientHost* host = it->second.get();
+    for (size_t i = 0; i < host->waiting.size(); ++i)
+    {
+      loop_->cancel(host->waiting[i]->timer);
+    }
+    for (size_t i = 0; i < host->connections.size(); ++i)
+    {
+      host->connections[i]->drop();
+    }
+  }
+}
+
+void HttpClient::request(HttpRequest::Method method,
+                         const string& url,
+                         const ResponseCallback& cb,
+                         const string& body,
+                         const string& headers)
+{
+  if (loop_->isInLoopThread())
+  {
+    requestInLoop(method, url, cb, body, headers);
+  }
+  else
+  {
+    loop_->queueInLoop(boost::bind(&HttpClient::requestInLoop, this,
+                                   method, url, cb, body, headers));
+  }
+}
+
+void HttpClient::requestInLoop(HttpRequest::Method method,
+                               const string& url,
+                               const ResponseCallback& cb,
+                               const string& body,
+                               const string& headers)
+{
+  loop_->assertInLoopThread();
+  CallPtr call(new HttpClientCall);
+  call->method = method;
+  call->cb = cb;
+  call->host = NULL;
+  call->connection = NULL;
+  call->retried = false;
+
+  // http://host[:port]/path?query
+  const size_t kSchemeLength = 7;
+  size_t hostEnd = url.find_first_of("/?", kSchemeLength);
+  if (hostEnd == string::npos)
+  {
+    hostEnd = url.size();
+  }
+  string hostPort(url, kSchemeLength, hostEnd - kSchemeLength);
+  size_t colon = hostPort.find(':');
+  string hostName(hostPort, 0, colon);
+  int port = 80;
+  if (colon != string::npos)
+  {
+    port = 0;
+    for (size_t i = colon + 1; i < hostPort.size() && port <= 65535; ++i)
+    {
+      char c = hostPort[i];
+      port = c >= '0' && c <= '9' ? port * 10 + (c - '0') : 65536;
+    }
+  }
+  if (url.compare(0, kSchemeLength, "http://") != 0
+      || hostName.empty() || port <= 0 || port > 65535)
+  {
+    LOG_ERROR << "HttpClient bad url " << url;
+    fail(call, HttpClientResponse::kBadUrl);
+    return;
+  }
+
+  char portString[8];
+  snprintf(portString, sizeof portString, "%d", port);
+  const string key(hostName + ':' + portString);
+  HostPtr& host = hosts_[key];
+  if (!host)
+  {
+    host.reset(new HttpClientHost(this, key, hostPort));
+    struct in_addr ip;
+    if (::inet_pton(AF_INET, hostName.c_str(), &ip) == 1)
+    {
+      host->addr = InetAddress(hostName, static_cast<uint16_t>(port));
+      host->resolved = true;
+    }
+    else
+    {
+      // the requests wait in host->waiting, their timers run meanwhile
+      if (!resolver_)
+      {
+        resolver_.reset(new ThreadPool(name_ + "Resolver"));
+        resolver_->start(1);
+      }
+      resolver_->run(boost::bind(&HttpClient::resolve,
+                                 loop_,
+                                 boost::weak_ptr<HttpClientHost>(host),
+                                 hostName,
+                                 InetAddress(static_cast<uint16_t>(port))));
+    }
+  }
+  call->host = host.get();
+
+  string& data = call->data;
+  const char* methodName = HttpRequest::methodName(method);
+  data.reserve(strlen(methodName) + url.size() + hostPort.size()
+               + headers.size() + body.size() + 64);
+  data += methodName;
+  data += ' ';
+  if (hostEnd == url.size() || url[hostEnd] == '?')
+  {
+    data += '/';
+  }
+  data.append(url, hostEnd, string::npos);
+  data += " HTTP/1.1\r\nHost: ";
+  data += hostPort;
+  data += "\r\n";
+  if (!body.empty() || method == HttpRequest::kPost || method == HttpRequest::kPut)
+  {
+    char length[48];
+    snprintf(length, sizeof length, "Content-Length: %zu\r\n", body.size());
+    data += length;
+  }
+  data += headers;
+  data += "\r\n";
+  data += body;
+
+  if (timeout_ > 0)
+  {
+    call->timer = loop_->runAfter(timeout_, boost::bind(&HttpClient::onTimeout, this,
+                                                        boost::weak_ptr<HttpClientCall>(call)));
+  }
+  host->waiting.push_back(call);
+  dispatch(host.get());
+}
+
+void HttpClient::resolve(EventLoop* loop,
+                         const boost::weak_ptr<HttpClientHost>& weakHost,
+                         const string& hostName,
+                         InetAddress addr)
+{
+  bool ok = InetAddress::resolve(hostName, &addr);
+  if (!ok)
+  {
+    LOG_ERROR << "HttpClient can not resolve " << hostName;
+  }
+  loop->queueInLoop(boost::bind(&HttpClient::onResolved, weakHost, addr, ok));
+}
+
+void HttpClient::onResolved(const boost::weak_ptr<HttpClientHost>& weakHost,
+                            const InetAddress& addr,
+                            bool ok)
+{
+  // gone with its HttpClient, which is destroyed in this thread
+  HostPtr host(weakHost.lock());
+  if (!host)
+  {
+    return;
+  }
+  HttpClient* client = host->client;
+  if (ok)
+  {
+    host->addr = addr;
+    host->resolved = true;
+    client->dispatch(host.get());
+  }
+  else
+  {
+    // a later request looks the name up again
+    std::deque<CallPtr> calls;
+    calls.swap(host->waiting);
+    client->hosts_.erase(host->key);
+    for (size_t i = 0; i < calls.size(); ++i)
+    {
+      client->fail(calls[i], HttpClientResponse::kBadUrl);
+    }
+  }
+}
+
+void HttpClient::dispatch(HttpClientHost* host)
+{
+  if (!host->resolved)
+  {
+    return;
+  }
+  std::vector<HttpClientConnectionPtr>& connections = host->connections;
+  while (!host->waiting.empty())
+  {
+    const CallPtr& call = host->waiting.front();
+    // an idle connection, else a new one, else the least busy one pipelining
+    HttpClientConnection* conn = NULL;
+    for (size_t i = 0; i < connections.size() && !conn; ++i)
+    {
+      if (connections[i]->idle())
+      {
+        conn = connections[i].get();
+      }
+    }
+    if (!conn && connections.size() < static_cast<size_t>(maxConnectionsPerHost_))
+    {
+      conn = newConnection(host);
+      if (conn->closed())
+      {
+        // it failed the waiting requests or took them back itself
+        break;
+      }
+    }
+    for (size_t i = 0; i < connections.size() && maxPipelined_ > 1; ++i)
+    {
+      if (connections[i]->canPipeline(call->method, maxPipelined_)
+          && (!conn || connections[i]->inFlight() < conn->inFlight()))
+      {
+        conn = connections[i].get();
+      }
+    }
+    if (!conn)
+    {
+      break;
+    }
+    conn->send(call);
+    host->waiting.pop_front();
+  }
+
+  for (size_t i = 0; i < connections.size(); ++i)
+  {
+    connections[i]->flush();
+  }
+}
+
+HttpClientConnection* HttpClient::newConnection(HttpClientHost* host)
+{
+  char buf[32];
+  snprintf(buf, sizeof buf, "#%d", host->nextId++);
+  HttpClientConnectionPtr conn(new HttpClientConnection(this, host, name_ + buf));
+  host->connections.push_back(conn);
+  conn->connect();
+  return conn.get();
+}
+
+void HttpClient::removeConnection(HttpClientHost* host, HttpClientConnection* conn)
+{
+  std::vector<HttpClientConnectionPtr>& connections = host->connections;
+  for (size_t i = 0; i < connections.size(); ++i)
+  {
+    if (connections[i].get() == conn)
+    {
+      // it is on the call stack, and so is its TcpClient
+      loop_->queueInLoop(boost::bind(&detail::destroyConnection, connections[i]));
+      connections[i] = connections.back();
+      connections.pop_back();
+      return;
+    }
+  }
+  assert(false);
+}
+
+void HttpClient::onTimeout(const boost::weak_ptr<HttpClientCall>& weakCall)
+{
+  CallPtr call(weakCall.lock());
+  if (!call)
+  {
+    return;
+  }
+  if (call->connection)
+  {
+    // its response, if any, would come before the next ones
+    call->connection->close(call, HttpClientResponse::kTimeout);
+  }
+  else
+  {
+    std::deque<CallPtr>& waiting = call->host->waiting;
+    waiting.erase(std::find(waiting.begin(), waiting.end(), call));
+    fail(call, HttpClientResponse::kTimeout);
+  }
+}
+
+void HttpClient::complete(const CallPtr& call, const HttpClientResponse& response)
+{
+  loop_->cancel(call->timer);
+  call->cb(response);
+}
+
+void HttpClient::fail(const CallPtr& call, HttpClientResponse::Error error)
+{
+  HttpClientResponse response;
+  response.setError(error);
+  complete(call, response);
+}
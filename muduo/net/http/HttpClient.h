@@ -0,0 +1,164 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPCLIENT_H
+#define MUDUO_NET_HTTP_HTTPCLIENT_H
+
+#include <muduo/base/Types.h>
+#include <muduo/net/http/HttpClientResponse.h>
+#include <muduo/net/http/HttpRequest.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <map>
+
+namespace muduo
+{
+
+class ThreadPool;
+
+namespace net
+{
+
+class EventLoop;
+class InetAddress;
+
+namespace detail
+{
+struct HttpClientCall;
+class HttpClientConnection;
+struct HttpClientHost;
+}
+
+///
+/// Non-blocking HTTP/1.1 client on one EventLoop.
+///
+/// Keeps a pool of keep-alive connections per host:port, each one a
+/// TcpClient, and pipelines GET and HEAD requests on them once all the
+/// connections of a host are busy. Every request has a deadline kept by
+/// the loop's TimerQueue. An idempotent request whose connection closes
+/// before its response began, eg. an idle keep-alive connection closed by
+/// the server, is sent again once.
+///
+/// A numeric IPv4 host is used as it is. Other host names are looked up
+/// the first time a host is used, one at a time, on a resolver thread
+/// started with the first one, so the loop never waits on DNS; the
+/// requests to the host wait meanwhile, their deadlines included. A
+/// failed lookup fails them with kBadUrl. Only plain "http://" URLs.
+///
+class HttpClient : boost::noncopyable
+{
+ public:
+  /// The response is valid during the call.
+  typedef boost::function<void (const HttpClientResponse&)> ResponseCallback;
+
+  HttpClient(EventLoop* loop, const string& name);
+  /// Destroy in the loop thread. Pending requests are dropped, their
+  /// callbacks are not called. Waits for a host lookup in progress.
+  ~HttpClient();
+
+  EventLoop* getLoop() const { return loop_; }
+
+  /// Connections opened to one host:port at most, 8 by default.
+  /// Not thread safe, call before the first request.
+  void setMaxConnectionsPerHost(int num)
+  { maxConnectionsPerHost_ = num; }
+
+  /// Requests sent on a connection before the response of the first,
+  /// 1 (no pipelining) by default. Only GET and HEAD are pipelined.
+  /// Not thread safe, call before the first request.
+  void setMaxPipelined(int num)
+  { maxPipelined_ = num; }
+
+  /// Bytes of a response body at most, 64 MiB by default, checked
+  /// before any is buffered. A longer response fails with kBadResponse,
+  /// whether it has a Content-Length, is chunked or ends with the
+  /// connection.
+  /// Not thread safe, call before the first request.
+  void setMaxResponseBodySize(size_t bytes)
+  { maxResponseBodySize_ = bytes; }
+
+  /// Seconds from request() to the complete response, 30 by default,
+  /// connecting included. 0 waits forever.
+  /// Not thread safe, call before the first request.
+  void setTimeout(double seconds)
+  { timeout_ = seconds; }
+
+  /// Failed attempts to connect to a host retried, 2 by default, after
+  /// 0.5s, 1s, 2s... The requests on the connection then fail with
+  /// kConnectFailed, a connect that hangs still ends with kTimeout.
+  /// Not thread safe, call before the first request.
+  void setConnectRetries(int num)
+  { connectRetries_ = num; }
+
+  /// Sends a request to url, "http://host[:port]/path[?query]".
+  /// headers are extra lines, each ending with CRLF; Host and
+  /// Content-Length are added. cb is called once, in the loop thread.
+  /// Thread safe.
+  void request(HttpRequest::Method method,
+               const string& url,
+               const ResponseCallback& cb,
+               const string& body = string(),
+               const string& headers = string());
+
+  void get(const string& url, const ResponseCallback& cb)
+  { request(HttpRequest::kGet, url, cb); }
+
+  void post(const string& url,
+            const string& body,
+            const string& contentType,
+            const ResponseCallback& cb)
+  { request(HttpRequest::kPost, url, cb, body, "Content-Type: " + contentType + "\r\n"); }
+
+ private:
+  typedef boost::shared_ptr<detail::HttpClientCall> CallPtr;
+  typedef boost::shared_ptr<detail::HttpClientConnection> ConnectionPtr;
+  typedef boost::shared_ptr<detail::HttpClientHost> HostPtr;
+
+  friend class detail::HttpClientConnection;
+
+  void requestInLoop(HttpRequest::Method method,
+                     const string& url,
+                     const ResponseCallback& cb,
+                     const string& body,
+                     const string& headers);
+  // in the resolver thread
+  static void resolve(EventLoop* loop,
+                      const boost::weak_ptr<detail::HttpClientHost>& weakHost,
+                      const string& hostName,
+                      InetAddress addr);
+  // in the loop thread, the client may be gone since
+  static void onResolved(const boost::weak_ptr<detail::HttpClientHost>& weakHost,
+                         const InetAddress& addr,
+                         bool ok);
+  // sends the waiting requests of a resolved host on idle, new or
+  // pipelined connections
+  void dispatch(detail::HttpClientHost* host);
+  detail::HttpClientConnection* newConnection(detail::HttpClientHost* host);
+  // destroys conn once the current callback returns
+  void removeConnection(detail::HttpClientHost* host, detail::HttpClientConnection* conn);
+  void onTimeout(const boost::weak_ptr<detail::HttpClientCall>& weakCall);
+  void complete(const CallPtr& call, const HttpClientResponse& response);
+  void fail(const CallPtr& call, HttpClientResponse::Error error);
+
+  EventLoop* loop_;
+  const string name_;
+  int maxConnectionsPerHost_;
+  int maxPipelined_;
+  size_t maxResponseBodySize_;
+  double timeout_;
+  int connectRetries_;
+  std::map<string, HostPtr> hosts_;  // by "host:port", in loop thread
+  boost::scoped_ptr<ThreadPool> resolver_;  // once a name is looked up
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPCLIENT_H
@@ -0,0 +1,125 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPCLIENTRESPONSE_H
+#define MUDUO_NET_HTTP_HTTPCLIENTRESPONSE_H
+
+#include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/http/HttpHeaders.h>
+#include <muduo/net/http/HttpRequest.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Response received by HttpClient, or why there is none.
+///
+class HttpClientResponse : public muduo::copyable
+{
+ public:
+  enum Error
+  {
+    kOk,
+    kBadUrl,            // not "http://host[:port]/...", or host not found
+    kTimeout,           // not complete within HttpClient::setTimeout()
+    kConnectFailed,     // refused or unreachable, see HttpClient::setConnectRetries()
+    kConnectionClosed,  // closed before the response was complete
+    kBadResponse,       // not an HTTP/1.x response
+  };
+
+  HttpClientResponse()
+    : error_(kOk),
+      statusCode_(0),
+      version_(HttpRequest::kUnknown)
+  {
+  }
+
+  // default copy-ctor, dtor and assignment are fine
+
+  bool ok() const
+  { return error_ == kOk; }
+
+  Error error() const
+  { return error_; }
+
+  void setError(Error error)
+  { error_ = error; }
+
+  /// 0 unless ok().
+  int statusCode() const
+  { return statusCode_; }
+
+  void setStatusCode(int code)
+  { statusCode_ = code; }
+
+  const string& statusMessage() const
+  { return statusMessage_; }
+
+  void setStatusMessage(const char* start, const char* end)
+  { statusMessage_.assign(start, end); }
+
+  HttpRequest::Version version() const
+  { return version_; }
+
+  void setVersion(HttpRequest::Version v)
+  { version_ = v; }
+
+  const HttpHeaders& headers() const
+  { return headers_; }
+
+  /// field is case-insensitive, valid until the response is modified.
+  StringPiece header(const StringPiece& field) const
+  { return headers_.get(field); }
+
+  void reserveHeaders(size_t bytes)
+  { headers_.reserve(bytes); }
+
+  void addHeader(const char* start, const char* colon, const char* end)
+  { headers_.add(start, colon, end); }
+
+  bool addHeaderBlock(const char* begin, const char* end)
+  { return headers_.addBlock(begin, end); }
+
+  const string& body() const
+  { return body_; }
+
+  void appendBody(const char* start, const char* end)
+  { body_.append(start, end); }
+
+  void reserveBody(size_t size)
+  { body_.reserve(size); }
+
+  /// Keeps the capacity of the strings for the next response.
+  void clear()
+  {
+    error_ = kOk;
+    statusCode_ = 0;
+    statusMessage_.clear();
+    version_ = HttpRequest::kUnknown;
+    headers_.clear();
+    if (body_.capacity() > 64 * 1024)
+    {
+      string().swap(body_);
+    }
+    body_.clear();
+  }
+
+ private:
+  Error error_;
+  int statusCode_;
+  string statusMessage_;
+  HttpRequest::Version version_;
+  HttpHeaders headers_;
+  string body_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPCLIENTRESPONSE_H
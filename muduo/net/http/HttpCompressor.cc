@@ -0,0 +1,351 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/http/HttpCompressor.h>
+
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+#ifndef NO_ZLIB
+#include <muduo/net/ZlibStream.h>
+#endif
+
+#include <algorithm>
+#include <fcntl.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+inline uint64_t rotl(uint64_t x, int b)
+{
+  return (x << b) | (x >> (64 - b));
+}
+
+inline void sipRound(uint64_t* v)
+{
+  v[0] += v[1]; v[1] = rotl(v[1], 13); v[1] ^= v[0]; v[0] = rotl(v[0], 32);
+  v[2] += v[3]; v[3] = rotl(v[3], 16); v[3] ^= v[2];
+  v[0] += v[3]; v[3] = rotl(v[3], 21); v[3] ^= v[0];
+  v[2] += v[1]; v[1] = rotl(v[1], 17); v[1] ^= v[2]; v[2] = rotl(v[2], 32);
+}
+
+// SipHash-2-4, words in host order
+uint64_t sipHash(const uint64_t key[2], const StringPiece& body)
+{
+  uint64_t v[4] = {
+    key[0] ^ 0x736f6d6570736575ULL, key[1] ^ 0x646f72616e646f6dULL,
+    key[0] ^ 0x6c7967656e657261ULL, key[1] ^ 0x7465646279746573ULL,
+  };
+  const char* p = body.data();
+  const char* end = p + body.size();
+  for (; end - p >= 8; p += 8)
+  {
+    uint64_t word;
+    memcpy(&word, p, sizeof word);
+    v[3] ^= word;
+    sipRound(v);
+    sipRound(v);
+    v[0] ^= word;
+  }
+  uint64_t last = 0;
+  for (int i = 0; p + i < end; ++i)
+  {
+    last |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+  }
+  last |= static_cast<uint64_t>(body.size()) << 56;
+  v[3] ^= last;
+  sipRound(v);
+  sipRound(v);
+  v[0] ^= last;
+  v[2] ^= 0xff;
+  for (int i = 0; i < 4; ++i)
+  {
+    sipRound(v);
+  }
+  return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+// from /dev/urandom, or the clock and the pid if it cannot be read
+void randomKey(uint64_t* key, size_t n)
+{
+  int fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+  ssize_t nr = fd >= 0 ? ::read(fd, key, n * sizeof key[0]) : -1;
+  if (fd >= 0)
+  {
+    ::close(fd);
+  }
+  if (nr != static_cast<ssize_t>(n * sizeof key[0]))
+  {
+    uint64_t seed = Timestamp::now().microSecondsSinceEpoch()
+        ^ (static_cast<uint64_t>(::getpid()) << 32);
+    for (size_t i = 0; i < n; ++i)
+    {
+      seed += 0x9E3779B97F4A7C15ULL;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      key[i] = z ^ (z >> 31);
+    }
+  }
+}
+
+bool isCompressible(const StringPiece& contentType)
+{
+  static const char* const kTypes[] = {
+    "text/", "application/json", "application/javascript",
+    "application/xml", "image/svg+xml",
+  };
+  for (size_t i = 0; i < sizeof kTypes / sizeof kTypes[0]; ++i)
+  {
+    StringPiece type(kTypes[i]);
+    if (contentType.size() >= type.size()
+        && ::strncasecmp(contentType.data(), type.data(), type.size()) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+StringPiece trim(const char* begin, const char* end)
+{
+  while (begin < end && (*begin == ' ' || *begin == '\t'))
+    ++begin;
+  while (end > begin && (end[-1] == ' ' || end[-1] == '\t'))
+    --end;
+  return StringPiece(begin, static_cast<int>(end - begin));
+}
+
+// "q=0", "q=0.0" and so on
+bool isZeroQuality(const StringPiece& params)
+{
+  const char* q = static_cast<const char*>(memmem(params.data(), params.size(), "q=", 2));
+  if (!q)
+  {
+    return false;
+  }
+  for (q += 2; q < params.end() && *q != ';'; ++q)
+  {
+    if (*q != '0' && *q != '.' && *q != ' ')
+      return false;
+  }
+  return true;
+}
+
+boost::shared_ptr<const string> deflateBody(const StringPiece& body,
+                                            HttpCompressor::Encoding encoding)
+{
+  boost::shared_ptr<const string> compressed;
+#ifndef NO_ZLIB
+  Buffer output;
+  {
+    ZlibOutputStream stream(&output,
+                            encoding == HttpCompressor::kGzip ? 16 + MAX_WBITS : MAX_WBITS);
+    if (!stream.write(body) || !stream.finish())
+    {
+      return compressed;
+    }
+  }
+  if (output.readableBytes() < static_cast<size_t>(body.size()))
+  {
+    compressed.reset(new string(output.peek(), output.readableBytes()));
+  }
+#else
+  (void) body;
+  (void) encoding;
+#endif
+  return compressed;
+}
+
+}
+
+const size_t HttpCompressor::kDefaultMinSize;
+const size_t HttpCompressor::kDefaultMaxCacheBytes;
+
+HttpCompressor::HttpCompressor(size_t minSize, size_t maxCacheBytes)
+  : minSize_(minSize),
+    maxCacheBytes_(maxCacheBytes),
+    cachedBytes_(0),
+    hits_(0),
+    misses_(0)
+{
+  randomKey(hashKey_, sizeof hashKey_ / sizeof hashKey_[0]);
+}
+
+void HttpCompressor::hashBody(const StringPiece& body, Key* key) const
+{
+  key->hash1 = sipHash(hashKey_, body);
+  key->hash2 = sipHash(hashKey_ + 2, body);
+}
+
+HttpCompressor::Encoding HttpCompressor::negotiate(const StringPiece& acceptEncoding)
+{
+#ifdef NO_ZLIB
+  (void) acceptEncoding;
+  return kIdentity;
+#else
+  // 1 accepted, 0 refused, -1 not mentioned
+  int gzip = -1;
+  int deflate = -1;
+  int any = -1;
+  const char* p = acceptEncoding.begin();
+  const char* end = acceptEncoding.end();
+  while (p < end)
+  {
+    const char* comma = std::find(p, end, ',');
+    const char* semicolon = std::find(p, comma, ';');
+    StringPiece coding = trim(p, semicolon);
+    int accepted = isZeroQuality(StringPiece(semicolon, static_cast<int>(comma - semicolon))) ? 0 : 1;
+    if (coding.size() == 4 && ::strncasecmp(coding.data(), "gzip", 4) == 0)
+      gzip = accepted;
+    else if (coding.size() == 6 && ::strncasecmp(coding.data(), "x-gzip", 6) == 0)
+      gzip = accepted;
+    else if (coding.size() == 7 && ::strncasecmp(coding.data(), "deflate", 7) == 0)
+      deflate = accepted;
+    else if (coding == "*")
+      any = accepted;
+    p = comma + 1;
+  }
+  if (gzip == 1 || (gzip == -1 && any == 1))
+    return kGzip;
+  if (deflate == 1 || (deflate == -1 && any == 1))
+    return kDeflate;
+  return kIdentity;
+#endif
+}
+
+boost::shared_ptr<const string> HttpCompressor::compress(const StringPiece& body,
+                                                         Encoding encoding)
+{
+  if (encoding == kIdentity)
+  {
+    return boost::shared_ptr<const string>();
+  }
+
+  Key key = { static_cast<size_t>(body.size()), encoding, 0, 0 };
+  bool hashed = false;
+  bool sizeMatched = false;
+  {
+    MutexLockGuard lock(mutex_);
+    sizeMatched = sizeCached(key);
+  }
+  if (sizeMatched)
+  {
+    hashBody(body, &key);
+    hashed = true;
+    MutexLockGuard lock(mutex_);
+    EntryMap::iterator it = entries_.find(key);
+    if (it != entries_.end())
+    {
+      lru_.splice(lru_.begin(), lru_, it->second.lru);
+      ++hits_;
+      return it->second.compressed;
+    }
+  }
+
+  // compress and hash without the lock, two threads may both do a new body
+  boost::shared_ptr<const string> compressed = deflateBody(body, encoding);
+  bool cacheable = compressed && compressed->size() <= maxCacheBytes_;
+  if (cacheable && !hashed)
+  {
+    hashBody(body, &key);
+  }
+
+  MutexLockGuard lock(mutex_);
+  ++misses_;
+  if (!cacheable)
+  {
+    return compressed;
+  }
+  std::pair<EntryMap::iterator, bool> inserted =
+      entries_.insert(std::make_pair(key, Entry()));
+  Entry& entry = inserted.first->second;
+  if (inserted.second)
+  {
+    lru_.push_front(key);
+    entry.lru = lru_.begin();
+  }
+  else
+  {
+    // another thread did it meanwhile
+    cachedBytes_ -= entry.compressed->size();
+    lru_.splice(lru_.begin(), lru_, entry.lru);
+  }
+  entry.compressed = compressed;
+  cachedBytes_ += compressed->size();
+  evict();
+  return compressed;
+}
+
+bool HttpCompressor::sizeCached(const Key& key) const
+{
+  EntryMap::const_iterator it = entries_.lower_bound(key);
+  return it != entries_.end()
+      && it->first.size == key.size
+      && it->first.encoding == key.encoding;
+}
+
+void HttpCompressor::evict()
+{
+  while (cachedBytes_ > maxCacheBytes_)
+  {
+    EntryMap::iterator oldest = entries_.find(lru_.back());
+    cachedBytes_ -= oldest->second.compressed->size();
+    lru_.pop_back();
+    entries_.erase(oldest);
+  }
+}
+
+void HttpCompressor::compress(const HttpRequest& req, HttpResponse* response)
+{
+  if (response->statusCode() != HttpResponse::k200Ok
+      || response->bodyFile()
+      || response->body().size() < static_cast<int>(minSize_)
+      || !isCompressible(response->header("Content-Type"))
+      || !response->header("Content-Encoding").empty())
+  {
+    return;
+  }
+
+  // addHeader() replaces, keep what the handler varies on
+  string vary = response->header("Vary").as_string();
+  if (vary.empty())
+  {
+    response->addHeader("Vary", "Accept-Encoding");
+  }
+  else if (vary != "*" && vary.find("Accept-Encoding") == string::npos)
+  {
+    response->addHeader("Vary", vary + ", Accept-Encoding");
+  }
+  Encoding encoding = negotiate(req.header("Accept-Encoding"));
+  boost::shared_ptr<const string> compressed = compress(response->body(), encoding);
+  if (compressed)
+  {
+    response->addHeader("Content-Encoding", encoding == kGzip ? "gzip" : "deflate");
+    response->setBody(compressed);
+  }
+}
+
+size_t HttpCompressor::cachedBytes() const
+{
+  MutexLockGuard lock(mutex_);
+  return cachedBytes_;
+}
+
+int64_t HttpCompressor::hits() const
+{
+  MutexLockGuard lock(mutex_);
+  return hits_;
+}
+
+int64_t HttpCompressor::misses() const
+{
+  MutexLockGuard lock(mutex_);
+  return misses_;
+}
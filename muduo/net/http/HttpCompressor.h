@@ -0,0 +1,119 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPCOMPRESSOR_H
+#define MUDUO_NET_HTTP_HTTPCOMPRESSOR_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <list>
+#include <map>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpRequest;
+class HttpResponse;
+
+///
+/// gzip and deflate Content-Encoding of in-memory response bodies.
+///
+/// Compressed bodies are kept in an LRU cache of at most maxCacheBytes,
+/// so a body served over and over is compressed once. They are keyed by
+/// the length and a 128-bit hash of the body, which is not kept. A body
+/// is hashed only if one of its length is cached, or to cache it; one
+/// which does not shrink is not cached. Thread safe.
+///
+/// Not keeping the body saves a copy of each one, but a hash
+/// collision would serve the compressed body of another response, which
+/// may be another user's. So the hash is SipHash-2-4 under a random key
+/// of each HttpCompressor, twice with independent keys: a client who
+/// controls part of a body cannot aim at a collision without the key.
+/// Without zlib at build time every body is sent as it is.
+///
+class HttpCompressor : boost::noncopyable
+{
+ public:
+  enum Encoding
+  {
+    kIdentity,
+    kGzip,
+    kDeflate,
+  };
+
+  static const size_t kDefaultMinSize = 1024;
+  static const size_t kDefaultMaxCacheBytes = 16 * 1024 * 1024;
+
+  explicit HttpCompressor(size_t minSize = kDefaultMinSize,
+                          size_t maxCacheBytes = kDefaultMaxCacheBytes);
+
+  /// The best encoding allowed by an Accept-Encoding value.
+  static Encoding negotiate(const StringPiece& acceptEncoding);
+
+  /// Returns NULL if body does not get smaller.
+  boost::shared_ptr<const string> compress(const StringPiece& body, Encoding encoding);
+
+  /// Compresses a 200 response with a text-like Content-Type and a body
+  /// of at least minSize, if req accepts an encoding.
+  void compress(const HttpRequest& req, HttpResponse* response);
+
+  size_t cachedBytes() const;
+  int64_t hits() const;
+  int64_t misses() const;
+
+ private:
+  // by size first, to tell a miss without hashing
+  struct Key
+  {
+    size_t size;
+    Encoding encoding;
+    uint64_t hash1;
+    uint64_t hash2;
+
+    bool operator<(const Key& rhs) const
+    {
+      if (size != rhs.size)
+        return size < rhs.size;
+      if (encoding != rhs.encoding)
+        return encoding < rhs.encoding;
+      if (hash1 != rhs.hash1)
+        return hash1 < rhs.hash1;
+      return hash2 < rhs.hash2;
+    }
+  };
+
+  struct Entry
+  {
+    boost::shared_ptr<const string> compressed;
+    std::list<Key>::iterator lru;
+  };
+  typedef std::map<Key, Entry> EntryMap;
+
+  void hashBody(const StringPiece& body, Key* key) const;
+  void evict();  // requires mutex_
+  bool sizeCached(const Key& key) const;  // requires mutex_
+
+  const size_t minSize_;
+  const size_t maxCacheBytes_;
+  uint64_t hashKey_[4];    // two SipHash keys, set once
+  mutable MutexLock mutex_;
+  EntryMap entries_;       // guarded by mutex_
+  std::list<Key> lru_;     // most recent first
+  size_t cachedBytes_;     // of the compressed bodies
+  int64_t hits_;
+  int64_t misses_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPCOMPRESSOR_H
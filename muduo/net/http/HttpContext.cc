@@ -9,10 +9,56 @@
 
 #include <muduo/net/Buffer.h>
 #include <muduo/net/http/HttpContext.h>
+#include <muduo/net/http/HttpParsing.h>
+
+#include <string.h>
+#include <strings.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+using muduo::net::detail::findCRLF;
+
+namespace
+{
+
+// false if field is repeated with another value, the last one would
+// frame the body where a proxy may have taken the first
+bool sameValues(const HttpHeaders& headers, const char* field)
+{
+  const int last = headers.find(field);
+  const size_t len = strlen(field);
+  for (int i = 0; i < last; ++i)
+  {
+    StringPiece f = headers.field(i);
+    if (static_cast<size_t>(f.size()) == len
+        && ::strncasecmp(f.data(), field, len) == 0
+        && headers.value(i) != headers.value(last))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// its lines together make one list
+int countFields(const HttpHeaders& headers, const char* field)
+{
+  const size_t len = strlen(field);
+  int count = 0;
+  for (size_t i = 0; i < headers.size(); ++i)
+  {
+    StringPiece f = headers.field(i);
+    if (static_cast<size_t>(f.size()) == len && ::strncasecmp(f.data(), field, len) == 0)
+    {
+      ++count;
+    }
+  }
+  return count;
+}
+
+}
+
 bool HttpContext::processRequestLine(const char* begin, const char* end)
 {
   bool succeed = false;
@@ -56,6 +102,68 @@ bool HttpContext::processRequestLine(const char* begin, const char* end)
   return succeed;
 }
 
+// decides how the body is delimited once the empty line is seen
+bool HttpContext::processHeadersEnd()
+{
+  if (request_.getVersion() == HttpRequest::kHttp11)
+  {
+    StringPiece expect = request_.header("Expect");
+    expectContinue_ = expect.size() == 12
+        && ::strncasecmp(expect.data(), "100-continue", 12) == 0;
+  }
+
+  if (request_.headers().has("Transfer-Encoding"))
+  {
+    // no other coding is decoded, a body still gzipped would pass for plain
+    if (countFields(request_.headers(), "Transfer-Encoding") > 1
+        || !detail::isChunked(request_.header("Transfer-Encoding")))
+    {
+      notImplemented_ = true;
+      return false;
+    }
+    state_ = kExpectChunkSize;
+    return true;
+  }
+
+  if (request_.headers().has("Content-Length"))
+  {
+    size_t contentLength = 0;
+    if (!sameValues(request_.headers(), "Content-Length")
+        || !detail::parseContentLength(request_.header("Content-Length"), &contentLength))
+    {
+      return false;
+    }
+    if (contentLength > maxBodySize_)
+    {
+      return false;
+    }
+    if (contentLength > 0)
+    {
+      request_.reserveBody(contentLength);
+      bodyRemaining_ = contentLength;
+      state_ = kExpectBody;
+      return true;
+    }
+  }
+  expectContinue_ = false;
+  state_ = kGotAll;
+  return true;
+}
+
+// chunk-size [ chunk-ext ] CRLF
+bool HttpContext::processChunkSize(const char* begin, const char* end)
+{
+  size_t size = 0;
+  if (!detail::parseChunkSize(begin, end, &size)
+      || size > maxBodySize_ - request_.body().size())
+  {
+    return false;
+  }
+  bodyRemaining_ = size;
+  state_ = size > 0 ? kExpectChunkData : kExpectTrailers;
+  return true;
+}
+
 // return false if any error
 bool HttpContext::parseRequest(Buffer* buf, Timestamp receiveTime)
 {
@@ -65,7 +173,7 @@ bool HttpContext::parseRequest(Buffer* buf, Timestamp receiveTime)
   {
     if (state_ == kExpectRequestLine)
     {
-      const char* crlf = buf->findCRLF();
+      const char* crlf = findCRLF(buf->peek(), buf->beginWrite());
       if (crlf)
       {
         ok = processRequestLine(buf->peek(), crlf);  //
@@ -87,32 +195,186 @@ bool HttpContext::parseRequest(Buffer* buf, Timestamp receiveTime)
     }
     else if (state_ == kExpectHeaders)
     {
-      const char* crlf = buf->findCRLF();
+      // wait for the whole block, then split it in one pass
+      const char* begin = buf->peek();
+      const char* end = buf->beginWrite();
+      const char* blockEnd = detail::findHeaderBlockEnd(begin, end, headerScanned_);
+      if (blockEnd)
+      {
+        // the limit holds for a block read at once too
+        ok = static_cast<size_t>(blockEnd + 2 - begin) <= kMaxHeaderSize
+            && request_.addHeaderBlock(begin, blockEnd) && processHeadersEnd();
+        hasMore = ok;
+        buf->retrieveUntil(blockEnd + 2);
+        headerScanned_ = 0;
+        headerSize_ = blockEnd + 2 - begin;
+      }
+      else
+      {
+        headerScanned_ = buf->readableBytes();
+        ok = headerScanned_ <= kMaxHeaderSize;
+        hasMore = false;
+      }
+    }
+    else if (state_ == kExpectBody || state_ == kExpectChunkData)
+    {
+      size_t n = std::min(buf->readableBytes(), bodyRemaining_);
+      request_.appendBody(buf->peek(), buf->peek() + n);
+      buf->retrieve(n);
+      bodyRemaining_ -= n;
+      if (bodyRemaining_ == 0)
+      {
+        state_ = state_ == kExpectBody ? kGotAll : kExpectChunkEnd;
+      }
+      else
+      {
+        hasMore = false;
+      }
+    }
+    else if (state_ == kExpectChunkSize)
+    {
+      const char* crlf = findCRLF(buf->peek(), buf->beginWrite());
       if (crlf)
       {
-        const char* colon = std::find(buf->peek(), crlf, ':');
-        if (colon != crlf)
+        ok = static_cast<size_t>(crlf - buf->peek()) <= detail::kMaxChunkSizeLine
+            && processChunkSize(buf->peek(), crlf);
+        hasMore = ok;
+        buf->retrieveUntil(crlf + 2);
+      }
+      else
+      {
+        // or a line without end would be buffered for ever
+        ok = buf->readableBytes() <= detail::kMaxChunkSizeLine;
+        hasMore = false;
+      }
+    }
+    else if (state_ == kExpectChunkEnd)
+    {
+      if (buf->readableBytes() >= 2)
+      {
+        ok = buf->peek()[0] == '\r' && buf->peek()[1] == '\n';
+        hasMore = ok;
+        buf->retrieve(2);
+        state_ = kExpectChunkSize;
+      }
+      else
+      {
+        hasMore = false;
+      }
+    }
+    else if (state_ == kExpectTrailers)
+    {
+      // trailers count against the limit of the header block
+      const char* crlf = findCRLF(buf->peek(), buf->beginWrite());
+      if (crlf)
+      {
+        headerSize_ += crlf + 2 - buf->peek();
+        const char* colon = NULL;
+        detail::TrailerLine line = detail::parseTrailerLine(buf->peek(), crlf, &colon);
+        if (headerSize_ > kMaxHeaderSize || line == detail::kBadTrailer)
+        {
+          ok = false;
+          hasMore = false;
+        }
+        else if (line == detail::kTrailerField)
         {
           request_.addHeader(buf->peek(), colon, crlf);
         }
         else
         {
-          // empty line, end of header
-          // FIXME:
           state_ = kGotAll;
-          hasMore = false;
         }
         buf->retrieveUntil(crlf + 2);
       }
       else
       {
+        ok = headerSize_ + buf->readableBytes() <= kMaxHeaderSize;
         hasMore = false;
       }
     }
-    else if (state_ == kExpectBody)
+    else
     {
-      // FIXME:
+      // kGotAll, leave the next pipelined request in buf
+      hasMore = false;
     }
   }
   return ok;
 }
+
+void HttpContext::complete(int64_t sequence,
+                           const StringPiece& data,
+                           bool close,
+                           Buffer* output)
+{
+  if (closing_)
+  {
+    return;
+  }
+  if (sequence != nextResponseSequence_)
+  {
+    assert(sequence > nextResponseSequence_);
+    CompletedResponse& response = completed_[sequence];
+    data.CopyToString(&response.data);
+    response.close = close;
+    return;
+  }
+  output->append(data);
+  completeNext(close, output);
+}
+
+void HttpContext::completeNext(bool close, Buffer* output)
+{
+  ++nextResponseSequence_;
+  while (!close
+         && !completed_.empty()
+         && completed_.begin()->first == nextResponseSequence_)
+  {
+    CompletedResponse& response = completed_.begin()->second;
+    output->append(response.data);
+    if (response.stream)
+    {
+      // its body comes next
+      stream_.swap(response.stream);
+      completed_.erase(completed_.begin());
+      return;
+    }
+    close = response.close;
+    completed_.erase(completed_.begin());
+    ++nextResponseSequence_;
+  }
+  if (close)
+  {
+    closing_ = true;
+    completed_.clear();
+  }
+}
+
+bool HttpContext::startStream(int64_t sequence,
+                              const StringPiece& headers,
+                              const AsyncHttpResponsePtr& stream,
+                              Buffer* output)
+{
+  if (closing_)
+  {
+    return false;
+  }
+  if (sequence != nextResponseSequence_)
+  {
+    assert(sequence > nextResponseSequence_);
+    CompletedResponse& response = completed_[sequence];
+    headers.CopyToString(&response.data);
+    response.close = false;
+    response.stream = stream;
+    return true;
+  }
+  output->append(headers);
+  stream_ = stream;
+  return true;
+}
+
+void HttpContext::finishStream(bool close, Buffer* output)
+{
+  assert(stream_);
+  stream_.reset();
+  completeNext(close, output);
+}
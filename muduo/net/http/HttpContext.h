@@ -13,7 +13,12 @@
 
 #include <muduo/base/copyable.h>
 
+#include <muduo/net/http/AsyncHttpResponse.h>
 #include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/http/WebSocket.h>
+
+#include <map>
 
 namespace muduo
 {
@@ -31,27 +36,66 @@ class HttpContext : public muduo::copyable
     kExpectRequestLine,
     kExpectHeaders,
     kExpectBody,
+    kExpectChunkSize,
+    kExpectChunkData,
+    kExpectChunkEnd,
+    kExpectTrailers,
     kGotAll,
   };
 
+  static const size_t kDefaultMaxBodySize = 16 * 1024 * 1024;
+  static const size_t kMaxHeaderSize = 64 * 1024;
+
   HttpContext()
-    : state_(kExpectRequestLine)
+    : state_(kExpectRequestLine),
+      bodyRemaining_(0),
+      headerScanned_(0),
+      headerSize_(0),
+      expectContinue_(false),
+      notImplemented_(false),
+      maxBodySize_(kDefaultMaxBodySize),
+      response_(false),
+      nextRequestSequence_(0),
+      nextResponseSequence_(0),
+      lastRequestSeen_(false),
+      closing_(false)
   {
   }
 
   // default copy-ctor, dtor and assignment are fine
 
   // return false if any error
+  // stops after one complete request, so pipelined requests stay in buf
   bool parseRequest(Buffer* buf, Timestamp receiveTime);
 
   bool gotAll() const
   { return state_ == kGotAll; }
 
+  // parseRequest() failed on a transfer coding other than chunked,
+  // to be answered with 501
+  bool notImplemented() const
+  { return notImplemented_; }
+
+  // true once if the client waits for "100 Continue" before the body
+  bool takeExpectContinue()
+  {
+    bool expect = expectContinue_;
+    expectContinue_ = false;
+    return expect;
+  }
+
+  void setMaxBodySize(size_t size)
+  { maxBodySize_ = size; }
+
   void reset()
   {
     state_ = kExpectRequestLine;
-    HttpRequest dummy;
-    request_.swap(dummy);
+    bodyRemaining_ = 0;
+    headerScanned_ = 0;
+    headerSize_ = 0;
+    expectContinue_ = false;
+    notImplemented_ = false;
+    request_.clear();
   }
 
   const HttpRequest& request() const
@@ -60,11 +104,91 @@ class HttpContext : public muduo::copyable
   HttpRequest& request()
   { return request_; }
 
+  /// Reused by every response on this connection.
+  HttpResponse& response()
+  { return response_; }
+
+  // Responses go out in request order: one completed before those of
+  // earlier requests is kept until they are sent.
+
+  int64_t nextSequence()
+  { return nextRequestSequence_++; }
+
+  /// Requests dispatched whose response is not sent yet.
+  size_t inFlight() const
+  { return static_cast<size_t>(nextRequestSequence_ - nextResponseSequence_); }
+
+  bool isNextResponse(int64_t sequence) const
+  { return sequence == nextResponseSequence_; }
+
+  /// Appends the response of sequence to output if it is its turn,
+  /// followed by any kept responses which are now in order.
+  void complete(int64_t sequence, const StringPiece& data, bool close, Buffer* output);
+
+  /// Like complete(), when the caller has appended the next response itself.
+  void completeNext(bool close, Buffer* output);
+
+  /// Like complete() for the headers of a streamed response, which then
+  /// stays the next one, holding back those after it, until finishStream().
+  /// Returns false if the connection is closing and stream was dropped.
+  bool startStream(int64_t sequence,
+                   const StringPiece& headers,
+                   const AsyncHttpResponsePtr& stream,
+                   Buffer* output);
+
+  /// The streamed response whose headers are sent, NULL if none.
+  const AsyncHttpResponsePtr& stream() const
+  { return stream_; }
+
+  /// The body of stream() is sent.
+  void finishStream(bool close, Buffer* output);
+
+  /// A close response was sent, everything after it is dropped.
+  bool closing() const
+  { return closing_; }
+
+  /// The client asked to close after the current request.
+  void setLastRequestSeen()
+  { lastRequestSeen_ = true; }
+
+  bool lastRequestSeen() const
+  { return lastRequestSeen_; }
+
+  /// Set once the connection is upgraded, its data are frames from then.
+  const WebSocketConnectionPtr& webSocket() const
+  { return webSocket_; }
+
+  void setWebSocket(const WebSocketConnectionPtr& webSocket)
+  { webSocket_ = webSocket; }
+
  private:
   bool processRequestLine(const char* begin, const char* end);
+  bool processHeadersEnd();
+  bool processChunkSize(const char* begin, const char* end);
 
   HttpRequestParseState state_;  //״̬
+  size_t bodyRemaining_;         // of Content-Length body or current chunk
+  size_t headerScanned_;         // bytes of an incomplete header block seen
+  size_t headerSize_;            // of the header block and trailers taken
+  bool expectContinue_;
+  bool notImplemented_;
+  size_t maxBodySize_;
   HttpRequest request_;			//http
+  HttpResponse response_;
+
+  struct CompletedResponse
+  {
+    string data;
+    bool close;
+    AsyncHttpResponsePtr stream;  // data is its headers
+  };
+  int64_t nextRequestSequence_;
+  int64_t nextResponseSequence_;
+  std::map<int64_t, CompletedResponse> completed_;
+  AsyncHttpResponsePtr stream_;
+  WebSocketConnectionPtr webSocket_;
+  bool lastRequestSeen_;
+  bool closing_;
 };
 
 }
@@ -0,0 +1,384 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/http/HttpFileCache.h>
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/http/HttpRequest.h>
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const double kRevalidateSeconds = 1.0;
+const char kHttpDateFormat[] = "%a, %d %b %Y %H:%M:%S GMT";
+
+struct ContentType
+{
+  const char* extension;
+  const char* type;
+};
+
+const ContentType kContentTypes[] = {
+  { ".html", "text/html" },
+  { ".htm", "text/html" },
+  { ".css", "text/css" },
+  { ".js", "application/javascript" },
+  { ".json", "application/json" },
+  { ".txt", "text/plain" },
+  { ".xml", "application/xml" },
+  { ".png", "image/png" },
+  { ".jpg", "image/jpeg" },
+  { ".jpeg", "image/jpeg" },
+  { ".gif", "image/gif" },
+  { ".svg", "image/svg+xml" },
+  { ".ico", "image/x-icon" },
+  { ".pdf", "application/pdf" },
+  { ".wasm", "application/wasm" },
+};
+
+const char* contentType(const StringPiece& path)
+{
+  for (size_t i = 0; i < sizeof kContentTypes / sizeof kContentTypes[0]; ++i)
+  {
+    StringPiece ext(kContentTypes[i].extension);
+    if (path.size() > ext.size()
+        && StringPiece(path.end() - ext.size(), ext.size()) == ext)
+    {
+      return kContentTypes[i].type;
+    }
+  }
+  return "application/octet-stream";
+}
+
+// no ".." segment and no NUL
+bool isSafePath(const StringPiece& path)
+{
+  if (path.empty() || path[0] != '/' || memchr(path.data(), '\0', path.size()))
+  {
+    return false;
+  }
+  const char* p = path.begin();
+  while (p < path.end())
+  {
+    const char* segment = p + 1;  // after '/'
+    p = std::find(segment, path.end(), '/');
+    if (p - segment == 2 && segment[0] == '.' && segment[1] == '.')
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// path is root or below it, both resolved by realpath(3)
+bool isUnder(const char* path, const string& root)
+{
+  return strncmp(path, root.c_str(), root.size()) == 0
+      && (path[root.size()] == '/' || path[root.size()] == '\0');
+}
+
+// returns -1 if malformed
+time_t parseHttpDate(const StringPiece& date)
+{
+  char buf[64];
+  if (date.size() >= static_cast<int>(sizeof buf))
+  {
+    return -1;
+  }
+  memcpy(buf, date.data(), date.size());
+  buf[date.size()] = '\0';
+  struct tm tm;
+  memset(&tm, 0, sizeof tm);
+  const char* end = ::strptime(buf, kHttpDateFormat, &tm);
+  return end && *end == '\0' ? ::timegm(&tm) : -1;
+}
+
+bool parseNumber(const char** p, const char* end, int64_t* value)
+{
+  const char* start = *p;
+  int64_t v = 0;
+  // 18 digits can not overflow
+  while (*p < end && **p >= '0' && **p <= '9' && *p - start < 18)
+  {
+    v = v * 10 + (**p - '0');
+    ++*p;
+  }
+  *value = v;
+  return *p > start;
+}
+
+// [*begin, *end) of "bytes=first-last" or "bytes=-suffix",
+// returns 1 if satisfiable, -1 if not, 0 if the header should be
+// ignored because it is malformed or has several ranges.
+int parseRange(StringPiece range, int64_t size, int64_t* begin, int64_t* end)
+{
+  if (!range.starts_with("bytes="))
+  {
+    return 0;
+  }
+  range.remove_prefix(6);
+  const char* p = range.begin();
+  const char* e = range.end();
+  if (std::find(p, e, ',') != e)
+  {
+    return 0;
+  }
+
+  int64_t first = 0;
+  int64_t last = 0;
+  bool hasFirst = parseNumber(&p, e, &first);
+  if (p == e || *p != '-')
+  {
+    return 0;
+  }
+  ++p;
+  bool hasLast = parseNumber(&p, e, &last);
+  if (p != e || (!hasFirst && !hasLast) || (hasFirst && hasLast && last < first))
+  {
+    return 0;
+  }
+
+  if (!hasFirst)
+  {
+    if (last == 0 || size == 0)
+    {
+      return -1;
+    }
+    *begin = std::max<int64_t>(0, size - last);
+    *end = size;
+  }
+  else
+  {
+    if (first >= size)
+    {
+      return -1;
+    }
+    *begin = first;
+    *end = hasLast && last < size ? last + 1 : size;
+  }
+  return 1;
+}
+
+}
+
+HttpFile::HttpFile(int fd, int64_t size, time_t modifiedTime, const char* contentType)
+  : fd_(fd),
+    size_(size),
+    modifiedTime_(modifiedTime),
+    contentType_(contentType)
+{
+  struct tm tm;
+  ::gmtime_r(&modifiedTime_, &tm);
+  char buf[64];
+  size_t len = ::strftime(buf, sizeof buf, kHttpDateFormat, &tm);
+  lastModified_.assign(buf, len);
+}
+
+HttpFile::~HttpFile()
+{
+  ::close(fd_);
+}
+
+HttpFileCache::HttpFileCache(const string& root, size_t maxOpenFiles)
+  : root_(root),
+    maxOpenFiles_(maxOpenFiles)
+{
+  assert(maxOpenFiles_ > 0);
+  char resolved[PATH_MAX];
+  if (::realpath(root_.c_str(), resolved))
+  {
+    realRoot_ = resolved;
+  }
+  else
+  {
+    LOG_SYSERR << "HttpFileCache " << root_;
+    realRoot_ = root_;
+  }
+}
+
+size_t HttpFileCache::size() const
+{
+  MutexLockGuard lock(mutex_);
+  return entries_.size();
+}
+
+void HttpFileCache::touch(Entry* entry)
+{
+  lru_.splice(lru_.begin(), lru_, entry->lru);
+}
+
+HttpFilePtr HttpFileCache::open(const StringPiece& requestPath)
+{
+  if (!isSafePath(requestPath))
+  {
+    return HttpFilePtr();
+  }
+  string path(requestPath.data(), requestPath.size());
+  if (path[path.size() - 1] == '/')
+  {
+    path += "index.html";
+  }
+
+  Timestamp now(Timestamp::now());
+  {
+    MutexLockGuard lock(mutex_);
+    EntryMap::iterator it = entries_.find(path);
+    if (it != entries_.end() && timeDifference(now, it->second.checked) < kRevalidateSeconds)
+    {
+      touch(&it->second);
+      return it->second.file;
+    }
+  }
+
+  // resolve, stat and open without the lock, they may block on the disk;
+  // a symlink may lead anywhere under root, but not out of it
+  string fullPath = root_ + path;
+  char resolved[PATH_MAX];
+  struct stat st;
+  if (!::realpath(fullPath.c_str(), resolved)
+      || !isUnder(resolved, realRoot_)
+      || ::stat(resolved, &st) != 0
+      || !S_ISREG(st.st_mode))
+  {
+    MutexLockGuard lock(mutex_);
+    EntryMap::iterator it = entries_.find(path);
+    if (it != entries_.end())
+    {
+      lru_.erase(it->second.lru);
+      entries_.erase(it);
+    }
+    return HttpFilePtr();
+  }
+
+  {
+    MutexLockGuard lock(mutex_);
+    EntryMap::iterator it = entries_.find(path);
+    if (it != entries_.end())
+    {
+      Entry& entry = it->second;
+      if (entry.device == st.st_dev
+          && entry.inode == st.st_ino
+          && entry.file->size() == st.st_size
+          && entry.file->modifiedTime() == st.st_mtime)
+      {
+        entry.checked = now;
+        touch(&entry);
+        return entry.file;
+      }
+    }
+  }
+
+  // not a symlink swapped in since realpath()
+  int fd = ::open(resolved, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  if (fd < 0)
+  {
+    LOG_SYSERR << "HttpFileCache::open " << resolved;
+    return HttpFilePtr();
+  }
+  // the file may have changed since stat()
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+  {
+    ::close(fd);
+    return HttpFilePtr();
+  }
+  HttpFilePtr file(new HttpFile(fd, st.st_size, st.st_mtime, contentType(path)));
+
+  MutexLockGuard lock(mutex_);
+  std::pair<EntryMap::iterator, bool> inserted =
+      entries_.insert(std::make_pair(path, Entry()));
+  Entry& entry = inserted.first->second;
+  if (inserted.second)
+  {
+    lru_.push_front(&inserted.first->first);
+    entry.lru = lru_.begin();
+  }
+  else
+  {
+    touch(&entry);
+  }
+  entry.file = file;
+  entry.device = st.st_dev;
+  entry.inode = st.st_ino;
+  entry.checked = now;
+
+  while (entries_.size() > maxOpenFiles_)
+  {
+    EntryMap::iterator oldest = entries_.find(*lru_.back());
+    lru_.pop_back();
+    entries_.erase(oldest);
+  }
+  return file;
+}
+
+void HttpFileCache::respond(const HttpRequest& req,
+                            const StringPiece& path,
+                            HttpResponse* response)
+{
+  HttpFilePtr file = open(path);
+  if (!file)
+  {
+    response->setStatusCode(HttpResponse::k404NotFound);
+    return;
+  }
+
+  response->addHeader("Last-Modified", file->lastModified());
+  response->addHeader("Accept-Ranges", "bytes");
+  StringPiece ifModifiedSince = req.header("If-Modified-Since");
+  if (!ifModifiedSince.empty()
+      && file->modifiedTime() <= parseHttpDate(ifModifiedSince))
+  {
+    response->setStatusCode(HttpResponse::k304NotModified);
+    return;
+  }
+
+  const int64_t size = file->size();
+  int64_t begin = 0;
+  int64_t end = size;
+  StringPiece range = req.header("Range");
+  StringPiece ifRange = req.header("If-Range");
+  int ranged = 0;
+  if (!range.empty() && (ifRange.empty() || ifRange == file->lastModified()))
+  {
+    ranged = parseRange(range, size, &begin, &end);
+  }
+
+  char buf[64];
+  if (ranged < 0)
+  {
+    response->setStatusCode(HttpResponse::k416RangeNotSatisfiable);
+    snprintf(buf, sizeof buf, "bytes */%" PRId64, size);
+    response->addHeader("Content-Range", buf);
+    return;
+  }
+  if (ranged > 0)
+  {
+    response->setStatusCode(HttpResponse::k206PartialContent);
+    snprintf(buf, sizeof buf, "bytes %" PRId64 "-%" PRId64 "/%" PRId64,
+             begin, end - 1, size);
+    response->addHeader("Content-Range", buf);
+  }
+  else
+  {
+    response->setStatusCode(HttpResponse::k200Ok);
+  }
+  response->setContentType(file->contentType());
+  response->setBodyFile(file, begin, static_cast<size_t>(end - begin));
+}
@@ -0,0 +1,113 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPFILECACHE_H
+#define MUDUO_NET_HTTP_HTTPFILECACHE_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <list>
+#include <map>
+#include <sys/types.h>
+#include <time.h>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpRequest;
+
+///
+/// An open regular file, closed when the last reference goes away.
+///
+class HttpFile : boost::noncopyable
+{
+ public:
+  HttpFile(int fd, int64_t size, time_t modifiedTime, const char* contentType);
+  ~HttpFile();
+
+  int fd() const
+  { return fd_; }
+
+  int64_t size() const
+  { return size_; }
+
+  time_t modifiedTime() const
+  { return modifiedTime_; }
+
+  /// The Last-Modified header value.
+  const string& lastModified() const
+  { return lastModified_; }
+
+  const char* contentType() const
+  { return contentType_; }
+
+ private:
+  const int fd_;
+  const int64_t size_;
+  const time_t modifiedTime_;
+  string lastModified_;
+  const char* contentType_;
+};
+
+///
+/// Regular files under a directory, with an LRU cache of open fds and
+/// their stat. A cached file is revalidated with stat(2) at most once a
+/// second, a changed one is reopened; evicted files stay open while
+/// responses still refer to them. Symlinks are followed only while they
+/// stay under the directory. Thread safe.
+///
+/// A miss or a revalidation resolves, stats and opens the file in the
+/// calling thread, which blocks on a slow disk; from HttpServer that is
+/// the IO thread, so serve directories on local disks only.
+///
+class HttpFileCache : boost::noncopyable
+{
+ public:
+  HttpFileCache(const string& root, size_t maxOpenFiles);
+
+  /// path is relative to root and starts with '/', a trailing '/' means
+  /// index.html. Returns NULL if it is not a readable regular file or
+  /// leaves root.
+  HttpFilePtr open(const StringPiece& path);
+
+  /// Answers GET or HEAD of path with 200, 206, 304, 404 or 416.
+  /// Supports one byte range, If-Range and If-Modified-Since.
+  void respond(const HttpRequest& req, const StringPiece& path, HttpResponse* response);
+
+  size_t size() const;
+
+ private:
+  struct Entry
+  {
+    HttpFilePtr file;
+    dev_t device;
+    ino_t inode;
+    Timestamp checked;
+    std::list<const string*>::iterator lru;
+  };
+  typedef std::map<string, Entry> EntryMap;
+
+  void touch(Entry* entry);  // requires mutex_
+
+  const string root_;
+  string realRoot_;  // root_ resolved by realpath(3)
+  const size_t maxOpenFiles_;
+  mutable MutexLock mutex_;
+  EntryMap entries_;                // guarded by mutex_
+  std::list<const string*> lru_;    // keys of entries_, most recent first
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPFILECACHE_H
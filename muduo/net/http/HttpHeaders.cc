@@ -0,0 +1,153 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/http/HttpHeaders.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <strings.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+inline bool isBlank(char c)
+{
+  return c == ' ' || c == '\t';
+}
+
+// First '\r' of a header line in [p, end), or end.
+// *colon is set to the first ':' before it, or NULL.
+// 16 bytes per step with SSE2, a byte loop for the tail.
+const char* scanHeaderLine(const char* p, const char* end, const char** colon)
+{
+  *colon = NULL;
+#ifdef __SSE2__
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i co = _mm_set1_epi8(':');
+  for (; end - p >= 16; p += 16)
+  {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int crMask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, cr));
+    if (!*colon)
+    {
+      int coMask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, co));
+      if (crMask)
+      {
+        // only colons before the CR count
+        coMask &= (crMask & -crMask) - 1;
+      }
+      if (coMask)
+      {
+        *colon = p + __builtin_ctz(coMask);
+      }
+    }
+    if (crMask)
+    {
+      return p + __builtin_ctz(crMask);
+    }
+  }
+#endif
+  for (; p < end && *p != '\r'; ++p)
+  {
+    if (*p == ':' && !*colon)
+    {
+      *colon = p;
+    }
+  }
+  return p;
+}
+
+}
+
+void HttpHeaders::add(const char* start, const char* colon, const char* end)
+{
+  assert(start <= colon && colon < end);
+  const char* value = colon + 1;
+  while (value < end && isBlank(*value))
+  {
+    ++value;
+  }
+  const char* valueEnd = end;
+  while (valueEnd > value && isBlank(valueEnd[-1]))
+  {
+    --valueEnd;
+  }
+
+  Entry e;
+  e.field = static_cast<int>(data_.size());
+  e.fieldLen = static_cast<int>(colon - start);
+  data_.append(start, colon);
+  e.value = static_cast<int>(data_.size());
+  e.valueLen = static_cast<int>(valueEnd - value);
+  data_.append(value, valueEnd);
+
+  if (size_ < kInlineEntries)
+  {
+    inline_[size_] = e;
+  }
+  else
+  {
+    overflow_.push_back(e);
+  }
+  ++size_;
+}
+
+bool HttpHeaders::addBlock(const char* begin, const char* end)
+{
+  reserve(end - begin);
+  while (begin < end)
+  {
+    const char* colon = NULL;
+    const char* cr = scanHeaderLine(begin, end, &colon);
+    if (colon == NULL || colon == begin || cr + 1 >= end || cr[1] != '\n')
+    {
+      return false;
+    }
+    add(begin, colon, cr);
+    begin = cr + 2;
+  }
+  return true;
+}
+
+int HttpHeaders::find(const StringPiece& field) const
+{
+  const int len = field.size();
+  // most lookups use the canonical spelling, compare the first byte case-folded
+  const char first = static_cast<char>(field.empty() ? 0 : field[0] | 0x20);
+  // from the back, a repeated field overrides the earlier ones
+  for (size_t i = size_; i > 0; --i)
+  {
+    const Entry& e = entry(i - 1);
+    if (e.fieldLen == len
+        && (data_[e.field] | 0x20) == first
+        && ::strncasecmp(data_.data() + e.field, field.data(), len) == 0)
+    {
+      return static_cast<int>(i - 1);
+    }
+  }
+  return -1;
+}
+
+void HttpHeaders::clear()
+{
+  data_.clear();
+  size_ = 0;
+  overflow_.clear();
+}
+
+void HttpHeaders::swap(HttpHeaders& that)
+{
+  data_.swap(that.data_);
+  std::swap(size_, that.size_);
+  size_t n = std::max(size_, that.size_);
+  if (n > kInlineEntries)
+    n = kInlineEntries;
+  std::swap_ranges(inline_, inline_ + n, that.inline_);
+  overflow_.swap(that.overflow_);
+}
@@ -0,0 +1,112 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPHEADERS_H
+#define MUDUO_NET_HTTP_HTTPHEADERS_H
+
+#include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Header fields of one HTTP message, in arrival order.
+///
+/// All fields and values are kept in a single string and entries are
+/// offsets into it, so a typical header set costs one allocation and
+/// the object can be copied or swapped freely. Returned pieces point
+/// into this object and are valid until it is modified.
+/// The first kInlineEntries entries live inside the object.
+/// Lookup is case-insensitive. A repeated field is kept as many entries,
+/// lookup returns the last one, as the std::map<string, string> which
+/// HttpRequest::headers() used to return did.
+///
+class HttpHeaders : public muduo::copyable
+{
+ public:
+  static const size_t kInlineEntries = 16;
+
+  HttpHeaders()
+    : size_(0)
+  {
+  }
+
+  // default copy-ctor, dtor and assignment are fine
+
+  /// Reserves room for bytes of header lines, ie. the header block size.
+  void reserve(size_t bytes)
+  { data_.reserve(bytes); }
+
+  /// Adds the line [start, end) split at colon, trims the value.
+  void add(const char* start, const char* colon, const char* end);
+
+  /// Adds the lines of a complete header block [begin, end), each ending
+  /// with CRLF. Returns false at a line without a field name.
+  bool addBlock(const char* begin, const char* end);
+
+  size_t size() const
+  { return size_; }
+
+  bool empty() const
+  { return size_ == 0; }
+
+  StringPiece field(size_t i) const
+  {
+    const Entry& e = entry(i);
+    return StringPiece(data_.data() + e.field, e.fieldLen);
+  }
+
+  StringPiece value(size_t i) const
+  {
+    const Entry& e = entry(i);
+    return StringPiece(data_.data() + e.value, e.valueLen);
+  }
+
+  /// Returns the index of the last field of that name, or -1.
+  int find(const StringPiece& field) const;
+
+  /// Returns the value of field, or an empty piece.
+  StringPiece get(const StringPiece& field) const
+  {
+    int i = find(field);
+    return i >= 0 ? value(i) : StringPiece();
+  }
+
+  bool has(const StringPiece& field) const
+  { return find(field) >= 0; }
+
+  void clear();
+  void swap(HttpHeaders& that);
+
+ private:
+  struct Entry
+  {
+    int field;
+    int fieldLen;
+    int value;
+    int valueLen;
+  };
+
+  const Entry& entry(size_t i) const
+  {
+    return i < kInlineEntries ? inline_[i] : overflow_[i - kInlineEntries];
+  }
+
+  string data_;
+  size_t size_;
+  Entry inline_[kInlineEntries];
+  std::vector<Entry> overflow_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPHEADERS_H
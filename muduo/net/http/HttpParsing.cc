@@ -0,0 +1,150 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/http/HttpParsing.h>
+
+#include <algorithm>
+
+#include <strings.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// Looks at 16 bytes per step with SSE2, which every x86-64 has, and
+// falls back to a byte loop for the tail and other targets.
+
+// first '\r' in [p, end), or end
+const char* findCR(const char* p, const char* end)
+{
+#ifdef __SSE2__
+  const __m128i cr = _mm_set1_epi8('\r');
+  for (; end - p >= 16; p += 16)
+  {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, cr));
+    if (mask)
+    {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  while (p < end && *p != '\r')
+  {
+    ++p;
+  }
+  return p;
+}
+
+}
+
+const char* detail::findCRLF(const char* p, const char* end)
+{
+  for (p = findCR(p, end); p + 1 < end; p = findCR(p + 1, end))
+  {
+    if (p[1] == '\n')
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+const char* detail::findHeaderBlockEnd(const char* begin, const char* end, size_t scanned)
+{
+  if (end - begin >= 2 && begin[0] == '\r' && begin[1] == '\n')
+  {
+    return begin;
+  }
+  // resume where the last call stopped, a CRLFCRLF may straddle
+  const char* p = begin + (scanned > 3 ? scanned - 3 : 0);
+  for (p = findCRLF(p, end); p; p = findCRLF(p + 2, end))
+  {
+    if (end - p >= 4 && p[2] == '\r' && p[3] == '\n')
+    {
+      return p + 2;
+    }
+  }
+  return NULL;
+}
+
+bool detail::parseChunkSize(const char* begin, const char* end, size_t* size)
+{
+  *size = 0;
+  const char* p = begin;
+  for (; p < end && p - begin < 16; ++p)
+  {
+    int digit;
+    if (*p >= '0' && *p <= '9')
+      digit = *p - '0';
+    else if (*p >= 'a' && *p <= 'f')
+      digit = *p - 'a' + 10;
+    else if (*p >= 'A' && *p <= 'F')
+      digit = *p - 'A' + 10;
+    else
+      break;
+    *size = *size * 16 + digit;
+  }
+  return p > begin && (p == end || *p == ';' || *p == ' ' || *p == '\t');
+}
+
+detail::TrailerLine detail::parseTrailerLine(const char* begin,
+                                             const char* end,
+                                             const char** colon)
+{
+  if (begin == end)
+  {
+    return kTrailersEnd;
+  }
+  *colon = std::find(begin, end, ':');
+  return *colon != end && *colon != begin ? kTrailerField : kBadTrailer;
+}
+
+bool detail::parseContentLength(const StringPiece& value, size_t* length)
+{
+  if (value.empty() || value.size() > 18)
+  {
+    return false;
+  }
+  *length = 0;
+  for (int i = 0; i < value.size(); ++i)
+  {
+    char c = value[i];
+    if (c < '0' || c > '9')
+    {
+      return false;
+    }
+    *length = *length * 10 + (c - '0');
+  }
+  return true;
+}
+
+bool detail::isChunked(const StringPiece& encoding)
+{
+  int codings = 0;
+  bool chunked = false;
+  const char* p = encoding.begin();
+  const char* end = encoding.end();
+  while (p < end)
+  {
+    const char* comma = std::find(p, end, ',');
+    const char* last = comma;
+    while (p < last && (*p == ' ' || *p == '\t'))
+      ++p;
+    while (last > p && (last[-1] == ' ' || last[-1] == '\t'))
+      --last;
+    if (p < last)
+    {
+      // empty list elements are allowed
+      ++codings;
+      chunked = last - p == 7 && ::strncasecmp(p, "chunked", 7) == 0;
+    }
+    p = comma + 1;
+  }
+  return codings == 1 && chunked;
+}
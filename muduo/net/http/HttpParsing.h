@@ -0,0 +1,60 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_HTTP_HTTPPARSING_H
+#define MUDUO_NET_HTTP_HTTPPARSING_H
+
+#include <muduo/base/StringPiece.h>
+
+#include <stddef.h>
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+// Scanners shared by the request parser, HttpContext, and the response
+// parser of HttpClient. Header lines are split by HttpHeaders::addBlock().
+
+// first CRLF in [begin, end), or NULL
+const char* findCRLF(const char* begin, const char* end);
+
+// The end of the header block at begin: past the CRLF of its last line,
+// begin if it has no line, NULL until the empty line has arrived.
+// The first scanned bytes were looked at by an earlier call.
+const char* findHeaderBlockEnd(const char* begin, const char* end, size_t scanned);
+
+// a longer chunk-size line, extensions included, is an error
+const size_t kMaxChunkSizeLine = 1024;
+
+// chunk-size [ chunk-ext ], the line without its CRLF
+bool parseChunkSize(const char* begin, const char* end, size_t* size);
+
+// at most 18 digits, which do not overflow
+bool parseContentLength(const StringPiece& value, size_t* length);
+
+enum TrailerLine
+{
+  kTrailerField,  // *colon is set
+  kTrailersEnd,
+  kBadTrailer
+};
+
+// A trailer line without its CRLF. Only the empty line ends the
+// trailers, or the rest of a bad line would start the next message.
+TrailerLine parseTrailerLine(const char* begin, const char* end, const char** colon);
+
+// A Transfer-Encoding value, a comma-separated list of codings: true if
+// it is chunked alone, the only coding decoded. Codings are whole tokens,
+// "xchunked" is not chunked.
+bool isChunked(const StringPiece& encoding);
+
+}
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPPARSING_H
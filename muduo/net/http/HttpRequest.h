@@ -14,8 +14,8 @@
 #include <muduo/base/copyable.h>
 #include <muduo/base/Timestamp.h>
 #include <muduo/base/Types.h>
+#include <muduo/net/http/HttpHeaders.h>
 
-#include <map>
 #include <assert.h>
 #include <stdio.h>
 
@@ -53,7 +53,7 @@ class HttpRequest : public muduo::copyable
   bool setMethod(const char* start, const char* end)
   {
     assert(method_ == kInvalid);
-    string m(start, end);
+    StringPiece m(start, static_cast<int>(end - start));
     if (m == "GET")
     {
       method_ = kGet;
@@ -85,9 +85,14 @@ class HttpRequest : public muduo::copyable
   { return method_; }
 
   const char* methodString() const
+  {
+    return methodName(method_);
+  }
+
+  static const char* methodName(Method method)
   {
     const char* result = "UNKNOWN";
-    switch(method_)
+    switch(method)
     {
       case kGet:
         result = "GET";
@@ -132,36 +137,74 @@ class HttpRequest : public muduo::copyable
   Timestamp receiveTime() const
   { return receiveTime_; }
 
+  void reserveHeaders(size_t bytes)
+  {
+    headers_.reserve(bytes);
+  }
+
   void addHeader(const char* start, const char* colon, const char* end)
   {
-    string field(start, colon);
-    ++colon;
-    while (colon < end && isspace(*colon))
-    {
-      ++colon;
-    }
-    string value(colon, end);
-    while (!value.empty() && isspace(value[value.size()-1]))
-    {
-      value.resize(value.size()-1);
-    }
-    headers_[field] = value;
+    headers_.add(start, colon, end);
   }
 
-  string getHeader(const string& field) const
+  bool addHeaderBlock(const char* begin, const char* end)
   {
-    string result;
-    std::map<string, string>::const_iterator it = headers_.find(field);
-    if (it != headers_.end())
-    {
-      result = it->second;
-    }
-    return result;
+    return headers_.addBlock(begin, end);
+  }
+
+  /// field is case-insensitive, a repeated field gives its last value
+  string getHeader(const StringPiece& field) const
+  {
+    return headers_.get(field).as_string();
+  }
+
+  /// Like getHeader() without a copy, valid until the request is modified.
+  StringPiece header(const StringPiece& field) const
+  {
+    return headers_.get(field);
   }
 
-  const std::map<string, string>& headers() const
+  /// Every header line in arrival order, repeated fields included.
+  /// Was a std::map<string, string>, iterate with size(), field(i)
+  /// and value(i) instead.
+  const HttpHeaders& headers() const
   { return headers_; }
 
+  void setBody(const char* start, const char* end)
+  {
+    body_.assign(start, end);
+  }
+
+  void appendBody(const char* start, const char* end)
+  {
+    body_.append(start, end);
+  }
+
+  void reserveBody(size_t size)
+  {
+    body_.reserve(size);
+  }
+
+  const string& body() const
+  { return body_; }
+
+  /// Like swapping with a default constructed request, but keeps the
+  /// capacity of the strings for the next request on the connection.
+  void clear()
+  {
+    method_ = kInvalid;
+    version_ = kUnknown;
+    path_.clear();
+    query_.clear();
+    receiveTime_ = Timestamp();
+    headers_.clear();
+    if (body_.capacity() > 64 * 1024)
+    {
+      string().swap(body_);
+    }
+    body_.clear();
+  }
+
   void swap(HttpRequest& that)
   {
     std::swap(method_, that.method_);
@@ -170,14 +213,17 @@ class HttpRequest : public muduo::copyable
     query_.swap(that.query_);
     receiveTime_.swap(that.receiveTime_);
     headers_.swap(that.headers_);
+    body_.swap(that.body_);
   }
 
  private:
 	 Method method_;	   // 󷽷
 	 Version version_;	   // Э汾1.0/1.1
 	 string path_;		   // ·
+	 string query_;		   // query string, including the leading '?'
 	 Timestamp receiveTime_;   // ʱ
-	 std::map<string, string> headers_;    // headerб
+	 HttpHeaders headers_;    // headerб
+	 string body_;		   // request body, de-chunked
 };
 
 }
@@ -8,43 +8,206 @@
 //
 
 #include <muduo/net/http/HttpResponse.h>
+#include <muduo/base/Logging.h>
 #include <muduo/net/Buffer.h>
+#include <muduo/net/http/HttpFileCache.h>
 
+#include <assert.h>
+#include <errno.h>
 #include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
-void HttpResponse::appendToBuffer(Buffer* output) const
+namespace
 {
-  char buf[32];
-  snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_);
-  output->append(buf);
-  output->append(statusMessage_);
-  output->append("\r\n");
+
+const size_t kMaxRetainedBody = 64 * 1024;
+
+// complete status lines of the codes HttpResponse knows about
+StringPiece statusLine(int code)
+{
+  switch (code)
+  {
+    case 200: return "HTTP/1.1 200 OK\r\n";
+    case 204: return "HTTP/1.1 204 No Content\r\n";
+    case 206: return "HTTP/1.1 206 Partial Content\r\n";
+    case 301: return "HTTP/1.1 301 Moved Permanently\r\n";
+    case 302: return "HTTP/1.1 302 Found\r\n";
+    case 304: return "HTTP/1.1 304 Not Modified\r\n";
+    case 400: return "HTTP/1.1 400 Bad Request\r\n";
+    case 403: return "HTTP/1.1 403 Forbidden\r\n";
+    case 404: return "HTTP/1.1 404 Not Found\r\n";
+    case 405: return "HTTP/1.1 405 Method Not Allowed\r\n";
+    case 413: return "HTTP/1.1 413 Payload Too Large\r\n";
+    case 416: return "HTTP/1.1 416 Range Not Satisfiable\r\n";
+    case 500: return "HTTP/1.1 500 Internal Server Error\r\n";
+    case 503: return "HTTP/1.1 503 Service Unavailable\r\n";
+    default: return StringPiece();
+  }
+}
+
+// writes decimal digits of v backwards, ending at end
+char* formatDecimal(char* end, size_t v)
+{
+  do
+  {
+    *--end = static_cast<char>('0' + v % 10);
+    v /= 10;
+  } while (v != 0);
+  return end;
+}
+
+// the copying path for file bodies, when sendfile(2) can not be used,
+// false if the file ends early or can not be read
+bool appendFile(Buffer* output, int fd, int64_t offset, size_t length)
+{
+  output->ensureWritableBytes(length);
+  while (length > 0)
+  {
+    ssize_t n = ::pread(fd, output->beginWrite(), length, offset);
+    if (n <= 0)
+    {
+      if (n < 0 && errno == EINTR)
+        continue;
+      LOG_ERROR << "HttpResponse: short read of file body, " << length << " bytes missing";
+      return false;
+    }
+    output->hasWritten(n);
+    offset += n;
+    length -= n;
+  }
+  return true;
+}
+
+}
+
+void HttpResponse::reset(bool close)
+{
+  statusCode_ = kUnknown;
+  statusMessage_.clear();
+  closeConnection_ = close;
+  chunked_ = false;
+  headers_.clear();
+  if (body_.capacity() > kMaxRetainedBody)
+  {
+    string().swap(body_);
+  }
+  body_.clear();
+  bodyRef_.clear();
+  sharedBody_.reset();
+  file_.reset();
+}
+
+void HttpResponse::addHeader(const StringPiece& key, const StringPiece& value)
+{
+  size_t valueEnd = 0;
+  size_t valueBegin = findHeader(key, &valueEnd);
+  if (valueBegin != string::npos)
+  {
+    headers_.replace(valueBegin, valueEnd - valueBegin, value.data(), value.size());
+    return;
+  }
+  headers_.append(key.data(), key.size());
+  headers_.append(": ", 2);
+  headers_.append(value.data(), value.size());
+  headers_.append("\r\n", 2);
+}
+
+StringPiece HttpResponse::header(const StringPiece& field) const
+{
+  size_t valueEnd = 0;
+  size_t valueBegin = findHeader(field, &valueEnd);
+  if (valueBegin == string::npos)
+  {
+    return StringPiece();
+  }
+  return StringPiece(headers_.data() + valueBegin, static_cast<int>(valueEnd - valueBegin));
+}
+
+size_t HttpResponse::findHeader(const StringPiece& field, size_t* valueEnd) const
+{
+  const char* begin = headers_.data();
+  const char* line = begin;
+  const char* end = line + headers_.size();
+  while (line < end)
+  {
+    const char* crlf = static_cast<const char*>(memchr(line, '\r', end - line));
+    assert(crlf && crlf + 1 < end);
+    if (crlf - line > field.size() + 1
+        && line[field.size()] == ':'
+        && ::strncasecmp(line, field.data(), field.size()) == 0)
+    {
+      *valueEnd = crlf - begin;
+      return line + field.size() + 2 - begin;  // ": "
+    }
+    line = crlf + 2;
+  }
+  return string::npos;
+}
+
+bool HttpResponse::appendToBuffer(Buffer* output) const
+{
+  // "Content-Length: " + digits + "Connection: Keep-Alive" + CRLFs
+  output->ensureWritableBytes(64 + statusMessage_.size()
+                              + headers_.size() + bodyLength());
+  appendHeadersToBuffer(output);
+  if (file_)
+  {
+    return appendFile(output, file_->fd(), fileOffset_, fileLength_);
+  }
+  output->append(body());
+  return true;
+}
+
+void HttpResponse::appendHeadersToBuffer(Buffer* output) const
+{
+  StringPiece line = statusLine(statusCode_);
+  if (!line.empty()
+      && (statusMessage_.empty()
+          || StringPiece(line.data() + 13, line.size() - 15) == statusMessage_))
+  {
+    output->append(line);
+  }
+  else
+  {
+    char buf[32];
+    int len = snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_);
+    output->append(buf, len);
+    output->append(statusMessage_);
+    output->append("\r\n", 2);
+  }
 
   if (closeConnection_)
   {
 	// ǶӣҪContent-LengthҲȷ
     output->append("Connection: close\r\n");
   }
-  else
+  else if (chunked_
+           || statusCode_ == k204NoContent
+           || statusCode_ == k304NotModified)
   {
-    snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size());
-    output->append(buf);
+    // 204 and 304 have no body, and the Content-Length of a 304 would be
+    // the size of the file, not 0
     output->append("Connection: Keep-Alive\r\n");
   }
-
-  for (std::map<string, string>::const_iterator it = headers_.begin();
-       it != headers_.end();
-       ++it)
+  else
   {
-    output->append(it->first);
-    output->append(": ");
-    output->append(it->second);
-    output->append("\r\n");
+    output->append("Content-Length: ");
+    char digits[24];
+    char* end = digits + sizeof digits;
+    char* begin = formatDecimal(end, bodyLength());
+    output->append(begin, end - begin);
+    output->append("\r\nConnection: Keep-Alive\r\n");
   }
 
-  output->append("\r\n");
-  output->append(body_);
+  if (chunked_)
+  {
+    output->append("Transfer-Encoding: chunked\r\n");
+  }
+  output->append(headers_);
+  output->append("\r\n", 2);
 }
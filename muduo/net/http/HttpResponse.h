@@ -12,9 +12,10 @@
 #define MUDUO_NET_HTTP_HTTPRESPONSE_H
 
 #include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 
-#include <map>
+#include <boost/shared_ptr.hpp>
 
 namespace muduo
 {
@@ -22,7 +23,16 @@ namespace net
 {
 
 class Buffer;
+class HttpFile;
 
+typedef boost::shared_ptr<const HttpFile> HttpFilePtr;
+
+/// Response built by an HttpCallback.
+///
+/// Header lines are rendered as they are added, in order, without
+/// de-duplication. HttpServer reuses one response per connection via
+/// reset(), so a keep-alive connection stops allocating after its first
+/// response, and appendToBuffer() writes with one reserve and no snprintf.
 class HttpResponse : public muduo::copyable
 {
  public:
@@ -30,22 +40,42 @@ class HttpResponse : public muduo::copyable
   {
     kUnknown,
     k200Ok = 200,
+    k204NoContent = 204,
+    k206PartialContent = 206,
     k301MovedPermanently = 301,
+    k302Found = 302,
+    k304NotModified = 304,
     k400BadRequest = 400,
+    k403Forbidden = 403,
     k404NotFound = 404,
+    k405MethodNotAllowed = 405,
+    k413PayloadTooLarge = 413,
+    k416RangeNotSatisfiable = 416,
+    k500InternalServerError = 500,
+    k503ServiceUnavailable = 503,
   };
 
   explicit HttpResponse(bool close)
     : statusCode_(kUnknown),
-      closeConnection_(close)
+      closeConnection_(close),
+      chunked_(false),
+      fileOffset_(0),
+      fileLength_(0)
   {
   }
 
+  /// Clears everything but keeps the capacity.
+  void reset(bool close);
+
   void setStatusCode(HttpStatusCode code)
   { statusCode_ = code; }
 
-  void setStatusMessage(const string& message)
-  { statusMessage_ = message; }
+  HttpStatusCode statusCode() const
+  { return statusCode_; }
+
+  /// Optional for the codes above, their standard reason phrase is used.
+  void setStatusMessage(const StringPiece& message)
+  { statusMessage_.assign(message.data(), message.size()); }
 
   void setCloseConnection(bool on)
   { closeConnection_ = on; }
@@ -53,25 +83,103 @@ class HttpResponse : public muduo::copyable
   bool closeConnection() const
   { return closeConnection_; }
 
-  void setContentType(const string& contentType)
+  /// The body follows the headers in chunks, see AsyncHttpResponse::startStream().
+  /// Sends "Transfer-Encoding: chunked" instead of Content-Length.
+  void setChunked(bool on)
+  { chunked_ = on; }
+
+  bool chunked() const
+  { return chunked_; }
+
+  void setContentType(const StringPiece& contentType)
   { addHeader("Content-Type", contentType); }
 
-  // FIXME: replace string with StringPiece
-  void addHeader(const string& key, const string& value)
-  { headers_[key] = value; }
+  /// Sets the header key, replacing an earlier value of it,
+  /// case-insensitive. Headers are sent in the order first added.
+  void addHeader(const StringPiece& key, const StringPiece& value);
+
+  /// Value of the header named field, case-insensitive.
+  /// Empty if there is none.
+  StringPiece header(const StringPiece& field) const;
 
-  void setBody(const string& body)
-  { body_ = body; }
+  /// Copies body.
+  void setBody(const StringPiece& body)
+  {
+    body_.assign(body.data(), body.size());
+    bodyRef_.clear();
+    sharedBody_.reset();
+    file_.reset();
+  }
 
-  void appendToBuffer(Buffer* output) const;
+  /// Refers to body, which must stay valid until the response is written,
+  /// eg. a literal or data owned by the server.
+  void setBodyRef(const StringPiece& body)
+  {
+    body_.clear();
+    bodyRef_ = body.data() ? body : StringPiece("");
+    sharedBody_.reset();
+    file_.reset();
+  }
+
+  /// Shares body, eg. a cached document, without copying it.
+  void setBody(const boost::shared_ptr<const string>& body)
+  {
+    body_.clear();
+    sharedBody_ = body;
+    bodyRef_ = *body;
+    file_.reset();
+  }
+
+  /// Sends length bytes of file from offset. HttpServer writes them
+  /// with sendfile(2) when it can, otherwise they are read into the buffer.
+  void setBodyFile(const HttpFilePtr& file, int64_t offset, size_t length)
+  {
+    body_.clear();
+    bodyRef_.clear();
+    sharedBody_.reset();
+    file_ = file;
+    fileOffset_ = offset;
+    fileLength_ = length;
+  }
+
+  /// Empty if the body is a file.
+  StringPiece body() const
+  { return bodyRef_.data() ? bodyRef_ : StringPiece(body_); }
+
+  const HttpFilePtr& bodyFile() const
+  { return file_; }
+
+  int64_t bodyFileOffset() const
+  { return fileOffset_; }
+
+  size_t bodyLength() const
+  { return file_ ? fileLength_ : body().size(); }
+
+  /// Returns false if a file body could not be read in full. output then
+  /// ends with the part read, close the connection after it, so that the
+  /// client sees a truncated body.
+  bool appendToBuffer(Buffer* output) const;
+
+  /// Everything but the body, Content-Length still counts it.
+  void appendHeadersToBuffer(Buffer* output) const;
 
  private:
-  std::map<string, string> headers_;
+  // offset of the value of field in headers_, sets *valueEnd;
+  // string::npos if there is none
+  size_t findHeader(const StringPiece& field, size_t* valueEnd) const;
+
   HttpStatusCode statusCode_;
   // FIXME: add http version
   string statusMessage_;
   bool closeConnection_;
+  bool chunked_;
+  string headers_;                           // rendered "Field: value\r\n" lines
   string body_;
+  StringPiece bodyRef_;                      // external body if data() != NULL
+  boost::shared_ptr<const string> sharedBody_;
+  HttpFilePtr file_;
+  int64_t fileOffset_;
+  size_t fileLength_;
 };
 
 }
@@ -9,13 +9,24 @@
 
 #include <muduo/net/http/HttpServer.h>
 
+#include <muduo/base/CountDownLatch.h>
 #include <muduo/base/Logging.h>
+#include <muduo/base/ThreadPool.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/http/HttpCompressor.h>
 #include <muduo/net/http/HttpContext.h>
+#include <muduo/net/http/HttpFileCache.h>
 #include <muduo/net/http/HttpRequest.h>
 #include <muduo/net/http/HttpResponse.h>
 
 #include <boost/bind.hpp>
 
+#include <algorithm>
+#include <assert.h>
+#include <stdio.h>
+#include <strings.h>
+#include <time.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -26,6 +37,93 @@ namespace net
 namespace detail
 {
 
+const size_t kMaxRetainedOutput = 64 * 1024;
+// smaller file bodies are copied into the output, one write with the
+// headers is cheaper than a sendfile and is not held back by Nagle
+const size_t kMinSendfileBody = 32 * 1024;
+
+// "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n" of this IO thread
+__thread char t_dateLine[64];
+__thread int t_dateLineLength;
+
+void updateDateLine()
+{
+  static const char kDays[7][4] = {
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+  static const char kMonths[12][4] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+  time_t now = ::time(NULL);
+  struct tm tm;
+  ::gmtime_r(&now, &tm);
+  t_dateLineLength = snprintf(t_dateLine, sizeof t_dateLine,
+                              "Date: %s, %02d %s %4d %02d:%02d:%02d GMT\r\n",
+                              kDays[tm.tm_wday], tm.tm_mday, kMonths[tm.tm_mon],
+                              tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+StringPiece dateLine()
+{
+  if (t_dateLineLength == 0)
+  {
+    updateDateLine();
+  }
+  return StringPiece(t_dateLine, t_dateLineLength);
+}
+
+void addDateHeader(HttpResponse* response)
+{
+  StringPiece date = dateLine();
+  // "Date: " and CRLF are added back by addHeader()
+  response->addHeader("Date", StringPiece(date.data() + 6, date.size() - 8));
+}
+
+// the body is left to HttpServer::sendFile()
+bool sendsFile(const HttpRequest& req, const HttpResponse& response)
+{
+  return response.bodyFile()
+      && response.bodyLength() >= kMinSendfileBody
+      && req.method() != HttpRequest::kHead;
+}
+
+bool isHeadOrGet(HttpRequest::Method method)
+{
+  return method == HttpRequest::kGet || method == HttpRequest::kHead;
+}
+
+// a comma-separated header value has token, case-insensitively
+bool hasToken(const StringPiece& value, const char* token)
+{
+  const size_t len = strlen(token);
+  const char* p = value.data();
+  const char* end = value.data() + value.size();
+  while (p < end)
+  {
+    const char* comma = std::find(p, end, ',');
+    while (p < comma && (*p == ' ' || *p == '\t'))
+      ++p;
+    const char* last = comma;
+    while (last > p && (last[-1] == ' ' || last[-1] == '\t'))
+      --last;
+    if (static_cast<size_t>(last - p) == len && ::strncasecmp(p, token, len) == 0)
+    {
+      return true;
+    }
+    p = comma + 1;
+  }
+  return false;
+}
+
+// queued in loop after any runInServer() already there
+void stopInLoop(EventLoop* loop, const std::vector<TimerId>& timers, CountDownLatch* latch)
+{
+  for (size_t i = 0; i < timers.size(); ++i)
+  {
+    loop->cancel(timers[i]);
+  }
+  latch->countDown();
+}
+
 void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
 {
   resp->setStatusCode(HttpResponse::k404NotFound);
@@ -37,11 +135,18 @@ void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
 }
 }
 
+const size_t HttpServer::kMaxPipelined;
+
 HttpServer::HttpServer(EventLoop* loop,
                        const InetAddress& listenAddr,
                        const string& name,
                        TcpServer::Option option)
   : server_(loop, listenAddr, name, option),
+    ref_(new detail::HttpServerRef(this)),
+    maxBodySize_(HttpContext::kDefaultMaxBodySize),
+    dateHeader_(true),
+    webSocketPingInterval_(30.0),
+    numWorkers_(0),
     httpCallback_(detail::defaultHttpCallback)
 {
   server_.setConnectionCallback(
@@ -52,20 +157,127 @@ HttpServer::HttpServer(EventLoop* loop,
 
 HttpServer::~HttpServer()
 {
+  {
+    // responses done from now on are dropped
+    MutexLockGuard lock(ref_->mutex);
+    ref_->server = NULL;
+  }
+  // The IO threads run until server_ is destroyed, after webSockets_.
+  // Pass a barrier through each of them, cancelling its timers, and wait:
+  // a runInServer() which saw this HttpServer before has returned then,
+  // and no tick reaches it from now on.
+  IoLoopMap loops;
+  {
+    MutexLockGuard lock(mutex_);
+    loops.swap(ioLoops_);
+  }
+  CountDownLatch latch(static_cast<int>(loops.size()));
+  for (IoLoopMap::iterator it = loops.begin(); it != loops.end(); ++it)
+  {
+    it->first->runInLoop(boost::bind(&detail::stopInLoop, it->first, it->second, &latch));
+  }
+  latch.wait();
+}
+
+HttpServer::RenderedResponse HttpServer::render(const HttpResponse& response,
+                                                bool close)
+{
+  HttpResponse copy(response);
+  copy.setCloseConnection(response.closeConnection() || close);
+  Buffer buf;
+  bool complete = copy.appendToBuffer(&buf);
+
+  const char kCRLFCRLF[] = "\r\n\r\n";
+  const char* end = buf.peek() + buf.readableBytes();
+  const char* headerEnd = std::search(buf.peek(), end, kCRLFCRLF, kCRLFCRLF + 4);
+  assert(headerEnd != end);
+  RenderedResponse rendered;
+  rendered.close = copy.closeConnection() || !complete;
+  rendered.statusLineLength = buf.findCRLF() + 2 - buf.peek();
+  rendered.headerLength = headerEnd + 4 - buf.peek();
+  rendered.data.reset(new string(buf.retrieveAllAsString()));
+  return rendered;
+}
+
+void HttpServer::addStaticResponse(const string& path, const HttpResponse& response)
+{
+  StaticResponse& r = staticResponses_[path];
+  r.keepAlive = render(response, false);
+  r.close = render(response, true);
+}
+
+void HttpServer::addStaticDirectory(const string& urlPrefix,
+                                    const string& dir,
+                                    size_t maxOpenFiles)
+{
+  string prefix(urlPrefix);
+  if (!prefix.empty() && prefix[prefix.size() - 1] == '/')
+  {
+    prefix.resize(prefix.size() - 1);
+  }
+  boost::shared_ptr<HttpFileCache> files(new HttpFileCache(dir, maxOpenFiles));
+  staticDirectories_.push_back(std::make_pair(prefix, files));
+}
+
+void HttpServer::setWorkerThreads(int numThreads, size_t maxQueueSize)
+{
+  workers_.reset(new ThreadPool(server_.name() + "Worker"));
+  workers_->setMaxQueueSize(static_cast<int>(maxQueueSize));
+  numWorkers_ = numThreads;
 }
 
 void HttpServer::start()
 {
   LOG_WARN << "HttpServer[" << server_.name()
     << "] starts listenning on " << server_.ipPort();
+  if (workers_)
+  {
+    workers_->start(numWorkers_);
+  }
+  server_.setThreadInitCallback(
+      boost::bind(&HttpServer::onThreadInit, this, _1));
   server_.start();
 }
 
+void HttpServer::onThreadInit(EventLoop* loop)
+{
+  MutexLockGuard lock(mutex_);
+  std::vector<TimerId>& timers = ioLoops_[loop];
+  if (dateHeader_)
+  {
+    detail::updateDateLine();
+    timers.push_back(loop->runEvery(1.0, detail::updateDateLine));
+  }
+  if (webSocketMessageCallback_ && webSocketPingInterval_ > 0)
+  {
+    timers.push_back(loop->runEvery(webSocketPingInterval_,
+                                    boost::bind(&HttpServer::onWebSocketTimer, this)));
+  }
+}
+
 void HttpServer::onConnection(const TcpConnectionPtr& conn)
 {
   if (conn->connected())
   {
-    conn->setContext(HttpContext());  // TcpConnectionһHttpContext
+    HttpContext context;
+    context.setMaxBodySize(maxBodySize_);
+    conn->setContext(context);  // TcpConnectionһHttpContext
+  }
+  else
+  {
+    HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+    if (context->stream())
+    {
+      context->stream()->abort();
+    }
+    if (const WebSocketConnectionPtr& webSocket = context->webSocket())
+    {
+      webSockets_.value().erase(get_pointer(webSocket));
+      if (webSocketCloseCallback_)
+      {
+        webSocketCloseCallback_(webSocket);
+      }
+    }
   }
 }
 
@@ -75,35 +287,524 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
 {
   //࣬Э
   HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
-
-  if (!context->parseRequest(buf, receiveTime))
+  if (context->webSocket())
   {
-    conn->send("HTTP/1.1 400 Bad Request\r\n\r\n");
-    conn->shutdown();
+    context->webSocket()->handleData(buf, receiveTime, webSocketMessageCallback_);
+    return;
   }
 
-  //
-  if (context->gotAll())
+  // Handles every complete request in buf, pipelined ones included, and
+  // sends all responses which are ready with one write.
+  Buffer& output = outputBuffer_.value();
+  assert(output.readableBytes() == 0);
+  bool upgraded = false;
+  while (!context->closing()
+         && !context->lastRequestSeen()
+         && context->inFlight() < kMaxPipelined)
   {
-    onRequest(conn, context->request());
+    if (!context->parseRequest(buf, receiveTime))
+    {
+      context->setLastRequestSeen();
+      context->complete(context->nextSequence(),
+                        context->notImplemented()
+                        ? "HTTP/1.1 501 Not Implemented\r\n\r\n"
+                        : "HTTP/1.1 400 Bad Request\r\n\r\n",
+                        true, &output);
+      break;
+    }
+
+    // not in the middle of earlier responses
+    if (context->takeExpectContinue()
+        && context->request().body().empty()
+        && !buf->readableBytes()
+        && context->inFlight() == 0)
+    {
+      output.append("HTTP/1.1 100 Continue\r\n\r\n");
+    }
+    if (!context->gotAll())
+    {
+      break;
+    }
+
+    //
+    HttpRequest& req = context->request();
+    StringPiece connection = req.header("Connection");
+    //жǳӻǶ
+    bool close = connection == "close" ||
+      (req.getVersion() == HttpRequest::kHttp10 && connection != "Keep-Alive");
+    if (close)
+    {
+      context->setLastRequestSeen();
+    }
+
+    if (webSocketMessageCallback_ && WebSocketConnection::isUpgradeRequest(req))
+    {
+      upgraded = upgrade(conn, context, &output);
+      break;
+    }
+
+    int64_t sequence = context->nextSequence();
+    if ((asyncHttpCallback_ || workers_) && !isStatic(req, close))
+    {
+      dispatch(conn, context, sequence, close);
+    }
+    else if (context->isNextResponse(sequence))
+    {
+      HttpResponse& response = context->response();
+      bool closeAfter = onRequest(req, close, &response, &output);
+      if (detail::sendsFile(req, response))
+      {
+        sendFile(conn, &output, response);
+      }
+      context->completeNext(closeAfter, &output);
+    }
+    else
+    {
+      // waits for an earlier async response
+      Buffer pending;
+      HttpResponse& response = context->response();
+      bool closeAfter = onRequest(req, close, &response, &pending);
+      if (detail::sendsFile(req, response))
+      {
+        // kept as bytes, read the file in
+        pending.retrieveAll();
+        if (!response.appendToBuffer(&pending))
+        {
+          closeAfter = true;
+        }
+      }
+      context->complete(sequence,
+                        StringPiece(pending.peek(), static_cast<int>(pending.readableBytes())),
+                        closeAfter, &output);
+    }
     context->reset();  // ϣHttpContextڳ
   }
+
+  flush(conn, context, &output);
+  if (upgraded)
+  {
+    WebSocketConnectionPtr webSocket(context->webSocket());
+    if (webSocketOpenCallback_)
+    {
+      webSocketOpenCallback_(webSocket);
+    }
+    // frames sent right after the handshake
+    if (buf->readableBytes() > 0)
+    {
+      webSocket->handleData(buf, receiveTime, webSocketMessageCallback_);
+    }
+  }
+  else if (!context->closing() && context->inFlight() >= kMaxPipelined)
+  {
+    conn->stopRead();  // resumed by onResponseDone()
+  }
 }
 
-void HttpServer::onRequest(const TcpConnectionPtr& conn, const HttpRequest& req)
+bool HttpServer::upgrade(const TcpConnectionPtr& conn,
+                         HttpContext* context,
+                         Buffer* output)
 {
-  const string& connection = req.getHeader("Connection");
-  //жǳӻǶ
-  bool close = connection == "close" ||
-    (req.getVersion() == HttpRequest::kHttp10 && connection != "Keep-Alive");
-  HttpResponse response(close);
-  httpCallback_(req, &response);		//صûĺ
-  Buffer buf;
-  response.appendToBuffer(&buf);
-  conn->send(&buf);
-  if (response.closeConnection())
+  const HttpRequest& req = context->request();
+  StringPiece key = req.header("Sec-WebSocket-Key");
+  const char* error = NULL;
+  if (context->inFlight() > 0
+      || req.getVersion() != HttpRequest::kHttp11
+      || key.empty()
+      || !detail::hasToken(req.header("Connection"), "upgrade"))
+  {
+    error = "HTTP/1.1 400 Bad Request\r\n\r\n";
+  }
+  else if (req.header("Sec-WebSocket-Version") != "13")
+  {
+    error = "HTTP/1.1 426 Upgrade Required\r\n"
+            "Sec-WebSocket-Version: 13\r\n"
+            "Content-Length: 0\r\n\r\n";
+  }
+  if (error)
+  {
+    context->setLastRequestSeen();
+    context->complete(context->nextSequence(), error, true, output);
+    return false;
+  }
+
+  output->append("HTTP/1.1 101 Switching Protocols\r\n"
+                 "Upgrade: websocket\r\n"
+                 "Connection: Upgrade\r\n"
+                 "Sec-WebSocket-Accept: ");
+  output->append(WebSocketConnection::acceptKey(key));
+  output->append("\r\n\r\n");
+
+  WebSocketConnectionPtr webSocket(new WebSocketConnection(conn, req, maxBodySize_));
+  context->setWebSocket(webSocket);
+  context->reset();
+  webSockets_.value().insert(get_pointer(webSocket));
+  return true;
+}
+
+void HttpServer::onWebSocketTimer()
+{
+  WebSocketSet& webSockets = webSockets_.value();
+  if (webSockets.empty())
+  {
+    return;
+  }
+  // one frame for all, like a broadcast
+  WebSocketConnection::Frame ping(
+      WebSocketConnection::makeFrame(WebSocketConnection::kPing, StringPiece()));
+  Timestamp now(Timestamp::now());
+  for (WebSocketSet::iterator it = webSockets.begin(); it != webSockets.end(); ++it)
+  {
+    WebSocketConnection* webSocket = *it;
+    double idle = timeDifference(now, webSocket->lastReceiveTime_);
+    if (idle >= 2 * webSocketPingInterval_)
+    {
+      TcpConnectionPtr conn(webSocket->connection());
+      if (conn)
+      {
+        LOG_WARN << "HttpServer::onWebSocketTimer closes " << conn->name()
+                 << ", silent for " << idle << " seconds";
+        conn->forceClose();
+      }
+    }
+    else if (idle >= webSocketPingInterval_)
+    {
+      webSocket->sendInLoop(ping);
+    }
+  }
+}
+
+void HttpServer::flush(const TcpConnectionPtr& conn,
+                       HttpContext* context,
+                       Buffer* output)
+{
+  if (output->readableBytes() > 0)
+  {
+    conn->send(output);
+    output->retrieveAll();
+  }
+  if (output->internalCapacity() > detail::kMaxRetainedOutput)
+  {
+    output->shrink(0);
+  }
+  // its headers are in what was just sent
+  if (context->stream() && !context->stream()->active_)
+  {
+    activateStream(conn, context->stream());
+  }
+  if (context->closing()
+      || (context->lastRequestSeen() && context->inFlight() == 0))
   {
     conn->shutdown();
   }
 }
 
+void HttpServer::sendFile(const TcpConnectionPtr& conn,
+                          Buffer* output,
+                          const HttpResponse& response)
+{
+  // the headers and earlier responses go first
+  conn->send(output);
+  output->retrieveAll();
+  const HttpFilePtr& file = response.bodyFile();
+  conn->sendFile(file, file->fd(), response.bodyFileOffset(), response.bodyLength());
+}
+
+void HttpServer::dispatch(const TcpConnectionPtr& conn,
+                          HttpContext* context,
+                          int64_t sequence,
+                          bool close)
+{
+  AsyncHttpResponsePtr handle(new AsyncHttpResponse(this, conn, sequence, close));
+  handle->request_.swap(context->request());
+  if (dateHeader_)
+  {
+    detail::addDateHeader(&handle->response_);
+  }
+
+  if (!workers_)
+  {
+    asyncHttpCallback_(handle);
+  }
+  else if (!workers_->tryRun(boost::bind(&HttpServer::runInWorker, this, handle)))
+  {
+    LOG_WARN << "HttpServer[" << server_.name() << "] workers busy, 503 for "
+             << handle->request().path();
+    HttpResponse* response = handle->response();
+    response->setStatusCode(HttpResponse::k503ServiceUnavailable);
+    response->addHeader("Retry-After", "1");
+    handle->done();
+  }
+}
+
+void HttpServer::runInWorker(const AsyncHttpResponsePtr& handle)
+{
+  if (asyncHttpCallback_)
+  {
+    asyncHttpCallback_(handle);
+  }
+  else
+  {
+    httpCallback_(handle->request(), handle->response());
+    handle->done();
+  }
+}
+
+void HttpServer::onResponseDone(const boost::weak_ptr<TcpConnection>& weakConn,
+                                int64_t sequence,
+                                const boost::shared_ptr<Buffer>& data,
+                                bool close)
+{
+  TcpConnectionPtr conn(weakConn.lock());
+  if (!conn || !conn->connected())
+  {
+    return;
+  }
+  conn->getLoop()->assertInLoopThread();
+  HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+  bool stopped = context->inFlight() >= kMaxPipelined;
+  Buffer& output = outputBuffer_.value();
+  context->complete(sequence,
+                    StringPiece(data->peek(), static_cast<int>(data->readableBytes())),
+                    close, &output);
+  flush(conn, context, &output);
+  resumeReading(conn, context, stopped);
+}
+
+void HttpServer::resumeReading(const TcpConnectionPtr& conn,
+                               HttpContext* context,
+                               bool stopped)
+{
+  if (stopped && !context->closing() && context->inFlight() < kMaxPipelined)
+  {
+    conn->startRead();
+    // requests which arrived before reading stopped
+    if (conn->inputBuffer()->readableBytes() > 0)
+    {
+      onMessage(conn, conn->inputBuffer(), Timestamp::now());
+    }
+  }
+}
+
+void HttpServer::onStreamStart(const AsyncHttpResponsePtr& stream,
+                               const boost::shared_ptr<Buffer>& headers)
+{
+  TcpConnectionPtr conn(stream->conn_.lock());
+  if (!conn || !conn->connected())
+  {
+    stream->abort();
+    return;
+  }
+  conn->getLoop()->assertInLoopThread();
+  HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+  Buffer& output = outputBuffer_.value();
+  if (!context->startStream(stream->sequence_,
+                            StringPiece(headers->peek(), static_cast<int>(headers->readableBytes())),
+                            stream, &output))
+  {
+    stream->abort();
+  }
+  flush(conn, context, &output);
+}
+
+void HttpServer::activateStream(const TcpConnectionPtr& conn,
+                                const AsyncHttpResponsePtr& stream)
+{
+  // only while streaming, other responses do not pay for the callbacks
+  conn->setWriteCompleteCallback(
+      boost::bind(&HttpServer::onWriteComplete, this, _1));
+  conn->setHighWaterMarkCallback(
+      boost::bind(&HttpServer::onHighWaterMark, this, _1, _2),
+      AsyncHttpResponse::kStreamHighWaterMark);
+  {
+    MutexLockGuard lock(stream->mutex_);
+    stream->active_ = true;
+  }
+  if (sendStream(conn, stream.get()))
+  {
+    // done() before its turn, finish outside of flush()
+    conn->getLoop()->queueInLoop(
+        boost::bind(&AsyncHttpResponse::runInServer, ref_,
+                    AsyncHttpResponse::ServerFunctor(
+                        boost::bind(&HttpServer::onStreamWrite, _1, stream))));
+  }
+  else if (stream->writableCallback_)
+  {
+    stream->writableCallback_(stream);
+  }
+}
+
+bool HttpServer::sendStream(const TcpConnectionPtr& conn, AsyncHttpResponse* stream)
+{
+  MutexLockGuard lock(stream->mutex_);
+  stream->sendQueued_ = false;
+  if (stream->pending_.readableBytes() > 0)
+  {
+    conn->send(&stream->pending_);
+    // the high water mark callback is queued, a producer looping on
+    // writable() in the IO thread has to see it now
+    if (conn->outputBuffer()->readableBytes() >= AsyncHttpResponse::kStreamHighWaterMark)
+    {
+      stream->congested_ = true;
+    }
+  }
+  return stream->finished_;
+}
+
+void HttpServer::onStreamWrite(const AsyncHttpResponsePtr& stream)
+{
+  TcpConnectionPtr conn(stream->conn_.lock());
+  if (!conn || !conn->connected())
+  {
+    stream->abort();
+    return;
+  }
+  conn->getLoop()->assertInLoopThread();
+  HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+  if (context->stream() != stream || !stream->active_)
+  {
+    return;  // not its turn, activateStream() sends it
+  }
+  if (sendStream(conn, stream.get()))
+  {
+    finishStream(conn, context);
+  }
+}
+
+void HttpServer::finishStream(const TcpConnectionPtr& conn, HttpContext* context)
+{
+  conn->setWriteCompleteCallback(WriteCompleteCallback());
+  conn->setHighWaterMarkCallback(HighWaterMarkCallback(),
+                                 AsyncHttpResponse::kStreamHighWaterMark);
+  bool stopped = context->inFlight() >= kMaxPipelined;
+  Buffer& output = outputBuffer_.value();
+  context->finishStream(context->stream()->response_.closeConnection(), &output);
+  flush(conn, context, &output);
+  resumeReading(conn, context, stopped);
+}
+
+void HttpServer::onWriteComplete(const TcpConnectionPtr& conn)
+{
+  HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+  AsyncHttpResponsePtr stream(context->stream());
+  if (!stream)
+  {
+    return;
+  }
+  {
+    MutexLockGuard lock(stream->mutex_);
+    stream->congested_ = false;
+    if (!stream->active_ || stream->finished_ || stream->aborted_)
+    {
+      return;
+    }
+  }
+  if (stream->writableCallback_)
+  {
+    stream->writableCallback_(stream);
+  }
+}
+
+void HttpServer::onHighWaterMark(const TcpConnectionPtr& conn, size_t)
+{
+  HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+  if (const AsyncHttpResponsePtr& stream = context->stream())
+  {
+    MutexLockGuard lock(stream->mutex_);
+    stream->congested_ = true;
+  }
+}
+
+const HttpServer::RenderedResponse*
+HttpServer::findStaticResponse(const HttpRequest& req, bool close) const
+{
+  if (!staticResponses_.empty() && detail::isHeadOrGet(req.method()))
+  {
+    StaticResponseMap::const_iterator it = staticResponses_.find(req.path());
+    if (it != staticResponses_.end())
+    {
+      return close ? &it->second.close : &it->second.keepAlive;
+    }
+  }
+  return NULL;
+}
+
+HttpFileCache* HttpServer::findStaticDirectory(const HttpRequest& req,
+                                               StringPiece* path) const
+{
+  if (!staticDirectories_.empty() && detail::isHeadOrGet(req.method()))
+  {
+    const string& reqPath = req.path();
+    for (size_t i = 0; i < staticDirectories_.size(); ++i)
+    {
+      const string& prefix = staticDirectories_[i].first;
+      if (reqPath.size() > prefix.size()
+          && reqPath[prefix.size()] == '/'
+          && reqPath.compare(0, prefix.size(), prefix) == 0)
+      {
+        *path = StringPiece(reqPath.data() + prefix.size(),
+                            static_cast<int>(reqPath.size() - prefix.size()));
+        return staticDirectories_[i].second.get();
+      }
+    }
+  }
+  return NULL;
+}
+
+bool HttpServer::isStatic(const HttpRequest& req, bool close) const
+{
+  StringPiece path;
+  return findStaticResponse(req, close) || findStaticDirectory(req, &path);
+}
+
+bool HttpServer::onRequest(const HttpRequest& req,
+                           bool close,
+                           HttpResponse* response,
+                           Buffer* output)
+{
+  if (const RenderedResponse* r = findStaticResponse(req, close))
+  {
+    const string& data = *r->data;
+    size_t length = req.method() == HttpRequest::kHead ? r->headerLength : data.size();
+    if (dateHeader_)
+    {
+      output->append(data.data(), r->statusLineLength);
+      output->append(detail::dateLine());
+      output->append(data.data() + r->statusLineLength, length - r->statusLineLength);
+    }
+    else
+    {
+      output->append(data.data(), length);
+    }
+    return r->close;
+  }
+
+  response->reset(close);
+  if (dateHeader_)
+  {
+    detail::addDateHeader(response);
+  }
+  StringPiece path;
+  if (HttpFileCache* files = findStaticDirectory(req, &path))
+  {
+    files->respond(req, path, response);
+  }
+  else
+  {
+    httpCallback_(req, response);		//صûĺ
+    if (compressor_)
+    {
+      compressor_->compress(req, response);
+    }
+  }
+  if (req.method() == HttpRequest::kHead || detail::sendsFile(req, *response))
+  {
+    response->appendHeadersToBuffer(output);
+  }
+  else if (!response->appendToBuffer(output))
+  {
+    // the body is cut short, closing tells the client
+    return true;
+  }
+  return response->closeConnection();
+}
+
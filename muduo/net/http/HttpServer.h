@@ -11,16 +11,48 @@
 #ifndef MUDUO_NET_HTTP_HTTPSERVER_H
 #define MUDUO_NET_HTTP_HTTPSERVER_H
 
+#include <muduo/base/Mutex.h>
+#include <muduo/base/ThreadLocal.h>
 #include <muduo/net/TcpServer.h>
+#include <muduo/net/TimerId.h>
+#include <muduo/net/http/AsyncHttpResponse.h>
+#include <muduo/net/http/WebSocket.h>
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <map>
+#include <set>
+#include <vector>
 
 namespace muduo
 {
+class ThreadPool;
+
 namespace net
 {
 
+class HttpCompressor;
+class HttpContext;
+class HttpFileCache;
 class HttpRequest;
 class HttpResponse;
+class HttpServer;
+
+namespace detail
+{
+// what an AsyncHttpResponse holds of its server, which may go first
+struct HttpServerRef : boost::noncopyable
+{
+  explicit HttpServerRef(HttpServer* s)
+    : server(s)
+  {
+  }
+
+  MutexLock mutex;
+  HttpServer* server;  // NULL once destroyed, guarded by mutex
+};
+}
 
 /// A simple embeddable HTTP server designed for report status of a program.
 /// It is not a fully HTTP 1.1 compliant server, but provides minimum features
@@ -36,12 +68,19 @@ class HttpServer : boost::noncopyable
  public:
   typedef boost::function<void (const HttpRequest&,
                                 HttpResponse*)> HttpCallback;
+  typedef boost::function<void (const AsyncHttpResponsePtr&)> AsyncHttpCallback;
+
+  /// Pipelined requests of one connection that may wait for their
+  /// responses, reading stops beyond that.
+  static const size_t kMaxPipelined = 16;
 
   HttpServer(EventLoop* loop,
              const InetAddress& listenAddr,
              const string& name,
              TcpServer::Option option = TcpServer::kNoReusePort);
 
+  /// Waits for each IO loop to finish what it runs for this server and
+  /// cancel its timers, destroy in the thread of loop, or while it runs.
   ~HttpServer();  // force out-line dtor, for scoped_ptr members.
 
   EventLoop* getLoop() const { return server_.getLoop(); }
@@ -52,21 +91,168 @@ class HttpServer : boost::noncopyable
     httpCallback_ = cb;
   }
 
+  /// Replaces the HttpCallback, the handler calls done() on the
+  /// AsyncHttpResponse when the response is ready, from any thread.
+  /// Not thread safe, callback be registered before calling start().
+  void setAsyncHttpCallback(const AsyncHttpCallback& cb)
+  {
+    asyncHttpCallback_ = cb;
+  }
+
   void setThreadNum(int numThreads)
   {
     server_.setThreadNum(numThreads);
   }
 
+  /// Compresses the bodies of callback responses when the client accepts
+  /// gzip or deflate, see HttpCompressor. May be shared by servers.
+  /// Not thread safe, call before start().
+  void setCompressor(const boost::shared_ptr<HttpCompressor>& compressor)
+  {
+    compressor_ = compressor;
+  }
+
+  /// Runs the callback in a pool of numThreads instead of the IO thread.
+  /// When maxQueueSize requests are waiting for a worker, new ones are
+  /// answered with 503 right away.
+  /// Not thread safe, call before start().
+  void setWorkerThreads(int numThreads, size_t maxQueueSize);
+
+  /// Requests with a larger body are answered with 400 and closed.
+  /// Not thread safe, call before start().
+  void setMaxBodySize(size_t size)
+  {
+    maxBodySize_ = size;
+  }
+
+  /// Adds a "Date" header to every response, on by default.
+  /// Each IO thread formats it once per second with a timer.
+  /// Not thread safe, call before start().
+  void setDateHeader(bool on)
+  {
+    dateHeader_ = on;
+  }
+
+  /// Answers GET and HEAD of path with response without calling the
+  /// HttpCallback, eg. health checks, known 404s and small static files.
+  /// The response is rendered once, here, and sent from a shared buffer.
+  /// Not thread safe, call before start().
+  void addStaticResponse(const string& path, const HttpResponse& response);
+
+  /// Answers GET and HEAD of paths under urlPrefix with files under dir,
+  /// eg. ("/static/", "/var/www"), keeping up to maxOpenFiles open.
+  /// Bodies are sent with sendfile(2); Range and If-Modified-Since are
+  /// supported. Served in the IO thread, like static responses; a file
+  /// not cached yet is opened there too, see HttpFileCache.
+  /// Not thread safe, call before start().
+  void addStaticDirectory(const string& urlPrefix,
+                          const string& dir,
+                          size_t maxOpenFiles = 1024);
+
+  /// Upgrades GET requests with "Upgrade: websocket" to WebSocket,
+  /// RFC 6455, other requests still go to the HttpCallback.
+  /// onOpen is called after the handshake, onMessage for every message,
+  /// up to setMaxBodySize() bytes, and onClose when the connection is
+  /// gone, all in the IO thread. onOpen and onClose may be empty.
+  /// Not thread safe, call before start().
+  void setWebSocketCallbacks(const WebSocketCallback& onOpen,
+                             const WebSocketMessageCallback& onMessage,
+                             const WebSocketCallback& onClose)
+  {
+    webSocketOpenCallback_ = onOpen;
+    webSocketMessageCallback_ = onMessage;
+    webSocketCloseCallback_ = onClose;
+  }
+
+  /// WebSocket connections which sent nothing for seconds are pinged,
+  /// those silent for twice as long are closed. 30 by default, 0 never.
+  /// Each IO thread checks its connections with one timer.
+  /// Not thread safe, call before start().
+  void setWebSocketPingInterval(double seconds)
+  {
+    webSocketPingInterval_ = seconds;
+  }
+
   void start();
 
  private:
+  struct RenderedResponse
+  {
+    boost::shared_ptr<const string> data;
+    size_t statusLineLength;  // the Date header goes after it
+    size_t headerLength;      // all that is sent for HEAD
+    bool close;
+  };
+
+  struct StaticResponse
+  {
+    RenderedResponse keepAlive;
+    RenderedResponse close;
+  };
+
+  typedef std::map<string, StaticResponse> StaticResponseMap;
+  typedef std::vector<std::pair<string, boost::shared_ptr<HttpFileCache> > >
+      StaticDirectoryList;
+  typedef std::set<WebSocketConnection*> WebSocketSet;
+
+  static RenderedResponse render(const HttpResponse& response, bool close);
+
+  friend class AsyncHttpResponse;
+
+  void onThreadInit(EventLoop* loop);
   void onConnection(const TcpConnectionPtr& conn);
   void onMessage(const TcpConnectionPtr& conn,
                  Buffer* buf,
                  Timestamp receiveTime);
-  void onRequest(const TcpConnectionPtr&, const HttpRequest&);
+  const RenderedResponse* findStaticResponse(const HttpRequest& req, bool close) const;
+  // returns the cache and sets *path relative to its directory
+  HttpFileCache* findStaticDirectory(const HttpRequest& req, StringPiece* path) const;
+  bool isStatic(const HttpRequest& req, bool close) const;
+  void sendFile(const TcpConnectionPtr& conn, Buffer* output, const HttpResponse& response);
+  // appends the response to output, returns true if conn should be closed
+  bool onRequest(const HttpRequest&, bool close, HttpResponse*, Buffer* output);
+  void dispatch(const TcpConnectionPtr& conn, HttpContext* context,
+                int64_t sequence, bool close);
+  void runInWorker(const AsyncHttpResponsePtr& handle);
+  void onResponseDone(const boost::weak_ptr<TcpConnection>& weakConn,
+                      int64_t sequence,
+                      const boost::shared_ptr<Buffer>& data,
+                      bool close);
+  void onStreamStart(const AsyncHttpResponsePtr& stream,
+                     const boost::shared_ptr<Buffer>& headers);
+  void onStreamWrite(const AsyncHttpResponsePtr& stream);
+  void onWriteComplete(const TcpConnectionPtr& conn);
+  void onHighWaterMark(const TcpConnectionPtr& conn, size_t bytes);
+  void activateStream(const TcpConnectionPtr& conn, const AsyncHttpResponsePtr& stream);
+  // hands the written data of stream to conn, returns true if it is done
+  bool sendStream(const TcpConnectionPtr& conn, AsyncHttpResponse* stream);
+  void finishStream(const TcpConnectionPtr& conn, HttpContext* context);
+  void flush(const TcpConnectionPtr& conn, HttpContext* context, Buffer* output);
+  // after a response is sent, reads the requests held back by kMaxPipelined
+  void resumeReading(const TcpConnectionPtr& conn, HttpContext* context, bool stopped);
+  // answers the handshake in context->request(), returns true if upgraded
+  bool upgrade(const TcpConnectionPtr& conn, HttpContext* context, Buffer* output);
+  void onWebSocketTimer();
 
   TcpServer server_;
+  boost::shared_ptr<detail::HttpServerRef> ref_;
+  size_t maxBodySize_;
+  bool dateHeader_;
+  StaticResponseMap staticResponses_;
+  StaticDirectoryList staticDirectories_;
+  MutexLock mutex_;
+  typedef std::map<EventLoop*, std::vector<TimerId> > IoLoopMap;
+  IoLoopMap ioLoops_;  // with their timers, guarded by mutex_
+  ThreadLocal<Buffer> outputBuffer_;  // responses of one onMessage, per IO thread
+  ThreadLocal<WebSocketSet> webSockets_;  // upgraded connections, per IO thread
+  double webSocketPingInterval_;
+  WebSocketCallback webSocketOpenCallback_;
+  WebSocketMessageCallback webSocketMessageCallback_;
+  WebSocketCallback webSocketCloseCallback_;
+  boost::shared_ptr<HttpCompressor> compressor_;
+  boost::scoped_ptr<ThreadPool> workers_;
+  int numWorkers_;
+  AsyncHttpCallback asyncHttpCallback_;
   HttpCallback httpCallback_;  // ڴhttp󣨼onRequestĹлص˺оĴ
 };
 
@@ -0,0 +1,308 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/http/WebSocket.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/http/WebSocketContext.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+uint32_t rotateLeft(uint32_t x, int n)
+{
+  return (x << n) | (x >> (32 - n));
+}
+
+// SHA-1, FIPS 180-4, only for the 60 bytes of a handshake
+void sha1(const string& data, unsigned char digest[20])
+{
+  string msg(data);
+  const uint64_t bits = static_cast<uint64_t>(data.size()) * 8;
+  msg += '\x80';
+  while (msg.size() % 64 != 56)
+  {
+    msg += '\0';
+  }
+  for (int i = 7; i >= 0; --i)
+  {
+    msg += static_cast<char>(bits >> (i * 8));
+  }
+
+  uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(msg.data());
+  for (size_t chunk = 0; chunk < msg.size(); chunk += 64, p += 64)
+  {
+    uint32_t w[80];
+    for (int i = 0; i < 16; ++i)
+    {
+      w[i] = (p[i * 4] << 24) | (p[i * 4 + 1] << 16) | (p[i * 4 + 2] << 8) | p[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; ++i)
+    {
+      w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; ++i)
+    {
+      uint32_t f, k;
+      if (i < 20)
+      {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      }
+      else if (i < 40)
+      {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      }
+      else if (i < 60)
+      {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      }
+      else
+      {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t t = rotateLeft(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rotateLeft(b, 30);
+      b = a;
+      a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+  for (int i = 0; i < 20; ++i)
+  {
+    digest[i] = static_cast<unsigned char>(h[i / 4] >> (24 - (i % 4) * 8));
+  }
+}
+
+string base64(const unsigned char* data, size_t len)
+{
+  static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  string result;
+  result.reserve((len + 2) / 3 * 4);
+  for (size_t i = 0; i < len; i += 3)
+  {
+    uint32_t n = data[i] << 16;
+    if (i + 1 < len)
+      n |= data[i + 1] << 8;
+    if (i + 2 < len)
+      n |= data[i + 2];
+    result += kAlphabet[(n >> 18) & 63];
+    result += kAlphabet[(n >> 12) & 63];
+    result += i + 1 < len ? kAlphabet[(n >> 6) & 63] : '=';
+    result += i + 2 < len ? kAlphabet[n & 63] : '=';
+  }
+  return result;
+}
+
+// frame header of a server, unmasked, returns its length
+size_t encodeHeader(WebSocketConnection::Opcode opcode, size_t length, char header[10])
+{
+  header[0] = static_cast<char>(0x80 | opcode);
+  if (length < 126)
+  {
+    header[1] = static_cast<char>(length);
+    return 2;
+  }
+  else if (length <= 0xFFFF)
+  {
+    header[1] = 126;
+    header[2] = static_cast<char>(length >> 8);
+    header[3] = static_cast<char>(length);
+    return 4;
+  }
+  header[1] = 127;
+  for (int i = 0; i < 8; ++i)
+  {
+    header[2 + i] = static_cast<char>(static_cast<uint64_t>(length) >> (56 - i * 8));
+  }
+  return 10;
+}
+
+}
+
+WebSocketConnection::Frame WebSocketConnection::makeFrame(Opcode opcode,
+                                                          const StringPiece& payload)
+{
+  char header[10];
+  size_t headerLength = encodeHeader(opcode, payload.size(), header);
+  string* frame = new string;
+  frame->reserve(headerLength + payload.size());
+  frame->append(header, headerLength);
+  frame->append(payload.data(), payload.size());
+  return Frame(frame);
+}
+
+void WebSocketConnection::appendFrame(Opcode opcode,
+                                      const StringPiece& payload,
+                                      Buffer* output)
+{
+  char header[10];
+  size_t headerLength = encodeHeader(opcode, payload.size(), header);
+  output->ensureWritableBytes(headerLength + payload.size());
+  output->append(header, headerLength);
+  output->append(payload);
+}
+
+bool WebSocketConnection::isUpgradeRequest(const HttpRequest& request)
+{
+  StringPiece upgrade = request.header("Upgrade");
+  return request.method() == HttpRequest::kGet
+      && upgrade.size() == 9
+      && ::strncasecmp(upgrade.data(), "websocket", 9) == 0;
+}
+
+string WebSocketConnection::acceptKey(const StringPiece& key)
+{
+  unsigned char digest[20];
+  sha1(key.as_string() + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+  return base64(digest, sizeof digest);
+}
+
+WebSocketConnection::WebSocketConnection(const TcpConnectionPtr& conn,
+                                         const HttpRequest& request,
+                                         size_t maxMessageSize)
+  : loop_(conn->getLoop()),
+    conn_(conn),
+    request_(request),
+    parser_(new WebSocketContext(maxMessageSize)),
+    lastReceiveTime_(Timestamp::now())
+{
+}
+
+WebSocketConnection::~WebSocketConnection()
+{
+}
+
+bool WebSocketConnection::connected()
+{
+  TcpConnectionPtr conn(conn_.lock());
+  return conn && conn->connected() && closeSent_.get() == 0;
+}
+
+void WebSocketConnection::sendMessage(Opcode opcode, const StringPiece& data)
+{
+  TcpConnectionPtr conn(conn_.lock());
+  if (conn && closeSent_.get() == 0)
+  {
+    Buffer buf;
+    appendFrame(opcode, data, &buf);
+    conn->send(&buf);
+  }
+}
+
+void WebSocketConnection::send(const Frame& frame)
+{
+  if (loop_->isInLoopThread())
+  {
+    sendInLoop(frame);
+  }
+  else if (closeSent_.get() == 0)
+  {
+    loop_->queueInLoop(boost::bind(&WebSocketConnection::sendInLoop,
+                                   shared_from_this(), frame));
+  }
+}
+
+void WebSocketConnection::sendInLoop(const Frame& frame)
+{
+  TcpConnectionPtr conn(conn_.lock());
+  if (conn && closeSent_.get() == 0)
+  {
+    conn->send(StringPiece(*frame));
+  }
+}
+
+void WebSocketConnection::close(CloseCode code, const StringPiece& reason)
+{
+  sendClose(static_cast<uint16_t>(code), reason);
+}
+
+void WebSocketConnection::sendClose(uint16_t code, const StringPiece& reason)
+{
+  TcpConnectionPtr conn(conn_.lock());
+  if (closeSent_.getAndSet(1) == 0 && conn)
+  {
+    // a control frame carries 125 bytes at most
+    char payload[125];
+    payload[0] = static_cast<char>(code >> 8);
+    payload[1] = static_cast<char>(code);
+    size_t reasonLength = std::min(reason.size(), static_cast<int>(sizeof payload - 2));
+    memcpy(payload + 2, reason.data(), reasonLength);
+    Buffer buf;
+    appendFrame(kClose, StringPiece(payload, static_cast<int>(reasonLength + 2)), &buf);
+    conn->send(&buf);
+    conn->shutdown();
+  }
+}
+
+void WebSocketConnection::handleData(Buffer* buf,
+                                     Timestamp receiveTime,
+                                     const WebSocketMessageCallback& cb)
+{
+  lastReceiveTime_ = receiveTime;
+  WebSocketContext::Result result;
+  while ((result = parser_->parse(buf)) != WebSocketContext::kNeedMore)
+  {
+    if (result == WebSocketContext::kMessage)
+    {
+      if (closeSent_.get() == 0)
+      {
+        cb(shared_from_this(), parser_->message(), parser_->binary());
+      }
+      parser_->clearMessage();
+    }
+    else if (result == WebSocketContext::kPing)
+    {
+      sendMessage(kPong, parser_->control());
+    }
+    else if (result == WebSocketContext::kClose)
+    {
+      // echoes the code, unless there is none or it may not be sent
+      uint16_t code = parser_->closeCode();
+      if (code == WebSocketContext::kNoStatusCode)
+      {
+        code = kNormalClosure;
+      }
+      else if (code < 1000 || code >= 5000 || (code >= 1004 && code <= 1006)
+               || (code >= 1015 && code < 3000))
+      {
+        code = kProtocolError;
+      }
+      sendClose(code, StringPiece());
+      buf->retrieveAll();
+      break;
+    }
+    else if (result == WebSocketContext::kError)
+    {
+      LOG_ERROR << "WebSocketConnection bad frame, closing with "
+                << parser_->closeCode();
+      sendClose(parser_->closeCode(), StringPiece());
+      buf->retrieveAll();
+      break;
+    }
+  }
+}
@@ -0,0 +1,147 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_WEBSOCKET_H
+#define MUDUO_NET_HTTP_WEBSOCKET_H
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/base/Types.h>
+#include <muduo/net/Callbacks.h>
+#include <muduo/net/http/HttpRequest.h>
+
+#include <boost/any.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class Buffer;
+class EventLoop;
+class HttpServer;
+class WebSocketConnection;
+class WebSocketContext;
+
+typedef boost::shared_ptr<WebSocketConnection> WebSocketConnectionPtr;
+typedef boost::function<void (const WebSocketConnectionPtr&)> WebSocketCallback;
+/// message is valid during the call, text is not checked to be UTF-8.
+typedef boost::function<void (const WebSocketConnectionPtr&,
+                              const string& message,
+                              bool binary)> WebSocketMessageCallback;
+
+///
+/// A connection upgraded to WebSocket by HttpServer, RFC 6455.
+///
+/// Frames are sent unmasked and unfragmented; received fragments are
+/// assembled into one message. Pings are answered in the IO thread.
+///
+class WebSocketConnection : boost::noncopyable,
+                            public boost::enable_shared_from_this<WebSocketConnection>
+{
+ public:
+  enum Opcode
+  {
+    kText = 0x1,
+    kBinary = 0x2,
+    kClose = 0x8,
+    kPing = 0x9,
+    kPong = 0xA,
+  };
+
+  enum CloseCode
+  {
+    kNormalClosure = 1000,
+    kGoingAway = 1001,
+    kProtocolError = 1002,
+    kMessageTooBig = 1009,
+  };
+
+  /// An encoded frame, which can be sent to many connections,
+  /// eg. a broadcast, without encoding or copying it for each.
+  typedef boost::shared_ptr<const string> Frame;
+
+  static Frame makeFrame(Opcode opcode, const StringPiece& payload);
+  static void appendFrame(Opcode opcode, const StringPiece& payload, Buffer* output);
+
+  /// A GET with "Upgrade: websocket", whatever its version.
+  static bool isUpgradeRequest(const HttpRequest& request);
+
+  /// The Sec-WebSocket-Accept value answering a Sec-WebSocket-Key.
+  static string acceptKey(const StringPiece& key);
+
+  WebSocketConnection(const TcpConnectionPtr& conn,
+                      const HttpRequest& request,
+                      size_t maxMessageSize);
+  ~WebSocketConnection();  // force out-line dtor, for scoped_ptr members.
+
+  EventLoop* getLoop() const { return loop_; }
+
+  /// The upgrade request, eg. its path, query and headers.
+  const HttpRequest& request() const { return request_; }
+
+  /// The TCP connection, NULL once it is gone.
+  TcpConnectionPtr connection() const { return conn_.lock(); }
+
+  /// False once a Close frame is sent or the connection is gone.
+  bool connected();
+
+  /// Thread safe.
+  void send(const StringPiece& text)
+  { sendMessage(kText, text); }
+
+  /// Thread safe.
+  void sendBinary(const StringPiece& data)
+  { sendMessage(kBinary, data); }
+
+  /// Thread safe, the frame is not copied.
+  void send(const Frame& frame);
+
+  /// Sends a Close frame and closes the connection after it.
+  /// Later sends are dropped. Thread safe.
+  void close(CloseCode code = kNormalClosure,
+             const StringPiece& reason = StringPiece());
+
+  void setContext(const boost::any& context)
+  { context_ = context; }
+
+  const boost::any& getContext() const
+  { return context_; }
+
+  boost::any* getMutableContext()
+  { return &context_; }
+
+ private:
+  friend class HttpServer;
+
+  void sendMessage(Opcode opcode, const StringPiece& data);
+  void sendInLoop(const Frame& frame);
+  // code may be any the peer sent
+  void sendClose(uint16_t code, const StringPiece& reason);
+  // in the IO thread
+  void handleData(Buffer* buf,
+                  Timestamp receiveTime,
+                  const WebSocketMessageCallback& cb);
+
+  EventLoop* loop_;
+  boost::weak_ptr<TcpConnection> conn_;
+  const HttpRequest request_;
+  boost::scoped_ptr<WebSocketContext> parser_;
+  Timestamp lastReceiveTime_;  // in the IO thread, for HttpServer pings
+  AtomicInt32 closeSent_;
+  boost::any context_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_WEBSOCKET_H
@@ -0,0 +1,152 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/http/WebSocketContext.h>
+
+#include <muduo/net/Buffer.h>
+
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+const uint16_t WebSocketContext::kNoStatusCode;
+
+void WebSocketContext::unmask(char* data, size_t len, const char* key)
+{
+  size_t i = 0;
+#ifdef __SSE2__
+  // the key repeats every 4 bytes, so 16 bytes take it 4 times
+  int32_t key32;
+  memcpy(&key32, key, sizeof key32);
+  const __m128i k = _mm_set1_epi32(key32);
+  for (; len - i >= 16; i += 16)
+  {
+    __m128i* p = reinterpret_cast<__m128i*>(data + i);
+    _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), k));
+  }
+#else
+  uint64_t key64;
+  memcpy(&key64, key, 4);
+  memcpy(reinterpret_cast<char*>(&key64) + 4, key, 4);
+  for (; len - i >= 8; i += 8)
+  {
+    uint64_t x;
+    memcpy(&x, data + i, sizeof x);
+    x ^= key64;
+    memcpy(data + i, &x, sizeof x);
+  }
+#endif
+  for (; i < len; ++i)
+  {
+    data[i] ^= key[i & 3];
+  }
+}
+
+WebSocketContext::Result WebSocketContext::parse(Buffer* buf)
+{
+  while (buf->readableBytes() >= 2)
+  {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(buf->peek());
+    const bool fin = p[0] & 0x80;
+    const int opcode = p[0] & 0x0F;
+    const bool control = opcode & 0x08;
+    // no extension is negotiated, so RSV1-3 stay 0, and clients mask
+    if ((p[0] & 0x70) || !(p[1] & 0x80))
+    {
+      return error(1002);
+    }
+
+    size_t headerLength = 2;
+    uint64_t length = p[1] & 0x7F;
+    if (length == 126)
+    {
+      headerLength = 4;
+      if (buf->readableBytes() < headerLength)
+        return kNeedMore;
+      length = (p[2] << 8) | p[3];
+    }
+    else if (length == 127)
+    {
+      headerLength = 10;
+      if (buf->readableBytes() < headerLength)
+        return kNeedMore;
+      length = 0;
+      for (int i = 2; i < 10; ++i)
+      {
+        length = (length << 8) | p[i];
+      }
+    }
+    headerLength += 4;  // masking key
+
+    if (control)
+    {
+      if (!fin || length > 125 || opcode > 0xA)
+      {
+        return error(1002);
+      }
+    }
+    else if (opcode > 2 || (opcode == 0) != fragmented_)
+    {
+      // reserved opcode, continuation of nothing, or an interleaved message
+      return error(1002);
+    }
+    else if (length > maxMessageSize_ - message_.size())
+    {
+      return error(1009);
+    }
+
+    if (buf->readableBytes() < headerLength
+        || buf->readableBytes() - headerLength < length)
+    {
+      return kNeedMore;
+    }
+
+    const char* key = buf->peek() + headerLength - 4;
+    const char* payload = buf->peek() + headerLength;
+    const size_t len = static_cast<size_t>(length);
+    if (control)
+    {
+      control_.assign(payload, len);
+      if (len > 0)
+      {
+        unmask(&control_[0], len, key);
+      }
+      buf->retrieve(headerLength + len);
+      if (opcode == 0x8)
+      {
+        if (len == 1)
+        {
+          return error(1002);
+        }
+        closeCode_ = len >= 2
+            ? static_cast<uint16_t>((static_cast<uint8_t>(control_[0]) << 8)
+                                    | static_cast<uint8_t>(control_[1]))
+            : kNoStatusCode;
+        return kClose;
+      }
+      return opcode == 0x9 ? kPing : kPong;
+    }
+
+    if (opcode != 0)
+    {
+      binary_ = opcode == 2;
+    }
+    size_t start = message_.size();
+    message_.append(payload, len);
+    if (len > 0)
+    {
+      unmask(&message_[start], len, key);
+    }
+    buf->retrieve(headerLength + len);
+    fragmented_ = !fin;
+    if (fin)
+    {
+      return kMessage;
+    }
+  }
+  return kNeedMore;
+}
@@ -0,0 +1,94 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_HTTP_WEBSOCKETCONTEXT_H
+#define MUDUO_NET_HTTP_WEBSOCKETCONTEXT_H
+
+#include <muduo/base/copyable.h>
+#include <muduo/base/Types.h>
+
+#include <stdint.h>
+
+namespace muduo
+{
+namespace net
+{
+
+class Buffer;
+
+// Frames received from a client, RFC 6455 section 5.
+class WebSocketContext : public muduo::copyable
+{
+ public:
+  enum Result
+  {
+    kNeedMore,  // no complete frame in buf
+    kMessage,   // message() is complete, fragments assembled
+    kPing,      // control() is its payload
+    kPong,
+    kClose,     // closeCode() is the peer's, 1005 if none
+    kError,     // closeCode() is the one to close with
+  };
+
+  static const uint16_t kNoStatusCode = 1005;
+
+  explicit WebSocketContext(size_t maxMessageSize)
+    : maxMessageSize_(maxMessageSize),
+      fragmented_(false),
+      binary_(false),
+      closeCode_(0)
+  {
+  }
+
+  // default copy-ctor, dtor and assignment are fine
+
+  // Consumes frames from buf until a message or a control frame is
+  // complete. A frame is parsed once all of it is in buf.
+  Result parse(Buffer* buf);
+
+  const string& message() const
+  { return message_; }
+
+  bool binary() const
+  { return binary_; }
+
+  /// Keeps the capacity for the next message, unless it was large.
+  void clearMessage()
+  {
+    if (message_.capacity() > 64 * 1024)
+    {
+      string().swap(message_);
+    }
+    message_.clear();
+  }
+
+  const string& control() const
+  { return control_; }
+
+  uint16_t closeCode() const
+  { return closeCode_; }
+
+  // XORs data with the 4-byte masking key, key[0] applies to data[0]
+  static void unmask(char* data, size_t len, const char* key);
+
+ private:
+  Result error(uint16_t code)
+  {
+    closeCode_ = code;
+    return kError;
+  }
+
+  size_t maxMessageSize_;
+  bool fragmented_;    // a message is started but not finished
+  bool binary_;
+  uint16_t closeCode_;
+  string message_;
+  string control_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_WEBSOCKETCONTEXT_H
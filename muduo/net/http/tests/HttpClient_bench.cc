@@ -0,0 +1,150 @@
+#include <muduo/net/http/HttpClient.h>
+#include <muduo/net/http/HttpServer.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Keeps a number of GETs outstanding on one HttpClient, on keep-alive
+// connections, pipelined or not. Without a url it starts its own server.
+// Compare with examples/curl/bench.cc, which does the same with libcurl.
+
+const uint16_t kPort = 18005;
+
+void onRequest(const HttpRequest&, HttpResponse* resp)
+{
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setContentType("text/plain");
+  resp->setBody("hello, world!\n");
+}
+
+void serve(CountDownLatch* latch)
+{
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort), "HttpClientBench");
+  server.setHttpCallback(onRequest);
+  server.start();
+  latch->countDown();
+  loop.loop();
+}
+
+class Bench
+{
+ public:
+  Bench(EventLoop* loop, const string& url, int requests)
+    : loop_(loop),
+      client_(new HttpClient(loop, "HttpClientBench")),
+      url_(url),
+      remaining_(requests),
+      outstanding_(0),
+      failures_(0)
+  {
+  }
+
+  HttpClient* client() { return get_pointer(client_); }
+
+  void start(int concurrency)
+  {
+    for (int i = 0; i < concurrency && remaining_ > 0; ++i)
+    {
+      send();
+    }
+  }
+
+  int failures() const { return failures_; }
+  Timestamp finished() const { return finished_; }
+
+ private:
+  void send()
+  {
+    --remaining_;
+    ++outstanding_;
+    client_->get(url_, boost::bind(&Bench::onResponse, this, _1));
+  }
+
+  void onResponse(const HttpClientResponse& response)
+  {
+    --outstanding_;
+    if (!response.ok() || response.statusCode() != 200)
+    {
+      ++failures_;
+    }
+    if (remaining_ > 0)
+    {
+      send();
+    }
+    else if (outstanding_ == 0)
+    {
+      finished_ = Timestamp::now();
+      loop_->queueInLoop(boost::bind(&Bench::stop, this));
+    }
+  }
+
+  // lets the connections close before quitting
+  void stop()
+  {
+    client_.reset();
+    loop_->runAfter(0.1, boost::bind(&EventLoop::quit, loop_));
+  }
+
+  EventLoop* loop_;
+  boost::scoped_ptr<HttpClient> client_;
+  const string url_;
+  int remaining_;
+  int outstanding_;
+  int failures_;
+  Timestamp finished_;
+};
+
+int main(int argc, char* argv[])
+{
+  if (argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: %s [url] [requests] [concurrency] [pipelined]\n", argv[0]);
+    return 0;
+  }
+  string url = argc > 1 ? argv[1] : "";
+  int requests = argc > 2 ? atoi(argv[2]) : 100000;
+  int concurrency = argc > 3 ? atoi(argv[3]) : 8;
+  int pipelined = argc > 4 ? atoi(argv[4]) : 1;
+  Logger::setLogLevel(Logger::WARN);
+
+  CountDownLatch latch(1);
+  boost::scoped_ptr<Thread> server;
+  if (url.empty())
+  {
+    char buf[64];
+    snprintf(buf, sizeof buf, "http://127.0.0.1:%d/hello", kPort);
+    url = buf;
+    server.reset(new Thread(boost::bind(serve, &latch), "server"));
+    server->start();
+    latch.wait();
+  }
+
+  EventLoop loop;
+  Bench bench(&loop, url, requests);
+  // with pipelining the requests share fewer connections
+  bench.client()->setMaxConnectionsPerHost(pipelined > 1 ? (concurrency + pipelined - 1) / pipelined
+                                                         : concurrency);
+  bench.client()->setMaxPipelined(pipelined);
+
+  Timestamp start(Timestamp::now());
+  bench.start(concurrency);
+  loop.loop();
+  double seconds = timeDifference(bench.finished(), start);
+  printf("%d requests, concurrency %d, pipelined %d: %.3f seconds, %.0f req/s, %d failures\n",
+         requests, concurrency, pipelined, seconds, requests / seconds, bench.failures());
+  // the server thread, if any, is detached and ends with the process
+}
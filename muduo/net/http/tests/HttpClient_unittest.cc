@@ -0,0 +1,375 @@
+#include <muduo/net/http/HttpClient.h>
+#include <muduo/net/http/HttpServer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpServer.h>
+#include <muduo/base/Logging.h>
+
+//#define BOOST_TEST_MODULE HttpClientTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <vector>
+
+using muduo::string;
+using muduo::net::AsyncHttpResponsePtr;
+using muduo::net::Buffer;
+using muduo::net::EventLoop;
+using muduo::net::HttpClient;
+using muduo::net::HttpClientResponse;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponse;
+using muduo::net::HttpServer;
+using muduo::net::InetAddress;
+using muduo::net::TcpConnectionPtr;
+using muduo::net::TcpServer;
+
+const uint16_t kPort = 18006;
+const string kUrl = "http://127.0.0.1:18006";
+const uint16_t kRawPort = 18007;
+const string kRawUrl = "http://127.0.0.1:18007";
+
+std::vector<AsyncHttpResponsePtr> g_neverDone;
+
+void onRequest(const AsyncHttpResponsePtr& handle)
+{
+  const HttpRequest& req = handle->request();
+  HttpResponse* resp = handle->response();
+  resp->setStatusCode(HttpResponse::k200Ok);
+  if (req.path() == "/hello")
+  {
+    resp->setBody("hello");
+  }
+  else if (req.path() == "/echo")
+  {
+    resp->setBody(req.body());
+  }
+  else if (req.path() == "/query")
+  {
+    resp->setBody(req.query());
+  }
+  else if (req.path() == "/close")
+  {
+    resp->setCloseConnection(true);
+    resp->setBody("bye");
+  }
+  else if (req.path() == "/stream")
+  {
+    handle->startStream(muduo::net::AsyncHttpResponse::WritableCallback());
+    handle->write("a");
+    handle->write("bb");
+    handle->write("ccc");
+  }
+  else if (req.path() == "/never")
+  {
+    g_neverDone.push_back(handle);
+    return;
+  }
+  else
+  {
+    resp->setStatusCode(HttpResponse::k404NotFound);
+  }
+  handle->done();
+}
+
+// answers with canned bytes, which HttpServer would not send
+void onRawMessage(const TcpConnectionPtr& conn, Buffer* buf, muduo::Timestamp)
+{
+  const char* crlf = buf->findCRLF();
+  if (!crlf || !buf->findCRLF(crlf + 2))
+  {
+    return;
+  }
+  string line(buf->peek(), crlf);
+  buf->retrieveAll();
+  if (line.find("/huge ") != string::npos)
+  {
+    conn->send("HTTP/1.1 200 OK\r\nContent-Length: 999999999999999999\r\n\r\n");
+  }
+  else if (line.find("/toclose ") != string::npos)
+  {
+    conn->send("HTTP/1.0 200 OK\r\n\r\n0123456789");
+    conn->shutdown();
+  }
+  else if (line.find("/longchunk ") != string::npos)
+  {
+    // a chunk-size line which never ends
+    conn->send("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5;");
+    conn->send(string(4096, 'x'));
+  }
+  else if (line.find("/longtrailers ") != string::npos)
+  {
+    conn->send("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n");
+    string trailer("X-Trailer: ");
+    trailer.append(1000, 'x');
+    trailer += "\r\n";
+    for (int i = 0; i < 100; ++i)
+    {
+      conn->send(trailer);
+    }
+  }
+  else if (line.find("/badtrailer ") != string::npos)
+  {
+    // the rest would pass for the next response
+    conn->send("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+               "0\r\ngarbage-no-colon\r\n\r\n"
+               "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+  }
+}
+
+struct Fixture
+{
+  Fixture()
+    : server(&loop, InetAddress(kPort), "HttpClientTest"),
+      client(new HttpClient(&loop, "HttpClientTest")),
+      pending(0)
+  {
+    muduo::Logger::setLogLevel(muduo::Logger::WARN);
+    server.setAsyncHttpCallback(onRequest);
+    server.start();
+  }
+
+  void get(const string& path)
+  {
+    ++pending;
+    client->get(kUrl + path, boost::bind(&Fixture::onResponse, this, _1));
+  }
+
+  void onResponse(const HttpClientResponse& response)
+  {
+    responses.push_back(response);
+    if (--pending == 0)
+    {
+      loop.queueInLoop(boost::bind(&Fixture::finish, this));
+    }
+  }
+
+  // lets the connections close before quitting
+  void finish()
+  {
+    client.reset();
+    g_neverDone.clear();
+    loop.runAfter(0.1, boost::bind(&EventLoop::quit, &loop));
+  }
+
+  void run()
+  {
+    loop.runAfter(10.0, boost::bind(&EventLoop::quit, &loop));
+    loop.loop();
+  }
+
+  EventLoop loop;
+  HttpServer server;
+  boost::scoped_ptr<HttpClient> client;
+  int pending;
+  std::vector<HttpClientResponse> responses;
+};
+
+BOOST_AUTO_TEST_CASE(testGet)
+{
+  Fixture f;
+  f.get("/hello");
+  f.get("/query?x=1");
+  f.get("/missing");
+  f.get("/stream");
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.responses.size(), 4u);
+  // four connections, the responses come in any order
+  int found = 0;
+  for (size_t i = 0; i < f.responses.size(); ++i)
+  {
+    const HttpClientResponse& r = f.responses[i];
+    BOOST_CHECK(r.ok());
+    if (r.body() == "hello")
+    {
+      BOOST_CHECK_EQUAL(r.statusCode(), 200);
+      BOOST_CHECK_EQUAL(r.statusMessage(), "OK");
+      BOOST_CHECK_EQUAL(r.header("content-length").as_string(), "5");
+      found |= 1;
+    }
+    else if (r.body() == "?x=1")
+      found |= 2;
+    else if (r.statusCode() == 404)
+      found |= 4;
+    else if (r.body() == "abbccc")
+    {
+      BOOST_CHECK_EQUAL(r.header("Transfer-Encoding").as_string(), "chunked");
+      found |= 8;
+    }
+  }
+  BOOST_CHECK_EQUAL(found, 15);
+}
+
+BOOST_AUTO_TEST_CASE(testPipelined)
+{
+  Fixture f;
+  f.client->setMaxConnectionsPerHost(1);
+  f.client->setMaxPipelined(8);
+  for (int i = 0; i < 20; ++i)
+  {
+    char path[32];
+    snprintf(path, sizeof path, "/query?%d", i);
+    f.get(path);
+  }
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.responses.size(), 20u);
+  for (int i = 0; i < 20; ++i)
+  {
+    char query[32];
+    snprintf(query, sizeof query, "?%d", i);
+    BOOST_CHECK_EQUAL(f.responses[i].body(), query);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testPostAndClose)
+{
+  Fixture f;
+  f.client->setMaxConnectionsPerHost(1);
+  ++f.pending;
+  f.client->post(kUrl + "/echo", "some data", "text/plain",
+                 boost::bind(&Fixture::onResponse, &f, _1));
+  f.get("/close");
+  f.get("/hello");  // on a new connection
+  ++f.pending;
+  f.client->request(HttpRequest::kHead, kUrl + "/hello",
+                    boost::bind(&Fixture::onResponse, &f, _1));
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.responses.size(), 4u);
+  BOOST_CHECK_EQUAL(f.responses[0].body(), "some data");
+  BOOST_CHECK_EQUAL(f.responses[1].body(), "bye");
+  BOOST_CHECK_EQUAL(f.responses[2].body(), "hello");
+  BOOST_CHECK(f.responses[3].ok());
+  BOOST_CHECK(f.responses[3].body().empty());
+}
+
+BOOST_AUTO_TEST_CASE(testErrors)
+{
+  Fixture f;
+  f.client->setTimeout(0.2);
+  f.client->setConnectRetries(0);
+  f.get("/never");
+  ++f.pending;
+  f.client->get("http://127.0.0.1:1/", boost::bind(&Fixture::onResponse, &f, _1));
+  ++f.pending;
+  f.client->get("ftp://127.0.0.1/", boost::bind(&Fixture::onResponse, &f, _1));
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.responses.size(), 3u);
+  BOOST_CHECK_EQUAL(f.responses[0].error(), HttpClientResponse::kBadUrl);
+  BOOST_CHECK_EQUAL(f.responses[1].error(), HttpClientResponse::kConnectFailed);
+  BOOST_CHECK_EQUAL(f.responses[2].error(), HttpClientResponse::kTimeout);
+}
+
+BOOST_AUTO_TEST_CASE(testResolve)
+{
+  {
+    // looked up on the resolver thread
+    Fixture f;
+    ++f.pending;
+    f.client->get("http://localhost:18006/hello", boost::bind(&Fixture::onResponse, &f, _1));
+    f.run();
+    BOOST_REQUIRE_EQUAL(f.responses.size(), 1u);
+    BOOST_CHECK(f.responses[0].ok());
+    BOOST_CHECK_EQUAL(f.responses[0].body(), "hello");
+  }
+
+  Fixture f;
+  ++f.pending;
+  f.client->get("http://no-such-host.invalid/", boost::bind(&Fixture::onResponse, &f, _1));
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.responses.size(), 1u);
+  BOOST_CHECK_EQUAL(f.responses[0].error(), HttpClientResponse::kBadUrl);
+}
+
+BOOST_AUTO_TEST_CASE(testConnectFailed)
+{
+  Fixture f;
+  f.client->setTimeout(0);  // the retries end it
+  f.client->setConnectRetries(1);
+  ++f.pending;
+  f.client->get("http://127.0.0.1:1/", boost::bind(&Fixture::onResponse, &f, _1));
+  ++f.pending;
+  f.client->post("http://127.0.0.1:1/", "data", "text/plain",
+                 boost::bind(&Fixture::onResponse, &f, _1));
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.responses.size(), 2u);
+  BOOST_CHECK_EQUAL(f.responses[0].error(), HttpClientResponse::kConnectFailed);
+  BOOST_CHECK_EQUAL(f.responses[1].error(), HttpClientResponse::kConnectFailed);
+}
+
+BOOST_AUTO_TEST_CASE(testConnectFailedAtOnce)
+{
+  // connect() to broadcast fails at once, EACCES or ENETUNREACH, inside
+  // TcpClient::connect()
+  Fixture f;
+  f.client->setTimeout(0);
+  f.client->setConnectRetries(0);
+  ++f.pending;
+  f.client->get("http://255.255.255.255:80/", boost::bind(&Fixture::onResponse, &f, _1));
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.responses.size(), 1u);
+  BOOST_CHECK_EQUAL(f.responses[0].error(), HttpClientResponse::kConnectFailed);
+}
+
+BOOST_AUTO_TEST_CASE(testMaxResponseBodySize)
+{
+  Fixture f;
+  TcpServer raw(&f.loop, InetAddress(kRawPort), "HttpClientTestRaw");
+  raw.setMessageCallback(onRawMessage);
+  raw.start();
+  f.client->setMaxResponseBodySize(5);
+  f.get("/hello");
+  f.get("/stream");
+  ++f.pending;
+  f.client->get(kRawUrl + "/huge", boost::bind(&Fixture::onResponse, &f, _1));
+  ++f.pending;
+  f.client->get(kRawUrl + "/toclose", boost::bind(&Fixture::onResponse, &f, _1));
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.responses.size(), 4u);
+  int ok = 0;
+  for (size_t i = 0; i < f.responses.size(); ++i)
+  {
+    const HttpClientResponse& r = f.responses[i];
+    if (r.ok())
+    {
+      BOOST_CHECK_EQUAL(r.body(), "hello");
+      ++ok;
+    }
+    else
+    {
+      BOOST_CHECK_EQUAL(r.error(), HttpClientResponse::kBadResponse);
+    }
+  }
+  BOOST_CHECK_EQUAL(ok, 1);
+}
+
+BOOST_AUTO_TEST_CASE(testLongChunkSizeAndTrailers)
+{
+  Fixture f;
+  TcpServer raw(&f.loop, InetAddress(kRawPort), "HttpClientTestRaw");
+  raw.setMessageCallback(onRawMessage);
+  raw.start();
+  ++f.pending;
+  f.client->get(kRawUrl + "/longchunk", boost::bind(&Fixture::onResponse, &f, _1));
+  ++f.pending;
+  f.client->get(kRawUrl + "/longtrailers", boost::bind(&Fixture::onResponse, &f, _1));
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.responses.size(), 2u);
+  BOOST_CHECK_EQUAL(f.responses[0].error(), HttpClientResponse::kBadResponse);
+  BOOST_CHECK_EQUAL(f.responses[1].error(), HttpClientResponse::kBadResponse);
+}
+
+BOOST_AUTO_TEST_CASE(testBadTrailer)
+{
+  Fixture f;
+  TcpServer raw(&f.loop, InetAddress(kRawPort), "HttpClientTestRaw");
+  raw.setMessageCallback(onRawMessage);
+  raw.start();
+  ++f.pending;
+  f.client->get(kRawUrl + "/badtrailer", boost::bind(&Fixture::onResponse, &f, _1));
+  f.run();
+  BOOST_REQUIRE_EQUAL(f.responses.size(), 1u);
+  BOOST_CHECK_EQUAL(f.responses[0].error(), HttpClientResponse::kBadResponse);
+}
@@ -0,0 +1,162 @@
+#include <muduo/net/http/HttpCompressor.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+
+//#define BOOST_TEST_MODULE HttpCompressorTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <zlib.h>
+
+using muduo::string;
+using muduo::StringPiece;
+using muduo::net::HttpCompressor;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponse;
+
+string inflateBody(const string& compressed, int windowBits)
+{
+  z_stream zs;
+  memset(&zs, 0, sizeof zs);
+  BOOST_REQUIRE_EQUAL(inflateInit2(&zs, windowBits), Z_OK);
+  string output(1024 * 1024, '\0');
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  zs.avail_in = static_cast<uInt>(compressed.size());
+  zs.next_out = reinterpret_cast<Bytef*>(&output[0]);
+  zs.avail_out = static_cast<uInt>(output.size());
+  BOOST_CHECK_EQUAL(inflate(&zs, Z_FINISH), Z_STREAM_END);
+  output.resize(zs.total_out);
+  inflateEnd(&zs);
+  return output;
+}
+
+string makeBody(int lines)
+{
+  string body;
+  for (int i = 0; i < lines; ++i)
+  {
+    body += "{\"id\": 12345, \"name\": \"muduo\", \"tags\": [\"net\", \"http\"]},\n";
+  }
+  return body;
+}
+
+BOOST_AUTO_TEST_CASE(testNegotiate)
+{
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate(""), HttpCompressor::kIdentity);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate("identity"), HttpCompressor::kIdentity);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate("gzip"), HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate("gzip, deflate, br"), HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate("deflate"), HttpCompressor::kDeflate);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate("GZIP;q=0.5"), HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate("gzip;q=0, deflate"), HttpCompressor::kDeflate);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate("gzip;q=0.0, deflate;q=0"), HttpCompressor::kIdentity);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate("*"), HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate("gzip;q=0, *"), HttpCompressor::kDeflate);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate("br"), HttpCompressor::kIdentity);
+}
+
+BOOST_AUTO_TEST_CASE(testCompress)
+{
+  HttpCompressor compressor;
+  string body = makeBody(100);
+
+  boost::shared_ptr<const string> gzip = compressor.compress(body, HttpCompressor::kGzip);
+  BOOST_REQUIRE(gzip);
+  BOOST_CHECK_LT(gzip->size(), body.size());
+  BOOST_CHECK_EQUAL(inflateBody(*gzip, 16 + MAX_WBITS), body);
+
+  boost::shared_ptr<const string> deflate = compressor.compress(body, HttpCompressor::kDeflate);
+  BOOST_REQUIRE(deflate);
+  BOOST_CHECK_EQUAL(inflateBody(*deflate, MAX_WBITS), body);
+  BOOST_CHECK_EQUAL(compressor.misses(), 2);
+
+  // served from the cache
+  BOOST_CHECK(compressor.compress(body, HttpCompressor::kGzip) == gzip);
+  BOOST_CHECK_EQUAL(compressor.hits(), 1);
+
+  // random bytes do not shrink
+  string noise;
+  uint32_t x = 2463534242U;
+  for (int i = 0; i < 4096; ++i)
+  {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    noise.push_back(static_cast<char>(x));
+  }
+  // only the compressed bodies are kept, not what did not shrink
+  BOOST_CHECK(!compressor.compress(noise, HttpCompressor::kGzip));
+  BOOST_CHECK(!compressor.compress(noise, HttpCompressor::kGzip));
+  BOOST_CHECK_EQUAL(compressor.misses(), 4);
+  BOOST_CHECK_EQUAL(compressor.cachedBytes(), gzip->size() + deflate->size());
+
+  // as long as another cached body, told apart by the hash
+  string other(body);
+  other[body.size() / 2] = 'x';
+  boost::shared_ptr<const string> otherGzip = compressor.compress(other, HttpCompressor::kGzip);
+  BOOST_REQUIRE(otherGzip);
+  BOOST_CHECK(otherGzip != gzip);
+  BOOST_CHECK_EQUAL(inflateBody(*otherGzip, 16 + MAX_WBITS), other);
+  BOOST_CHECK_EQUAL(compressor.misses(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(testEviction)
+{
+  string body1 = makeBody(200);
+  string body2 = body1 + "x";
+  size_t size1 = HttpCompressor().compress(body1, HttpCompressor::kGzip)->size();
+  // room for one of them
+  HttpCompressor compressor(1024, size1 + size1 / 2);
+  compressor.compress(body1, HttpCompressor::kGzip);
+  compressor.compress(body2, HttpCompressor::kGzip);  // evicts body1
+  BOOST_CHECK_LE(compressor.cachedBytes(), size1 + size1 / 2);
+  compressor.compress(body2, HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(compressor.hits(), 1);
+  compressor.compress(body1, HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(compressor.misses(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(testResponse)
+{
+  HttpCompressor compressor(1024);
+  HttpRequest req;
+  const char accept[] = "Accept-Encoding: gzip";
+  req.addHeader(accept, accept + 15, accept + sizeof accept - 1);
+
+  string body = makeBody(100);
+  HttpResponse response(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.setContentType("application/json");
+  response.setBody(body);
+  compressor.compress(req, &response);
+  BOOST_CHECK_EQUAL(response.header("Content-Encoding").as_string(), "gzip");
+  BOOST_CHECK_EQUAL(response.header("Vary").as_string(), "Accept-Encoding");
+  BOOST_CHECK_EQUAL(inflateBody(response.body().as_string(), 16 + MAX_WBITS), body);
+
+  // added to what the handler varies on
+  response.reset(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.setContentType("application/json");
+  response.addHeader("Vary", "Origin");
+  response.setBody(body);
+  compressor.compress(req, &response);
+  BOOST_CHECK_EQUAL(response.header("Vary").as_string(), "Origin, Accept-Encoding");
+
+  // too small
+  response.reset(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.setContentType("text/plain");
+  response.setBody("hello");
+  compressor.compress(req, &response);
+  BOOST_CHECK(response.header("Content-Encoding").empty());
+
+  // not text
+  response.reset(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.setContentType("image/png");
+  response.setBody(body);
+  compressor.compress(req, &response);
+  BOOST_CHECK(response.header("Content-Encoding").empty());
+  BOOST_CHECK_EQUAL(response.body().size(), static_cast<int>(body.size()));
+}
@@ -0,0 +1,192 @@
+#include <muduo/net/http/HttpFileCache.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/Buffer.h>
+
+//#define BOOST_TEST_MODULE HttpFileCacheTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::HttpFileCache;
+using muduo::net::HttpFilePtr;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponse;
+
+struct TempDir
+{
+  TempDir()
+  {
+    char name[] = "/tmp/httpfilecacheXXXXXX";
+    BOOST_REQUIRE(::mkdtemp(name));
+    dir = name;
+    write("/hello.txt", "hello, world");
+  }
+
+  ~TempDir()
+  {
+    ::unlink((dir + "/hello.txt").c_str());
+    ::rmdir(dir.c_str());
+  }
+
+  void write(const string& name, const string& content)
+  {
+    FILE* fp = ::fopen((dir + name).c_str(), "w");
+    BOOST_REQUIRE(fp);
+    ::fwrite(content.data(), 1, content.size(), fp);
+    ::fclose(fp);
+  }
+
+  string dir;
+};
+
+// headers are "Field: value" lines separated by CRLF
+string respond(HttpFileCache* cache, const char* path, const string& headers = string())
+{
+  HttpRequest req;
+  const char method[] = "GET";
+  req.setMethod(method, method + 3);
+  req.setPath(path, path + strlen(path));
+  size_t start = 0;
+  while (start < headers.size())
+  {
+    size_t end = headers.find("\r\n", start);
+    if (end == string::npos)
+      end = headers.size();
+    const char* line = headers.data() + start;
+    req.addHeader(line, line + headers.find(':', start) - start, headers.data() + end);
+    start = end + 2;
+  }
+  HttpResponse response(false);
+  cache->respond(req, path, &response);
+  Buffer buf;
+  response.appendToBuffer(&buf);
+  return buf.retrieveAllAsString();
+}
+
+bool contains(const string& s, const char* part)
+{
+  return s.find(part) != string::npos;
+}
+
+BOOST_AUTO_TEST_CASE(testOpen)
+{
+  TempDir tmp;
+  HttpFileCache cache(tmp.dir, 4);
+  HttpFilePtr file = cache.open("/hello.txt");
+  BOOST_REQUIRE(file);
+  BOOST_CHECK_EQUAL(file->size(), 12);
+  BOOST_CHECK_EQUAL(string(file->contentType()), "text/plain");
+  BOOST_CHECK(cache.open("/hello.txt") == file);
+  BOOST_CHECK_EQUAL(cache.size(), 1u);
+
+  BOOST_CHECK(!cache.open("/missing"));
+  BOOST_CHECK(!cache.open("/"));
+  BOOST_CHECK(!cache.open("/../etc/passwd"));
+  BOOST_CHECK(!cache.open("/a/../hello.txt"));
+  BOOST_CHECK(!cache.open("hello.txt"));
+}
+
+BOOST_AUTO_TEST_CASE(testSymlink)
+{
+  TempDir tmp;
+  HttpFileCache cache(tmp.dir, 4);
+  string inside = tmp.dir + "/inside.txt";
+  string outside = tmp.dir + "/outside.txt";
+  BOOST_REQUIRE(::symlink((tmp.dir + "/hello.txt").c_str(), inside.c_str()) == 0);
+  BOOST_REQUIRE(::symlink("/etc/passwd", outside.c_str()) == 0);
+  HttpFilePtr file = cache.open("/inside.txt");
+  BOOST_REQUIRE(file);
+  BOOST_CHECK_EQUAL(file->size(), 12);
+  BOOST_CHECK(!cache.open("/outside.txt"));
+  ::unlink(inside.c_str());
+  ::unlink(outside.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testEviction)
+{
+  TempDir tmp;
+  HttpFileCache cache(tmp.dir, 2);
+  tmp.write("/a.txt", "a");
+  tmp.write("/b.txt", "b");
+  HttpFilePtr a = cache.open("/a.txt");
+  cache.open("/b.txt");
+  cache.open("/a.txt");
+  cache.open("/hello.txt");  // evicts b.txt
+  BOOST_CHECK_EQUAL(cache.size(), 2u);
+  BOOST_CHECK(cache.open("/a.txt") == a);
+  ::unlink((tmp.dir + "/a.txt").c_str());
+  ::unlink((tmp.dir + "/b.txt").c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testRespond)
+{
+  TempDir tmp;
+  HttpFileCache cache(tmp.dir, 4);
+
+  string full = respond(&cache, "/hello.txt");
+  BOOST_CHECK(contains(full, "HTTP/1.1 200 OK\r\n"));
+  BOOST_CHECK(contains(full, "Content-Length: 12\r\n"));
+  BOOST_CHECK(contains(full, "Accept-Ranges: bytes\r\n"));
+  BOOST_CHECK(contains(full, "\r\n\r\nhello, world"));
+
+  string range = respond(&cache, "/hello.txt", "Range: bytes=7-");
+  BOOST_CHECK(contains(range, "HTTP/1.1 206 Partial Content\r\n"));
+  BOOST_CHECK(contains(range, "Content-Range: bytes 7-11/12\r\n"));
+  BOOST_CHECK(contains(range, "\r\n\r\nworld"));
+
+  range = respond(&cache, "/hello.txt", "Range: bytes=0-4");
+  BOOST_CHECK(contains(range, "Content-Range: bytes 0-4/12\r\n"));
+  BOOST_CHECK(contains(range, "\r\n\r\nhello"));
+
+  range = respond(&cache, "/hello.txt", "Range: bytes=-5");
+  BOOST_CHECK(contains(range, "\r\n\r\nworld"));
+
+  range = respond(&cache, "/hello.txt", "Range: bytes=12-");
+  BOOST_CHECK(contains(range, "HTTP/1.1 416 Range Not Satisfiable\r\n"));
+  BOOST_CHECK(contains(range, "Content-Range: bytes */12\r\n"));
+
+  // several ranges are answered with the whole file
+  range = respond(&cache, "/hello.txt", "Range: bytes=0-1,3-4");
+  BOOST_CHECK(contains(range, "HTTP/1.1 200 OK\r\n"));
+
+  HttpFilePtr file = cache.open("/hello.txt");
+  string notModified = respond(&cache, "/hello.txt",
+                                "If-Modified-Since: " + file->lastModified());
+  BOOST_CHECK(contains(notModified, "HTTP/1.1 304 Not Modified\r\n"));
+  BOOST_CHECK(!contains(notModified, "Content-Length"));
+
+  // If-Range with another date ignores Range
+  range = respond(&cache, "/hello.txt",
+                  "Range: bytes=7-\r\nIf-Range: Thu, 01 Jan 1970 00:00:00 GMT");
+  BOOST_CHECK(contains(range, "HTTP/1.1 200 OK\r\n"));
+  range = respond(&cache, "/hello.txt",
+                  "Range: bytes=7-\r\nIf-Range: " + file->lastModified());
+  BOOST_CHECK(contains(range, "HTTP/1.1 206 Partial Content\r\n"));
+
+  BOOST_CHECK(contains(respond(&cache, "/nothing"), "HTTP/1.1 404 Not Found\r\n"));
+}
+
+BOOST_AUTO_TEST_CASE(testShortRead)
+{
+  TempDir tmp;
+  HttpFileCache cache(tmp.dir, 4);
+  HttpFilePtr file = cache.open("/hello.txt");
+  BOOST_REQUIRE(file);
+  tmp.write("/hello.txt", "hello");  // truncated under the cache
+
+  HttpResponse response(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.setBodyFile(file, 0, file->size());
+  Buffer buf;
+  BOOST_CHECK(!response.appendToBuffer(&buf));
+  string output = buf.retrieveAllAsString();
+  BOOST_CHECK(contains(output, "Content-Length: 12\r\n"));
+  BOOST_CHECK_EQUAL(output.substr(output.size() - 7), "\r\nhello");
+}
@@ -77,3 +77,323 @@ BOOST_AUTO_TEST_CASE(testParseRequestEmptyHeaderValue)
   BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), string(""));
   BOOST_CHECK_EQUAL(request.getHeader("Accept-Encoding"), string(""));
 }
+
+BOOST_AUTO_TEST_CASE(testParseRequestWithBody)
+{
+  string all("POST /api HTTP/1.1\r\n"
+       "Host: www.chenshuo.com\r\n"
+       "content-length: 11\r\n"
+       "\r\n"
+       "hello world");
+
+  for (size_t sz1 = 0; sz1 < all.size(); ++sz1)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(all.c_str(), sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(!context.gotAll());
+
+    input.append(all.c_str() + sz1, all.size() - sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    BOOST_CHECK_EQUAL(context.request().method(), HttpRequest::kPost);
+    BOOST_CHECK_EQUAL(context.request().body(), string("hello world"));
+    BOOST_CHECK_EQUAL(input.readableBytes(), 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestChunked)
+{
+  string all("POST /upload HTTP/1.1\r\n"
+       "Transfer-Encoding: chunked\r\n"
+       "\r\n"
+       "5\r\n"
+       "hello\r\n"
+       "6;name=value\r\n"
+       " world\r\n"
+       "0\r\n"
+       "X-Trailer: done\r\n"
+       "\r\n");
+
+  for (size_t sz1 = 0; sz1 < all.size(); ++sz1)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(all.c_str(), sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(!context.gotAll());
+
+    input.append(all.c_str() + sz1, all.size() - sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    BOOST_CHECK_EQUAL(context.request().body(), string("hello world"));
+    BOOST_CHECK_EQUAL(context.request().getHeader("X-Trailer"), string("done"));
+    BOOST_CHECK_EQUAL(input.readableBytes(), 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestPipelined)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("POST /a HTTP/1.1\r\n"
+       "Content-Length: 3\r\n"
+       "\r\n"
+       "abc"
+       "GET /b HTTP/1.1\r\n"
+       "\r\n"
+       "GET /c HTTP/1.1\r\n");
+
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().path(), string("/a"));
+  BOOST_CHECK_EQUAL(context.request().body(), string("abc"));
+  context.reset();
+
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().path(), string("/b"));
+  BOOST_CHECK_EQUAL(context.request().body(), string(""));
+  context.reset();
+
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(!context.gotAll());
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestBadBody)
+{
+  const char* requests[] = {
+    "POST / HTTP/1.1\r\nContent-Length: 12x\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 1001\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 5\r\n\r\nabcde",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3e9\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nab\r\n",
+  };
+  for (size_t i = 0; i < sizeof requests / sizeof requests[0]; ++i)
+  {
+    HttpContext context;
+    context.setMaxBodySize(1000);
+    Buffer input;
+    input.append(requests[i]);
+    BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestTransferCodings)
+{
+  const char* requests[] = {
+    "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: xchunked\r\n\r\n0\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n0\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, chunked\r\n\r\n0\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n",
+  };
+  for (size_t i = 0; i < sizeof requests / sizeof requests[0]; ++i)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(requests[i]);
+    BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.notImplemented());
+  }
+
+  HttpContext context;
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\nTransfer-Encoding: , Chunked \r\n\r\n"
+               "5\r\nhello\r\n0\r\n\r\n");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().body(), string("hello"));
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestRepeatedContentLength)
+{
+  // the same value repeated is allowed
+  HttpContext context;
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\nContent-Length: 5\r\ncontent-length: 5\r\n\r\nhello");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().body(), string("hello"));
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestLongChunkSize)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n");
+  // a chunk-size line which never ends
+  string ext("5;");
+  ext.append(1000, 'x');
+  input.append(ext);
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(!context.gotAll());
+  input.append(ext);
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+
+  // nor in one piece
+  HttpContext context2;
+  Buffer input2;
+  input2.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n");
+  input2.append(ext + ext + "\r\nhello\r\n0\r\n\r\n");
+  BOOST_CHECK(!context2.parseRequest(&input2, Timestamp::now()));
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestLongTrailers)
+{
+  string trailer("X-Trailer: ");
+  trailer.append(1000, 'x');
+  trailer += "\r\n";
+  const size_t kFit = HttpContext::kMaxHeaderSize / trailer.size() - 1;
+
+  HttpContext context;
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+               "5\r\nhello\r\n0\r\n");
+  for (size_t i = 0; i < kFit; ++i)
+  {
+    input.append(trailer);
+  }
+  input.append("\r\n");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().body(), "hello");
+
+  // trailers without end, in whole lines
+  HttpContext context2;
+  Buffer input2;
+  input2.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n");
+  bool ok = true;
+  for (size_t i = 0; ok && i < 2 * kFit; ++i)
+  {
+    input2.append(trailer);
+    ok = context2.parseRequest(&input2, Timestamp::now());
+  }
+  BOOST_CHECK(!ok);
+  BOOST_CHECK(!context2.gotAll());
+
+  // and one line without end
+  HttpContext context3;
+  Buffer input3;
+  input3.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n0\r\nX-Trailer: ");
+  input3.append(string(HttpContext::kMaxHeaderSize, 'x'));
+  BOOST_CHECK(!context3.parseRequest(&input3, Timestamp::now()));
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestBadTrailer)
+{
+  // only the empty line ends the trailers
+  HttpContext context;
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+               "0\r\ngarbage-no-colon\r\n\r\n"
+               "GET /smuggled HTTP/1.1\r\n\r\n");
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(!context.gotAll());
+}
+
+BOOST_AUTO_TEST_CASE(testExpectContinue)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("PUT /file HTTP/1.1\r\n"
+       "Expect: 100-continue\r\n"
+       "Content-Length: 4\r\n"
+       "\r\n");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(!context.gotAll());
+  BOOST_CHECK(context.takeExpectContinue());
+  BOOST_CHECK(!context.takeExpectContinue());
+
+  input.append("data");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().body(), string("data"));
+}
+
+BOOST_AUTO_TEST_CASE(testHeadersCaseInsensitive)
+{
+  string all("GET / HTTP/1.1\r\n"
+       "host: a.example.com\r\n"
+       "X-Many:\t spaces and tabs \t\r\n");
+  for (int i = 0; i < 20; ++i)
+  {
+    char line[32];
+    snprintf(line, sizeof line, "X-Header-%d: %d\r\n", i, i);
+    all += line;
+  }
+  all += "\r\n";
+
+  HttpContext context;
+  Buffer input;
+  input.append(all);
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  const HttpRequest& request = context.request();
+  BOOST_CHECK_EQUAL(request.headers().size(), 22);
+  BOOST_CHECK_EQUAL(request.getHeader("Host"), string("a.example.com"));
+  BOOST_CHECK_EQUAL(request.getHeader("HOST"), string("a.example.com"));
+  BOOST_CHECK_EQUAL(request.getHeader("x-many"), string("spaces and tabs"));
+  BOOST_CHECK_EQUAL(request.getHeader("X-Header-19"), string("19"));
+  BOOST_CHECK_EQUAL(request.headers().field(21).as_string(), string("X-Header-19"));
+  BOOST_CHECK(!request.headers().has("X-Header-20"));
+
+  // copies and swaps keep the headers readable
+  HttpRequest copy(request);
+  HttpRequest swapped;
+  swapped.swap(copy);
+  BOOST_CHECK_EQUAL(swapped.getHeader("X-Header-3"), string("3"));
+  BOOST_CHECK_EQUAL(swapped.getHeader("X-Header-17"), string("17"));
+  BOOST_CHECK(copy.headers().empty());
+}
+
+BOOST_AUTO_TEST_CASE(testRepeatedHeader)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("GET / HTTP/1.1\r\n"
+               "Accept: text/html\r\n"
+               "X-Forwarded-For: 10.0.0.1\r\n"
+               "accept: */*\r\n"
+               "\r\n");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  const HttpRequest& request = context.request();
+  // every line is kept, the last one wins
+  BOOST_CHECK_EQUAL(request.headers().size(), 3);
+  BOOST_CHECK_EQUAL(request.headers().value(0).as_string(), string("text/html"));
+  BOOST_CHECK_EQUAL(request.getHeader("Accept"), string("*/*"));
+  BOOST_CHECK_EQUAL(request.headers().find("ACCEPT"), 2);
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestBadHeaders)
+{
+  const char* requests[] = {
+    "GET / HTTP/1.1\r\nno colon here\r\n\r\n",
+    "GET / HTTP/1.1\r\n: no field\r\n\r\n",
+    "GET / HTTP/1.1\r\nHost: bare\rcarriage\r\n\r\n",
+  };
+  for (size_t i = 0; i < sizeof requests / sizeof requests[0]; ++i)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(requests[i]);
+    BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  }
+
+  HttpContext context;
+  Buffer input;
+  input.append("GET / HTTP/1.1\r\n");
+  input.append(string(HttpContext::kMaxHeaderSize + 1, 'x'));
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+
+  // nor a whole one in one piece
+  HttpContext context2;
+  Buffer input2;
+  input2.append("GET / HTTP/1.1\r\nX-Big: ");
+  input2.append(string(HttpContext::kMaxHeaderSize, 'x'));
+  input2.append("\r\n\r\n");
+  BOOST_CHECK(!context2.parseRequest(&input2, Timestamp::now()));
+  BOOST_CHECK(!context2.gotAll());
+}
@@ -0,0 +1,129 @@
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/Buffer.h>
+
+//#define BOOST_TEST_MODULE HttpResponseTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/make_shared.hpp>
+
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::HttpResponse;
+
+BOOST_AUTO_TEST_CASE(testKeepAlive)
+{
+  HttpResponse response(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.setStatusMessage("OK");
+  response.setContentType("text/plain");
+  response.addHeader("Server", "Muduo");
+  response.setBody("hello, world!\n");
+
+  Buffer output;
+  response.appendToBuffer(&output);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    string("HTTP/1.1 200 OK\r\n"
+                           "Content-Length: 14\r\n"
+                           "Connection: Keep-Alive\r\n"
+                           "Content-Type: text/plain\r\n"
+                           "Server: Muduo\r\n"
+                           "\r\n"
+                           "hello, world!\n"));
+}
+
+BOOST_AUTO_TEST_CASE(testReplaceHeader)
+{
+  HttpResponse response(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.addHeader("Server", "Muduo");
+  response.setContentType("text/plain");
+  response.addHeader("Cache-Control", "no-cache");
+  // replaced in place, whatever the case
+  response.addHeader("content-type", "text/html; charset=utf-8");
+  response.addHeader("Server", "");
+  response.addHeader("Server", "Muduo/2");
+  BOOST_CHECK_EQUAL(response.header("Content-Type").as_string(),
+                    string("text/html; charset=utf-8"));
+
+  Buffer output;
+  response.appendToBuffer(&output);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    string("HTTP/1.1 200 OK\r\n"
+                           "Content-Length: 0\r\n"
+                           "Connection: Keep-Alive\r\n"
+                           "Server: Muduo/2\r\n"
+                           "Content-Type: text/html; charset=utf-8\r\n"
+                           "Cache-Control: no-cache\r\n"
+                           "\r\n"));
+}
+
+BOOST_AUTO_TEST_CASE(testStatusLine)
+{
+  Buffer output;
+  HttpResponse response(true);
+  response.setStatusCode(HttpResponse::k404NotFound);
+  response.appendToBuffer(&output);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    string("HTTP/1.1 404 Not Found\r\n"
+                           "Connection: close\r\n"
+                           "\r\n"));
+
+  response.reset(true);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.setStatusMessage("Fine");
+  response.appendToBuffer(&output);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    string("HTTP/1.1 200 Fine\r\n"
+                           "Connection: close\r\n"
+                           "\r\n"));
+}
+
+BOOST_AUTO_TEST_CASE(testBodyKinds)
+{
+  Buffer output;
+  HttpResponse response(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+
+  static const char kPage[] = "<html></html>";
+  response.setBodyRef(kPage);
+  BOOST_CHECK(response.body().data() == kPage);
+
+  boost::shared_ptr<const string> shared = boost::make_shared<string>(1000, 'x');
+  response.setBody(shared);
+  BOOST_CHECK(response.body().data() == shared->data());
+  HttpResponse copy(response);
+  BOOST_CHECK(copy.body().data() == shared->data());
+
+  response.setBody(string("copied"));
+  BOOST_CHECK_EQUAL(response.body().as_string(), string("copied"));
+
+  response.reset(false);
+  BOOST_CHECK(response.body().empty());
+  response.setStatusCode(HttpResponse::k204NoContent);
+  response.appendToBuffer(&output);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    string("HTTP/1.1 204 No Content\r\n"
+                           "Connection: Keep-Alive\r\n"
+                           "\r\n"));
+}
+
+BOOST_AUTO_TEST_CASE(testChunked)
+{
+  Buffer output;
+  HttpResponse response(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.setContentType("text/csv");
+  response.setChunked(true);
+  response.appendHeadersToBuffer(&output);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    string("HTTP/1.1 200 OK\r\n"
+                           "Connection: Keep-Alive\r\n"
+                           "Transfer-Encoding: chunked\r\n"
+                           "Content-Type: text/csv\r\n"
+                           "\r\n"));
+
+  response.reset(false);
+  BOOST_CHECK(!response.chunked());
+}
@@ -18,12 +18,11 @@ void onRequest(const HttpRequest& req, HttpResponse* resp)
   std::cout << "Headers " << req.methodString() << " " << req.path() << std::endl;
   if (!benchmark)
   {
-    const std::map<string, string>& headers = req.headers();
-    for (std::map<string, string>::const_iterator it = headers.begin();
-         it != headers.end();
-         ++it)
+    const HttpHeaders& headers = req.headers();
+    for (size_t i = 0; i < headers.size(); ++i)
     {
-      std::cout << it->first << ": " << it->second << std::endl;
+      std::cout << headers.field(i).as_string() << ": "
+                << headers.value(i).as_string() << std::endl;
     }
   }
 
@@ -73,6 +72,11 @@ int main(int argc, char* argv[])
   EventLoop loop;
   HttpServer server(&loop, InetAddress(8000), "dummy");
   server.setHttpCallback(onRequest);
+  HttpResponse health(false);
+  health.setStatusCode(HttpResponse::k200Ok);
+  health.setContentType("text/plain");
+  health.setBody("ok\n");
+  server.addStaticResponse("/health", health);
   server.setThreadNum(numThreads);
   server.start();
   loop.loop();
@@ -0,0 +1,399 @@
+#include <muduo/net/http/AsyncHttpResponse.h>
+#include <muduo/net/http/HttpServer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Thread.h>
+
+//#define BOOST_TEST_MODULE HttpServerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <boost/bind.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::AsyncHttpResponse;
+using muduo::net::AsyncHttpResponsePtr;
+using muduo::net::EventLoop;
+using muduo::net::HttpRequest;
+using muduo::net::HttpResponse;
+using muduo::net::HttpServer;
+using muduo::net::InetAddress;
+
+// Streamed responses of HttpServer, to a blocking client in another
+// thread which reads when it wants to.
+
+const uint16_t kPort = 18012;
+const int64_t kPaceTotal = 32 * 1024 * 1024;
+
+muduo::MutexLock g_mutex;
+AsyncHttpResponsePtr g_stream;  // of /endless and /stream
+AsyncHttpResponsePtr g_later;   // of /later
+bool g_earlyWritable = true;    // of /stream, before its turn
+
+// in the IO thread
+muduo::AtomicInt64 g_written;
+int g_writableCalls = 0;
+
+AsyncHttpResponsePtr get(const AsyncHttpResponsePtr& handle)
+{
+  muduo::MutexLockGuard lock(g_mutex);
+  return handle;
+}
+
+// writes until the client is behind, to kPaceTotal bytes for /pace
+void produce(const AsyncHttpResponsePtr& handle)
+{
+  ++g_writableCalls;
+  bool endless = handle->request().path() == "/endless";
+  static const string chunk(16 * 1024, 'x');
+  while (handle->writable() && (endless || g_written.get() < kPaceTotal))
+  {
+    if (!handle->write(chunk))
+    {
+      return;
+    }
+    if (g_written.addAndGet(chunk.size()) == kPaceTotal && !endless)
+    {
+      handle->done();
+    }
+  }
+}
+
+void onRequest(const AsyncHttpResponsePtr& handle)
+{
+  const string& path = handle->request().path();
+  handle->response()->setStatusCode(HttpResponse::k200Ok);
+  if (path == "/pace" || path == "/endless")
+  {
+    handle->startStream(boost::bind(produce, _1));
+    if (path == "/endless")
+    {
+      muduo::MutexLockGuard lock(g_mutex);
+      g_stream = handle;
+    }
+  }
+  else if (path == "/stream")
+  {
+    handle->startStream(AsyncHttpResponse::WritableCallback());
+    g_earlyWritable = handle->writable();
+    handle->write("early");
+    muduo::MutexLockGuard lock(g_mutex);
+    g_stream = handle;
+  }
+  else if (path == "/later")
+  {
+    muduo::MutexLockGuard lock(g_mutex);
+    g_later = handle;
+  }
+  else
+  {
+    handle->response()->setBody("hello");
+    handle->done();
+  }
+}
+
+int connectToServer(int rcvbuf)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (rcvbuf > 0)
+  {
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+  }
+  struct timeval timeout = { 10, 0 };
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0)
+  {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void sendAll(int fd, const string& data)
+{
+  size_t sent = 0;
+  while (sent < data.size())
+  {
+    ssize_t n = ::write(fd, data.data() + sent, data.size() - sent);
+    if (n <= 0)
+    {
+      return;
+    }
+    sent += n;
+  }
+}
+
+// until the server closes the connection
+string readAll(int fd)
+{
+  string data;
+  char buf[65536];
+  ssize_t n = 0;
+  while ((n = ::read(fd, buf, sizeof buf)) > 0)
+  {
+    data.append(buf, n);
+  }
+  return data;
+}
+
+// the body of the chunked response at offset, which is moved past it;
+// "?" if it is malformed
+string dechunk(const string& data, size_t* offset)
+{
+  string body;
+  size_t pos = data.find("\r\n\r\n", *offset);
+  if (pos == string::npos)
+  {
+    return "?";
+  }
+  pos += 4;
+  while (true)
+  {
+    size_t crlf = data.find("\r\n", pos);
+    if (crlf == string::npos)
+    {
+      return "?";
+    }
+    size_t size = strtoul(data.c_str() + pos, NULL, 16);
+    pos = crlf + 2;
+    if (size == 0)
+    {
+      *offset = pos + 2;  // no trailers
+      return body;
+    }
+    if (pos + size + 2 > data.size())
+    {
+      return "?";
+    }
+    body.append(data, pos, size);
+    pos += size + 2;
+  }
+}
+
+void sleepMs(int ms)
+{
+  ::usleep(ms * 1000);
+}
+
+struct Fixture
+{
+  Fixture()
+    : server(&loop, InetAddress(kPort), "HttpServerTest")
+  {
+    muduo::Logger::setLogLevel(muduo::Logger::WARN);
+    g_written.getAndSet(0);
+    g_writableCalls = 0;
+    g_earlyWritable = true;
+    server.setAsyncHttpCallback(onRequest);
+    server.start();
+  }
+
+  ~Fixture()
+  {
+    muduo::MutexLockGuard lock(g_mutex);
+    g_stream.reset();
+    g_later.reset();
+  }
+
+  // runs the loop until client returns
+  void run(const muduo::Thread::ThreadFunc& client)
+  {
+    muduo::Thread thread(boost::bind(&Fixture::runClient, this, client));
+    thread.start();
+    loop.loop();
+    thread.join();
+  }
+
+  void runClient(const muduo::Thread::ThreadFunc& client)
+  {
+    client();
+    // lets the connections be destroyed
+    loop.runAfter(0.1, boost::bind(&EventLoop::quit, &loop));
+  }
+
+  EventLoop loop;
+  HttpServer server;
+};
+
+struct PaceResult
+{
+  int64_t writtenWhileStalled;
+  string response;
+};
+
+void paceClient(PaceResult* result)
+{
+  int fd = connectToServer(4096);
+  sendAll(fd, "GET /pace HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n");
+  sleepMs(500);
+  result->writtenWhileStalled = g_written.get();
+  result->response = readAll(fd);
+  ::close(fd);
+}
+
+BOOST_AUTO_TEST_CASE(testStreamPacing)
+{
+  Fixture f;
+  PaceResult result;
+  f.run(boost::bind(paceClient, &result));
+
+  // the producer waits for the client, all written is still sent
+  BOOST_CHECK_GT(result.writtenWhileStalled, 0);
+  BOOST_CHECK_LT(result.writtenWhileStalled, kPaceTotal / 2);
+  BOOST_CHECK_GT(g_writableCalls, 1);
+  BOOST_CHECK_EQUAL(result.response.find("HTTP/1.1 200 OK\r\n"), 0u);
+  BOOST_CHECK(result.response.find("Transfer-Encoding: chunked\r\n") != string::npos);
+  size_t offset = 0;
+  string body = dechunk(result.response, &offset);
+  BOOST_CHECK_EQUAL(body.size(), static_cast<size_t>(kPaceTotal));
+  BOOST_CHECK_EQUAL(offset, result.response.size());
+}
+
+struct AbortResult
+{
+  bool writeFailed;
+  bool writable;
+};
+
+void abortClient(AbortResult* result)
+{
+  int fd = connectToServer(4096);
+  sendAll(fd, "GET /endless HTTP/1.1\r\nHost: test\r\n\r\n");
+  char buf[1024];
+  ::read(fd, buf, sizeof buf);
+  ::close(fd);
+
+  result->writeFailed = false;
+  AsyncHttpResponsePtr stream(get(g_stream));
+  for (int i = 0; stream && i < 500 && !result->writeFailed; ++i)
+  {
+    sleepMs(10);
+    result->writeFailed = !stream->write("late");
+  }
+  result->writable = stream && stream->writable();
+  if (stream)
+  {
+    // a no-op for the connection, which is gone
+    stream->done();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testClientGoneMidStream)
+{
+  Fixture f;
+  AbortResult result = { false, false };
+  f.run(boost::bind(abortClient, &result));
+
+  BOOST_CHECK(result.writeFailed);
+  // so a producer waiting for writable() gets to a failing write()
+  BOOST_CHECK(result.writable);
+  int64_t written = g_written.get();
+  BOOST_CHECK_GT(written, 0);
+  BOOST_CHECK_LT(written, kPaceTotal);
+}
+
+struct PipelineResult
+{
+  bool writableBeforeTurn;
+  string response;
+};
+
+void pipelineClient(PipelineResult* result)
+{
+  int fd = connectToServer(0);
+  // the stream queued behind a response not done yet,
+  // and a response done at once queued behind the stream
+  sendAll(fd, "GET /later HTTP/1.1\r\nHost: test\r\n\r\n"
+              "GET /stream HTTP/1.1\r\nHost: test\r\n\r\n"
+              "GET /hello HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n");
+  AsyncHttpResponsePtr later;
+  AsyncHttpResponsePtr stream;
+  for (int i = 0; i < 500 && !(later && stream); ++i)
+  {
+    sleepMs(10);
+    later = get(g_later);
+    stream = get(g_stream);
+  }
+  if (later && stream)
+  {
+    sleepMs(100);
+    result->writableBeforeTurn = stream->writable();
+    later->response()->setBody("later");
+    later->done();
+    sleepMs(100);
+    stream->write("late");
+    stream->done();
+  }
+  result->response = readAll(fd);
+  ::close(fd);
+}
+
+BOOST_AUTO_TEST_CASE(testPipelinedBehindStream)
+{
+  Fixture f;
+  PipelineResult result = { true, string() };
+  f.run(boost::bind(pipelineClient, &result));
+
+  BOOST_CHECK(!g_earlyWritable);
+  BOOST_CHECK(!result.writableBeforeTurn);
+  const string& response = result.response;
+  size_t later = response.find("\r\n\r\nlater");
+  BOOST_REQUIRE(later != string::npos);
+  size_t offset = later + 9;
+  BOOST_CHECK_EQUAL(dechunk(response, &offset), "earlylate");
+  BOOST_CHECK_EQUAL(response.find("HTTP/1.1 200 OK\r\n", offset), offset);
+  BOOST_CHECK_EQUAL(response.substr(response.size() - 9), "\r\n\r\nhello");
+}
+
+struct LateResult
+{
+  int fd;
+  AsyncHttpResponsePtr later;
+  AsyncHttpResponsePtr stream;
+};
+
+// keeps the connection open, with a response and a stream not done
+void lateClient(LateResult* result)
+{
+  result->fd = connectToServer(0);
+  sendAll(result->fd, "GET /later HTTP/1.1\r\nHost: test\r\n\r\n"
+                      "GET /stream HTTP/1.1\r\nHost: test\r\n\r\n");
+  for (int i = 0; i < 500 && !(result->later && result->stream); ++i)
+  {
+    sleepMs(10);
+    result->later = get(g_later);
+    result->stream = get(g_stream);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testHandleOutlivesServer)
+{
+  LateResult result = { -1, AsyncHttpResponsePtr(), AsyncHttpResponsePtr() };
+  {
+    Fixture f;
+    f.run(boost::bind(lateClient, &result));
+  }
+  BOOST_REQUIRE(result.later && result.stream);
+  // the server and its loop are gone, these are no-ops
+  BOOST_CHECK(!result.stream->write("late"));
+  result.stream->done();
+  result.later->response()->setBody("later");
+  result.later->done();
+  BOOST_CHECK_EQUAL(readAll(result.fd), "");
+  ::close(result.fd);
+}
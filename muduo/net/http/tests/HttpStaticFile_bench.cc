@@ -0,0 +1,149 @@
+#include <muduo/net/http/HttpServer.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/base/FileUtil.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Keep-alive GETs of files served from a string body read per request,
+// and from addStaticDirectory(), which uses sendfile for larger ones.
+
+const uint16_t kPort = 18003;
+string g_dir;
+
+void onRequest(const HttpRequest& req, HttpResponse* resp)
+{
+  const string& path = req.path();
+  if (path.compare(0, 8, "/string/") == 0)
+  {
+    string content;
+    if (FileUtil::readFile(g_dir + path.substr(7), 1 << 30, &content) == 0)
+    {
+      resp->setStatusCode(HttpResponse::k200Ok);
+      resp->setBody(content);
+      return;
+    }
+  }
+  resp->setStatusCode(HttpResponse::k404NotFound);
+}
+
+void writeFile(const string& name, size_t size)
+{
+  string content(size, 'x');
+  FILE* fp = ::fopen((g_dir + name).c_str(), "w");
+  if (!fp || ::fwrite(content.data(), 1, size, fp) != size)
+    abort();
+  ::fclose(fp);
+}
+
+// returns the body size
+size_t get(int sockfd, const string& path, char* buf, size_t bufSize)
+{
+  string request = "GET " + path + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+  if (::write(sockfd, request.data(), request.size()) != static_cast<ssize_t>(request.size()))
+    abort();
+
+  size_t got = 0;
+  const char* headerEnd = NULL;
+  while (!headerEnd)
+  {
+    ssize_t n = ::read(sockfd, buf + got, bufSize - got);
+    if (n <= 0)
+      abort();
+    got += n;
+    headerEnd = static_cast<const char*>(memmem(buf, got, "\r\n\r\n", 4));
+  }
+  const char* length = static_cast<const char*>(memmem(buf, headerEnd - buf, "Content-Length: ", 16));
+  if (!length || memcmp(buf, "HTTP/1.1 200", 12) != 0)
+    abort();
+  size_t bodySize = atol(length + 16);
+  size_t remaining = bodySize - (got - (headerEnd + 4 - buf));
+  while (remaining > 0)
+  {
+    ssize_t n = ::read(sockfd, buf, std::min(remaining, bufSize));
+    if (n <= 0)
+      abort();
+    remaining -= n;
+  }
+  return bodySize;
+}
+
+void bench(const char* name, const string& path, int n)
+{
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(sockfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) != 0)
+    abort();
+
+  static char buf[256 * 1024];
+  Timestamp start(Timestamp::now());
+  size_t bytes = 0;
+  for (int i = 0; i < n; ++i)
+  {
+    bytes += get(sockfd, path, buf, sizeof buf);
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("%-24s %8.0f requests/s %8.1f MiB/s\n", name,
+         n / seconds, static_cast<double>(bytes) / seconds / 1024 / 1024);
+  ::close(sockfd);
+}
+
+void runClient(EventLoop* loop, int n)
+{
+  bench("4KiB, string body", "/string/small", n);
+  bench("4KiB, static directory", "/static/small", n);
+  bench("64KiB, string body", "/string/medium", n / 10);
+  bench("64KiB, static directory", "/static/medium", n / 10);
+  bench("64MiB, string body", "/string/large", n / 1000 + 1);
+  bench("64MiB, static directory", "/static/large", n / 1000 + 1);
+  loop->quit();
+}
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 20000;
+  char dir[] = "/tmp/httpfilebenchXXXXXX";
+  if (!::mkdtemp(dir))
+    abort();
+  g_dir = dir;
+  writeFile("/small", 4 * 1024);
+  writeFile("/medium", 64 * 1024);
+  writeFile("/large", 64 * 1024 * 1024);
+
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort), "bench");
+  server.setHttpCallback(onRequest);
+  server.addStaticDirectory("/static/", g_dir);
+  server.start();
+
+  Thread client(boost::bind(runClient, &loop, n), "client");
+  client.start();
+  loop.loop();
+  client.join();
+
+  ::unlink((g_dir + "/small").c_str());
+  ::unlink((g_dir + "/medium").c_str());
+  ::unlink((g_dir + "/large").c_str());
+  ::rmdir(dir);
+}
@@ -0,0 +1,113 @@
+#include <muduo/net/http/WebSocket.h>
+#include <muduo/net/http/WebSocketContext.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/base/Timestamp.h>
+
+#include <vector>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Parses masked client frames of several sizes, unmasking included,
+// and encodes one broadcast frame against one per recipient.
+
+void appendClientFrame(Buffer* buf, const string& payload)
+{
+  const char key[4] = { 0x12, 0x34, 0x56, 0x78 };
+  buf->appendInt8(static_cast<int8_t>(0x82));
+  if (payload.size() < 126)
+  {
+    buf->appendInt8(static_cast<int8_t>(0x80 | payload.size()));
+  }
+  else if (payload.size() <= 0xFFFF)
+  {
+    buf->appendInt8(static_cast<int8_t>(0x80 | 126));
+    buf->appendInt16(static_cast<int16_t>(payload.size()));
+  }
+  else
+  {
+    buf->appendInt8(static_cast<int8_t>(0x80 | 127));
+    buf->appendInt64(static_cast<int64_t>(payload.size()));
+  }
+  buf->append(key, 4);
+  string masked(payload);
+  for (size_t i = 0; i < masked.size(); ++i)
+  {
+    masked[i] ^= key[i % 4];
+  }
+  buf->append(masked);
+}
+
+void benchParse(size_t frameSize)
+{
+  const size_t kTotal = 256 * 1024 * 1024;
+  const int frames = static_cast<int>(kTotal / frameSize);
+  Buffer one;
+  appendClientFrame(&one, string(frameSize, 'x'));
+  string bytes = one.retrieveAllAsString();
+
+  WebSocketContext context(frameSize);
+  Buffer buf;
+  int messages = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < frames; ++i)
+  {
+    buf.append(bytes);
+    while (context.parse(&buf) == WebSocketContext::kMessage)
+    {
+      ++messages;
+      context.clearMessage();
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("parse %6zu-byte frames: %8.0f frames/s %7.1f MB/s\n",
+         frameSize, messages / seconds, static_cast<double>(kTotal) / seconds / 1e6);
+}
+
+void benchBroadcast(int recipients)
+{
+  const string payload(200, 'b');
+  const int kRounds = 100;
+  size_t bytes = 0;
+  // what each recipient is handed, as queued by send()
+  std::vector<WebSocketConnection::Frame> shared(recipients);
+  std::vector<string> copies(recipients);
+
+  Timestamp start(Timestamp::now());
+  for (int round = 0; round < kRounds; ++round)
+  {
+    WebSocketConnection::Frame frame(
+        WebSocketConnection::makeFrame(WebSocketConnection::kText, payload));
+    for (int i = 0; i < recipients; ++i)
+    {
+      shared[i] = frame;
+      bytes += shared[i]->size();
+    }
+  }
+  double once = timeDifference(Timestamp::now(), start);
+
+  start = Timestamp::now();
+  for (int round = 0; round < kRounds; ++round)
+  {
+    for (int i = 0; i < recipients; ++i)
+    {
+      Buffer buf;
+      WebSocketConnection::appendFrame(WebSocketConnection::kText, payload, &buf);
+      copies[i] = buf.retrieveAllAsString();
+      bytes += copies[i].size();
+    }
+  }
+  double each = timeDifference(Timestamp::now(), start);
+  printf("broadcast to %d: %.3f ms encoded once, %.3f ms encoded for each (%zu bytes)\n",
+         recipients, once * 1e3 / kRounds, each * 1e3 / kRounds, bytes);
+}
+
+int main()
+{
+  benchParse(64);
+  benchParse(1024);
+  benchParse(64 * 1024);
+  benchBroadcast(100000);
+}
@@ -0,0 +1,186 @@
+#include <muduo/net/http/WebSocket.h>
+#include <muduo/net/http/WebSocketContext.h>
+#include <muduo/net/Buffer.h>
+
+//#define BOOST_TEST_MODULE WebSocketTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::WebSocketConnection;
+using muduo::net::WebSocketContext;
+
+// a masked frame, as a client sends it
+void appendClientFrame(Buffer* buf, int opcode, const string& payload, bool fin = true)
+{
+  const char key[4] = { 0x37, static_cast<char>(0xfa), 0x21, 0x3d };
+  buf->appendInt8(static_cast<int8_t>((fin ? 0x80 : 0) | opcode));
+  if (payload.size() < 126)
+  {
+    buf->appendInt8(static_cast<int8_t>(0x80 | payload.size()));
+  }
+  else if (payload.size() <= 0xFFFF)
+  {
+    buf->appendInt8(static_cast<int8_t>(0x80 | 126));
+    buf->appendInt16(static_cast<int16_t>(payload.size()));
+  }
+  else
+  {
+    buf->appendInt8(static_cast<int8_t>(0x80 | 127));
+    buf->appendInt64(static_cast<int64_t>(payload.size()));
+  }
+  buf->append(key, 4);
+  string masked(payload);
+  for (size_t i = 0; i < masked.size(); ++i)
+  {
+    masked[i] ^= key[i % 4];
+  }
+  buf->append(masked);
+}
+
+BOOST_AUTO_TEST_CASE(testAcceptKey)
+{
+  // RFC 6455 section 1.3
+  BOOST_CHECK_EQUAL(WebSocketConnection::acceptKey("dGhlIHNhbXBsZSBub25jZQ=="),
+                    "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+BOOST_AUTO_TEST_CASE(testUnmask)
+{
+  const char key[4] = { 1, 2, 3, 4 };
+  for (size_t len = 0; len < 100; ++len)
+  {
+    string data(len, 'x');
+    string expected(data);
+    for (size_t i = 0; i < len; ++i)
+    {
+      expected[i] ^= key[i % 4];
+    }
+    if (len > 0)
+    {
+      WebSocketContext::unmask(&data[0], len, key);
+    }
+    BOOST_CHECK(data == expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testMessages)
+{
+  WebSocketContext context(1 << 20);
+  Buffer buf;
+  appendClientFrame(&buf, 0x1, "Hello");
+  string large(70000, 'y');
+  large[12345] = 'z';
+  appendClientFrame(&buf, 0x2, large);
+
+  BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kMessage);
+  BOOST_CHECK_EQUAL(context.message(), "Hello");
+  BOOST_CHECK(!context.binary());
+  context.clearMessage();
+
+  BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kMessage);
+  BOOST_CHECK(context.message() == large);
+  BOOST_CHECK(context.binary());
+  context.clearMessage();
+  BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kNeedMore);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(testPartialFrame)
+{
+  WebSocketContext context(1 << 20);
+  Buffer frame;
+  appendClientFrame(&frame, 0x1, string(300, 'a'));
+  string bytes = frame.retrieveAllAsString();
+
+  Buffer buf;
+  for (size_t i = 0; i + 1 < bytes.size(); ++i)
+  {
+    buf.append(&bytes[i], 1);
+    BOOST_REQUIRE_EQUAL(context.parse(&buf), WebSocketContext::kNeedMore);
+  }
+  buf.append(&bytes[bytes.size() - 1], 1);
+  BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kMessage);
+  BOOST_CHECK_EQUAL(context.message(), string(300, 'a'));
+}
+
+BOOST_AUTO_TEST_CASE(testFragments)
+{
+  WebSocketContext context(1 << 20);
+  Buffer buf;
+  appendClientFrame(&buf, 0x1, "Hel", false);
+  appendClientFrame(&buf, 0x9, "ping");  // control frames may come in between
+  appendClientFrame(&buf, 0x0, "lo, ", false);
+  appendClientFrame(&buf, 0x0, "world");
+  appendClientFrame(&buf, 0x8, string("\x03\xe8" "bye", 5));
+
+  BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kPing);
+  BOOST_CHECK_EQUAL(context.control(), "ping");
+  BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kMessage);
+  BOOST_CHECK_EQUAL(context.message(), "Hello, world");
+  context.clearMessage();
+  BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kClose);
+  BOOST_CHECK_EQUAL(context.closeCode(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(testErrors)
+{
+  {
+    // not masked
+    WebSocketContext context(1 << 20);
+    Buffer buf;
+    buf.append("\x81\x02hi", 4);
+    BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kError);
+    BOOST_CHECK_EQUAL(context.closeCode(), 1002);
+  }
+  {
+    // continuation of nothing
+    WebSocketContext context(1 << 20);
+    Buffer buf;
+    appendClientFrame(&buf, 0x0, "x");
+    BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kError);
+  }
+  {
+    // a new message inside a fragmented one
+    WebSocketContext context(1 << 20);
+    Buffer buf;
+    appendClientFrame(&buf, 0x1, "x", false);
+    appendClientFrame(&buf, 0x1, "y");
+    BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kError);
+  }
+  {
+    // fragmented control frame
+    WebSocketContext context(1 << 20);
+    Buffer buf;
+    appendClientFrame(&buf, 0x9, "x", false);
+    BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kError);
+  }
+  {
+    // too big, known from the header alone
+    WebSocketContext context(1000);
+    Buffer buf;
+    appendClientFrame(&buf, 0x1, string(600, 'x'), false);
+    appendClientFrame(&buf, 0x0, string(600, 'x'));
+    string bytes = buf.retrieveAllAsString();
+    buf.append(bytes.data(), bytes.size() - 300);
+    BOOST_CHECK_EQUAL(context.parse(&buf), WebSocketContext::kError);
+    BOOST_CHECK_EQUAL(context.closeCode(), 1009);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testServerFrame)
+{
+  Buffer buf;
+  WebSocketConnection::appendFrame(WebSocketConnection::kText, "Hello", &buf);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string("\x81\x05Hello"));
+
+  WebSocketConnection::Frame frame =
+      WebSocketConnection::makeFrame(WebSocketConnection::kBinary, string(256, 'b'));
+  BOOST_CHECK_EQUAL(frame->size(), 4u + 256);
+  BOOST_CHECK_EQUAL(frame->substr(0, 4), string("\x82\x7e\x01\x00", 4));
+
+  frame = WebSocketConnection::makeFrame(WebSocketConnection::kBinary, string(70000, 'b'));
+  BOOST_CHECK_EQUAL(frame->substr(0, 10), string("\x82\x7f\0\0\0\0\0\x01\x11\x70", 10));
+}
@@ -17,6 +17,7 @@
 #include <muduo/net/inspect/ProcessInspector.h>
 #include <muduo/net/inspect/PerformanceInspector.h>
 #include <muduo/net/inspect/SystemInspector.h>
+#include <muduo/net/inspect/LogInspector.h>
 
 //#include <iostream>
 //#include <iterator>
@@ -65,7 +66,9 @@ Inspector::Inspector(EventLoop* loop,
                      const string& name)
     : server_(loop, httpAddr, "Inspector:"+name),
       processInspector_(new ProcessInspector),
-      systemInspector_(new SystemInspector)
+      performanceInspector_(new PerformanceInspector),
+      systemInspector_(new SystemInspector),
+      logInspector_(new LogInspector)
 {
   assert(CurrentThread::isMainThread());  //߳
   assert(g_globalInspector == 0);	
@@ -75,10 +78,8 @@ Inspector::Inspector(EventLoop* loop,
   //ע
   processInspector_->registerCommands(this);
   systemInspector_->registerCommands(this);
-#ifdef HAVE_TCMALLOC
-  performanceInspector_.reset(new PerformanceInspector);
+  logInspector_->registerCommands(this);
   performanceInspector_->registerCommands(this);
-#endif
 	
   // Ϊ˷ֹ̬
   // ֱӵstartǰ̲߳loopIỌ̣߳߳ôпܣǰ캯ûأ
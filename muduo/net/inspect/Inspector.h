@@ -28,6 +28,7 @@ namespace net
 class ProcessInspector;
 class PerformanceInspector;
 class SystemInspector;
+class LogInspector;
 
 // An internal inspector of the running process, usually a singleton.
 // Better to run in a separated thread, as some method may block for seconds
@@ -59,6 +60,7 @@ class Inspector : boost::noncopyable
   boost::scoped_ptr<ProcessInspector> processInspector_;  //һ̼
   boost::scoped_ptr<PerformanceInspector> performanceInspector_;
   boost::scoped_ptr<SystemInspector> systemInspector_;
+  boost::scoped_ptr<LogInspector> logInspector_;
   MutexLock mutex_;
   std::map<string, CommandList> modules_;  //ģӦ
   std::map<string, HelpList> helps_;	//ģӦİ
@@ -0,0 +1,96 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/inspect/LogInspector.h>
+#include <muduo/base/Logging.h>
+
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const char* kLevelNames[Logger::NUM_LOG_LEVELS] =
+{
+  "TRACE",
+  "DEBUG",
+  "INFO",
+  "WARN",
+  "ERROR",
+  "FATAL",
+};
+
+bool parseLevel(const string& name, Logger::LogLevel* level)
+{
+  for (int i = 0; i < Logger::NUM_LOG_LEVELS; ++i)
+  {
+    if (::strcasecmp(name.c_str(), kLevelNames[i]) == 0)
+    {
+      *level = static_cast<Logger::LogLevel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+string listLevels()
+{
+  string result = "global ";
+  result += kLevelNames[Logger::logLevel()];
+  result += "\n";
+  Logger::ModuleLogLevelList modules = Logger::moduleLogLevels();
+  for (Logger::ModuleLogLevelList::const_iterator it = modules.begin();
+       it != modules.end();
+       ++it)
+  {
+    result += it->first;
+    result += " ";
+    result += kLevelNames[it->second];
+    result += "\n";
+  }
+  return result;
+}
+
+}
+
+void LogInspector::registerCommands(Inspector* ins)
+{
+  ins->add("log", "level", LogInspector::level,
+           "get or set log level, /log/level/[module/]LEVEL");
+}
+
+string LogInspector::level(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  Logger::LogLevel level = Logger::INFO;
+  if (args.size() == 1)
+  {
+    if (!parseLevel(args[0], &level))
+    {
+      return "Unknown log level " + args[0] + "\n";
+    }
+    Logger::setLogLevel(level);
+  }
+  else if (args.size() == 2)
+  {
+    const string& module = args[0];
+    if (args[1] == "default")
+    {
+      Logger::resetModuleLogLevel(module);
+    }
+    else if (!parseLevel(args[1], &level))
+    {
+      return "Unknown log level " + args[1] + "\n";
+    }
+    else if (!Logger::setModuleLogLevel(module, level))
+    {
+      return "Can not set log level of " + module + "\n";
+    }
+  }
+  else if (args.size() > 2)
+  {
+    return "Usage: /log/level/[module/]LEVEL\n";
+  }
+  return listLevels();
+}
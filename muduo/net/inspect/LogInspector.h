@@ -0,0 +1,32 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_INSPECT_LOGINSPECTOR_H
+#define MUDUO_NET_INSPECT_LOGINSPECTOR_H
+
+#include <muduo/net/inspect/Inspector.h>
+#include <boost/noncopyable.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class LogInspector : boost::noncopyable
+{
+ public:
+  void registerCommands(Inspector* ins);
+
+  // /log/level                      list global and per-module levels
+  // /log/level/<LEVEL>              set global level
+  // /log/level/<module>/<LEVEL>     set level of module
+  // /log/level/<module>/default     remove override of module
+  static string level(HttpRequest::Method, const Inspector::ArgList&);
+};
+
+}
+}
+
+#endif  // MUDUO_NET_INSPECT_LOGINSPECTOR_H
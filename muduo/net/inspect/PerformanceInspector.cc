@@ -9,12 +9,14 @@
 
 #include <muduo/net/inspect/PerformanceInspector.h>
 #include <muduo/base/FileUtil.h>
+#include <muduo/base/LatencyHistogram.h>
 #include <muduo/base/LogStream.h>
 #include <muduo/base/ProcessInfo.h>
 
 #ifdef HAVE_TCMALLOC
 #include <gperftools/malloc_extension.h>
 #include <gperftools/profiler.h>
+#endif
 
 using namespace muduo;
 using namespace muduo::net;
@@ -22,6 +24,9 @@ using namespace muduo::net;
 //ע
 void PerformanceInspector::registerCommands(Inspector* ins)
 {
+  ins->add("perf", "latency", PerformanceInspector::latency,
+           "print latency histograms, /perf/latency/[name[/reset]]");
+#ifdef HAVE_TCMALLOC
   ins->add("pprof", "heap", PerformanceInspector::heap, "get heap information");
   ins->add("pprof", "growth", PerformanceInspector::growth, "get heap growth information");
   ins->add("pprof", "profile", PerformanceInspector::profile,
@@ -30,8 +35,18 @@ void PerformanceInspector::registerCommands(Inspector* ins)
   ins->add("pprof", "memstats", PerformanceInspector::memstats, "get memory stats");
   ins->add("pprof", "memhistogram", PerformanceInspector::memhistogram, "get memory histogram");
   ins->add("pprof", "releasefreememory", PerformanceInspector::releaseFreeMemory, "release free memory");
+#endif
+}
+
+string PerformanceInspector::latency(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  string name = args.empty() ? "" : args[0];
+  bool reset = args.size() > 1 && args[1] == "reset";
+  return LatencyHistogram::dumpAll(name, reset);
 }
 
+#ifdef HAVE_TCMALLOC
+
 string PerformanceInspector::heap(HttpRequest::Method, const Inspector::ArgList&)
 {
   std::string result;
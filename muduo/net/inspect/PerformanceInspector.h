@@ -24,6 +24,8 @@ class PerformanceInspector : boost::noncopyable
  public:
   void registerCommands(Inspector* ins);
 
+  static string latency(HttpRequest::Method, const Inspector::ArgList&);
+
   static string heap(HttpRequest::Method, const Inspector::ArgList&);
   static string growth(HttpRequest::Method, const Inspector::ArgList&);
   static string profile(HttpRequest::Method, const Inspector::ArgList&);
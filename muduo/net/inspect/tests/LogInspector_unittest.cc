@@ -0,0 +1,42 @@
+#undef NDEBUG
+#include <muduo/net/inspect/LogInspector.h>
+#include <muduo/base/Logging.h>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+string level(const char* a = NULL, const char* b = NULL, const char* c = NULL)
+{
+  Inspector::ArgList args;
+  if (a) args.push_back(a);
+  if (b) args.push_back(b);
+  if (c) args.push_back(c);
+  return LogInspector::level(HttpRequest::kGet, args);
+}
+
+int main()
+{
+  assert(level("warn") == "global WARN\n");
+  assert(Logger::logLevel() == Logger::WARN);
+
+  assert(level("TcpConnection", "DEBUG") == "global WARN\nTcpConnection DEBUG\n");
+  assert(Logger::logLevel(Logger::SourceFile("TcpConnection.cc")) == Logger::DEBUG);
+  assert(Logger::logLevel(Logger::SourceFile("TcpServer.cc")) == Logger::WARN);
+  assert(level() == "global WARN\nTcpConnection DEBUG\n");
+
+  assert(level("TcpConnection", "default") == "global WARN\n");
+  assert(Logger::logLevel(Logger::SourceFile("TcpConnection.cc")) == Logger::WARN);
+  assert(level("NoSuchModule", "default") == "global WARN\n");
+
+  assert(level("LOUD") == "Unknown log level LOUD\n");
+  assert(level("Tcp", "LOUD") == "Unknown log level LOUD\n");
+  assert(level(string(40, 'x').c_str(), "INFO")
+         == "Can not set log level of " + string(40, 'x') + "\n");
+  assert(level("a", "b", "c") == "Usage: /log/level/[module/]LEVEL\n");
+  assert(Logger::moduleLogLevels().empty());
+  assert(Logger::logLevel() == Logger::WARN);
+  printf("all tests passed\n");
+}
@@ -9,6 +9,7 @@
 #include <muduo/net/protobuf/ProtobufCodecLite.h>
 // #include <muduo/net/protobuf/BufferStream.h>
 
+#include <muduo/base/Crc32c.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/Endian.h>
 #include <muduo/net/TcpConnection.h>
@@ -17,6 +18,8 @@
 #include <google/protobuf/message.h>
 #include <zlib.h>
 
+#include <limits.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -41,15 +44,21 @@ void ProtobufCodecLite::send(const TcpConnectionPtr& conn,
 
 void ProtobufCodecLite::fillEmptyBuffer(muduo::net::Buffer* buf,
                                         const google::protobuf::Message& message)
+{
+  fillEmptyBuffer(buf, message, checksumType_);
+}
+
+void ProtobufCodecLite::fillEmptyBuffer(muduo::net::Buffer* buf,
+                                        const google::protobuf::Message& message,
+                                        ChecksumType type)
 {
   assert(buf->readableBytes() == 0);
   // FIXME: can we move serialization & checksum to other thread?
-  buf->append(tag_);
+  appendTag(buf, tag_, type);
 
   int byte_size = serializeToBuffer(message, buf);
 
-  int32_t checkSum = checksum(buf->peek(), static_cast<int>(buf->readableBytes()));
-  buf->appendInt32(checkSum);
+  appendChecksum(buf, type);
   assert(buf->readableBytes() == tag_.size() + byte_size + kChecksumLen); (void) byte_size;
   int32_t len = sockets::hostToNetwork32(static_cast<int32_t>(buf->readableBytes()));
   buf->prepend(&len, sizeof len);
@@ -101,6 +110,20 @@ bool ProtobufCodecLite::parseFromBuffer(StringPiece buf, google::protobuf::Messa
   return message->ParseFromArray(buf.data(), buf.size());
 }
 
+int ProtobufCodecLite::byteSize(const google::protobuf::Message& message)
+{
+#if GOOGLE_PROTOBUF_VERSION >= 3001000
+  size_t size = message.ByteSizeLong();
+  if (size > static_cast<size_t>(INT_MAX))
+  {
+    LOG_FATAL << message.GetTypeName() << " of " << size << " bytes is too large";
+  }
+  return static_cast<int>(size);
+#else
+  return message.ByteSize();
+#endif
+}
+
 int ProtobufCodecLite::serializeToBuffer(const google::protobuf::Message& message, Buffer* buf)
 {
   // TODO: use BufferOutputStream
@@ -111,14 +134,14 @@ int ProtobufCodecLite::serializeToBuffer(const google::protobuf::Message& messag
   // code copied from MessageLite::SerializeToArray() and MessageLite::SerializePartialToArray().
   GOOGLE_DCHECK(message.IsInitialized()) << InitializationErrorMessage("serialize", message);
 
-  int byte_size = message.ByteSize();
+  int byte_size = byteSize(message);
   buf->ensureWritableBytes(byte_size + kChecksumLen);
 
   uint8_t* start = reinterpret_cast<uint8_t*>(buf->beginWrite());
   uint8_t* end = message.SerializeWithCachedSizesToArray(start);
   if (end - start != byte_size)
   {
-    ByteSizeConsistencyError(byte_size, message.ByteSize(), static_cast<int>(end - start));
+    ByteSizeConsistencyError(byte_size, byteSize(message), static_cast<int>(end - start));
   }
   buf->hasWritten(byte_size);
   return byte_size;
@@ -189,36 +212,107 @@ bool ProtobufCodecLite::validateChecksum(const char* buf, int len)
   return checkSum == expectedCheckSum;
 }
 
-ProtobufCodecLite::ErrorCode ProtobufCodecLite::parse(const char* buf,
-                                                      int len,
-                                                      ::google::protobuf::Message* message)
+namespace
+{
+  const char kCrc32cTag = 'C';
+  const char kNoChecksumTag = 'N';
+}
+
+int32_t ProtobufCodecLite::checksum(ChecksumType type, const void* buf, int len)
 {
-  ErrorCode error = kNoError;
+  switch (type)
+  {
+   case kCrc32c:
+     return static_cast<int32_t>(Crc32c::value(buf, len));
+   case kNoChecksum:
+     return 0;
+   default:
+     return checksum(buf, len);
+  }
+}
 
-  if (validateChecksum(buf, len))
+void ProtobufCodecLite::appendTag(Buffer* buf, StringPiece tag, ChecksumType type)
+{
+  if (type == kAdler32)
+  {
+    buf->append(tag.data(), tag.size());
+  }
+  else
   {
-    if (memcmp(buf, tag_.data(), tag_.size()) == 0)
+    assert(!tag.empty());
+    buf->append(tag.data(), tag.size() - 1);
+    buf->append(type == kCrc32c ? &kCrc32cTag : &kNoChecksumTag, 1);
+  }
+}
+
+void ProtobufCodecLite::appendChecksum(Buffer* buf, ChecksumType type)
+{
+  buf->appendInt32(checksum(type, buf->peek(), static_cast<int>(buf->readableBytes())));
+}
+
+ProtobufCodecLite::ErrorCode ProtobufCodecLite::validateFrame(StringPiece tag,
+                                                              const char* buf,
+                                                              int len,
+                                                              bool allowNoChecksum,
+                                                              ChecksumType* type)
+{
+  if (len < tag.size() + kChecksumLen)
+  {
+    return kInvalidLength;
+  }
+  if (tag.empty())
+  {
+    *type = kAdler32;
+  }
+  else if (memcmp(buf, tag.data(), tag.size() - 1) != 0)
+  {
+    return kUnknownMessageType;
+  }
+  else
+  {
+    const char last = buf[tag.size() - 1];
+    if (last == tag[tag.size() - 1])
     {
-      // parse from buffer
-      const char* data = buf + tag_.size();
-      int32_t dataLen = len - kChecksumLen - static_cast<int>(tag_.size());
-      if (parseFromBuffer(StringPiece(data, dataLen), message))
-      {
-        error = kNoError;
-      }
-      else
-      {
-        error = kParseError;
-      }
+      *type = kAdler32;
+    }
+    else if (last == kCrc32cTag)
+    {
+      *type = kCrc32c;
+    }
+    else if (last == kNoChecksumTag)
+    {
+      *type = kNoChecksum;
     }
     else
     {
-      error = kUnknownMessageType;
+      return kUnknownMessageType;
     }
   }
-  else
+
+  if (*type == kNoChecksum)
   {
-    error = kCheckSumError;
+    return allowNoChecksum ? kNoError : kCheckSumError;
+  }
+  int32_t expectedCheckSum = asInt32(buf + len - kChecksumLen);
+  return checksum(*type, buf, len - kChecksumLen) == expectedCheckSum ? kNoError : kCheckSumError;
+}
+
+ProtobufCodecLite::ErrorCode ProtobufCodecLite::parse(const char* buf,
+                                                      int len,
+                                                      ::google::protobuf::Message* message)
+{
+  ChecksumType type = kAdler32;
+  ErrorCode error = validateFrame(tag_, buf, len, allowNoChecksum_, &type);
+
+  if (error == kNoError)
+  {
+    // parse from buffer
+    const char* data = buf + tag_.size();
+    int32_t dataLen = len - kChecksumLen - static_cast<int>(tag_.size());
+    if (!parseFromBuffer(StringPiece(data, dataLen), message))
+    {
+      error = kParseError;
+    }
   }
 
   return error;
@@ -57,6 +57,11 @@ typedef boost::shared_ptr<google::protobuf::Message> MessagePtr;
 // payload   N-byte
 // checksum  4-byte  adler32 of tag+payload
 //
+// The last byte of the tag tells the checksum: as given for adler32,
+// 'C' for CRC-32C, 'N' for none, in which case the checksum field is 0,
+// e.g. "RPC0", "RPCC" and "RPCN". A codec takes all three, the last only
+// if allowed, so a peer can be told to send CRC-32C by sending it.
+//
 // This is an internal class, you should use ProtobufCodecT instead.
 class ProtobufCodecLite : boost::noncopyable
 {
@@ -75,6 +80,13 @@ class ProtobufCodecLite : boost::noncopyable
     kParseError,
   };
 
+  enum ChecksumType
+  {
+    kAdler32,
+    kCrc32c,
+    kNoChecksum,  // for trusted links, eg. within a host
+  };
+
   // return false to stop parsing protobuf message
   typedef boost::function<bool (const TcpConnectionPtr&,
                                 StringPiece,
@@ -99,7 +111,9 @@ class ProtobufCodecLite : boost::noncopyable
       messageCallback_(messageCb),
       rawCb_(rawCb),
       errorCallback_(errorCb),
-      kMinMessageLen(tagArg.size() + kChecksumLen)
+      kMinMessageLen(tagArg.size() + kChecksumLen),
+      checksumType_(kAdler32),
+      allowNoChecksum_(false)
   {
   }
 
@@ -107,6 +121,19 @@ class ProtobufCodecLite : boost::noncopyable
 
   const string& tag() const { return tag_; }
 
+  /// Of the messages sent, kAdler32 by default, which all peers take.
+  /// Not thread safe, call before send().
+  void setChecksumType(ChecksumType type)
+  { checksumType_ = type; }
+
+  ChecksumType checksumType() const
+  { return checksumType_; }
+
+  /// Takes messages with no checksum, off by default.
+  /// Not thread safe, call before onMessage().
+  void setAllowNoChecksum(bool on)
+  { allowNoChecksum_ = on; }
+
   void send(const TcpConnectionPtr& conn,
             const ::google::protobuf::Message& message);
 
@@ -119,12 +146,33 @@ class ProtobufCodecLite : boost::noncopyable
 
   static const string& errorCodeToString(ErrorCode errorCode);
 
+  /// ByteSizeLong() where protobuf has it, which a message serialized
+  /// to one frame must fit in an int. Caches the sizes as ByteSize() does.
+  static int byteSize(const google::protobuf::Message& message);
+
   // public for unit tests
   ErrorCode parse(const char* buf, int len, ::google::protobuf::Message* message);
   void fillEmptyBuffer(muduo::net::Buffer* buf, const google::protobuf::Message& message);
+  void fillEmptyBuffer(muduo::net::Buffer* buf,
+                       const google::protobuf::Message& message,
+                       ChecksumType type);
 
+  // adler32
   static int32_t checksum(const void* buf, int len);
   static bool validateChecksum(const char* buf, int len);
+
+  static int32_t checksum(ChecksumType type, const void* buf, int len);
+  // the tag of frames with type
+  static void appendTag(Buffer* buf, StringPiece tag, ChecksumType type);
+  // of all readable bytes of buf, which start with the tag
+  static void appendChecksum(Buffer* buf, ChecksumType type);
+  // buf is a frame without its size, of len bytes, whose tag should be
+  // tag, with its last byte telling the type of checksum, put in *type.
+  static ErrorCode validateFrame(StringPiece tag,
+                                 const char* buf,
+                                 int len,
+                                 bool allowNoChecksum,
+                                 ChecksumType* type);
   static int32_t asInt32(const char* buf);
   static void defaultErrorCallback(const TcpConnectionPtr&,
                                    Buffer*,
@@ -138,6 +186,8 @@ class ProtobufCodecLite : boost::noncopyable
   RawMessageCallback rawCb_;
   ErrorCallback errorCallback_;
   const int kMinMessageLen;
+  ChecksumType checksumType_;
+  bool allowNoChecksum_;
 };
 
 template<typename MSG, const char* TAG, typename CODEC=ProtobufCodecLite>  // TAG must be a variable with external linkage, not a string literal
@@ -168,6 +218,12 @@ class ProtobufCodecLiteT
 
   const string& tag() const { return codec_.tag(); }
 
+  void setChecksumType(ProtobufCodecLite::ChecksumType type)
+  { codec_.setChecksumType(type); }
+
+  void setAllowNoChecksum(bool on)
+  { codec_.setAllowNoChecksum(on); }
+
   void send(const TcpConnectionPtr& conn,
             const MSG& message)
   {
@@ -194,6 +250,13 @@ class ProtobufCodecLiteT
     codec_.fillEmptyBuffer(buf, message);
   }
 
+  void fillEmptyBuffer(muduo::net::Buffer* buf,
+                       const MSG& message,
+                       ProtobufCodecLite::ChecksumType type)
+  {
+    codec_.fillEmptyBuffer(buf, message, type);
+  }
+
  private:
   ProtobufMessageCallback messageCallback_;
   CODEC codec_;
@@ -0,0 +1,374 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/protorpc/BalancedRpcChannel.h>
+
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <google/protobuf/message.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+struct BalancedRpcChannel::Backend : boost::noncopyable
+{
+  Backend(EventLoop* loop, const InetAddress& serverAddr, const string& name)
+    : client(loop, serverAddr, name),
+      lastMean(-1)
+  {
+  }
+
+  void finish(int64_t micros, bool failed)
+  {
+    outstanding.decrement();
+    latencySum.add(micros);
+    latencyCount.increment();
+    if (failed)
+    {
+      failures.increment();
+    }
+  }
+
+  TcpClient client;
+  MutexLock mutex;
+  RpcChannelPtr channel;  // guarded by mutex, while connected
+  AtomicInt32 up;
+  AtomicInt32 outstanding;
+  AtomicInt64 calls;
+  AtomicInt64 failures;
+  // of calls finished in this interval, in microseconds
+  AtomicInt64 latencySum;
+  AtomicInt32 latencyCount;
+  AtomicInt64 ejectedUntil;  // microseconds since epoch
+  int64_t lastMean;  // of the last interval, -1 if too few calls
+};
+
+// done of the call given to the RpcChannel of a backend
+class BalancedRpcChannel::Call : public ::google::protobuf::Closure
+{
+ public:
+  Call(Backend* backend, RpcController* controller, ::google::protobuf::Closure* done)
+    : backend_(backend),
+      controller_(controller),
+      done_(done),
+      start_(Timestamp::now())
+  {
+  }
+
+  virtual void Run()
+  {
+    int64_t micros = Timestamp::now().microSecondsSinceEpoch() - start_.microSecondsSinceEpoch();
+    backend_->finish(micros, controller_ != NULL && controller_->Failed());
+    if (done_)
+    {
+      done_->Run();
+    }
+    delete this;
+  }
+
+ private:
+  Backend* backend_;
+  RpcController* controller_;
+  ::google::protobuf::Closure* done_;
+  Timestamp start_;
+};
+
+BalancedRpcChannel::BalancedRpcChannel(EventLoop* loop,
+                                       const std::vector<InetAddress>& servers,
+                                       const string& name)
+  : loop_(loop),
+    name_(name),
+    policy_(kLeastOutstanding),
+    callTimeout_(0),  // opt-in, see setCallTimeout()
+    ejectFactor_(0),
+    ejectSeconds_(0),
+    ejectInterval_(1.0),
+    ejectMinCalls_(20)
+{
+  for (size_t i = 0; i < servers.size(); ++i)
+  {
+    char buf[64];
+    snprintf(buf, sizeof buf, "%s#%s", name_.c_str(), servers[i].toIpPort().c_str());
+    backends_.push_back(new Backend(loop_, servers[i], buf));
+    Backend* backend = &backends_.back();
+    backend->client.setConnectionCallback(
+        boost::bind(&BalancedRpcChannel::onConnection, this, backend, _1));
+    backend->client.enableRetry();
+  }
+}
+
+BalancedRpcChannel::~BalancedRpcChannel()
+{
+  loop_->cancel(ejectTimer_);
+}
+
+void BalancedRpcChannel::setOutlierEjection(double factor,
+                                            double ejectSeconds,
+                                            double interval,
+                                            int minCalls)
+{
+  ejectFactor_ = factor;
+  ejectSeconds_ = ejectSeconds;
+  ejectInterval_ = interval;
+  ejectMinCalls_ = minCalls;
+}
+
+void BalancedRpcChannel::connect()
+{
+  loop_->assertInLoopThread();
+  for (size_t i = 0; i < backends_.size(); ++i)
+  {
+    backends_[i].client.connect();
+  }
+  ejectTimer_ = loop_->runEvery(ejectInterval_,
+                                boost::bind(&BalancedRpcChannel::checkOutliers, this));
+}
+
+void BalancedRpcChannel::disconnect()
+{
+  loop_->assertInLoopThread();
+  loop_->cancel(ejectTimer_);
+  for (size_t i = 0; i < backends_.size(); ++i)
+  {
+    // and stops connecting to the servers which are down
+    backends_[i].client.disconnect();
+    backends_[i].client.stop();
+  }
+}
+
+void BalancedRpcChannel::onConnection(Backend* backend, const TcpConnectionPtr& conn)
+{
+  LOG_INFO << "BalancedRpcChannel - " << conn->localAddress().toIpPort() << " -> "
+           << conn->peerAddress().toIpPort() << " is "
+           << (conn->connected() ? "UP" : "DOWN");
+  if (conn->connected())
+  {
+    RpcChannelPtr channel(new muduo::net::RpcChannel(conn));
+    channel->setCallTimeout(callTimeout_);
+    conn->setMessageCallback(
+        boost::bind(&muduo::net::RpcChannel::onMessage, get_pointer(channel), _1, _2, _3));
+    conn->setContext(channel);
+    {
+      MutexLockGuard lock(backend->mutex);
+      backend->channel = channel;
+    }
+    backend->up.getAndSet(1);
+  }
+  else
+  {
+    backend->up.getAndSet(0);
+    RpcChannelPtr channel;
+    {
+      MutexLockGuard lock(backend->mutex);
+      channel.swap(backend->channel);
+    }
+    if (channel)
+    {
+      channel->failOutstandingCalls(UNAVAILABLE);
+      channel->closeStreams();
+    }
+    conn->setContext(RpcChannelPtr());
+  }
+}
+
+void BalancedRpcChannel::CallMethod(const ::google::protobuf::MethodDescriptor* method,
+                                    ::google::protobuf::RpcController* controller,
+                                    const ::google::protobuf::Message* request,
+                                    ::google::protobuf::Message* response,
+                                    ::google::protobuf::Closure* done)
+{
+  RpcController* rpcController = dynamic_cast<RpcController*>(controller);
+  RpcChannelPtr channel;
+  Backend* backend = pick();
+  if (backend)
+  {
+    MutexLockGuard lock(backend->mutex);
+    channel = backend->channel;
+  }
+
+  if (channel)
+  {
+    backend->outstanding.increment();
+    backend->calls.increment();
+    // fails with UNAVAILABLE if the connection is lost since the copy
+    channel->CallMethod(method, controller, request, response,
+                        new Call(backend, rpcController, done));
+  }
+  else
+  {
+    // as RpcChannel does with a failed call
+    boost::scoped_ptr< ::google::protobuf::Message> d(response);
+    if (rpcController)
+    {
+      rpcController->setFailed(UNAVAILABLE, std::string());
+    }
+    if (done)
+    {
+      done->Run();
+    }
+  }
+}
+
+bool BalancedRpcChannel::eligible(Backend& backend, int64_t now, bool ejectedToo)
+{
+  return backend.up.get() != 0 && (ejectedToo || backend.ejectedUntil.get() <= now);
+}
+
+BalancedRpcChannel::Backend* BalancedRpcChannel::pick()
+{
+  const size_t size = backends_.size();
+  if (size == 0)
+  {
+    return NULL;
+  }
+  const int64_t now = Timestamp::now().microSecondsSinceEpoch();
+  // ejected servers are better than none
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    const bool ejectedToo = pass > 0;
+    if (policy_ == kPowerOfTwoChoices)
+    {
+      size_t n = 0;
+      for (size_t i = 0; i < size; ++i)
+      {
+        if (eligible(backends_[i], now, ejectedToo))
+          ++n;
+      }
+      if (n == 0)
+      {
+        continue;
+      }
+
+      static __thread unsigned int seed = 0;
+      if (seed == 0)
+      {
+        seed = static_cast<unsigned int>(CurrentThread::tid());
+      }
+      size_t first = rand_r(&seed) % n;
+      size_t second = n > 1 ? rand_r(&seed) % (n - 1) : first;
+      if (n > 1 && second >= first)
+      {
+        ++second;
+      }
+      Backend* a = NULL;
+      Backend* b = NULL;
+      for (size_t i = 0, k = 0; i < size; ++i)
+      {
+        if (eligible(backends_[i], now, ejectedToo))
+        {
+          if (k == first)
+            a = &backends_[i];
+          if (k == second)
+            b = &backends_[i];
+          ++k;
+        }
+      }
+      if (a && b)
+      {
+        return a->outstanding.get() <= b->outstanding.get() ? a : b;
+      }
+      else if (a || b)
+      {
+        // one went down since counted
+        return a ? a : b;
+      }
+    }
+    else
+    {
+      // ties go round robin
+      const size_t start = static_cast<uint32_t>(next_.getAndAdd(1)) % size;
+      Backend* best = NULL;
+      for (size_t i = 0; i < size; ++i)
+      {
+        Backend& backend = backends_[(start + i) % size];
+        if (eligible(backend, now, ejectedToo)
+            && (best == NULL || backend.outstanding.get() < best->outstanding.get()))
+        {
+          best = &backend;
+        }
+      }
+      if (best)
+      {
+        return best;
+      }
+    }
+  }
+  return NULL;
+}
+
+void BalancedRpcChannel::checkOutliers()
+{
+  loop_->assertInLoopThread();
+  std::vector<int64_t> means;
+  for (size_t i = 0; i < backends_.size(); ++i)
+  {
+    Backend& backend = backends_[i];
+    int64_t sum = backend.latencySum.getAndSet(0);
+    int32_t count = backend.latencyCount.getAndSet(0);
+    backend.lastMean = count >= ejectMinCalls_ && count > 0 ? sum / count : -1;
+    if (backend.lastMean >= 0)
+    {
+      means.push_back(backend.lastMean);
+    }
+  }
+  if (ejectFactor_ <= 0 || means.size() < 2)
+  {
+    return;
+  }
+
+  std::nth_element(means.begin(), means.begin() + means.size() / 2, means.end());
+  const double limit = ejectFactor_ * static_cast<double>(means[means.size() / 2]);
+  const int64_t now = Timestamp::now().microSecondsSinceEpoch();
+  size_t ejected = 0;
+  for (size_t i = 0; i < backends_.size(); ++i)
+  {
+    if (backends_[i].ejectedUntil.get() > now)
+      ++ejected;
+  }
+  for (size_t i = 0; i < backends_.size(); ++i)
+  {
+    Backend& backend = backends_[i];
+    if (static_cast<double>(backend.lastMean) > limit
+        && backend.ejectedUntil.get() <= now
+        && (ejected + 1) * 2 <= backends_.size())
+    {
+      LOG_WARN << "BalancedRpcChannel::checkOutliers - eject " << backend.client.name()
+               << " mean latency " << backend.lastMean << "us";
+      backend.ejectedUntil.getAndSet(
+          now + static_cast<int64_t>(ejectSeconds_ * Timestamp::kMicroSecondsPerSecond));
+      ++ejected;
+    }
+  }
+}
+
+string BalancedRpcChannel::report()
+{
+  const int64_t now = Timestamp::now().microSecondsSinceEpoch();
+  string result;
+  for (size_t i = 0; i < backends_.size(); ++i)
+  {
+    Backend& backend = backends_[i];
+    char buf[256];
+    snprintf(buf, sizeof buf, "%s %s outstanding %d calls %lld failures %lld latency %lldus\n",
+             backend.client.name().c_str(),
+             backend.up.get() == 0 ? "down" : (backend.ejectedUntil.get() > now ? "ejected" : "up"),
+             backend.outstanding.get(),
+             static_cast<long long>(backend.calls.get()),
+             static_cast<long long>(backend.failures.get()),
+             static_cast<long long>(backend.lastMean));
+    result += buf;
+  }
+  return result;
+}
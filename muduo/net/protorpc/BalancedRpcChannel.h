@@ -0,0 +1,106 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_PROTORPC_BALANCEDRPCCHANNEL_H
+#define MUDUO_NET_PROTORPC_BALANCEDRPCCHANNEL_H
+
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TimerId.h>
+#include <muduo/net/protorpc/RpcChannel.h>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+
+/// An RpcChannel over one connection to each of several servers of the
+/// same services, every call goes to one of them.
+///
+/// Connections are made in loop and made again when lost, with the backoff
+/// of Connector. The calls outstanding on a lost connection fail with
+/// UNAVAILABLE, as do calls made while no server is connected.
+///
+/// A server whose mean latency is well above that of the others is ejected
+/// for a while, it gets calls again only if all the others are down.
+///
+/// CallMethod() is thread safe, the rest is not: call it in loop.
+class BalancedRpcChannel : public ::google::protobuf::RpcChannel
+{
+ public:
+  enum Policy
+  {
+    kLeastOutstanding,   // the server with the fewest calls outstanding
+    kPowerOfTwoChoices,  // the less loaded of two picked at random
+  };
+
+  BalancedRpcChannel(EventLoop* loop,
+                     const std::vector<InetAddress>& servers,
+                     const string& name);
+  ~BalancedRpcChannel();
+
+  /// kLeastOutstanding by default. Call before connect().
+  void setPolicy(Policy policy)
+  { policy_ = policy; }
+
+  /// See RpcChannel::setCallTimeout(), 0 by default, which waits forever.
+  /// Call before connect().
+  void setCallTimeout(double seconds)
+  { callTimeout_ = seconds; }
+
+  /// Every interval seconds, servers which answered at least minCalls
+  /// calls with a mean latency over factor times the median of all are
+  /// ejected for ejectSeconds, at most half of the servers at once.
+  /// factor 0 for never, the default. Call before connect().
+  void setOutlierEjection(double factor,
+                          double ejectSeconds,
+                          double interval = 1.0,
+                          int minCalls = 20);
+
+  void connect();
+  void disconnect();
+
+  /// controller may be NULL, or a muduo::net::RpcController.
+  virtual void CallMethod(const ::google::protobuf::MethodDescriptor* method,
+                          ::google::protobuf::RpcController* controller,
+                          const ::google::protobuf::Message* request,
+                          ::google::protobuf::Message* response,
+                          ::google::protobuf::Closure* done);
+
+  /// One line per server: state, calls outstanding and so far, failures,
+  /// and the mean latency of the last interval.
+  string report();
+
+ private:
+  struct Backend;
+  class Call;
+
+  void onConnection(Backend* backend, const TcpConnectionPtr& conn);
+  Backend* pick();
+  static bool eligible(Backend& backend, int64_t now, bool ejectedToo);
+  void checkOutliers();
+
+  EventLoop* loop_;
+  const string name_;
+  Policy policy_;
+  double callTimeout_;
+  double ejectFactor_;
+  double ejectSeconds_;
+  double ejectInterval_;
+  int ejectMinCalls_;
+  TimerId ejectTimer_;
+  AtomicInt32 next_;
+  boost::ptr_vector<Backend> backends_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_PROTORPC_BALANCEDRPCCHANNEL_H
@@ -0,0 +1,360 @@
+#undef NDEBUG
+#include <muduo/net/protorpc/BalancedRpcChannel.h>
+#include <muduo/net/protorpc/RpcServer.h>
+#include <muduo/net/protorpc/rpctest.pb.h>
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// BalancedRpcChannel over real connections to several RpcServers,
+// all in the loop of main().
+
+namespace
+{
+
+const uint16_t kBasePort = 18020;
+const uint16_t kIdlePort = 18029;  // nothing listens there
+
+class EchoServiceImpl : public rpctest::TestService
+{
+ public:
+  explicit EchoServiceImpl(EventLoop* loop)
+    : delay(0.0),
+      calls(0),
+      loop_(loop)
+  {
+  }
+
+  virtual void Echo(::google::protobuf::RpcController* controller,
+                    const rpctest::TestMessage* request,
+                    rpctest::TestMessage* response,
+                    ::google::protobuf::Closure* done)
+  {
+    ++calls;
+    response->CopyFrom(*request);
+    if (delay > 0)
+    {
+      loop_->runAfter(delay, boost::bind(&::google::protobuf::Closure::Run, done));
+    }
+    else
+    {
+      done->Run();
+    }
+  }
+
+  double delay;  // before each response
+  int calls;
+
+ private:
+  EventLoop* loop_;
+};
+
+// servers on kBasePort and the ports after it
+struct Servers
+{
+  Servers(EventLoop* loop, int num)
+  {
+    for (int i = 0; i < num; ++i)
+    {
+      services.push_back(new EchoServiceImpl(loop));
+      servers.push_back(new RpcServer(loop, InetAddress(static_cast<uint16_t>(kBasePort + i))));
+      servers.back().registerService(&services.back());
+      servers.back().start();
+      addresses.push_back(InetAddress("127.0.0.1", static_cast<uint16_t>(kBasePort + i)));
+    }
+  }
+
+  // destroyed after the servers
+  boost::ptr_vector<EchoServiceImpl> services;
+  boost::ptr_vector<RpcServer> servers;
+  std::vector<InetAddress> addresses;
+};
+
+struct Call
+{
+  RpcController controller;
+};
+
+std::vector<ErrorCode> g_errors;  // of the calls finished, in order
+
+void onResponse(Call* call)
+{
+  g_errors.push_back(call->controller.errorCode());
+  delete call;
+}
+
+void startCall(rpctest::TestService::Stub* stub)
+{
+  rpctest::TestMessage request;
+  request.set_id(1);
+  Call* call = new Call;
+  // the response is deleted by the channel once done is run
+  stub->Echo(&call->controller, &request, new rpctest::TestMessage,
+             ::google::protobuf::NewCallback(onResponse, call));
+}
+
+void startCalls(rpctest::TestService::Stub* stub, int num)
+{
+  for (int i = 0; i < num; ++i)
+  {
+    startCall(stub);
+  }
+}
+
+void runFor(EventLoop* loop, double seconds)
+{
+  // for what is queued while not looping
+  loop->wakeup();
+  loop->runAfter(seconds, boost::bind(&EventLoop::quit, loop));
+  loop->loop();
+}
+
+int count(const string& s, const char* word)
+{
+  int n = 0;
+  for (size_t pos = s.find(word); pos != string::npos; pos = s.find(word, pos + 1))
+  {
+    ++n;
+  }
+  return n;
+}
+
+// every backend is connected, or the test gives up
+void connect(EventLoop* loop, BalancedRpcChannel* channel)
+{
+  channel->connect();
+  for (int i = 0; i < 100 && count(channel->report(), " down ") > 0; ++i)
+  {
+    runFor(loop, 0.01);
+  }
+  assert(count(channel->report(), " down ") == 0);
+}
+
+// which lets the connections go before the channel is destroyed
+void disconnect(EventLoop* loop, BalancedRpcChannel* channel)
+{
+  channel->disconnect();
+  runFor(loop, 0.1);
+}
+
+void testPolicy(BalancedRpcChannel::Policy policy)
+{
+  EventLoop loop;
+  Servers servers(&loop, 3);
+  BalancedRpcChannel channel(&loop, servers.addresses, "BalancedRpcChannelTest");
+  channel.setPolicy(policy);
+  connect(&loop, &channel);
+  rpctest::TestService::Stub stub(&channel);
+  g_errors.clear();
+
+  // all outstanding at once, each goes to a less loaded server
+  startCalls(&stub, 30);
+  runFor(&loop, 0.2);
+  assert(g_errors.size() == 30);
+  for (int i = 0; i < 3; ++i)
+  {
+    int calls = servers.services[i].calls;
+    if (policy == BalancedRpcChannel::kLeastOutstanding)
+    {
+      assert(calls == 10);
+    }
+    else
+    {
+      assert(calls >= 5 && calls <= 15);
+    }
+  }
+
+  // a slow server has calls outstanding, the others get most new calls
+  servers.services[0].delay = 0.2;
+  for (int i = 0; i < 3; ++i)
+  {
+    servers.services[i].calls = 0;
+  }
+  for (int i = 0; i < 30; ++i)
+  {
+    startCalls(&stub, 3);
+    runFor(&loop, 0.01);
+  }
+  runFor(&loop, 0.3);
+  assert(g_errors.size() == 120);
+  for (size_t i = 0; i < g_errors.size(); ++i)
+  {
+    assert(g_errors[i] == NO_ERROR);
+  }
+  assert(servers.services[0].calls * 2 < servers.services[1].calls);
+  assert(servers.services[0].calls * 2 < servers.services[2].calls);
+  assert(servers.services[0].calls + servers.services[1].calls + servers.services[2].calls == 90);
+
+  disconnect(&loop, &channel);
+}
+
+struct Ejection
+{
+  Ejection() : checks(0), ejectedAt(-1), readmittedAt(-1) { }
+
+  int checks;
+  int ejectedAt;     // calls of the slow server when ejected
+  int readmittedAt;  // and when it came back
+};
+
+void checkEjection(BalancedRpcChannel* channel,
+                   EchoServiceImpl* slow,
+                   rpctest::TestService::Stub* stub,
+                   Ejection* ejection)
+{
+  ++ejection->checks;
+  string report = channel->report();
+  if (ejection->ejectedAt < 0 && count(report, " ejected ") == 1)
+  {
+    // the first line is the slow server's
+    assert(report.find(" ejected ") < report.find('\n'));
+    ejection->ejectedAt = slow->calls;
+    // so it is not ejected again once back
+    slow->delay = 0;
+  }
+  else if (ejection->ejectedAt >= 0 && ejection->readmittedAt < 0
+           && count(report, " ejected ") == 0)
+  {
+    ejection->readmittedAt = slow->calls;
+  }
+  // a call for each server, least outstanding first
+  startCalls(stub, 3);
+}
+
+// a server much slower than the others gets no calls for ejectSeconds
+void testEjection()
+{
+  EventLoop loop;
+  Servers servers(&loop, 3);
+  servers.services[0].delay = 0.05;
+  BalancedRpcChannel channel(&loop, servers.addresses, "BalancedRpcChannelTest");
+  channel.setOutlierEjection(10.0, 1.0, 0.5, 3);
+  connect(&loop, &channel);
+  rpctest::TestService::Stub stub(&channel);
+  g_errors.clear();
+
+  Ejection ejection;
+  TimerId timer = loop.runEvery(0.1, boost::bind(checkEjection, &channel,
+                                                 &servers.services[0], &stub, &ejection));
+  runFor(&loop, 3.0);
+  loop.cancel(timer);
+  runFor(&loop, 0.1);
+
+  assert(ejection.ejectedAt > 0);
+  // a call or two may be on the way when ejected
+  assert(ejection.readmittedAt >= ejection.ejectedAt);
+  assert(ejection.readmittedAt <= ejection.ejectedAt + 2);
+  assert(servers.services[0].calls > ejection.readmittedAt);
+  assert(static_cast<int>(g_errors.size()) == ejection.checks * 3);
+  disconnect(&loop, &channel);
+}
+
+// accepts calls and never answers them
+struct Blackhole
+{
+  explicit Blackhole(EventLoop* loop)
+    : server(loop, InetAddress(kBasePort), "Blackhole")
+  {
+    server.setConnectionCallback(boost::bind(&Blackhole::onConnection, this, _1));
+    server.setMessageCallback(boost::bind(&Blackhole::onMessage, this, _1, _2, _3));
+    server.start();
+  }
+
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      connections.push_back(conn);
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+  {
+    buf->retrieveAll();
+  }
+
+  void closeAll()
+  {
+    for (size_t i = 0; i < connections.size(); ++i)
+    {
+      connections[i]->forceClose();
+    }
+    connections.clear();
+  }
+
+  TcpServer server;
+  std::vector<TcpConnectionPtr> connections;
+};
+
+// calls outstanding on a lost connection fail, as do calls with no
+// server connected
+void testUnavailable()
+{
+  EventLoop loop;
+  Blackhole blackhole(&loop);
+  std::vector<InetAddress> addresses;
+  addresses.push_back(InetAddress("127.0.0.1", kBasePort));
+  BalancedRpcChannel channel(&loop, addresses, "BalancedRpcChannelTest");
+  connect(&loop, &channel);
+  rpctest::TestService::Stub stub(&channel);
+  g_errors.clear();
+
+  startCalls(&stub, 3);
+  runFor(&loop, 0.1);
+  assert(g_errors.empty());
+  assert(channel.report().find("outstanding 3 calls 3 failures 0") != string::npos);
+  blackhole.closeAll();
+  runFor(&loop, 0.1);
+  assert(g_errors.size() == 3);
+  for (size_t i = 0; i < g_errors.size(); ++i)
+  {
+    assert(g_errors[i] == UNAVAILABLE);
+  }
+  assert(channel.report().find("outstanding 0 calls 3 failures 3") != string::npos);
+
+  // connected again
+  assert(count(channel.report(), " up ") == 1);
+  disconnect(&loop, &channel);
+  blackhole.closeAll();
+
+  std::vector<InetAddress> idle;
+  idle.push_back(InetAddress("127.0.0.1", kIdlePort));
+  BalancedRpcChannel nowhere(&loop, idle, "BalancedRpcChannelTest");
+  nowhere.connect();
+  rpctest::TestService::Stub nowhereStub(&nowhere);
+  g_errors.clear();
+  startCall(&nowhereStub);
+  assert(g_errors.size() == 1);
+  assert(g_errors[0] == UNAVAILABLE);
+  assert(count(nowhere.report(), " down ") == 1);
+  disconnect(&loop, &nowhere);
+}
+
+// a lost connection and a refused one are logged
+void discardOutput(const char*, int)
+{
+}
+
+}
+
+int main()
+{
+  Logger::setOutput(discardOutput);
+  testPolicy(BalancedRpcChannel::kLeastOutstanding);
+  testPolicy(BalancedRpcChannel::kPowerOfTwoChoices);
+  testEjection();
+  testUnavailable();
+  printf("all tests passed\n");
+}
@@ -9,27 +9,542 @@
 #include <muduo/net/protorpc/RpcChannel.h>
 
 #include <muduo/base/Logging.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpConnection.h>
+#include <muduo/net/protorpc/RpcExecutor.h>
 #include <muduo/net/protorpc/rpc.pb.h>
 
 #include <google/protobuf/descriptor.h>
+#if GOOGLE_PROTOBUF_VERSION >= 3000000
+#include <google/protobuf/arena.h>
+#define MUDUO_PROTORPC_ARENA 1
+#endif
 
 #include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <new>
+#include <vector>
+
+#include <sched.h>
+#include <stdlib.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+bool onArena(const ::google::protobuf::Message* message)
+{
+#ifdef MUDUO_PROTORPC_ARENA
+  return message->GetArena() != NULL;
+#else
+  (void) message;
+  return false;
+#endif
+}
+
+// on the arena of request, if any
+::google::protobuf::Message* newResponse(const ::google::protobuf::Message& prototype,
+                                         const ::google::protobuf::Message& request)
+{
+#ifdef MUDUO_PROTORPC_ARENA
+  return prototype.New(request.GetArena());
+#else
+  (void) request;
+  return prototype.New();
+#endif
+}
+
+}
+
+// Outstanding calls, each in slot id % slots. The state of a slot is the id
+// of its call, which tells it from earlier calls of the slot, or kFree, or
+// kBusy while one thread reads or writes the call in it. A call whose slot
+// is taken goes to overflow_. Once closed, calls are not added any more.
+class RpcChannel::CallTable : boost::noncopyable
+{
+ public:
+  static const int kDefaultSlots = 256;
+
+  explicit CallTable(int slots)
+    : slots_(newSlots(roundUp(slots))),
+      mask_(roundUp(slots) - 1),
+      closed_(0)
+  {
+    for (int64_t i = 0; i <= mask_; ++i)
+    {
+      slots_[i].state = kFree;
+    }
+  }
+
+  ~CallTable()
+  {
+    // Slot has nothing to destroy
+    ::free(slots_);
+  }
+
+  // returns false if the table is closed, the call is not in it then
+  bool add(int64_t id, const OutstandingCall& call)
+  {
+    assert(id > 0);
+    Slot& slot = slots_[id & mask_];
+    if (__sync_bool_compare_and_swap(&slot.state, kFree, kBusy))
+    {
+      slot.call = call;
+      unlock(&slot, id);
+    }
+    else
+    {
+      MutexLockGuard lock(mutex_);
+      overflow_[id] = call;
+      overflowSize_.increment();
+    }
+    // either close() sees the call, or this sees closed_
+    __sync_synchronize();
+    if (closed_)
+    {
+      OutstandingCall taken;
+      return !take(id, &taken);
+    }
+    return true;
+  }
+
+  // calls added after this fail, the ones before are taken by takeAll()
+  void close()
+  {
+    closed_ = 1;
+    __sync_synchronize();
+  }
+
+  void open()
+  {
+    closed_ = 0;
+  }
+
+  // returns false if there is no such call
+  bool take(int64_t id, OutstandingCall* call)
+  {
+    if (Slot* slot = lock(id))
+    {
+      *call = slot->call;
+      unlock(slot, kFree);
+      return true;
+    }
+    if (overflowSize_.get() > 0)
+    {
+      MutexLockGuard lock(mutex_);
+      std::map<int64_t, OutstandingCall>::iterator it = overflow_.find(id);
+      if (it != overflow_.end())
+      {
+        *call = it->second;
+        overflow_.erase(it);
+        overflowSize_.decrement();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // a copy of the call, which stays in the table
+  bool get(int64_t id, OutstandingCall* call)
+  {
+    if (Slot* slot = lock(id))
+    {
+      *call = slot->call;
+      unlock(slot, id);
+      return true;
+    }
+    if (overflowSize_.get() > 0)
+    {
+      MutexLockGuard lock(mutex_);
+      std::map<int64_t, OutstandingCall>::iterator it = overflow_.find(id);
+      if (it != overflow_.end())
+      {
+        *call = it->second;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // returns false if the call is finished already
+  bool setTimer(int64_t id, TimerId timer)
+  {
+    if (Slot* slot = lock(id))
+    {
+      slot->call.timer = timer;
+      unlock(slot, id);
+      return true;
+    }
+    MutexLockGuard lock(mutex_);
+    std::map<int64_t, OutstandingCall>::iterator it = overflow_.find(id);
+    if (it != overflow_.end())
+    {
+      it->second.timer = timer;
+      return true;
+    }
+    return false;
+  }
+
+  void takeAll(std::vector<OutstandingCall>* calls)
+  {
+    for (int64_t i = 0; i <= mask_; ++i)
+    {
+      OutstandingCall call;
+      int64_t id = slots_[i].state;
+      if (id > 0 && take(id, &call))
+      {
+        calls->push_back(call);
+      }
+    }
+    MutexLockGuard lock(mutex_);
+    for (std::map<int64_t, OutstandingCall>::iterator it = overflow_.begin();
+         it != overflow_.end(); ++it)
+    {
+      calls->push_back(it->second);
+    }
+    overflow_.clear();
+  }
+
+ private:
+  static const int64_t kFree = 0;
+  static const int64_t kBusy = -1;
+  static const size_t kCacheLine = 64;
+
+  struct Slot
+  {
+    volatile int64_t state;
+    OutstandingCall call;
+    char padding[kCacheLine - sizeof(int64_t) - sizeof(OutstandingCall)];
+  };
+
+  // one Slot per cache line, new[] aligns to 16 bytes only
+  static Slot* newSlots(int n)
+  {
+    void* p = NULL;
+    if (::posix_memalign(&p, kCacheLine, n * sizeof(Slot)) != 0)
+    {
+      throw std::bad_alloc();
+    }
+    Slot* slots = static_cast<Slot*>(p);
+    for (int i = 0; i < n; ++i)
+    {
+      new (&slots[i]) Slot;
+    }
+    return slots;
+  }
+
+  static int roundUp(int n)
+  {
+    int slots = 1;
+    while (slots < n)
+    {
+      slots *= 2;
+    }
+    return slots;
+  }
+
+  // the slot of call id marked kBusy, NULL if it is not there
+  Slot* lock(int64_t id)
+  {
+    Slot& slot = slots_[id & mask_];
+    for (;;)
+    {
+      int64_t state = slot.state;
+      if (state == id)
+      {
+        if (__sync_bool_compare_and_swap(&slot.state, id, kBusy))
+        {
+          return &slot;
+        }
+      }
+      else if (state == kBusy)
+      {
+        // held for a few stores, unless that thread is preempted
+        ::sched_yield();
+      }
+      else
+      {
+        return NULL;
+      }
+    }
+  }
+
+  static void unlock(Slot* slot, int64_t state)
+  {
+    bool unlocked = __sync_bool_compare_and_swap(&slot->state, kBusy, state);
+    assert(unlocked); (void) unlocked;
+  }
+
+  Slot* const slots_;  // kCacheLine aligned
+  const int64_t mask_;
+  AtomicInt32 overflowSize_;
+  volatile int closed_;
+  MutexLock mutex_;
+  std::map<int64_t, OutstandingCall> overflow_;  // guarded by mutex_
+};
+
+// The done closure a service is handed with a request.
+class RpcChannel::ServerCall : public ::google::protobuf::Closure
+{
+ public:
+  ServerCall(RpcChannel* channel,
+             const RpcChannelPtr& guard,
+             RpcExecutor* executor,
+             const ::google::protobuf::MethodDescriptor* method,
+             const MessagePtr& request,
+             ::google::protobuf::Message* response,
+             int64_t id,
+             Timestamp deadline,
+             Timestamp receiveTime)
+    : channel_(channel),
+      guard_(guard),
+      executor_(executor),
+      method_(method),
+      request_(request),
+      response_(response),
+      id_(id),
+      receiveTime_(receiveTime)
+  {
+    controller_.setDeadline(deadline);
+  }
+
+  ~ServerCall()
+  {
+    if (response_ && !onArena(response_))
+    {
+      delete response_;
+    }
+  }
+
+  virtual void Run()
+  {
+    channel_->doneCallback(this);
+    delete this;
+  }
+
+  RpcController* controller() { return &controller_; }
+  ::google::protobuf::Message* response() { return response_; }
+  // not on an arena, which streams do not use
+  ::google::protobuf::Message* takeResponse()
+  {
+    assert(!onArena(response_));
+    ::google::protobuf::Message* response = response_;
+    response_ = NULL;
+    return response;
+  }
+  RpcExecutor* executor() const { return executor_; }
+  int64_t id() const { return id_; }
+  const ::google::protobuf::MethodDescriptor* method() const { return method_; }
+  Timestamp receiveTime() const { return receiveTime_; }
+
+ private:
+  RpcChannel* channel_;
+  RpcChannelPtr guard_;  // done may outlive the connection, if it is not run in the IO thread
+  RpcExecutor* executor_;  // that runs the call, if any
+  const ::google::protobuf::MethodDescriptor* method_;
+  RpcController controller_;
+  MessagePtr request_;  // and the arena of response_, if any
+  ::google::protobuf::Message* response_;
+  int64_t id_;
+  Timestamp receiveTime_;
+};
+
+struct RpcChannel::OutStream : boost::noncopyable
+{
+  OutStream(int64_t streamId,
+            MessageType messageType,
+            const RpcController::StreamWriter& streamWriter,
+            ::google::protobuf::Message* empty)
+    : id(streamId),
+      type(messageType),
+      writer(streamWriter),
+      next(empty),
+      cancelCallback(NULL)
+  {
+  }
+
+  ~OutStream()
+  {
+    if (cancelCallback)
+    {
+      cancelCallback->Run();
+    }
+  }
+
+  const int64_t id;
+  const MessageType type;
+  RpcController::StreamWriter writer;
+  boost::scoped_ptr< ::google::protobuf::Message> next;
+  boost::scoped_ptr< ::google::protobuf::Message> last;  // the response, NULL for requests
+  ::google::protobuf::Closure* cancelCallback;  // of the server call, run at the end
+};
+
+#ifdef MUDUO_PROTORPC_ARENA
+// Arenas of calls, reset and kept for later calls once done is run, in
+// whatever thread that is. Each has a first block of its own, which Reset()
+// keeps, so a call whose messages fit in it allocates nothing more.
+class RpcChannel::ArenaPool : boost::noncopyable,
+                              public boost::enable_shared_from_this<ArenaPool>
+{
+ public:
+  static const size_t kMaxIdle = 32;
+
+  explicit ArenaPool(size_t blockSize)
+    : blockSize_(blockSize)
+  {
+  }
+
+  ~ArenaPool()
+  {
+    for (size_t i = 0; i < idle_.size(); ++i)
+    {
+      delete idle_[i];
+    }
+  }
+
+  // an empty message of prototype, the arena goes back to the pool with it
+  MessagePtr newMessage(const ::google::protobuf::Message& prototype)
+  {
+    Arena* arena = NULL;
+    {
+      MutexLockGuard lock(mutex_);
+      if (!idle_.empty())
+      {
+        arena = idle_.back();
+        idle_.pop_back();
+      }
+    }
+    if (arena == NULL)
+    {
+      arena = new Arena(blockSize_);
+    }
+    return MessagePtr(prototype.New(&arena->arena),
+                      boost::bind(&ArenaPool::recycle, shared_from_this(), arena));
+  }
+
+ private:
+  struct Arena : boost::noncopyable
+  {
+    explicit Arena(size_t blockSize)
+      : block(new char[blockSize]),
+        arena(options(block.get(), blockSize))
+    {
+    }
+
+    static ::google::protobuf::ArenaOptions options(char* block, size_t blockSize)
+    {
+      ::google::protobuf::ArenaOptions options;
+      options.initial_block = block;
+      options.initial_block_size = blockSize;
+      options.start_block_size = blockSize;
+      return options;
+    }
+
+    boost::scoped_array<char> block;
+    ::google::protobuf::Arena arena;
+  };
+
+  void recycle(Arena* arena)
+  {
+    arena->arena.Reset();
+    {
+      MutexLockGuard lock(mutex_);
+      if (idle_.size() < kMaxIdle)
+      {
+        idle_.push_back(arena);
+        arena = NULL;
+      }
+    }
+    delete arena;
+  }
+
+  const size_t blockSize_;
+  MutexLock mutex_;
+  std::vector<Arena*> idle_;  // guarded by mutex_
+};
+#endif
+
+// Frames to be written together by flush() in the loop of the connection.
+class RpcChannel::Batch : boost::noncopyable
+{
+ public:
+  Batch()
+    : flushPending_(false)
+  {
+  }
+
+  // true if a flush() has to be scheduled
+  bool add(Buffer* frame)
+  {
+    MutexLockGuard lock(mutex_);
+    if (buffer_.readableBytes() == 0)
+    {
+      buffer_.swap(*frame);
+    }
+    else
+    {
+      buffer_.append(frame->peek(), frame->readableBytes());
+    }
+    bool schedule = !flushPending_;
+    flushPending_ = true;
+    return schedule;
+  }
+
+  void flush(const TcpConnectionPtr& conn)
+  {
+    Buffer frames;
+    {
+      MutexLockGuard lock(mutex_);
+      frames.swap(buffer_);
+      flushPending_ = false;
+    }
+    conn->send(&frames);
+  }
+
+ private:
+  MutexLock mutex_;
+  Buffer buffer_;
+  bool flushPending_;
+};
+
 RpcChannel::RpcChannel()
-  : codec_(boost::bind(&RpcChannel::onRpcMessage, this, _1, _2, _3)),
-    services_(NULL)
+  : codec_(boost::bind(&RpcChannel::onRpcMessage, this, _1, _2, _3),
+           boost::bind(&RpcChannel::onRawMessage, this, _1, _2, _3)),
+    calls_(new CallTable(CallTable::kDefaultSlots)),
+    callTimeout_(0),  // opt-in, see setCallTimeout()
+    services_(NULL),
+    executor_(NULL),
+    batchWindow_(0),
+    allowNoChecksum_(false),
+    arenaBlockSize_(kDefaultArenaBlockSize),
+    streamHighWaterMark_(1024 * 1024),
+    writeCompleteCallbackSet_(false),
+    writeQueued_(false)
 {
   LOG_INFO << "RpcChannel::ctor - " << this;
 }
 
 RpcChannel::RpcChannel(const TcpConnectionPtr& conn)
-  : codec_(boost::bind(&RpcChannel::onRpcMessage, this, _1, _2, _3)),
+  : codec_(boost::bind(&RpcChannel::onRpcMessage, this, _1, _2, _3),
+           boost::bind(&RpcChannel::onRawMessage, this, _1, _2, _3)),
     conn_(conn),
-    services_(NULL)
+    calls_(new CallTable(CallTable::kDefaultSlots)),
+    callTimeout_(0),  // opt-in, see setCallTimeout()
+    services_(NULL),
+    executor_(NULL),
+    batchWindow_(0),
+    allowNoChecksum_(false),
+    arenaBlockSize_(kDefaultArenaBlockSize),
+    streamHighWaterMark_(1024 * 1024),
+    writeCompleteCallbackSet_(false),
+    writeQueued_(false)
 {
   LOG_INFO << "RpcChannel::ctor - " << this;
 }
@@ -37,11 +552,45 @@ RpcChannel::RpcChannel(const TcpConnectionPtr& conn)
 RpcChannel::~RpcChannel()
 {
   LOG_INFO << "RpcChannel::dtor - " << this;
-  for (std::map<int64_t, OutstandingCall>::iterator it = outstandings_.begin(); it != outstandings_.end(); ++it)
+  // their timers find nothing, once calls_ is gone
+  std::vector<OutstandingCall> calls;
+  calls_->takeAll(&calls);
+  for (size_t i = 0; i < calls.size(); ++i)
+  {
+    delete calls[i].response;
+    delete calls[i].done;
+  }
+}
+
+void RpcChannel::setCallSlots(int slots)
+{
+  calls_.reset(new CallTable(slots));
+}
+
+void RpcChannel::enableBatching(double window)
+{
+  batch_.reset(new Batch);
+  batchWindow_ = window;
+}
+
+void RpcChannel::sendFrame(Buffer* buf)
+{
+  if (!batch_)
   {
-    OutstandingCall out = it->second;
-    delete out.response;
-    delete out.done;
+    conn_->send(buf);
+  }
+  else if (batch_->add(buf))
+  {
+    EventLoop* loop = conn_->getLoop();
+    if (batchWindow_ > 0)
+    {
+      loop->runAfter(batchWindow_, boost::bind(&Batch::flush, batch_, conn_));
+    }
+    else
+    {
+      // after the events of this iteration are handled
+      loop->queueInLoop(boost::bind(&Batch::flush, batch_, conn_));
+    }
   }
 }
 
@@ -62,14 +611,66 @@ void RpcChannel::CallMethod(const ::google::protobuf::MethodDescriptor* method,
   message.set_id(id);
   message.set_service(method->service()->full_name());
   message.set_method(method->name());
-  message.set_request(request->SerializeAsString()); // FIXME: error check
 
-  OutstandingCall out = { response, done };
+  RpcController* rpcController = dynamic_cast<RpcController*>(controller);
+  double timeout = callTimeout_;
+  if (rpcController && rpcController->timeout() > 0)
+  {
+    timeout = rpcController->timeout();
+  }
+  if (timeout > 0)
+  {
+    message.set_timeout(static_cast<int64_t>(timeout * Timestamp::kMicroSecondsPerSecond));
+  }
+  const bool streamRequests = rpcController && rpcController->requestWriter_;
+  const bool streamResponses = rpcController && rpcController->responseReader_;
+  if (streamRequests)
   {
-  MutexLockGuard lock(mutex_);
-  outstandings_[id] = out;
+    message.set_stream(true);
+  }
+  if (streamResponses)
+  {
+    message.set_accept_stream(true);
+  }
+
+  EventLoop* loop = conn_->getLoop();
+  OutstandingCall out = { response, done, rpcController, TimerId(), timeout > 0 };
+  if (rpcController)
+  {
+    // responses are parsed into response in the IO thread
+    rpcController->setCancel(boost::bind(streamResponses ? &RpcChannel::cancelInLoop
+                                                         : &RpcChannel::onCallCanceled,
+                                         boost::weak_ptr<CallTable>(calls_), loop, id));
+  }
+  if (!calls_->add(id, out))
+  {
+    // the connection is lost
+    finishCall(out, UNAVAILABLE, std::string());
+    return;
+  }
+  if (timeout > 0)
+  {
+    TimerId timer = loop->runAfter(
+        timeout,
+        boost::bind(&RpcChannel::onCallTimeout, boost::weak_ptr<CallTable>(calls_), id));
+    if (!calls_->setTimer(id, timer))
+    {
+      loop->cancel(timer);
+    }
+  }
+  Buffer buf;
+  fillRpcBuffer(&buf, message, *request, checksumType());
+  if (streamRequests)
+  {
+    // not batched, ahead of the rest of the stream
+    conn_->send(&buf);
+    OutStreamPtr stream(new OutStream(id, REQUEST, rpcController->requestWriter_, request->New()));
+    loop->runInLoop(boost::bind(&RpcChannel::startStream, shared_from_this(), stream));
+  }
+  else
+  {
+    sendFrame(&buf);
   }
-  codec_.send(conn_, message);
 }
 
 void RpcChannel::onMessage(const TcpConnectionPtr& conn,
@@ -79,45 +680,119 @@ void RpcChannel::onMessage(const TcpConnectionPtr& conn,
   codec_.onMessage(conn, buf, receiveTime);
 }
 
+void RpcChannel::setConnection(const TcpConnectionPtr& conn)
+{
+  conn_ = conn;
+  calls_->open();
+}
+
+void RpcChannel::failOutstandingCalls(ErrorCode error)
+{
+  std::vector<OutstandingCall> calls;
+  calls_->close();
+  calls_->takeAll(&calls);
+  for (size_t i = 0; i < calls.size(); ++i)
+  {
+    if (calls[i].hasTimer && conn_)
+    {
+      conn_->getLoop()->cancel(calls[i].timer);
+    }
+    finishCall(calls[i], error, std::string());
+  }
+}
+
+bool RpcChannel::onRawMessage(const TcpConnectionPtr& conn,
+                              StringPiece frame,
+                              Timestamp receiveTime)
+{
+  RpcMessage message;
+  StringPiece payload;
+  ProtobufCodecLite::ChecksumType type = ProtobufCodecLite::kAdler32;
+  if (parseRpcFrame(frame, &message, &payload, allowNoChecksum_, &type))
+  {
+    if (message.type() == REQUEST && type != checksumType())
+    {
+      // answer as asked
+      setChecksumType(type);
+    }
+    handleMessage(conn, message, payload, receiveTime);
+    return false;
+  }
+  // codec_ parses it again, and reports the error if it is bad
+  return true;
+}
+
 void RpcChannel::onRpcMessage(const TcpConnectionPtr& conn,
                               const RpcMessagePtr& messagePtr,
                               Timestamp receiveTime)
+{
+  const RpcMessage& message = *messagePtr;
+  StringPiece payload;
+  if (message.type() == REQUEST && message.has_request())
+  {
+    payload = message.request();
+  }
+  else if (message.type() == RESPONSE && message.has_response())
+  {
+    payload = message.response();
+  }
+  handleMessage(conn, message, payload, receiveTime);
+}
+
+void RpcChannel::handleMessage(const TcpConnectionPtr& conn,
+                               const RpcMessage& message,
+                               StringPiece payload,
+                               Timestamp receiveTime)
 {
   assert(conn == conn_);
   //printf("%s\n", message.DebugString().c_str());
-  RpcMessage& message = *messagePtr;
-  if (message.type() == RESPONSE)
+  if (message.type() == RESPONSE && message.stream())
+  {
+    onStreamResponse(message, payload);
+  }
+  else if (message.type() == REQUEST && !message.has_service())
+  {
+    onStreamRequest(message, payload);
+  }
+  else if (message.type() == RESPONSE)
   {
     int64_t id = message.id();
-    assert(message.has_response() || message.has_error());
-
-    OutstandingCall out = { NULL, NULL };
-
+    OutstandingCall out = { NULL, NULL, NULL, TimerId(), false };
+    if (calls_->take(id, &out))
     {
-      MutexLockGuard lock(mutex_);
-      std::map<int64_t, OutstandingCall>::iterator it = outstandings_.find(id);
-      if (it != outstandings_.end())
+      if (out.hasTimer)
       {
-        out = it->second;
-        outstandings_.erase(it);
+        conn->getLoop()->cancel(out.timer);
       }
-    }
-
-    if (out.response)
-    {
-      boost::scoped_ptr<google::protobuf::Message> d(out.response);
-      if (message.has_response())
+      if (message.has_error() && message.error() != NO_ERROR)
+      {
+        finishCall(out, message.error(), message.reason());
+      }
+      else if (payload.data() == NULL
+               || !out.response->ParseFromArray(payload.data(), payload.size()))
       {
-        out.response->ParseFromString(message.response());
+        finishCall(out, INVALID_RESPONSE, std::string());
       }
-      if (out.done)
+      else
       {
-        out.done->Run();
+        finishCall(out, NO_ERROR, std::string());
       }
     }
   }
   else if (message.type() == REQUEST)
   {
+    Timestamp deadline;
+    if (message.timeout() > 0)
+    {
+      deadline = Timestamp(receiveTime.microSecondsSinceEpoch() + message.timeout());
+      if (Timestamp::now() > deadline)
+      {
+        // the caller has given up on it
+        LOG_DEBUG << "RpcChannel::handleMessage - drop expired call " << message.id();
+        return;
+      }
+    }
+
     // FIXME: extract to a function
     ErrorCode error = WRONG_PROTO;
     if (services_)
@@ -132,14 +807,36 @@ void RpcChannel::onRpcMessage(const TcpConnectionPtr& conn,
           = desc->FindMethodByName(message.method());
         if (method)
         {
-          boost::scoped_ptr<google::protobuf::Message> request(service->GetRequestPrototype(method).New());
-          if (request->ParseFromString(message.request()))
+          // a stream outlives its call, its messages are on the heap
+          MessagePtr request(newRequest(service->GetRequestPrototype(method),
+                                        !message.stream() && !message.accept_stream()));
+          if (request->ParseFromArray(payload.data(), payload.size()))
           {
-            google::protobuf::Message* response = service->GetResponsePrototype(method).New();
-            // response is deleted in doneCallback
-            int64_t id = message.id();
-            service->CallMethod(method, NULL, get_pointer(request), response,
-                                NewCallback(this, &RpcChannel::doneCallback, response, id));
+            if (message.stream())
+            {
+              // in the IO thread, the service sets the reader of the
+              // requests that follow before they are parsed
+              InStream& in = inStreams_[message.id()];
+              in.next.reset(request->New());
+              callService(service, method, request, message.id(), deadline, receiveTime,
+                          message.accept_stream(), &in.reader);
+            }
+            else if (executor_)
+            {
+              RpcChannelPtr self(shared_from_this());
+              executor_->submit(method,
+                                conn->getLoop(),
+                                boost::bind(&RpcChannel::callService, self, service, method,
+                                            request, message.id(), deadline, receiveTime,
+                                            message.accept_stream(),
+                                            static_cast<RpcController::StreamReader*>(NULL)),
+                                boost::bind(&RpcChannel::sendError, self, message.id(), OVERLOADED));
+            }
+            else
+            {
+              callService(service, method, request, message.id(), deadline, receiveTime,
+                          message.accept_stream(), NULL);
+            }
             error = NO_ERROR;
           }
           else
@@ -163,11 +860,7 @@ void RpcChannel::onRpcMessage(const TcpConnectionPtr& conn,
     }
     if (error != NO_ERROR)
     {
-      RpcMessage response;
-      response.set_type(RESPONSE);
-      response.set_id(message.id());
-      response.set_error(error);
-      codec_.send(conn_, response);
+      sendError(message.id(), error);
     }
   }
   else if (message.type() == ERROR)
@@ -175,13 +868,378 @@ void RpcChannel::onRpcMessage(const TcpConnectionPtr& conn,
   }
 }
 
-void RpcChannel::doneCallback(::google::protobuf::Message* response, int64_t id)
+void RpcChannel::callService(google::protobuf::Service* service,
+                             const google::protobuf::MethodDescriptor* method,
+                             const MessagePtr& request,
+                             int64_t id,
+                             Timestamp deadline,
+                             Timestamp receiveTime,
+                             bool acceptStream,
+                             RpcController::StreamReader* requestReader)
+{
+  // a stream of requests is not run by executor_
+  RpcExecutor* executor = requestReader ? NULL : executor_;
+  if (executor && deadline.valid() && Timestamp::now() > deadline)
+  {
+    // expired while waiting in executor_
+    LOG_DEBUG << "RpcChannel::callService - drop expired call " << id;
+    executor->finish(method, receiveTime, true);
+    return;
+  }
+  // deletes itself in Run()
+  ServerCall* call = new ServerCall(this,
+                                    executor || requestReader ? shared_from_this() : RpcChannelPtr(),
+                                    executor,
+                                    method,
+                                    request,
+                                    newResponse(service->GetResponsePrototype(method), *request),
+                                    id,
+                                    deadline,
+                                    receiveTime);
+  call->controller()->setStreams(acceptStream, requestReader);
+  if (requestReader)
+  {
+    inStreams_[id].controller = call->controller();
+  }
+  service->CallMethod(method, call->controller(), get_pointer(request),
+                      call->response(), call);
+}
+
+MessagePtr RpcChannel::newRequest(const ::google::protobuf::Message& prototype, bool useArena)
 {
-  boost::scoped_ptr<google::protobuf::Message> d(response);
+#ifdef MUDUO_PROTORPC_ARENA
+  if (useArena && arenaBlockSize_ > 0)
+  {
+    if (!arenas_)
+    {
+      arenas_.reset(new ArenaPool(arenaBlockSize_));
+    }
+    return arenas_->newMessage(prototype);
+  }
+#else
+  (void) useArena;
+#endif
+  return MessagePtr(prototype.New());
+}
+
+void RpcChannel::sendError(int64_t id, ErrorCode error)
+{
+  RpcMessage response;
+  response.set_type(RESPONSE);
+  response.set_id(id);
+  response.set_error(error);
+  Buffer buf;
+  codec_.fillEmptyBuffer(&buf, response, checksumType());
+  sendFrame(&buf);
+}
+
+void RpcChannel::finishCall(const OutstandingCall& call,
+                            ErrorCode error,
+                            const std::string& reason)
+{
+  boost::scoped_ptr<google::protobuf::Message> d(call.response);
+  if (error != NO_ERROR && call.controller)
+  {
+    call.controller->setFailed(error, reason);
+  }
+  if (call.done)
+  {
+    call.done->Run();
+  }
+}
+
+void RpcChannel::onCallTimeout(const boost::weak_ptr<CallTable>& weakCalls, int64_t id)
+{
+  boost::shared_ptr<CallTable> calls(weakCalls.lock());
+  OutstandingCall out = { NULL, NULL, NULL, TimerId(), false };
+  if (calls && calls->take(id, &out))
+  {
+    LOG_WARN << "RpcChannel::onCallTimeout - call " << id << " got no response";
+    finishCall(out, TIMEOUT, std::string());
+  }
+}
+
+void RpcChannel::onCallCanceled(const boost::weak_ptr<CallTable>& weakCalls,
+                                EventLoop* loop,
+                                int64_t id)
+{
+  boost::shared_ptr<CallTable> calls(weakCalls.lock());
+  OutstandingCall out = { NULL, NULL, NULL, TimerId(), false };
+  if (calls && calls->take(id, &out))
+  {
+    if (out.hasTimer)
+    {
+      loop->cancel(out.timer);
+    }
+    finishCall(out, CANCELED, std::string());
+  }
+}
+
+void RpcChannel::cancelInLoop(const boost::weak_ptr<CallTable>& weakCalls,
+                               EventLoop* loop,
+                               int64_t id)
+{
+  loop->runInLoop(boost::bind(&RpcChannel::onCallCanceled, weakCalls, loop, id));
+}
+
+void RpcChannel::doneCallback(ServerCall* call)
+{
+  RpcController* controller = call->controller();
+  if (controller->requestReader_)
+  {
+    // the requests still to come are dropped
+    conn_->getLoop()->assertInLoopThread();
+    controller->requestReader_ = NULL;
+    dropRequestStream(call->id());
+  }
+  if (controller->responseWriter_ && !controller->Failed())
+  {
+    if (controller->acceptStream_)
+    {
+      OutStreamPtr stream(new OutStream(call->id(), RESPONSE, controller->responseWriter_,
+                                        call->response()->New()));
+      stream->last.reset(call->takeResponse());
+      stream->cancelCallback = controller->takeCancelCallback();
+      conn_->getLoop()->runInLoop(
+          boost::bind(&RpcChannel::startStream, shared_from_this(), stream));
+      if (call->executor())
+      {
+        call->executor()->finish(call->method(), call->receiveTime(), false);
+      }
+      return;
+    }
+    controller->setFailed(NO_STREAM, std::string());
+  }
+
   RpcMessage message;
   message.set_type(RESPONSE);
-  message.set_id(id);
-  message.set_response(response->SerializeAsString()); // FIXME: error check
-  codec_.send(conn_, message);
+  message.set_id(call->id());
+  Buffer buf;
+  if (controller->Failed())
+  {
+    message.set_error(controller->errorCode());
+    message.set_reason(controller->reason_);
+    codec_.fillEmptyBuffer(&buf, message, checksumType());
+  }
+  else
+  {
+    fillRpcBuffer(&buf, message, *call->response(), checksumType());
+  }
+  sendFrame(&buf);
+
+  if (::google::protobuf::Closure* callback = controller->takeCancelCallback())
+  {
+    callback->Run();
+  }
+  if (call->executor())
+  {
+    call->executor()->finish(call->method(), call->receiveTime(), false);
+  }
+}
+
+void RpcChannel::startStream(const OutStreamPtr& stream)
+{
+  conn_->getLoop()->assertInLoopThread();
+  streams_.push_back(stream);
+  writeStreams();
+}
+
+void RpcChannel::writeStreams()
+{
+  // a message of each stream in turn, no more than streamHighWaterMark_
+  // bytes a round, a socket that takes it all would starve the loop
+  size_t written = 0;
+  while (!streams_.empty()
+         && conn_->connected()
+         && conn_->outputBuffer()->readableBytes() < streamHighWaterMark_
+         && written < streamHighWaterMark_)
+  {
+    OutStreamPtr stream(streams_.front());
+    streams_.pop_front();
+    if (writeStream(get_pointer(stream), &written))
+    {
+      streams_.push_back(stream);
+    }
+  }
+  if (!conn_->connected())
+  {
+    streams_.clear();
+  }
+  else if (!streams_.empty())
+  {
+    if (!writeCompleteCallbackSet_)
+    {
+      conn_->setWriteCompleteCallback(boost::bind(&RpcChannel::onWriteComplete, this, _1));
+      writeCompleteCallbackSet_ = true;
+    }
+    if (conn_->outputBuffer()->readableBytes() < streamHighWaterMark_)
+    {
+      // the round is over, not the room in the buffer
+      queueWriteStreams();
+    }
+  }
+}
+
+void RpcChannel::queueWriteStreams()
+{
+  if (!writeQueued_)
+  {
+    writeQueued_ = true;
+    conn_->getLoop()->queueInLoop(
+        boost::bind(&RpcChannel::writeQueuedStreams, shared_from_this()));
+  }
+}
+
+void RpcChannel::writeQueuedStreams()
+{
+  writeQueued_ = false;
+  writeStreams();
+}
+
+bool RpcChannel::writeStream(OutStream* stream, size_t* written)
+{
+  OutstandingCall out = { NULL, NULL, NULL, TimerId(), false };
+  if (stream->type == REQUEST && !calls_->get(stream->id, &out))
+  {
+    // the call is over, eg. the server has answered
+    return false;
+  }
+  RpcMessage message;
+  message.set_type(stream->type);
+  message.set_id(stream->id);
+  Buffer buf;
+  stream->next->Clear();
+  bool more = stream->writer(get_pointer(stream->next));
+  if (more)
+  {
+    message.set_stream(true);
+    fillRpcBuffer(&buf, message, *stream->next, checksumType());
+  }
+  else if (stream->last)
+  {
+    fillRpcBuffer(&buf, message, *stream->last, checksumType());
+  }
+  else
+  {
+    codec_.fillEmptyBuffer(&buf, message, checksumType());
+  }
+  *written += buf.readableBytes();
+  conn_->send(&buf);
+  return more;
+}
+
+void RpcChannel::onWriteComplete(const TcpConnectionPtr&)
+{
+  // once for all the sends of a round
+  queueWriteStreams();
+}
+
+void RpcChannel::onStreamRequest(const RpcMessage& message, StringPiece payload)
+{
+  std::map<int64_t, InStream>::iterator it = inStreams_.find(message.id());
+  if (it == inStreams_.end())
+  {
+    // its call is done
+    return;
+  }
+  InStream& in = it->second;
+  bool end = !message.stream();
+  if (payload.data() != NULL)
+  {
+    if (in.next->ParseFromArray(payload.data(), payload.size()))
+    {
+      if (in.reader)
+      {
+        // reader may run done, which leaves in to us
+        in.reading = true;
+        in.reader(get_pointer(in.next));
+        in.reading = false;
+        if (in.dropped)
+        {
+          inStreams_.erase(it);
+          return;
+        }
+      }
+    }
+    else
+    {
+      sendError(message.id(), INVALID_REQUEST);
+      end = true;
+    }
+  }
+  if (end)
+  {
+    endRequestStream(message.id());
+  }
+}
+
+void RpcChannel::endRequestStream(int64_t id)
+{
+  std::map<int64_t, InStream>::iterator it = inStreams_.find(id);
+  if (it != inStreams_.end())
+  {
+    RpcController::StreamReader reader;
+    reader.swap(it->second.reader);
+    if (it->second.controller)
+    {
+      // the reader is gone, done may still be run
+      it->second.controller->requestReader_ = NULL;
+    }
+    inStreams_.erase(it);
+    if (reader)
+    {
+      reader(NULL);
+    }
+  }
+}
+
+void RpcChannel::dropRequestStream(int64_t id)
+{
+  std::map<int64_t, InStream>::iterator it = inStreams_.find(id);
+  if (it != inStreams_.end())
+  {
+    if (it->second.reading)
+    {
+      it->second.controller = NULL;
+      it->second.dropped = true;
+    }
+    else
+    {
+      inStreams_.erase(it);
+    }
+  }
+}
+
+void RpcChannel::onStreamResponse(const RpcMessage& message, StringPiece payload)
+{
+  OutstandingCall out = { NULL, NULL, NULL, TimerId(), false };
+  if (calls_->get(message.id(), &out)
+      && out.controller != NULL
+      && out.controller->responseReader_)
+  {
+    if (payload.data() != NULL
+        && out.response->ParseFromArray(payload.data(), payload.size()))
+    {
+      out.controller->responseReader_(out.response);
+      out.response->Clear();
+    }
+    else if (calls_->take(message.id(), &out))
+    {
+      if (out.hasTimer)
+      {
+        conn_->getLoop()->cancel(out.timer);
+      }
+      finishCall(out, INVALID_RESPONSE, std::string());
+    }
+  }
+}
+
+void RpcChannel::closeStreams()
+{
+  streams_.clear();
+  while (!inStreams_.empty())
+  {
+    endRequestStream(inStreams_.begin()->first);
+  }
 }
 
@@ -12,13 +12,17 @@
 #define MUDUO_NET_PROTORPC_RPCCHANNEL_H
 
 #include <muduo/base/Atomic.h>
-#include <muduo/base/Mutex.h>
+#include <muduo/net/TimerId.h>
 #include <muduo/net/protorpc/RpcCodec.h>
+#include <muduo/net/protorpc/RpcController.h>
 
 #include <google/protobuf/service.h>
 
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
 
+#include <list>
 #include <map>
 
 // Service and RpcChannel classes are incorporated from
@@ -81,6 +85,9 @@ namespace muduo
 namespace net
 {
 
+class EventLoop;
+class RpcExecutor;
+
 // Abstract interface for an RPC channel.  An RpcChannel represents a
 // communication line to a Service which can be used to call that Service's
 // methods.  The Service may be running on another machine.  Normally, you
@@ -90,7 +97,8 @@ namespace net
 //   RpcChannel* channel = new MyRpcChannel("remotehost.example.com:1234");
 //   MyService* service = new MyService::Stub(channel);
 //   service->MyMethod(request, &response, callback);
-class RpcChannel : public ::google::protobuf::RpcChannel
+class RpcChannel : public ::google::protobuf::RpcChannel,
+                   public boost::enable_shared_from_this<RpcChannel>
 {
  public:
   RpcChannel();
@@ -99,21 +107,95 @@ class RpcChannel : public ::google::protobuf::RpcChannel
 
   ~RpcChannel();
 
-  void setConnection(const TcpConnectionPtr& conn)
-  {
-    conn_ = conn;
-  }
+  /// Calls made after failOutstandingCalls() can be sent again.
+  void setConnection(const TcpConnectionPtr& conn);
 
   void setServices(const std::map<std::string, ::google::protobuf::Service*>* services)
   {
     services_ = services;
   }
 
+  /// Requests for services_ run in executor instead of the IO thread,
+  /// this channel must be owned by an RpcChannelPtr then.
+  void setExecutor(RpcExecutor* executor)
+  {
+    executor_ = executor;
+  }
+
+  /// Calls not answered within seconds fail with TIMEOUT, in the IO
+  /// thread of the connection, unless their RpcController has a timeout.
+  /// Timeouts are opt-in: 0, the default, waits forever, and arms no
+  /// timer per call. A call to a server that never answers then keeps
+  /// its response and done until failOutstandingCalls(), which must be
+  /// run when the connection is lost. Set a timeout unless the server is
+  /// trusted to answer every call.
+  /// Not thread safe, call before CallMethod().
+  void setCallTimeout(double seconds)
+  {
+    callTimeout_ = seconds;
+  }
+
+  /// Requests and responses sent in one iteration of the loop of the
+  /// connection, or within window seconds if it is positive, go out in
+  /// one write, as consecutive frames.
+  /// Not thread safe, call before CallMethod().
+  void enableBatching(double window = 0.0);
+
+  /// Outstanding calls are found by id in a table of slots without locking,
+  /// those whose slot is taken go to a map under a mutex.
+  /// Rounded up to a power of two, 256 by default.
+  /// Not thread safe, call before CallMethod().
+  void setCallSlots(int slots);
+
+  /// Streams are written while the output buffer of the connection holds
+  /// less than bytes, 1MB by default, and resumed once it is written out,
+  /// from the WriteCompleteCallback of the connection, which this sets.
+  /// Not thread safe, call before CallMethod().
+  void setStreamHighWaterMark(size_t bytes)
+  {
+    streamHighWaterMark_ = bytes;
+  }
+
+  /// Of the frames sent, kAdler32 by default. A channel answering calls
+  /// switches to that of the requests it gets, so it is set by the caller.
+  /// kNoChecksum needs setAllowNoChecksum(true) on the other end, and
+  /// sets it on this one, for the responses come back the same way.
+  /// Not thread safe with kNoChecksum, call before CallMethod() then.
+  void setChecksumType(ProtobufCodecLite::ChecksumType type)
+  {
+    if (type == ProtobufCodecLite::kNoChecksum && !allowNoChecksum_)
+    {
+      setAllowNoChecksum(true);
+    }
+    checksumType_.getAndSet(type);
+  }
+
+  /// Takes frames with no checksum, for trusted links, off by default.
+  /// Not thread safe, call before onMessage().
+  void setAllowNoChecksum(bool on)
+  {
+    allowNoChecksum_ = on;
+    codec_.setAllowNoChecksum(on);
+  }
+
+  static const size_t kDefaultArenaBlockSize = 4096;
+
+  /// The request and response of a call this channel answers are allocated
+  /// on a protobuf Arena, with a first block of bytes, 4KB by default, which
+  /// is reset and reused once done is run. 0 for the heap. Not for streams,
+  /// nor with protobuf 2, whose messages are always on the heap.
+  /// Not thread safe, call before onMessage().
+  void setArenaBlockSize(size_t bytes)
+  {
+    arenaBlockSize_ = bytes;
+  }
+
   // Call the given method of the remote service.  The signature of this
   // procedure looks the same as Service::CallMethod(), but the requirements
   // are less strict in one important way:  the request and response objects
   // need not be of any specific class as long as their descriptors are
   // method->input_type() and method->output_type().
+  // controller may be NULL, or a muduo::net::RpcController.
   void CallMethod(const ::google::protobuf::MethodDescriptor* method,
                   ::google::protobuf::RpcController* controller,
                   const ::google::protobuf::Message* request,
@@ -124,27 +206,136 @@ class RpcChannel : public ::google::protobuf::RpcChannel
                  Buffer* buf,
                  Timestamp receiveTime);
 
+  /// Runs done of the calls still outstanding, they fail with error,
+  /// e.g. UNAVAILABLE when the connection is lost. Calls made after
+  /// this, from any thread, fail at once with UNAVAILABLE until
+  /// setConnection(). In the IO thread of the connection.
+  void failOutstandingCalls(ErrorCode error);
+
+  /// Drops the streams being written and ends those being read, when the
+  /// connection is lost. In the IO thread of the connection.
+  void closeStreams();
+
  private:
+  // parses in place, the request or response is not copied out of buf
+  bool onRawMessage(const TcpConnectionPtr& conn,
+                    StringPiece frame,
+                    Timestamp receiveTime);
+
   void onRpcMessage(const TcpConnectionPtr& conn,
                     const RpcMessagePtr& messagePtr,
                     Timestamp receiveTime);
 
-  void doneCallback(::google::protobuf::Message* response, int64_t id);
+  // payload is the request or response field of message
+  void handleMessage(const TcpConnectionPtr& conn,
+                     const RpcMessage& message,
+                     StringPiece payload,
+                     Timestamp receiveTime);
+
+  typedef boost::shared_ptr< ::google::protobuf::Message> MessagePtr;
+
+  // in the IO thread, or in a thread of executor_
+  void callService(::google::protobuf::Service* service,
+                   const ::google::protobuf::MethodDescriptor* method,
+                   const MessagePtr& request,
+                   int64_t id,
+                   Timestamp deadline,
+                   Timestamp receiveTime,
+                   bool acceptStream,
+                   RpcController::StreamReader* requestReader);
+
+  void sendError(int64_t id, ErrorCode error);
+
+  ProtobufCodecLite::ChecksumType checksumType()
+  {
+    return static_cast<ProtobufCodecLite::ChecksumType>(checksumType_.get());
+  }
+
+  // a whole frame, now or batched
+  void sendFrame(Buffer* buf);
+  class Batch;
+
+  class ServerCall;
+  void doneCallback(ServerCall* call);
+
+  class ArenaPool;
+  MessagePtr newRequest(const ::google::protobuf::Message& prototype, bool useArena);
+
+  // the rest of a stream of requests or responses, in the IO thread
+  struct OutStream;
+  typedef boost::shared_ptr<OutStream> OutStreamPtr;
+  void startStream(const OutStreamPtr& stream);
+  void writeStreams();
+  bool writeStream(OutStream* stream, size_t* written);  // false at the end
+  void queueWriteStreams();
+  void writeQueuedStreams();
+  void onWriteComplete(const TcpConnectionPtr& conn);
+
+  // the requests of a call after the first one
+  struct InStream
+  {
+    InStream() : controller(NULL), reading(false), dropped(false) { }
+
+    RpcController::StreamReader reader;  // set by the service
+    boost::shared_ptr< ::google::protobuf::Message> next;
+    RpcController* controller;  // of the call, NULL once done is run
+    bool reading;  // reader is running
+    bool dropped;  // done was run by reader, erased once it returns
+  };
+  void onStreamRequest(const RpcMessage& message, StringPiece payload);
+  // the end of the stream, or of the connection, reader gets NULL
+  void endRequestStream(int64_t id);
+  // done is run, reader is not called again
+  void dropRequestStream(int64_t id);
+  void onStreamResponse(const RpcMessage& message, StringPiece payload);
 
   struct OutstandingCall
   {
     ::google::protobuf::Message* response;
     ::google::protobuf::Closure* done;
+    RpcController* controller;
+    TimerId timer;
+    bool hasTimer;
   };
 
+  class CallTable;
+
+  // runs done and deletes response, the call failed unless error is NO_ERROR
+  static void finishCall(const OutstandingCall& call,
+                         ErrorCode error,
+                         const std::string& reason);
+  static void onCallTimeout(const boost::weak_ptr<CallTable>& weakCalls, int64_t id);
+  static void onCallCanceled(const boost::weak_ptr<CallTable>& weakCalls,
+                             EventLoop* loop,
+                             int64_t id);
+  static void cancelInLoop(const boost::weak_ptr<CallTable>& weakCalls,
+                           EventLoop* loop,
+                           int64_t id);
+
   RpcCodec codec_;
   TcpConnectionPtr conn_;
   AtomicInt64 id_;
 
-  MutexLock mutex_;
-  std::map<int64_t, OutstandingCall> outstandings_;
+  boost::shared_ptr<CallTable> calls_;  // timers hold it weakly
+  double callTimeout_;
 
   const std::map<std::string, ::google::protobuf::Service*>* services_;
+  RpcExecutor* executor_;
+
+  boost::shared_ptr<Batch> batch_;  // flushes hold it
+  double batchWindow_;
+
+  AtomicInt32 checksumType_;
+  bool allowNoChecksum_;
+
+  size_t arenaBlockSize_;
+  boost::shared_ptr<ArenaPool> arenas_;  // in the IO thread, requests hold it
+
+  size_t streamHighWaterMark_;
+  bool writeCompleteCallbackSet_;
+  bool writeQueued_;  // writeQueuedStreams() is in the loop
+  std::list<OutStreamPtr> streams_;  // in the IO thread, written in turn
+  std::map<int64_t, InStream> inStreams_;  // in the IO thread
 };
 typedef boost::shared_ptr<RpcChannel> RpcChannelPtr;
 
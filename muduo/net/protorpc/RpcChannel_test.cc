@@ -0,0 +1,305 @@
+#undef NDEBUG
+#include <muduo/net/protorpc/RpcChannel.h>
+#include <muduo/net/protorpc/RpcCodec.h>
+#include <muduo/net/protorpc/RpcController.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <assert.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// The table of outstanding calls of RpcChannel, driven through a
+// connection which is never established: requests go nowhere and
+// responses are handed to onMessage(). A channel numbers its calls
+// from 1 in call order.
+
+namespace
+{
+
+const ::google::protobuf::MethodDescriptor* buildMethod()
+{
+  static ::google::protobuf::DescriptorPool pool;
+  ::google::protobuf::FileDescriptorProto file;
+  file.set_name("RpcChannel_test.proto");
+  file.set_package("test");
+  file.add_message_type()->set_name("Empty");
+  ::google::protobuf::ServiceDescriptorProto* service = file.add_service();
+  service->set_name("TestService");
+  ::google::protobuf::MethodDescriptorProto* method = service->add_method();
+  method->set_name("Call");
+  method->set_input_type(".test.Empty");
+  method->set_output_type(".test.Empty");
+  return pool.BuildFile(file)->service(0)->method(0);
+}
+
+const ::google::protobuf::MethodDescriptor* testMethod()
+{
+  static const ::google::protobuf::MethodDescriptor* method = buildMethod();
+  return method;
+}
+
+struct Call
+{
+  Call() : error(NO_ERROR), answer(0) { }
+
+  RpcController controller;
+  AtomicInt32 runs;
+  ErrorCode error;
+  int64_t answer;  // id in the response, 0 if none
+};
+
+AtomicInt32 g_finished;
+
+void finished(Call* call, RpcMessage* response)
+{
+  call->error = call->controller.errorCode();
+  call->answer = response->id();
+  call->runs.increment();
+  g_finished.increment();
+}
+
+void startCall(RpcChannel* channel, Call* call)
+{
+  RpcMessage request;
+  request.set_type(REQUEST);
+  request.set_id(0);
+  // deleted by the channel once done is run
+  RpcMessage* response = new RpcMessage;
+  channel->CallMethod(testMethod(), &call->controller, &request, response,
+                      ::google::protobuf::NewCallback(finished, call, response));
+}
+
+// the response to call id carries id
+void respond(RpcChannel* channel, const TcpConnectionPtr& conn, int64_t id)
+{
+  RpcMessage message;
+  message.set_type(RESPONSE);
+  message.set_id(id);
+  RpcMessage payload;
+  payload.set_type(RESPONSE);
+  payload.set_id(id);
+  Buffer buf;
+  fillRpcBuffer(&buf, message, payload);
+  channel->onMessage(conn, &buf, Timestamp::now());
+  assert(buf.readableBytes() == 0);
+}
+
+void respondAll(RpcChannel* channel, const TcpConnectionPtr& conn, int64_t last)
+{
+  for (int64_t id = 1; id <= last; ++id)
+  {
+    respond(channel, conn, id);
+  }
+}
+
+TcpConnectionPtr newConnection(EventLoop* loop)
+{
+  int fds[2];
+  int ret = ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+  assert(ret == 0); (void)ret;
+  InetAddress addr;
+  return TcpConnectionPtr(new TcpConnection(loop, "RpcChannelTest", fds[0], addr, addr));
+}
+
+// kept until _exit(), a TcpConnection must be closed before it is destroyed
+std::vector<TcpConnectionPtr> g_connections;
+
+// calls whose slot is taken go to the overflow map
+void testCollisions(EventLoop* loop)
+{
+  TcpConnectionPtr conn(newConnection(loop));
+  g_connections.push_back(conn);
+  RpcChannelPtr channel(new RpcChannel(conn));
+  channel->setCallSlots(4);
+  const int kCalls = 20;
+  boost::ptr_vector<Call> calls;
+  for (int i = 0; i < kCalls; ++i)
+  {
+    calls.push_back(new Call);
+    startCall(get_pointer(channel), &calls.back());
+  }
+  // in slots and out of them, the other way round
+  for (int64_t id = kCalls; id > 0; id -= 2)
+  {
+    respond(get_pointer(channel), conn, id);
+  }
+  for (int64_t id = 1; id <= kCalls; id += 2)
+  {
+    respond(get_pointer(channel), conn, id);
+  }
+  respond(get_pointer(channel), conn, 3);  // again
+  respond(get_pointer(channel), conn, 99);  // no such call
+  for (int i = 0; i < kCalls; ++i)
+  {
+    assert(calls[i].runs.get() == 1);
+    assert(calls[i].error == NO_ERROR);
+    assert(calls[i].answer == i + 1);
+  }
+
+  // a slot freed is used again, 21 goes where 1 was
+  calls.push_back(new Call);
+  startCall(get_pointer(channel), &calls.back());
+  assert(calls.back().runs.get() == 0);
+  respond(get_pointer(channel), conn, kCalls + 1);
+  assert(calls.back().runs.get() == 1);
+  assert(calls.back().answer == kCalls + 1);
+}
+
+// failOutstandingCalls() takes all, from slots and overflow
+void testTakeAll(EventLoop* loop)
+{
+  TcpConnectionPtr conn(newConnection(loop));
+  g_connections.push_back(conn);
+  RpcChannelPtr channel(new RpcChannel(conn));
+  channel->setCallSlots(2);
+  const int kCalls = 10;
+  boost::ptr_vector<Call> calls;
+  for (int i = 0; i < kCalls; ++i)
+  {
+    calls.push_back(new Call);
+    startCall(get_pointer(channel), &calls.back());
+  }
+  respond(get_pointer(channel), conn, 1);
+  respond(get_pointer(channel), conn, 6);
+  channel->failOutstandingCalls(UNAVAILABLE);
+  respond(get_pointer(channel), conn, 2);  // too late
+  for (int i = 0; i < kCalls; ++i)
+  {
+    assert(calls[i].runs.get() == 1);
+    bool answered = i == 0 || i == 5;
+    assert(calls[i].error == (answered ? NO_ERROR : UNAVAILABLE));
+    assert(calls[i].answer == (answered ? i + 1 : 0));
+  }
+
+  // closed until the next connection
+  calls.push_back(new Call);
+  startCall(get_pointer(channel), &calls.back());
+  assert(calls.back().runs.get() == 1);
+  assert(calls.back().error == UNAVAILABLE);
+
+  channel->setConnection(conn);
+  calls.push_back(new Call);
+  startCall(get_pointer(channel), &calls.back());
+  assert(calls.back().runs.get() == 0);
+  respond(get_pointer(channel), conn, kCalls + 2);
+  assert(calls.back().runs.get() == 1);
+  assert(calls.back().error == NO_ERROR);
+}
+
+void respondAllAndCountDown(RpcChannel* channel, const TcpConnectionPtr& conn,
+                            int64_t last, CountDownLatch* latch)
+{
+  respondAll(channel, conn, last);
+  latch->countDown();
+}
+
+void cancelAll(boost::ptr_vector<Call>* calls)
+{
+  for (size_t i = 0; i < calls->size(); ++i)
+  {
+    (*calls)[i].controller.StartCancel();
+  }
+}
+
+// the response, the timeout and a cancel race for each call,
+// exactly one of them finishes it
+void testRaces()
+{
+  EventLoopThread loopThread;
+  EventLoop* loop = loopThread.startLoop();
+  TcpConnectionPtr conn(newConnection(loop));
+  g_connections.push_back(conn);
+  RpcChannelPtr channel(new RpcChannel(conn));
+  channel->setCallSlots(64);
+  const int kCalls = 20000;
+  boost::ptr_vector<Call> calls;
+  for (int i = 0; i < kCalls; ++i)
+  {
+    calls.push_back(new Call);
+    calls.back().controller.setTimeout(0.001);
+  }
+
+  g_finished.getAndSet(0);
+  Thread canceler(boost::bind(cancelAll, &calls), "canceler");
+  canceler.start();
+  for (int i = 0; i < kCalls; ++i)
+  {
+    startCall(get_pointer(channel), &calls[i]);
+    if (i % 1000 == 999)
+    {
+      loop->runInLoop(boost::bind(respondAll, get_pointer(channel), conn, i + 1));
+    }
+  }
+  canceler.join();
+  // cancels missed by the canceler
+  cancelAll(&calls);
+  while (g_finished.get() < kCalls)
+  {
+    usleep(1000);
+  }
+  // late ones are ignored
+  CountDownLatch latch(1);
+  loop->runInLoop(boost::bind(respondAllAndCountDown, get_pointer(channel), conn,
+                              kCalls, &latch));
+  latch.wait();
+
+  int answered = 0, timedOut = 0, canceled = 0;
+  for (int i = 0; i < kCalls; ++i)
+  {
+    assert(calls[i].runs.get() == 1);
+    switch (calls[i].error)
+    {
+      case NO_ERROR:
+        assert(calls[i].answer == i + 1);
+        ++answered;
+        break;
+      case TIMEOUT:
+        ++timedOut;
+        break;
+      case CANCELED:
+        ++canceled;
+        break;
+      default:
+        assert(false);
+    }
+  }
+  printf("races: %d answered, %d timed out, %d canceled\n", answered, timedOut, canceled);
+}
+
+// a timeout is logged as a warning
+void discardOutput(const char*, int)
+{
+}
+
+}
+
+int main()
+{
+  Logger::setOutput(discardOutput);
+  EventLoop loop;
+  testCollisions(&loop);
+  testTakeAll(&loop);
+  testRaces();
+  printf("all tests passed\n");
+  fflush(stdout);
+  // the connections are never closed
+  _exit(0);
+}
@@ -15,6 +15,9 @@
 #include <muduo/net/protorpc/rpc.pb.h>
 #include <muduo/net/protorpc/google-inl.h>
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
 #include <boost/bind.hpp>
 
 using namespace muduo;
@@ -37,3 +40,123 @@ namespace net
 const char rpctag [] = "RPC0";
 }
 }
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+namespace
+{
+  const int kTagLen = sizeof rpctag - 1;
+
+  bool isPayloadField(uint32_t tag)
+  {
+    int field = WireFormatLite::GetTagFieldNumber(tag);
+    return (field == RpcMessage::kRequestFieldNumber
+            || field == RpcMessage::kResponseFieldNumber)
+        && WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED;
+  }
+}
+
+void muduo::net::fillRpcBuffer(Buffer* buf,
+                               const RpcMessage& message,
+                               const ::google::protobuf::Message& payload,
+                               ProtobufCodecLite::ChecksumType checksumType)
+{
+  assert(buf->readableBytes() == 0);
+  assert(!message.has_request() && !message.has_response());
+  GOOGLE_DCHECK(payload.IsInitialized()) << InitializationErrorMessage("serialize", payload);
+  ProtobufCodecLite::appendTag(buf, StringPiece(rpctag, kTagLen), checksumType);
+
+  // the field of a bytes value: key, length, then the serialized payload
+  const int field = message.type() == RESPONSE ? RpcMessage::kResponseFieldNumber
+                                               : RpcMessage::kRequestFieldNumber;
+  const uint32_t key = WireFormatLite::MakeTag(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  const int payloadSize = ProtobufCodecLite::byteSize(payload);
+  const int headerSize = ProtobufCodecLite::byteSize(message)
+      + static_cast<int>(CodedOutputStream::VarintSize32(key)
+                         + CodedOutputStream::VarintSize32(payloadSize));
+  const int byteSize = headerSize + payloadSize;
+  buf->ensureWritableBytes(byteSize + ProtobufCodecLite::kChecksumLen);
+
+  uint8_t* start = reinterpret_cast<uint8_t*>(buf->beginWrite());
+  uint8_t* end = message.SerializeWithCachedSizesToArray(start);
+  end = CodedOutputStream::WriteTagToArray(key, end);
+  end = CodedOutputStream::WriteVarint32ToArray(payloadSize, end);
+  end = payload.SerializeWithCachedSizesToArray(end);
+  if (end - start != byteSize)
+  {
+    ByteSizeConsistencyError(payloadSize, ProtobufCodecLite::byteSize(payload),
+                             static_cast<int>(end - start) - headerSize);
+  }
+  buf->hasWritten(byteSize);
+
+  ProtobufCodecLite::appendChecksum(buf, checksumType);
+  int32_t len = sockets::hostToNetwork32(static_cast<int32_t>(buf->readableBytes()));
+  buf->prepend(&len, sizeof len);
+}
+
+bool muduo::net::parseRpcFrame(StringPiece frame,
+                               RpcMessage* message,
+                               StringPiece* payload,
+                               bool allowNoChecksum,
+                               ProtobufCodecLite::ChecksumType* checksumType)
+{
+  const int kHeaderLen = ProtobufCodecLite::kHeaderLen;
+  const int kChecksumLen = ProtobufCodecLite::kChecksumLen;
+  ProtobufCodecLite::ChecksumType type = ProtobufCodecLite::kAdler32;
+  if (frame.size() < kHeaderLen + kTagLen + kChecksumLen
+      || ProtobufCodecLite::validateFrame(StringPiece(rpctag, kTagLen),
+                                          frame.data() + kHeaderLen,
+                                          frame.size() - kHeaderLen,
+                                          allowNoChecksum,
+                                          &type) != ProtobufCodecLite::kNoError)
+  {
+    return false;
+  }
+  if (checksumType)
+  {
+    *checksumType = type;
+  }
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(frame.data() + kHeaderLen + kTagLen);
+  const int size = frame.size() - kHeaderLen - kTagLen - kChecksumLen;
+
+  // finds the payload field, skipping the others
+  int fieldBegin = size;
+  int fieldEnd = size;
+  *payload = StringPiece();
+  CodedInputStream input(data, size);
+  while (input.CurrentPosition() < size)
+  {
+    const int position = input.CurrentPosition();
+    const uint32_t tag = input.ReadTag();
+    if (isPayloadField(tag))
+    {
+      uint32_t length = 0;
+      // a frame with both fields is left to the full parse
+      if (payload->data() != NULL
+          || !input.ReadVarint32(&length)
+          || length > static_cast<uint32_t>(size - input.CurrentPosition()))
+      {
+        return false;
+      }
+      fieldBegin = position;
+      payload->set(data + input.CurrentPosition(), static_cast<int>(length));
+      input.Skip(static_cast<int>(length));
+      fieldEnd = input.CurrentPosition();
+    }
+    else if (tag == 0 || !WireFormatLite::SkipField(&input, tag))
+    {
+      return false;
+    }
+  }
+
+  // the fields around it, usually all before it
+  bool ok = message->ParsePartialFromArray(data, fieldBegin);
+  if (ok && fieldEnd < size)
+  {
+    CodedInputStream after(data + fieldEnd, size - fieldEnd);
+    ok = message->MergePartialFromCodedStream(&after);
+  }
+  return ok && message->IsInitialized();
+}
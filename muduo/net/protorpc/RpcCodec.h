@@ -11,6 +11,7 @@
 #ifndef MUDUO_NET_PROTORPC_RPCCODEC_H
 #define MUDUO_NET_PROTORPC_RPCCODEC_H
 
+#include <muduo/base/StringPiece.h>
 #include <muduo/base/Timestamp.h>
 #include <muduo/net/protobuf/ProtobufCodecLite.h>
 
@@ -40,9 +41,33 @@ extern const char rpctag[];// = "RPC0";
 // payload   N-byte
 // checksum  4-byte  adler32 of "RPC0"+payload
 //
+// or "RPCC" with CRC-32C, or "RPCN" with no checksum, see ProtobufCodecLite.
+//
 
 typedef ProtobufCodecLiteT<RpcMessage, rpctag> RpcCodec;
 
+// The request or response of an RpcMessage is a message of its own,
+// these put it on the wire and take it off without the nested string
+// of set_request(request.SerializeAsString()).
+
+/// Like RpcCodec::fillEmptyBuffer(), with payload serialized straight into
+/// buf as the request field of message, or the response field if it is a
+/// RESPONSE. The bytes are the same as if the field were set.
+void fillRpcBuffer(Buffer* buf,
+                   const RpcMessage& message,
+                   const ::google::protobuf::Message& payload,
+                   ProtobufCodecLite::ChecksumType checksumType = ProtobufCodecLite::kAdler32);
+
+/// Parses a frame passed to RpcCodec's RawMessageCallback, except the
+/// request or response field, which *payload points to inside frame,
+/// with data() NULL if there is none. Returns false if the frame is bad.
+/// The checksum of the frame goes to *checksumType if it is not NULL.
+bool parseRpcFrame(StringPiece frame,
+                   RpcMessage* message,
+                   StringPiece* payload,
+                   bool allowNoChecksum = false,
+                   ProtobufCodecLite::ChecksumType* checksumType = NULL);
+
 }
 }
 
@@ -0,0 +1,65 @@
+#include <muduo/base/Crc32c.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/protobuf/ProtobufCodecLite.h>
+#include <muduo/net/protorpc/RpcCodec.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int g_received = 0;
+
+void messageCallback(const TcpConnectionPtr&,
+                     const MessagePtr&,
+                     Timestamp)
+{
+  ++g_received;
+}
+
+// MB/s of encoding and decoding messages of size bytes, in frames of type
+double bench(int size, ProtobufCodecLite::ChecksumType type)
+{
+  ProtobufCodecLite codec(&RpcMessage::default_instance(), "RPC0", messageCallback);
+  codec.setChecksumType(type);
+  codec.setAllowNoChecksum(true);
+  RpcMessage message;
+  message.set_type(REQUEST);
+  message.set_id(1);
+  message.set_request(std::string(size, 'x'));
+
+  const int64_t kTotalBytes = 1024 * 1024 * 1024;
+  const int n = static_cast<int>(std::max<int64_t>(kTotalBytes / size, 10));
+  g_received = 0;
+  Buffer buf;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    codec.fillEmptyBuffer(&buf, message);
+    codec.onMessage(TcpConnectionPtr(), &buf, start);
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  if (g_received != n)
+  {
+    abort();
+  }
+  return static_cast<double>(size) * n / seconds / (1024 * 1024);
+}
+
+int main()
+{
+  printf("CRC-32C in %s\n", Crc32c::isHardware() ? "hardware" : "software");
+  printf("%10s %12s %12s %12s\n", "size", "adler32", "crc32c", "none");
+  const int sizes[] = { 64, 1024, 16*1024, 256*1024, 1024*1024, 4*1024*1024 };
+  for (size_t i = 0; i < sizeof sizes / sizeof sizes[0]; ++i)
+  {
+    printf("%10d %9.0fMB/s %9.0fMB/s %9.0fMB/s\n", sizes[i],
+           bench(sizes[i], ProtobufCodecLite::kAdler32),
+           bench(sizes[i], ProtobufCodecLite::kCrc32c),
+           bench(sizes[i], ProtobufCodecLite::kNoChecksum));
+  }
+  google::protobuf::ShutdownProtobufLibrary();
+}
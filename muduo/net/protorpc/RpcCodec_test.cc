@@ -1,10 +1,12 @@
 #undef NDEBUG
+#include <muduo/base/Crc32c.h>
 #include <muduo/net/protorpc/RpcCodec.h>
 #include <muduo/net/protorpc/rpc.pb.h>
 #include <muduo/net/protobuf/ProtobufCodecLite.h>
 #include <muduo/net/Buffer.h>
 
 #include <stdio.h>
+#include <string.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -23,6 +25,16 @@ void messageCallback(const TcpConnectionPtr&,
   g_msgptr = msg;
 }
 
+ProtobufCodecLite::ErrorCode g_error;
+void errorCallback(const TcpConnectionPtr&,
+                   Buffer* buf,
+                   Timestamp,
+                   ProtobufCodecLite::ErrorCode error)
+{
+  g_error = error;
+  buf->retrieveAll();
+}
+
 void print(const Buffer& buf)
 {
   printf("encoded to %zd bytes\n", buf.readableBytes());
@@ -77,5 +89,102 @@ int main()
   assert(g_msgptr->DebugString() == message.DebugString());
   }
 
+  {
+  // the payload serialized in place is the same as the bytes field set
+  RpcMessage payload;
+  payload.set_type(RESPONSE);
+  payload.set_id(42);
+  payload.set_service(std::string(300, 's'));
+  RpcMessage request(message);
+  request.set_service("EchoService");
+  request.set_method("Echo");
+  Buffer buf3, buf4;
+  RpcCodec codec(rpcMessageCallback);
+  fillRpcBuffer(&buf3, request, payload);
+  request.set_request(payload.SerializeAsString());
+  codec.fillEmptyBuffer(&buf4, request);
+  assert(buf3.toStringPiece() == buf4.toStringPiece());
+
+  RpcMessage parsed;
+  StringPiece bytes;
+  assert(parseRpcFrame(buf3.toStringPiece(), &parsed, &bytes));
+  assert(bytes.data() > buf3.peek() && bytes.data() < buf3.peek() + buf3.readableBytes());
+  assert(bytes == request.request());
+  assert(!parsed.has_request());
+  parsed.set_request(bytes.data(), bytes.size());
+  assert(parsed.DebugString() == request.DebugString());
+
+  assert(parseRpcFrame(expected, &parsed, &bytes));
+  assert(bytes.data() == NULL);
+  assert(parsed.DebugString() == message.DebugString());
+
+  // both fields are left to the codec
+  Buffer buf5;
+  request.set_response("x");
+  codec.fillEmptyBuffer(&buf5, request);
+  assert(!parseRpcFrame(buf5.toStringPiece(), &parsed, &bytes));
+
+  // bad checksum
+  string bad = buf3.retrieveAllAsString();
+  bad[bad.size() - 10] ^= 1;
+  assert(!parseRpcFrame(bad, &parsed, &bytes));
+  }
+
+  {
+  // the last byte of the tag tells the checksum
+  ProtobufCodecLite codec(&RpcMessage::default_instance(), "RPC0", messageCallback,
+                          ProtobufCodecLite::RawMessageCallback(), errorCallback);
+  Buffer crc, none;
+  codec.fillEmptyBuffer(&crc, message, ProtobufCodecLite::kCrc32c);
+  codec.fillEmptyBuffer(&none, message, ProtobufCodecLite::kNoChecksum);
+  assert(crc.readableBytes() == expected.size());
+  assert(memcmp(crc.peek() + 4, "RPCC", 4) == 0);
+  assert(memcmp(none.peek() + 4, "RPCN", 4) == 0);
+  const int len = static_cast<int>(crc.readableBytes());
+  assert(ProtobufCodecLite::asInt32(crc.peek() + len - 4)
+         == static_cast<int32_t>(Crc32c::value(crc.peek() + 4, len - 8)));
+  assert(ProtobufCodecLite::asInt32(none.peek() + len - 4) == 0);
+  string crcFrame = crc.toStringPiece().as_string();
+  string noneFrame = none.toStringPiece().as_string();
+
+  g_msgptr.reset();
+  codec.onMessage(TcpConnectionPtr(), &crc, Timestamp::now());
+  assert(g_msgptr);
+  assert(g_msgptr->DebugString() == message.DebugString());
+
+  g_msgptr.reset();
+  g_error = ProtobufCodecLite::kNoError;
+  codec.onMessage(TcpConnectionPtr(), &none, Timestamp::now());
+  assert(!g_msgptr);
+  assert(g_error == ProtobufCodecLite::kCheckSumError);
+  codec.setAllowNoChecksum(true);
+  none.append(noneFrame);
+  codec.onMessage(TcpConnectionPtr(), &none, Timestamp::now());
+  assert(g_msgptr);
+
+  crcFrame[9] ^= 1;
+  crc.append(crcFrame);
+  g_error = ProtobufCodecLite::kNoError;
+  codec.onMessage(TcpConnectionPtr(), &crc, Timestamp::now());
+  assert(g_error == ProtobufCodecLite::kCheckSumError);
+
+  // the raw path too
+  RpcMessage payload;
+  payload.set_type(RESPONSE);
+  payload.set_id(43);
+  RpcMessage parsed;
+  StringPiece bytes;
+  ProtobufCodecLite::ChecksumType type = ProtobufCodecLite::kAdler32;
+  Buffer buf6, buf7;
+  fillRpcBuffer(&buf6, message, payload, ProtobufCodecLite::kCrc32c);
+  assert(parseRpcFrame(buf6.toStringPiece(), &parsed, &bytes, false, &type));
+  assert(type == ProtobufCodecLite::kCrc32c);
+  assert(bytes == payload.SerializeAsString());
+  fillRpcBuffer(&buf7, message, payload, ProtobufCodecLite::kNoChecksum);
+  assert(!parseRpcFrame(buf7.toStringPiece(), &parsed, &bytes));
+  assert(parseRpcFrame(buf7.toStringPiece(), &parsed, &bytes, true, &type));
+  assert(type == ProtobufCodecLite::kNoChecksum);
+  }
+
   google::protobuf::ShutdownProtobufLibrary();
 }
@@ -0,0 +1,112 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/protorpc/RpcController.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+RpcController::RpcController()
+  : timeout_(0),
+    errorCode_(NO_ERROR),
+    cancelCallback_(NULL),
+    acceptStream_(false),
+    requestReader_(NULL)
+{
+}
+
+RpcController::~RpcController()
+{
+  delete cancelCallback_;
+}
+
+void RpcController::Reset()
+{
+  timeout_ = 0;
+  errorCode_ = NO_ERROR;
+  reason_.clear();
+  deadline_ = Timestamp();
+  setCancel(boost::function<void ()>());
+  delete cancelCallback_;
+  cancelCallback_ = NULL;
+  requestWriter_ = StreamWriter();
+  responseReader_ = StreamReader();
+}
+
+bool RpcController::Failed() const
+{
+  return errorCode_ != NO_ERROR;
+}
+
+std::string RpcController::ErrorText() const
+{
+  if (!Failed())
+  {
+    return std::string();
+  }
+  return reason_.empty() ? ErrorCode_Name(errorCode_) : reason_;
+}
+
+void RpcController::StartCancel()
+{
+  boost::function<void ()> cancel;
+  {
+    MutexLockGuard lock(mutex_);
+    cancel.swap(cancel_);
+  }
+  if (cancel)
+  {
+    cancel();
+  }
+}
+
+void RpcController::SetFailed(const std::string& reason)
+{
+  setFailed(FAILED, reason);
+}
+
+bool RpcController::IsCanceled() const
+{
+  return deadline_.valid() && Timestamp::now() > deadline_;
+}
+
+void RpcController::NotifyOnCancel(::google::protobuf::Closure* callback)
+{
+  assert(cancelCallback_ == NULL);
+  if (IsCanceled())
+  {
+    callback->Run();
+  }
+  else
+  {
+    cancelCallback_ = callback;
+  }
+}
+
+bool RpcController::setRequestReader(const StreamReader& reader)
+{
+  if (requestReader_)
+  {
+    *requestReader_ = reader;
+  }
+  return requestReader_ != NULL;
+}
+
+void RpcController::setFailed(ErrorCode code, const std::string& reason)
+{
+  errorCode_ = code;
+  reason_ = reason;
+}
+
+void RpcController::setCancel(const boost::function<void ()>& cancel)
+{
+  MutexLockGuard lock(mutex_);
+  cancel_ = cancel;
+}
+
+::google::protobuf::Closure* RpcController::takeCancelCallback()
+{
+  ::google::protobuf::Closure* callback = cancelCallback_;
+  cancelCallback_ = NULL;
+  return callback;
+}
@@ -0,0 +1,152 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_PROTORPC_RPCCONTROLLER_H
+#define MUDUO_NET_PROTORPC_RPCCONTROLLER_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/protorpc/rpc.pb.h>
+
+#include <google/protobuf/service.h>
+
+#include <boost/function.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+/// The RpcController of RpcChannel.
+///
+/// On the client side it sets the timeout of one call, can cancel it, and
+/// tells why it failed after done is run. Reset() it before reusing it.
+///
+/// On the server side a service gets one with every request, for the
+/// deadline of the caller and to fail the call with SetFailed().
+///
+/// Either side may stream, for payloads too large for one message: the
+/// requests or responses of a call are then a sequence of messages, each
+/// in a frame of its own, and never all in memory. A writer is called in
+/// the IO thread of the connection while its output buffer is below the
+/// high-water mark of the channel, and again once the buffer is written
+/// out. A reader gets each message as it is parsed, in the IO thread.
+/// The channel must be owned by an RpcChannelPtr.
+class RpcController : public ::google::protobuf::RpcController
+{
+ public:
+  /// Fills next, which is empty, with the next message of the stream.
+  /// Returns false if there are no more, next is not sent then.
+  typedef boost::function<bool (::google::protobuf::Message* next)> StreamWriter;
+  /// message is valid only during the call.
+  typedef boost::function<void (const ::google::protobuf::Message* message)> StreamReader;
+
+  RpcController();
+  virtual ~RpcController();
+
+  // client side
+
+  virtual void Reset();
+  virtual bool Failed() const;
+  virtual std::string ErrorText() const;
+
+  /// Thread safe. The call fails with CANCELED, done is run right away
+  /// if it is still outstanding. The server is not told.
+  virtual void StartCancel();
+
+  /// The call fails with TIMEOUT if there is no response within seconds,
+  /// and the server drops it if it has not started on it by then.
+  /// 0 for the setCallTimeout() of the channel, the default.
+  void setTimeout(double seconds)
+  { timeout_ = seconds; }
+
+  double timeout() const
+  { return timeout_; }
+
+  ErrorCode errorCode() const
+  { return errorCode_; }
+
+  /// Client streaming: the request passed to CallMethod() is the first of
+  /// the stream, writer fills the rest. Set before CallMethod().
+  void setRequestWriter(const StreamWriter& writer)
+  { requestWriter_ = writer; }
+
+  /// Server streaming: reader gets the responses before the last one,
+  /// which is left in the response passed to CallMethod() as usual.
+  /// Set before CallMethod(). A cancel of the call takes effect in the
+  /// IO thread, so that the response outlives reader.
+  void setResponseReader(const StreamReader& reader)
+  { responseReader_ = reader; }
+
+  // server side
+
+  /// The response is replaced by a FAILED error with reason.
+  virtual void SetFailed(const std::string& reason);
+
+  /// True once the deadline of the caller has passed.
+  virtual bool IsCanceled() const;
+
+  /// callback is run at once if IsCanceled(), otherwise after the
+  /// response is sent.
+  virtual void NotifyOnCancel(::google::protobuf::Closure* callback);
+
+  /// When the caller gives up, invalid if it did not say.
+  Timestamp deadline() const
+  { return deadline_; }
+
+  /// Client streaming: reader gets the requests after the first one, which
+  /// is passed to the method, then NULL at the end of the stream, or when
+  /// it is cut short. Set it in the method, which is called in the IO
+  /// thread, never in an executor, for a stream of requests, and so must
+  /// done be run, by the method or from reader. Once done is run reader is
+  /// not called again, it gets no NULL then.
+  /// Returns false if the requests do not stream, reader is not called.
+  bool setRequestReader(const StreamReader& reader);
+
+  /// Server streaming: the caller takes a stream of responses.
+  bool acceptsResponseStream() const
+  { return acceptStream_; }
+
+  /// Server streaming: once done is run, writer fills responses sent before
+  /// the response passed to the method, which goes last. The call fails
+  /// with NO_STREAM if the caller takes no stream.
+  void setResponseWriter(const StreamWriter& writer)
+  { responseWriter_ = writer; }
+
+ private:
+  friend class BalancedRpcChannel;
+  friend class RpcChannel;
+
+  void setFailed(ErrorCode code, const std::string& reason);
+  void setCancel(const boost::function<void ()>& cancel);
+  void setDeadline(Timestamp deadline)
+  { deadline_ = deadline; }
+  void setStreams(bool acceptStream, StreamReader* requestReader)
+  {
+    acceptStream_ = acceptStream;
+    requestReader_ = requestReader;
+  }
+  // the closure of NotifyOnCancel(), if any
+  ::google::protobuf::Closure* takeCancelCallback();
+
+  double timeout_;
+  ErrorCode errorCode_;
+  std::string reason_;
+  Timestamp deadline_;
+  MutexLock mutex_;
+  boost::function<void ()> cancel_;  // guarded by mutex_, set while a call is outstanding
+  ::google::protobuf::Closure* cancelCallback_;
+
+  StreamWriter requestWriter_;
+  StreamReader responseReader_;
+  bool acceptStream_;
+  StreamReader* requestReader_;  // in the channel, NULL unless the requests stream
+  StreamWriter responseWriter_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_PROTORPC_RPCCONTROLLER_H
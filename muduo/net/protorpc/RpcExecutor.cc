@@ -0,0 +1,243 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/protorpc/RpcExecutor.h>
+
+#include <muduo/base/LatencyHistogram.h>
+#include <muduo/base/LogStream.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/ThreadPool.h>
+#include <muduo/net/EventLoop.h>
+
+#include <google/protobuf/descriptor.h>
+
+#include <algorithm>
+#include <deque>
+
+using namespace muduo;
+using namespace muduo::net;
+
+struct RpcExecutor::Call
+{
+  EventLoop* loop;
+  Task task;
+  Task reject;
+};
+
+struct RpcExecutor::Method : boost::noncopyable
+{
+  explicit Method(const std::string& fullName)
+    : name(fullName.c_str()),
+      latency("rpc." + name),
+      pool(NULL),
+      hasPool(false),
+      maxRunning(0),
+      maxQueued(0),
+      running(0),
+      peakQueued(0),
+      calls(0),
+      rejected(0),
+      expired(0)
+  {
+  }
+
+  const string name;
+  LatencyHistogram latency;
+  ThreadPool* pool;
+  bool hasPool;
+  int maxRunning;
+  int maxQueued;
+
+  MutexLock mutex;
+  int running;
+  std::deque<Call> queue;
+  size_t peakQueued;
+  int64_t calls;
+  int64_t rejected;
+  int64_t expired;
+};
+
+RpcExecutor::RpcExecutor()
+  : pool_(NULL)
+{
+}
+
+RpcExecutor::~RpcExecutor()
+{
+}
+
+void RpcExecutor::addService(const google::protobuf::ServiceDescriptor* desc)
+{
+  for (int i = 0; i < desc->method_count(); ++i)
+  {
+    const google::protobuf::MethodDescriptor* method = desc->method(i);
+    if (methods_.find(method) == methods_.end())
+    {
+      methods_[method].reset(new Method(method->full_name()));
+    }
+  }
+}
+
+bool RpcExecutor::setMethodOptions(const std::string& fullName,
+                                   ThreadPool* pool,
+                                   int maxRunning,
+                                   int maxQueued)
+{
+  for (std::map<const google::protobuf::MethodDescriptor*, boost::shared_ptr<Method> >::iterator it
+         = methods_.begin();
+       it != methods_.end();
+       ++it)
+  {
+    if (it->first->full_name() == fullName)
+    {
+      Method* m = get_pointer(it->second);
+      m->pool = pool;
+      m->hasPool = true;
+      m->maxRunning = maxRunning;
+      m->maxQueued = maxQueued;
+      return true;
+    }
+  }
+  return false;
+}
+
+RpcExecutor::Method* RpcExecutor::find(const google::protobuf::MethodDescriptor* method) const
+{
+  std::map<const google::protobuf::MethodDescriptor*, boost::shared_ptr<Method> >::const_iterator it
+    = methods_.find(method);
+  assert(it != methods_.end());
+  return get_pointer(it->second);
+}
+
+void RpcExecutor::submit(const google::protobuf::MethodDescriptor* method,
+                         EventLoop* loop,
+                         const Task& task,
+                         const Task& reject)
+{
+  Method* m = find(method);
+  Call call = { loop, task, reject };
+  bool admitted = true;
+  {
+    MutexLockGuard lock(m->mutex);
+    ++m->calls;
+    if (m->maxRunning > 0 && m->running >= m->maxRunning)
+    {
+      if (m->queue.size() < static_cast<size_t>(m->maxQueued))
+      {
+        m->queue.push_back(call);
+        m->peakQueued = std::max(m->peakQueued, m->queue.size());
+        return;
+      }
+      ++m->rejected;
+      admitted = false;
+    }
+    else
+    {
+      ++m->running;
+    }
+  }
+
+  if (!admitted)
+  {
+    reject();
+  }
+  else if (!start(m, call, false))
+  {
+    release(m, false);
+  }
+}
+
+bool RpcExecutor::start(Method* m, const Call& call, bool queued)
+{
+  ThreadPool* pool = m->hasPool ? m->pool : pool_;
+  if (pool)
+  {
+    if (!pool->tryRun(call.task))
+    {
+      {
+        MutexLockGuard lock(m->mutex);
+        ++m->rejected;
+      }
+      call.reject();
+      return false;
+    }
+  }
+  else if (queued)
+  {
+    // not from the finish() of the call before it, which may be deep in it
+    call.loop->queueInLoop(call.task);
+  }
+  else
+  {
+    call.task();
+  }
+  return true;
+}
+
+void RpcExecutor::finish(const google::protobuf::MethodDescriptor* method,
+                         Timestamp receiveTime,
+                         bool expired)
+{
+  Method* m = find(method);
+  if (!expired)
+  {
+    int64_t micros = Timestamp::now().microSecondsSinceEpoch() - receiveTime.microSecondsSinceEpoch();
+    m->latency.record(micros * 1000);
+  }
+  release(m, expired);
+}
+
+void RpcExecutor::release(Method* m, bool expired)
+{
+  while (true)
+  {
+    Call next;
+    {
+      MutexLockGuard lock(m->mutex);
+      --m->running;
+      if (expired)
+      {
+        ++m->expired;
+        expired = false;
+      }
+      if (m->queue.empty())
+      {
+        return;
+      }
+      next = m->queue.front();
+      m->queue.pop_front();
+      ++m->running;
+    }
+    if (start(m, next, true))
+    {
+      return;
+    }
+  }
+}
+
+string RpcExecutor::report() const
+{
+  LogStream s;
+  string result;
+  for (std::map<const google::protobuf::MethodDescriptor*, boost::shared_ptr<Method> >::const_iterator it
+         = methods_.begin();
+       it != methods_.end();
+       ++it)
+  {
+    Method* m = get_pointer(it->second);
+    s.resetBuffer();
+    s << m->name;
+    {
+      MutexLockGuard lock(m->mutex);
+      s << " running " << m->running
+        << " queued " << m->queue.size()
+        << " peak " << m->peakQueued
+        << " calls " << m->calls
+        << " rejected " << m->rejected
+        << " expired " << m->expired;
+    }
+    s << " latency " << m->latency.snapshot().toString() << "\n";
+    result += s.buffer().toString();
+  }
+  return result;
+}
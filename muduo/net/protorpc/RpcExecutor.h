@@ -0,0 +1,100 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_PROTORPC_RPCEXECUTOR_H
+#define MUDUO_NET_PROTORPC_RPCEXECUTOR_H
+
+#include <muduo/base/Timestamp.h>
+#include <muduo/base/Types.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <map>
+#include <string>
+
+namespace google {
+namespace protobuf {
+
+class MethodDescriptor;
+class ServiceDescriptor;
+
+}  // namespace protobuf
+}  // namespace google
+
+namespace muduo
+{
+
+class ThreadPool;
+
+namespace net
+{
+
+class EventLoop;
+
+/// Runs the calls of each method of RpcServer, in the IO thread of the
+/// connection or in a ThreadPool, at most maxRunning of them at once.
+/// Up to maxQueued more wait for one of them to finish, beyond that calls
+/// are rejected, as are those the ThreadPool has no room for.
+///
+/// Options are set before RpcServer::start(), the rest is thread safe.
+class RpcExecutor : boost::noncopyable
+{
+ public:
+  typedef boost::function<void ()> Task;
+
+  RpcExecutor();
+  ~RpcExecutor();
+
+  void addService(const ::google::protobuf::ServiceDescriptor* desc);
+
+  /// For methods without a pool of their own, NULL for the IO thread,
+  /// the default.
+  void setThreadPool(ThreadPool* pool)
+  { pool_ = pool; }
+
+  /// fullName is "package.Service.Method", pool is NULL for the IO thread,
+  /// maxRunning is 0 for no limit.
+  /// Returns false if there is no such method.
+  bool setMethodOptions(const std::string& fullName,
+                        ThreadPool* pool,
+                        int maxRunning,
+                        int maxQueued);
+
+  /// Runs task now, in pool or in the IO thread of loop later, or reject.
+  /// Every task must be followed by finish().
+  void submit(const ::google::protobuf::MethodDescriptor* method,
+              EventLoop* loop,
+              const Task& task,
+              const Task& reject);
+
+  /// The call received at receiveTime is done, or dropped if expired.
+  void finish(const ::google::protobuf::MethodDescriptor* method,
+              Timestamp receiveTime,
+              bool expired);
+
+  /// One line per method, with its latency from receiving to responding,
+  /// which is also at /perf/latency of Inspector as rpc.<fullName>.
+  string report() const;
+
+ private:
+  struct Method;
+  struct Call;
+
+  Method* find(const ::google::protobuf::MethodDescriptor* method) const;
+  // false if rejected
+  bool start(Method* m, const Call& call, bool queued);
+  void release(Method* m, bool expired);
+
+  ThreadPool* pool_;
+  // not modified after RpcServer::start()
+  std::map<const ::google::protobuf::MethodDescriptor*, boost::shared_ptr<Method> > methods_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_PROTORPC_RPCEXECUTOR_H
@@ -0,0 +1,230 @@
+#undef NDEBUG
+#include <muduo/net/protorpc/RpcExecutor.h>
+#include <muduo/net/protorpc/rpctest.pb.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/ThreadPool.h>
+#include <muduo/net/EventLoop.h>
+
+#include <boost/bind.hpp>
+
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// The calls of one method, run at once, queued, rejected or dropped.
+// Each task records its id when it runs, a rejected one its -id.
+
+namespace
+{
+
+const ::google::protobuf::MethodDescriptor* echo()
+{
+  return rpctest::TestService::descriptor()->method(0);
+}
+
+MutexLock g_mutex;
+std::vector<int> g_events;
+
+void record(int event)
+{
+  MutexLockGuard lock(g_mutex);
+  g_events.push_back(event);
+}
+
+std::vector<int> events()
+{
+  MutexLockGuard lock(g_mutex);
+  return g_events;
+}
+
+std::vector<int> expect(int a, int b = 0, int c = 0, int d = 0, int e = 0, int f = 0)
+{
+  int all[] = { a, b, c, d, e, f };
+  std::vector<int> result;
+  for (int i = 0; i < 6 && all[i] != 0; ++i)
+  {
+    result.push_back(all[i]);
+  }
+  return result;
+}
+
+void run(int id)
+{
+  record(id);
+}
+
+void reject(int id)
+{
+  record(-id);
+}
+
+// as RpcChannel does for a call past its deadline once its turn comes
+void runExpired(RpcExecutor* executor, int id)
+{
+  record(id);
+  executor->finish(echo(), Timestamp::now(), true);
+}
+
+// runs in the pool until latch is counted down
+void runBlocked(RpcExecutor* executor, int id, CountDownLatch* latch)
+{
+  record(id);
+  latch->wait();
+  executor->finish(echo(), Timestamp::now(), false);
+}
+
+void submit(RpcExecutor* executor, EventLoop* loop, int id)
+{
+  executor->submit(echo(), loop, boost::bind(run, id), boost::bind(reject, id));
+}
+
+void finish(RpcExecutor* executor)
+{
+  executor->finish(echo(), Timestamp::now(), false);
+}
+
+// the tasks queued in the loop are run
+void drain(EventLoop* loop)
+{
+  loop->runAfter(0.01, boost::bind(&EventLoop::quit, loop));
+  loop->loop();
+}
+
+bool reports(const RpcExecutor& executor, const char* counters)
+{
+  return executor.report().find(counters) != string::npos;
+}
+
+// without options, every call runs at once
+void testNoLimit(EventLoop* loop)
+{
+  g_events.clear();
+  RpcExecutor executor;
+  executor.addService(rpctest::TestService::descriptor());
+  for (int id = 1; id <= 3; ++id)
+  {
+    submit(&executor, loop, id);
+  }
+  assert(events() == expect(1, 2, 3));
+  assert(reports(executor, "running 3 queued 0 peak 0 calls 3 rejected 0"));
+  for (int i = 0; i < 3; ++i)
+  {
+    finish(&executor);
+  }
+  assert(reports(executor, "running 0 queued 0 peak 0 calls 3 rejected 0 expired 0"));
+}
+
+// maxRunning run, maxQueued wait in order, the rest are rejected
+void testQueue(EventLoop* loop)
+{
+  g_events.clear();
+  RpcExecutor executor;
+  executor.addService(rpctest::TestService::descriptor());
+  assert(executor.setMethodOptions("rpctest.TestService.Echo", NULL, 2, 3));
+  assert(!executor.setMethodOptions("rpctest.TestService.NoSuchMethod", NULL, 2, 3));
+  for (int id = 1; id <= 6; ++id)
+  {
+    submit(&executor, loop, id);
+  }
+  assert(events() == expect(1, 2, -6));
+  assert(reports(executor, "running 2 queued 3 peak 3 calls 6 rejected 1"));
+
+  // the next one runs from the loop, not from finish()
+  finish(&executor);
+  assert(events() == expect(1, 2, -6));
+  assert(reports(executor, "running 2 queued 2"));
+  drain(loop);
+  assert(events() == expect(1, 2, -6, 3));
+
+  finish(&executor);
+  finish(&executor);
+  assert(reports(executor, "running 2 queued 0"));
+  drain(loop);
+  assert(events() == expect(1, 2, -6, 3, 4, 5));
+
+  submit(&executor, loop, 7);
+  assert(reports(executor, "running 2 queued 1"));
+  for (int i = 0; i < 3; ++i)
+  {
+    finish(&executor);
+  }
+  drain(loop);
+  assert(events().back() == 7);
+  assert(reports(executor, "running 0 queued 0 peak 3 calls 7 rejected 1 expired 0"));
+}
+
+// a call dropped once its turn comes makes room for the next
+void testExpired(EventLoop* loop)
+{
+  g_events.clear();
+  RpcExecutor executor;
+  executor.addService(rpctest::TestService::descriptor());
+  assert(executor.setMethodOptions("rpctest.TestService.Echo", NULL, 1, 2));
+  submit(&executor, loop, 1);
+  executor.submit(echo(), loop, boost::bind(runExpired, &executor, 2), boost::bind(reject, 2));
+  submit(&executor, loop, 3);
+  assert(events() == expect(1));
+
+  finish(&executor);
+  drain(loop);
+  drain(loop);
+  assert(events() == expect(1, 2, 3));
+  assert(reports(executor, "running 1 queued 0 peak 2 calls 3 rejected 0 expired 1"));
+  finish(&executor);
+  assert(reports(executor, "running 0 queued 0 peak 2 calls 3 rejected 0 expired 1"));
+}
+
+// a call the pool has no room for is rejected, and leaves no trace
+void testPoolFull(EventLoop* loop)
+{
+  g_events.clear();
+  RpcExecutor executor;
+  executor.addService(rpctest::TestService::descriptor());
+  ThreadPool pool("RpcExecutorTest");
+  pool.setMaxQueueSize(1);
+  pool.start(1);
+  executor.setThreadPool(&pool);
+
+  CountDownLatch latch(1);
+  executor.submit(echo(), loop, boost::bind(runBlocked, &executor, 1, &latch),
+                  boost::bind(reject, 1));
+  while (events().empty())
+  {
+    usleep(1000);
+  }
+  // 2 waits in the pool, which has no room for 3
+  for (int id = 2; id <= 3; ++id)
+  {
+    executor.submit(echo(), loop, boost::bind(runBlocked, &executor, id, &latch),
+                    boost::bind(reject, id));
+  }
+  assert(events() == expect(1, -3));
+  assert(reports(executor, "running 2 queued 0 peak 0 calls 3 rejected 1"));
+
+  latch.countDown();
+  while (events().size() < 3)
+  {
+    usleep(1000);
+  }
+  pool.stop();
+  assert(events() == expect(1, -3, 2));
+  assert(reports(executor, "running 0 queued 0 peak 0 calls 3 rejected 1"));
+}
+
+}
+
+int main()
+{
+  EventLoop loop;
+  testNoLimit(&loop);
+  testQueue(&loop);
+  testExpired(&loop);
+  testPoolFull(&loop);
+  printf("all tests passed\n");
+}
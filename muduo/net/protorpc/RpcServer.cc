@@ -21,7 +21,10 @@ using namespace muduo::net;
 
 RpcServer::RpcServer(EventLoop* loop,
                      const InetAddress& listenAddr)
-  : server_(loop, listenAddr, "RpcServer")
+  : server_(loop, listenAddr, "RpcServer"),
+    batchWindow_(-1),
+    allowNoChecksum_(false),
+    arenaBlockSize_(RpcChannel::kDefaultArenaBlockSize)
 {
   server_.setConnectionCallback(
       boost::bind(&RpcServer::onConnection, this, _1));
@@ -33,6 +36,7 @@ void RpcServer::registerService(google::protobuf::Service* service)
 {
   const google::protobuf::ServiceDescriptor* desc = service->GetDescriptor();
   services_[desc->full_name()] = service;
+  executor_.addService(desc);
 }
 
 void RpcServer::start()
@@ -49,12 +53,26 @@ void RpcServer::onConnection(const TcpConnectionPtr& conn)
   {
     RpcChannelPtr channel(new RpcChannel(conn));
     channel->setServices(&services_);
+    channel->setExecutor(&executor_);
+    channel->setAllowNoChecksum(allowNoChecksum_);
+    channel->setArenaBlockSize(arenaBlockSize_);
+    if (batchWindow_ >= 0)
+    {
+      channel->enableBatching(batchWindow_);
+    }
     conn->setMessageCallback(
         boost::bind(&RpcChannel::onMessage, get_pointer(channel), _1, _2, _3));
     conn->setContext(channel);
   }
   else
   {
+    if (const RpcChannelPtr* channel = boost::any_cast<RpcChannelPtr>(&conn->getContext()))
+    {
+      if (*channel)
+      {
+        (*channel)->closeStreams();
+      }
+    }
     conn->setContext(RpcChannelPtr());
     // FIXME:
   }
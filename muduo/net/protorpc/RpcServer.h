@@ -12,6 +12,7 @@
 #define MUDUO_NET_PROTORPC_RPCSERVER_H
 
 #include <muduo/net/TcpServer.h>
+#include <muduo/net/protorpc/RpcExecutor.h>
 
 namespace google {
 namespace protobuf {
@@ -38,6 +39,49 @@ class RpcServer
   }
 
   void registerService(::google::protobuf::Service*);
+
+  /// Methods run in pool instead of the IO thread, pool must be started
+  /// and outlive the server. See RpcExecutor.
+  void setThreadPool(ThreadPool* pool)
+  {
+    executor_.setThreadPool(pool);
+  }
+
+  /// After registerService(), see RpcExecutor::setMethodOptions().
+  bool setMethodOptions(const std::string& fullMethodName,
+                        ThreadPool* pool,
+                        int maxRunning,
+                        int maxQueued)
+  {
+    return executor_.setMethodOptions(fullMethodName, pool, maxRunning, maxQueued);
+  }
+
+  /// See RpcChannel::enableBatching(), for the responses.
+  /// Call before start().
+  void enableBatching(double window = 0.0)
+  {
+    batchWindow_ = window;
+  }
+
+  /// See RpcChannel::setAllowNoChecksum(), clients on trusted links may
+  /// then send no checksum. Call before start().
+  void setAllowNoChecksum(bool on)
+  {
+    allowNoChecksum_ = on;
+  }
+
+  /// See RpcChannel::setArenaBlockSize(). Call before start().
+  void setArenaBlockSize(size_t bytes)
+  {
+    arenaBlockSize_ = bytes;
+  }
+
+  /// Calls and latency of each method, for Inspector::add().
+  string methodStats() const
+  {
+    return executor_.report();
+  }
+
   void start();
 
  private:
@@ -49,6 +93,10 @@ class RpcServer
 
   TcpServer server_;
   std::map<std::string, ::google::protobuf::Service*> services_;
+  RpcExecutor executor_;
+  double batchWindow_;  // negative for no batching
+  bool allowNoChecksum_;
+  size_t arenaBlockSize_;
 };
 
 }
@@ -0,0 +1,368 @@
+#undef NDEBUG
+#include <muduo/net/protorpc/RpcChannel.h>
+#include <muduo/net/protorpc/RpcServer.h>
+#include <muduo/net/protorpc/rpctest.pb.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/ThreadPool.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// RpcServer and the RpcChannel of a client over a real connection,
+// both in the loop of main().
+
+namespace
+{
+
+const uint16_t kPort = 18010;
+
+class EchoServiceImpl : public rpctest::TestService
+{
+ public:
+  EchoServiceImpl()
+    : sleepMicroSeconds(0)
+  {
+  }
+
+  virtual void Echo(::google::protobuf::RpcController* controller,
+                    const rpctest::TestMessage* request,
+                    rpctest::TestMessage* response,
+                    ::google::protobuf::Closure* done)
+  {
+    {
+      MutexLockGuard lock(mutex);
+      ids.push_back(request->id());
+    }
+    if (sleepMicroSeconds > 0)
+    {
+      ::usleep(sleepMicroSeconds);
+    }
+    response->CopyFrom(*request);
+    done->Run();
+  }
+
+  int sleepMicroSeconds;  // for each call, in a ThreadPool
+  MutexLock mutex;
+  std::vector<int64_t> ids;  // in the order of the requests
+};
+
+struct Call
+{
+  int64_t id;
+  RpcController controller;
+  rpctest::TestMessage* response;  // deleted by the channel once done is run
+};
+
+struct Result
+{
+  int64_t id;
+  ErrorCode error;
+  int64_t answer;  // id in the response, 0 if none
+};
+
+class Client : boost::noncopyable
+{
+ public:
+  Client(EventLoop* loop, const InetAddress& serverAddr)
+    : checksumType(ProtobufCodecLite::kAdler32),
+      callTimeout(0.0),
+      batchWindow(-1.0),
+      disconnectAfter(0.0),
+      firstResultDelay(-1.0),
+      loop_(loop),
+      client_(loop, serverAddr, "RpcServerTest"),
+      calls_(0),
+      connected_(false)
+  {
+    client_.setConnectionCallback(
+        boost::bind(&Client::onConnection, this, _1));
+    client_.setMessageCallback(
+        boost::bind(&Client::onMessage, this, _1, _2, _3));
+  }
+
+  // makes calls once connected, and quits the loop once they are done
+  // and the connection is closed
+  void run(int calls)
+  {
+    calls_ = calls;
+    client_.connect();
+    loop_->runAfter(10.0, boost::bind(&EventLoop::quit, loop_));
+    loop_->loop();
+  }
+
+  ProtobufCodecLite::ChecksumType checksumType;  // of the requests
+  double callTimeout;
+  double batchWindow;      // of the requests, negative for none
+  double disconnectAfter;  // seconds from connecting, 0 for once done
+
+  double firstResultDelay;  // seconds from connecting
+
+  std::vector<Result> results;
+  std::set<char> checksumTags;  // of the frames received
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    connected_ = conn->connected();
+    if (connected_)
+    {
+      channel_.reset(new RpcChannel(conn));
+      channel_->setChecksumType(checksumType);
+      channel_->setCallTimeout(callTimeout);
+      if (batchWindow >= 0)
+      {
+        channel_->enableBatching(batchWindow);
+      }
+      if (disconnectAfter > 0)
+      {
+        loop_->runAfter(disconnectAfter, boost::bind(&TcpClient::disconnect, &client_));
+      }
+      connectedAt_ = Timestamp::now();
+      stub_.reset(new rpctest::TestService::Stub(get_pointer(channel_)));
+      for (int64_t id = 1; id <= calls_; ++id)
+      {
+        rpctest::TestMessage request;
+        request.set_id(id);
+        request.set_payload("payload");
+        Call* call = new Call;
+        call->id = id;
+        call->response = new rpctest::TestMessage;
+        stub_->Echo(&call->controller, &request, call->response,
+                   ::google::protobuf::NewCallback(this, &Client::onResponse, call));
+      }
+    }
+    else
+    {
+      channel_->failOutstandingCalls(UNAVAILABLE);
+      // which holds the connection
+      stub_.reset();
+      channel_.reset();
+      quitIfDone();
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
+  {
+    // length, "RPC" and the tag of the checksum
+    if (buf->readableBytes() >= 8)
+    {
+      checksumTags.insert(buf->peek()[7]);
+    }
+    channel_->onMessage(conn, buf, receiveTime);
+  }
+
+  void onResponse(Call* call)
+  {
+    Result result = { call->id, call->controller.errorCode(), call->response->id() };
+    results.push_back(result);
+    if (results.size() == 1)
+    {
+      firstResultDelay = timeDifference(Timestamp::now(), connectedAt_);
+    }
+    delete call;
+    if (results.size() == static_cast<size_t>(calls_))
+    {
+      client_.disconnect();
+    }
+    quitIfDone();
+  }
+
+  void quitIfDone()
+  {
+    if (!connected_ && results.size() == static_cast<size_t>(calls_))
+    {
+      // lets the connections be destroyed
+      loop_->runAfter(0.05, boost::bind(&EventLoop::quit, loop_));
+    }
+  }
+
+  EventLoop* loop_;
+  TcpClient client_;
+  RpcChannelPtr channel_;  // while connected
+  boost::scoped_ptr<rpctest::TestService::Stub> stub_;
+  int calls_;
+  bool connected_;
+  Timestamp connectedAt_;
+};
+
+// the server answers with the checksum of the requests
+void testChecksum(ProtobufCodecLite::ChecksumType type, char tag, bool serverAllowsNone)
+{
+  EventLoop loop;
+  RpcServer server(&loop, InetAddress(kPort));
+  EchoServiceImpl service;
+  server.registerService(&service);
+  server.setAllowNoChecksum(serverAllowsNone);
+  server.start();
+
+  const int kCalls = 10;
+  Client client(&loop, InetAddress("127.0.0.1", kPort));
+  client.checksumType = type;
+  client.run(kCalls);
+
+  assert(client.results.size() == kCalls);
+  if (type == ProtobufCodecLite::kNoChecksum && !serverAllowsNone)
+  {
+    // the server closes the connection
+    for (int i = 0; i < kCalls; ++i)
+    {
+      assert(client.results[i].error == UNAVAILABLE);
+    }
+    assert(client.checksumTags.empty());
+    return;
+  }
+  for (int i = 0; i < kCalls; ++i)
+  {
+    assert(client.results[i].error == NO_ERROR);
+    assert(client.results[i].answer == client.results[i].id);
+  }
+  assert(client.checksumTags.size() == 1);
+  assert(*client.checksumTags.begin() == tag);
+}
+
+// calls beyond maxRunning wait, beyond maxQueued are overloaded,
+// and those past their deadline once their turn comes are dropped
+void testOverloadedAndExpired()
+{
+  // outlives the server
+  ThreadPool pool("RpcServerTest");
+  pool.start(1);
+  EventLoop loop;
+  RpcServer server(&loop, InetAddress(kPort));
+  EchoServiceImpl service;
+  service.sleepMicroSeconds = 400 * 1000;
+  server.registerService(&service);
+  bool ok = server.setMethodOptions("rpctest.TestService.Echo", &pool, 1, 2);
+  assert(ok); (void)ok;
+  server.start();
+
+  const int kCalls = 5;
+  Client client(&loop, InetAddress("127.0.0.1", kPort));
+  // 2 starts at 0.4s, 3 at 0.8s
+  client.callTimeout = 0.6;
+  client.run(kCalls);
+  // lets 3 have its turn
+  loop.runAfter(0.5, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  assert(client.results.size() == kCalls);
+  ErrorCode errors[kCalls + 1];
+  for (int i = 0; i < kCalls; ++i)
+  {
+    const Result& result = client.results[i];
+    errors[result.id] = result.error;
+    assert(result.answer == (result.error == NO_ERROR ? result.id : 0));
+  }
+  assert(errors[1] == NO_ERROR);
+  assert(errors[2] == TIMEOUT);
+  assert(errors[3] == TIMEOUT);
+  assert(errors[4] == OVERLOADED);
+  assert(errors[5] == OVERLOADED);
+  {
+    MutexLockGuard lock(service.mutex);
+    assert(service.ids.size() == 2);
+    assert(service.ids[0] == 1 && service.ids[1] == 2);
+  }
+  assert(server.methodStats().find("calls 5 rejected 2 expired 1") != string::npos);
+}
+
+// frames written together, once the loop is done with the calls or
+// after a window, in the order of the calls
+void testBatching(double clientWindow, double serverWindow)
+{
+  EventLoop loop;
+  RpcServer server(&loop, InetAddress(kPort));
+  EchoServiceImpl service;
+  server.registerService(&service);
+  if (serverWindow >= 0)
+  {
+    server.enableBatching(serverWindow);
+  }
+  server.start();
+
+  const int kCalls = 100;
+  Client client(&loop, InetAddress("127.0.0.1", kPort));
+  client.batchWindow = clientWindow;
+  client.run(kCalls);
+
+  assert(client.results.size() == kCalls);
+  assert(service.ids.size() == kCalls);
+  for (int i = 0; i < kCalls; ++i)
+  {
+    assert(service.ids[i] == i + 1);
+    assert(client.results[i].id == i + 1);
+    assert(client.results[i].error == NO_ERROR);
+    assert(client.results[i].answer == i + 1);
+  }
+  // neither batch is flushed before its window
+  double windows = std::max(clientWindow, 0.0) + std::max(serverWindow, 0.0);
+  assert(client.firstResultDelay >= windows);
+}
+
+// the connection is lost while the requests, or the responses, wait
+// for the window to end
+void testBatchCutOff(bool requests)
+{
+  EventLoop loop;
+  RpcServer server(&loop, InetAddress(kPort));
+  EchoServiceImpl service;
+  server.registerService(&service);
+  if (!requests)
+  {
+    server.enableBatching(0.3);
+  }
+  server.start();
+
+  const int kCalls = 10;
+  Client client(&loop, InetAddress("127.0.0.1", kPort));
+  if (requests)
+  {
+    client.batchWindow = 0.3;
+  }
+  client.disconnectAfter = 0.1;
+  client.run(kCalls);
+  // the flush after the window writes to the closed connection
+  loop.runAfter(0.4, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  assert(client.results.size() == kCalls);
+  for (int i = 0; i < kCalls; ++i)
+  {
+    assert(client.results[i].error == UNAVAILABLE);
+  }
+  assert(service.ids.size() == (requests ? 0u : static_cast<size_t>(kCalls)));
+}
+
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  testChecksum(ProtobufCodecLite::kAdler32, '0', false);
+  testChecksum(ProtobufCodecLite::kCrc32c, 'C', false);
+  testChecksum(ProtobufCodecLite::kNoChecksum, 'N', true);
+  testChecksum(ProtobufCodecLite::kNoChecksum, 'N', false);
+  testOverloadedAndExpired();
+  testBatching(0.0, -1.0);
+  testBatching(-1.0, 0.0);
+  testBatching(0.1, 0.1);
+  testBatchCutOff(true);
+  testBatchCutOff(false);
+  printf("all tests passed\n");
+}